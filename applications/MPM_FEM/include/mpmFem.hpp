@@ -1,4 +1,7 @@
 
+#include "ParticleArrays.hpp"
+#include "ThreadedParticleLoop.hpp"
+
 using namespace femus;
 
 double beta = 0.25;
@@ -62,13 +65,9 @@ void AssembleMPMSys(MultiLevelProblem& ml_prob) {
   vector< vector< double > > SolVdOld(dim);
   vector< vector< double > > SolAdOld(dim);
 
-  vector< vector< int > > dofsVAR(dim);
-
   vector< vector< double > > Rhs(dim);     // local redidual vector
   vector< vector< adept::adouble > > aRhs(dim);     // local redidual vector
 
-  vector < int > dofsAll;
-
   vector < double > Jac;
 
   adept::adouble weight;
@@ -122,11 +121,6 @@ void AssembleMPMSys(MultiLevelProblem& ml_prob) {
 
   if(assembleMatrix) myKK->zero();
 
-  //line instances
-  std::vector<unsigned> markerOffset = linea->GetMarkerOffset();
-  unsigned markerOffset1 = markerOffset[iproc];
-  unsigned markerOffset2 = markerOffset[iproc + 1];
-  std::vector<Marker*> particles = linea->GetParticles();
   //std::map<unsigned, std::vector < std::vector < std::vector < std::vector < double > > > > > aX;
 
   //BEGIN loop on elements (to initialize the "soft" stiffness matrix)
@@ -358,134 +352,118 @@ void AssembleMPMSys(MultiLevelProblem& ml_prob) {
   //END building "soft" stiffness matrix
 
 
-  //initialization of iel
-  unsigned ielOld = UINT_MAX;
+  //BEGIN loop on particles (used as Gauss points), element by element
+  ParticleArrays particles;
+  linea->GetLocalParticles(particles);
 
-  //BEGIN loop on particles (used as Gauss points)
-  for(unsigned iMarker = markerOffset1; iMarker < markerOffset2; iMarker++) {
-
-    //element of particle iMarker
-    unsigned iel = particles[iMarker]->GetMarkerElement();
-    if(iel != UINT_MAX) {
-      short unsigned ielt;
-      unsigned nDofsD;
-      
-      //BEGIN considering traction
-      
-      double traction[3] = {0., 0., 0.};
-      double boundaryLayer = 0.0542;
-      
-      //END
-      
-      
-      //update element related quantities only if we are in a different element
-      if(iel != ielOld) {
+  auto assembleParticleBin = [&](const unsigned & ib, const unsigned & ithread) {
 
-        ielt = mymsh->GetElementType(iel);
-        nDofsD = mymsh->GetElementDofNumber(iel, solType);
-        //initialization of everything is in common fluid and solid
+    adept::Stack& st = FemusInit::GetAdeptStack(ithread);
+    if(assembleMatrix) st.continue_recording();
+    else st.pause_recording();
 
-        //Rhs
-        for(int i = 0; i < dim; i++) {
-          dofsVAR[i].resize(nDofsD);
-          SolDd[indexPdeD[i]].resize(nDofsD);
-	  SolDdOld[indexPdeD[i]].resize(nDofsD);
-          aRhs[indexPdeD[i]].resize(nDofsD);
-          vx[i].resize(nDofsD);
-          vx_hat[i].resize(nDofsD);
-        }
-        dofsAll.resize(0);
+    unsigned iel = particles.GetBinElement(ib);
+    short unsigned ielt = mymsh->GetElementType(iel);
+    unsigned nDofsD = mymsh->GetElementDofNumber(iel, solType);
+
+    vector < double > phi;
+    vector < double > phi_hat;
+    vector < adept::adouble> gradphi;
+    vector < double > gradphi_hat;
+    vector <vector < adept::adouble> > vx(dim);
+    vector <vector < double> > vx_hat(dim);
+    vector< vector< adept::adouble > > SolDd(dim);
+    vector< vector< double > > SolDdOld(dim);
+    vector< vector< int > > dofsVAR(dim);
+    vector< vector< adept::adouble > > aRhs(dim);
+    vector< vector< double > > Rhs(dim);
+    vector < int > dofsAll;
+    vector < double > Jac;
+    vector < double > xi(dim);
+    adept::adouble weight;
+    double weight_hat;
+
+    for(int i = 0; i < dim; i++) {
+      dofsVAR[i].resize(nDofsD);
+      SolDd[indexPdeD[i]].resize(nDofsD);
+      SolDdOld[indexPdeD[i]].resize(nDofsD);
+      aRhs[indexPdeD[i]].resize(nDofsD);
+      vx[i].resize(nDofsD);
+      vx_hat[i].resize(nDofsD);
+    }
 
+    //BEGIN copy of the value of Sol at the dofs idof of the element iel
+    const int *solLocalDofs = mymsh->GetElementSolutionLocalDofs(iel, solType); //local 2 local array solution
+    const int *xLocalDofs = mymsh->GetElementSolutionLocalDofs(iel, 2); //local 2 local array coordinates
+    vector < double > solD(nDofsD);
 
-        //BEGIN copy of the value of Sol at the dofs idof of the element iel
-        for(unsigned i = 0; i < nDofsD; i++) {
-          unsigned idof = mymsh->GetSolutionDof(i, iel, solType); //local 2 global solution
-          unsigned idofX = mymsh->GetSolutionDof(i, iel, 2); //local 2 global coordinates
+    for(int j = 0; j < dim; j++) {
+      const unsigned *sysDofs = myLinEqSolver->GetSystemDofs(indexPdeD[j], iel); //local 2 global Pde
 
-	  if( mymsh->GetSolidMark(idof) ) traction[0] = gravity[0];
-	  
-	  
-          for(int j = 0; j < dim; j++) {
-	    SolDdOld[indexPdeD[j]][i] = (*mysolution->_SolOld[indexSolD[j]])(idof);
-            SolDd[indexPdeD[j]][i] = (*mysolution->_Sol[indexSolD[j]])(idof) - SolDdOld[indexPdeD[j]][i];
-	   
-            dofsVAR[j][i] = myLinEqSolver->GetSystemDof(indexSolD[j], indexPdeD[j], i, iel); //local 2 global Pde
-            aRhs[indexPdeD[j]][i] = 0.;
-
-            //Fixed coordinates (Reference frame)
-            vx_hat[j][i] = (*mymsh->_topology->_Sol[j])(idofX) + SolDdOld[indexPdeD[j]][i];
-            vx[j][i]    = vx_hat[j][i] + SolDd[indexPdeD[j]][i];
-          }
-        }
-        //END
+      mysolution->_SolOld[indexSolD[j]]->get_local(solLocalDofs, nDofsD, &SolDdOld[indexPdeD[j]][0]);
+      mysolution->_Sol[indexSolD[j]]->get_local(solLocalDofs, nDofsD, &solD[0]);
+      mymsh->_topology->_Sol[j]->get_local(xLocalDofs, nDofsD, &vx_hat[j][0]);
 
-        // build dof composition
-        for(int idim = 0; idim < dim; idim++) {
-          dofsAll.insert(dofsAll.end(), dofsVAR[idim].begin(), dofsVAR[idim].end());
-        }
+      for(unsigned i = 0; i < nDofsD; i++) {
+        SolDd[indexPdeD[j]][i] = solD[i] - SolDdOld[indexPdeD[j]][i];
 
-        if(assembleMatrix) s.new_recording();
+        dofsVAR[j][i] = sysDofs[i];
+        aRhs[indexPdeD[j]][i] = 0.;
 
-        // start a new recording of all the operations involving adept::adouble variables
+        //Fixed coordinates (Reference frame)
+        vx_hat[j][i] += SolDdOld[indexPdeD[j]][i];
+        vx[j][i]    = vx_hat[j][i] + SolDd[indexPdeD[j]][i];
       }
+    }
+    //END
 
-      //bool elementUpdate = (aX.find(iel) != aX.end()) ? false : true;  //TODO to be removed after we include FindLocalCoordinates in the advection
-      //particles[iMarker]->FindLocalCoordinates(solType, aX[iel], elementUpdate, mysolution, 0);
+    // build dof composition
+    for(int idim = 0; idim < dim; idim++) {
+      dofsAll.insert(dofsAll.end(), dofsVAR[idim].begin(), dofsVAR[idim].end());
+    }
 
-      // the local coordinates of the particles are the Gauss points in this context
-      std::vector <double> xi = particles[iMarker]->GetMarkerLocalCoordinates();
+    // start a new recording of all the operations involving adept::adouble variables
+    if(assembleMatrix) st.new_recording();
 
-//       if(iMarker < 3){
-// 	std::cout << iel <<" "<< iMarker << " " << xi[0] << " " << xi[1] <<std::endl;
-//       }
+    for(unsigned ip = particles.GetBinBegin(ib); ip < particles.GetBinEnd(ib); ip++) {
+
+      // the local coordinates of the particles are the Gauss points in this context
+      xi.assign(particles.GetLocalCoordinates(ip), particles.GetLocalCoordinates(ip) + dim);
 
       mymsh->_finiteElement[ielt][solType]->Jacobian(vx, xi, weight, phi, gradphi); //function to evaluate at the particles
       mymsh->_finiteElement[ielt][solType]->Jacobian(vx_hat, xi, weight_hat, phi_hat, gradphi_hat);
 
-
       // displacement and velocity
-      //BEGIN evaluates SolDp at the particle iMarker
-      vector<adept::adouble> SolDp(dim,0.);
-      vector<double> SolDpOld(dim,0.);
+      //BEGIN evaluates SolDp at the particle ip
+      vector<adept::adouble> SolDp(dim, 0.);
       vector<vector < adept::adouble > > GradSolDp(dim);
       vector<vector < adept::adouble > > GradSolDpHat(dim);
-      vector < vector < adept::adouble > > LocalFp(dim);
 
-      vector<double> Xp(dim,0.);
-      
+      vector<double> Xp(dim, 0.);
+
       for(int i = 0; i < dim; i++) {
-        GradSolDp[i].resize(dim);
-        std::fill(GradSolDp[i].begin(), GradSolDp[i].end(), 0);
-        GradSolDpHat[i].resize(dim);
-        std::fill(GradSolDpHat[i].begin(), GradSolDpHat[i].end(), 0);
+        GradSolDp[i].assign(dim, 0.);
+        GradSolDpHat[i].assign(dim, 0.);
       }
 
       for(int i = 0; i < dim; i++) {
         for(unsigned inode = 0; inode < nDofsD; inode++) {
-	  Xp[i] +=  phi[inode] * phi_hat[inode];
+          Xp[i] +=  phi[inode] * phi_hat[inode];
           SolDp[i] += phi[inode] * SolDd[indexPdeD[i]][inode];
-	  //SolDpOld[i] += phi[inode] * SolDdOld[indexPdeD[i]][inode];
           for(int j = 0; j < dim; j++) {
             GradSolDp[i][j] +=  gradphi[inode * dim + j] * SolDd[indexPdeD[i]][inode];
-//             GradSolDpHat[i][j] +=  gradphi_hat[inode * dim + j] * 0.5 * SolDd[indexPdeD[i]][inode];
-            GradSolDpHat[i][j] +=  gradphi_hat[inode * dim + j] * (SolDd[indexPdeD[i]][inode] - 0. * SolDdOld[indexPdeD[i]][inode]);
+            GradSolDpHat[i][j] +=  gradphi_hat[inode * dim + j] * SolDd[indexPdeD[i]][inode];
           }
         }
       }
-      //END evaluates SolDp at the particle iMarker
-
-      std::vector <double> SolVpOld(dim);
-      particles[iMarker]->GetMarkerVelocity(SolVpOld);
+      //END evaluates SolDp at the particle ip
 
-
-      std::vector <double> SolApOld(dim);
-      particles[iMarker]->GetMarkerAcceleration(SolApOld);
-
-      double mass = particles[iMarker]->GetMarkerMass();
+      const double *SolVpOld = particles.GetMPMQuantities(ip) + dim;
+      const double *SolApOld = particles.GetMPMQuantities(ip) + 2 * dim;
+      double mass = particles.GetMass(ip);
 
       //BEGIN computation of the Cauchy Stress
-      std::vector < std::vector < double > > FpOld;
-      FpOld = particles[iMarker]->GetDeformationGradient(); //extraction of the deformation gradient
+      const double *FpOld = particles.GetDeformationGradient(ip); //extraction of the deformation gradient
 
       adept::adouble FpNew[3][3] = {{1., 0., 0.}, {0., 1., 0.}, {0., 0., 1.}};
       adept::adouble F[3][3] = {{0., 0., 0.}, {0., 0., 0.}, {0., 0., 0.}};
@@ -502,7 +480,7 @@ void AssembleMPMSys(MultiLevelProblem& ml_prob) {
       for(int i = 0; i < dim; i++) {
         for(int j = 0; j < dim; j++) {
           for(int k = 0; k < dim; k++) {
-            F[i][j] += FpNew[i][k] * FpOld[k][j];
+            F[i][j] += FpNew[i][k] * FpOld[k * dim + j];
           }
         }
       }
@@ -523,19 +501,12 @@ void AssembleMPMSys(MultiLevelProblem& ml_prob) {
         }
       }
 
-      adept::adouble I1_B = B[0][0] + B[1][1] + B[2][2];
-      
-      double mu = (Xp[1] > -1.1416) ? mu_MPM: mu_MPM; 
-      double lambda = (Xp[1] > -1.1416) ? lambda_MPM: lambda_MPM; 
+      double mu = (Xp[1] > -1.1416) ? mu_MPM : mu_MPM;
+      double lambda = (Xp[1] > -1.1416) ? lambda_MPM : lambda_MPM;
 
       for(int i = 0; i < 3; i++) {
         for(int j = 0; j < 3; j++) {
-          //Cauchy[i][j] = mu_MPM * (B[i][j] - I1_B * Id2th[i][j] / 3.) / pow(J_hat, 5. / 3.)
-            //             + K_MPM * (J_hat - 1.) * Id2th[i][j];  //Generalized Neo-Hookean solid, in Allan-Bower's book, for rubbers with very limited compressibility and K >> mu
-
-	  Cauchy[i][j] = lambda * log(J_hat) / J_hat * Id2th[i][j] + mu / J_hat * (B[i][j] - Id2th[i][j]); //alternative formulation
-
-
+          Cauchy[i][j] = lambda * log(J_hat) / J_hat * Id2th[i][j] + mu / J_hat * (B[i][j] - Id2th[i][j]); //alternative formulation
         }
       }
       //END computation of the Cauchy Stress
@@ -551,54 +522,53 @@ void AssembleMPMSys(MultiLevelProblem& ml_prob) {
         }
 
         for(int idim = 0; idim < dim; idim++) {
-          aRhs[indexPdeD[idim]][i] += (phi[i] * gravity[idim] - J_hat * CauchyDIR[idim] / density_MPM /*+ phi[i] * 1. / (boundaryLayer * 3. * density_MPM) * traction[idim]*/ //                                  
-//                                        -  phi[i] * (1. / (beta * dt * dt) * (SolDp[idim]-SolDpOld[idim]) - 1. / (beta * dt) * SolVpOld[idim] - (1. - 2.* beta) / (2. * beta) * SolApOld[idim])
-					-  phi[i] * (1. / (beta * dt * dt) * SolDp[idim] - 1. / (beta * dt) * SolVpOld[idim] - (1. - 2.* beta) / (2. * beta) * SolApOld[idim])
-	  ) * mass;
+          aRhs[indexPdeD[idim]][i] += (phi[i] * gravity[idim] - J_hat * CauchyDIR[idim] / density_MPM
+                                       -  phi[i] * (1. / (beta * dt * dt) * SolDp[idim] - 1. / (beta * dt) * SolVpOld[idim] - (1. - 2.* beta) / (2. * beta) * SolApOld[idim])
+                                      ) * mass;
         }
       }
       //END redidual Solid Momentum in moving domain
+    }
 
+    //BEGIN local to global assembly
+    //copy adouble aRhs into double Rhs
+    for(unsigned i = 0; i < dim; i++) {
+      Rhs[indexPdeD[i]].resize(nDofsD);
 
-      if(iMarker == markerOffset2 - 1 || iel != particles[iMarker + 1]->GetMarkerElement()) {
-
-        //copy adouble aRhs into double Rhs
-        for(unsigned i = 0; i < dim; i++) {
-          Rhs[indexPdeD[i]].resize(nDofsD);
-
-          for(int j = 0; j < nDofsD; j++) {
-            Rhs[indexPdeD[i]][j] = -aRhs[indexPdeD[i]][j].value();
-          }
-        }
-
-        for(int i = 0; i < dim; i++) {
-          myRES->add_vector_blocked(Rhs[indexPdeD[i]], dofsVAR[i]);
-        }
+      for(int j = 0; j < nDofsD; j++) {
+        Rhs[indexPdeD[i]][j] = -aRhs[indexPdeD[i]][j].value();
+      }
+    }
 
-        if(assembleMatrix) {
-          //Store equations
-          for(int i = 0; i < dim; i++) {
-            s.dependent(&aRhs[indexPdeD[i]][0], nDofsD);
-            s.independent(&SolDd[indexPdeD[i]][0], nDofsD);
-          }
+    for(int i = 0; i < dim; i++) {
+      myRES->add_vector_blocked(Rhs[indexPdeD[i]], dofsVAR[i]);
+    }
 
-          Jac.resize((dim * nDofsD) * (dim * nDofsD));
+    if(assembleMatrix) {
+      //Store equations
+      for(int i = 0; i < dim; i++) {
+        st.dependent(&aRhs[indexPdeD[i]][0], nDofsD);
+        st.independent(&SolDd[indexPdeD[i]][0], nDofsD);
+      }
 
-          s.jacobian(&Jac[0], true);
+      Jac.resize((dim * nDofsD) * (dim * nDofsD));
 
-          myKK->add_matrix_blocked(Jac, dofsAll, dofsAll);
-          s.clear_independents();
-          s.clear_dependents();
-        }
-      }
-      //END local to global assembly
+      st.jacobian(&Jac[0], true);
 
-      ielOld = iel;
-    }
-    else {
-      break;
+      myKK->add_matrix_blocked(Jac, dofsAll, dofsAll);
+      st.clear_independents();
+      st.clear_dependents();
     }
+    //END local to global assembly
+  };
+
+  // the vectors read by the kernel, their local arrays are acquired before the threads start
+  vector < NumericVector* > inputVectors;
+  for(unsigned i = 0; i < dim; i++) {
+    inputVectors.push_back(mysolution->_Sol[indexSolD[i]]);
+    inputVectors.push_back(mysolution->_SolOld[indexSolD[i]]);
   }
+  ThreadedParticleLoop(mymsh, inputVectors, particles, assembleParticleBin);
   //END loop on particles
 
   myRES->close();
@@ -644,23 +614,6 @@ void GridToParticlesProjection(MultiLevelProblem & ml_prob, Line & linea) {
   // data
   unsigned iproc  = mymsh->processor_id();
 
-  // local objects
-  vector< vector < double > > SolDd(dim);
-  vector< vector < double > > SolDdOld(dim);
-  vector< vector < double > > GradSolDp(dim);
-
-  for(int i = 0; i < dim; i++) {
-    GradSolDp[i].resize(dim);
-  }
-
-  vector < double > phi_hat;
-  vector < double > gradphi_hat;
-  vector < double > nablaphi_hat;
-
-  vector <vector < double> > vx_hat(dim); //vx is coordX in assembly of ex30
-
-  double weight;
-
   //variable-name handling
   const char varname[9][3] = {"DX", "DY", "DZ", "VX", "VY", "VW", "AX", "AY", "AW"};
   vector <unsigned> indexSolD(dim);
@@ -676,139 +629,115 @@ void GridToParticlesProjection(MultiLevelProblem & ml_prob, Line & linea) {
     }
   }
 
-  //line instances
-  std::vector<unsigned> markerOffset = linea.GetMarkerOffset();
-  unsigned markerOffset1 = markerOffset[iproc];
-  unsigned markerOffset2 = markerOffset[iproc + 1];
-  std::vector<Marker*> particles = linea.GetParticles();
-  //std::map<unsigned, std::vector < std::vector < std::vector < std::vector < double > > > > > aX;
-
-  //initialization of iel
-  unsigned ielOld = UINT_MAX;
-  //declaration of element instances
+  //BEGIN loop on particles, element by element
+  ParticleArrays particles;
+  linea.GetLocalParticles(particles);
 
-  //BEGIN loop on particles
-  for(unsigned iMarker = markerOffset1; iMarker < markerOffset2; iMarker++) {
-
-    //element of particle iMarker
-    unsigned iel = particles[iMarker]->GetMarkerElement();
+  auto projectParticleBin = [&](const unsigned & ib, const unsigned & ithread) {
 
+    unsigned iel = particles.GetBinElement(ib);
+    short unsigned ielt = mymsh->GetElementType(iel);
+    unsigned nve = mymsh->GetElementDofNumber(iel, solType);
+
+    // local objects
+    vector< vector < double > > SolDd(dim);
+    vector< vector < double > > SolDdOld(dim);
+    vector <vector < double> > vx_hat(dim); //vx is coordX in assembly of ex30
+    vector < double > phi_hat;
+    vector < double > gradphi_hat;
+    vector < double > nablaphi_hat;
+    vector < double > xi(dim);
+    double weight;
+
+    for(int i = 0; i < dim; i++) {
+      SolDd[i].resize(nve);
+      SolDdOld[i].resize(nve);
+      vx_hat[i].resize(nve);
+    }
 
-    if(iel != UINT_MAX) {
+    //BEGIN copy of the value of Sol at the dofs idof of the element iel
+    const int *solLocalDofs = mymsh->GetElementSolutionLocalDofs(iel, solType); //local 2 local array solution
+    const int *xLocalDofs = mymsh->GetElementSolutionLocalDofs(iel, 2); //local 2 local array coordinates
 
-      short unsigned ielt;
-      unsigned nve;
+    for(int i = 0; i < dim; i++) {
+      mysolution->_SolOld[indexSolD[i]]->get_local(solLocalDofs, nve, &SolDdOld[i][0]);
+      mysolution->_Sol[indexSolD[i]]->get_local(solLocalDofs, nve, &SolDd[i][0]);
+      mymsh->_topology->_Sol[i]->get_local(xLocalDofs, nve, &vx_hat[i][0]);
 
-      //update element related quantities only if we are in a different element
-      if(iel != ielOld) {
+      for(unsigned inode = 0; inode < nve; inode++) {
+        SolDd[i][inode] -= SolDdOld[i][inode];
 
-        ielt = mymsh->GetElementType(iel);
-        nve = mymsh->GetElementDofNumber(iel, solType);
+        //moving domain
+        vx_hat[i][inode] += SolDdOld[i][inode];
+      }
+    }
+    //END
 
-        for(int i = 0; i < dim; i++) {
-          SolDd[i].resize(nve);
-	  SolDdOld[i].resize(nve);
-          vx_hat[i].resize(nve);
-        }
+    for(unsigned ip = particles.GetBinBegin(ib); ip < particles.GetBinEnd(ib); ip++) {
 
-        //BEGIN copy of the value of Sol at the dofs idof of the element iel
-        for(unsigned inode = 0; inode < nve; inode++) {
-          unsigned idof = mymsh->GetSolutionDof(inode, iel, solType); //local 2 global solution
-          unsigned idofX = mymsh->GetSolutionDof(inode, iel, 2); //local 2 global solution
-
-          for(int i = 0; i < dim; i++) {
-	    SolDdOld[i][inode] = (*mysolution->_SolOld[indexSolD[i]])(idof);
-            SolDd[i][inode] = (*mysolution->_Sol[indexSolD[i]])(idof) - SolDdOld[i][inode];
-	    
-            //moving domain
-            vx_hat[i][inode] = (*mymsh->_topology->_Sol[i])(idofX) + SolDdOld[i][inode];
-          }
-        }
-        //END
-      }
-      std::vector <double> xi = particles[iMarker]->GetMarkerLocalCoordinates();
-      
-      //bool elementUpdate = (aX.find(iel) != aX.end()) ? false : true;  //TODO to be removed after we include FindLocalCoordinates in the advection
-      //particles[iMarker]->FindLocalCoordinates(solType, aX[iel], elementUpdate, mysolution, 0);
-      // xi = particles[iMarker]->GetMarkerLocalCoordinates();
+      xi.assign(particles.GetLocalCoordinates(ip), particles.GetLocalCoordinates(ip) + dim);
 
       mymsh->_finiteElement[ielt][solType]->Jacobian(vx_hat, xi, weight, phi_hat, gradphi_hat, nablaphi_hat); //function to evaluate at the particles
 
-      std::vector <double> particleDisp(dim, 0.);
-      //std::vector <double> particleDispNew(dim, 0.);
-      //update displacement and acceleration
+      //update displacement, coordinates, velocity and acceleration
+      double *particleDisp = particles.GetDisplacement(ip);
+      double *particleX = particles.GetCoordinates(ip);
+      double *particleVel = particles.GetVelocity(ip);
+      double *particleAcc = particles.GetAcceleration(ip);
+
       for(int i = 0; i < dim; i++) {
+        particleDisp[i] = 0.;
         for(unsigned inode = 0; inode < nve; inode++) {
-	  //std::cout << SolDd[i][inode] << " ";
           particleDisp[i] += phi_hat[inode] * SolDd[i][inode];
-	  //particleDispNew[i] += phi_hat[inode] * SolDd[i][inode];
-	  //std::cout<<std::endl;
         }
-        //std::cout << particleDisp[i] <<std::endl;
+        particleX[i] += particleDisp[i];
       }
-      
-
-      particles[iMarker]->SetMarkerDisplacement(particleDisp);
-      particles[iMarker]->UpdateParticleCoordinates();
-
-
-      std::vector <double> particleVelOld(dim);
-      particles[iMarker]->GetMarkerVelocity(particleVelOld);
 
-      std::vector <double> particleAccOld(dim);
-      particles[iMarker]->GetMarkerAcceleration(particleAccOld);
-
-      std::vector <double> particleAcc(dim);
-      std::vector <double> particleVel(dim);
       for(unsigned i = 0; i < dim; i++) {
-        particleAcc[i] = 1. / (beta * dt * dt) * particleDisp[i] - 1. / (beta * dt) * particleVelOld[i] - (1. - 2.* beta) / (2. * beta) * particleAccOld[i];
-        //particleVel[i] = 2. / dt * particleDisp[i] - particleVelOld[i];
-        particleVel[i] = particleVelOld[i] + dt * ((1. - Gamma) * particleAccOld[i] + Gamma * particleAcc[i]);
+        double particleVelOld = particleVel[i];
+        double particleAccOld = particleAcc[i];
+        particleAcc[i] = 1. / (beta * dt * dt) * particleDisp[i] - 1. / (beta * dt) * particleVelOld - (1. - 2.* beta) / (2. * beta) * particleAccOld;
+        particleVel[i] = particleVelOld + dt * ((1. - Gamma) * particleAccOld + Gamma * particleAcc[i]);
       }
 
-      particles[iMarker]->SetMarkerVelocity(particleVel);
-      particles[iMarker]->SetMarkerAcceleration(particleAcc);
-
       //   update the deformation gradient
+      double FpNew[3][3] = {{1., 0., 0.}, {0., 1., 0.}, {0., 0., 1.}};
       for(int i = 0; i < dim; i++) {
         for(int j = 0; j < dim; j++) {
-          GradSolDp[i][j] = 0.;
           for(unsigned inode = 0; inode < nve; inode++) {
-            GradSolDp[i][j] +=  gradphi_hat[inode * dim + j] * SolDd[i][inode];
+            FpNew[i][j] +=  gradphi_hat[inode * dim + j] * SolDd[i][inode];
           }
         }
       }
 
-      std::vector < std::vector < double > > FpOld;
-      FpOld = particles[iMarker]->GetDeformationGradient(); //extraction of the deformation gradient
-
-      double FpNew[3][3] = {{1., 0., 0.}, {0., 1., 0.}, {0., 0., 1.}};
-      std::vector < std::vector < double > > Fp(dim);
-
+      double *Fp = particles.GetDeformationGradient(ip);
+      double FpOld[3][3];
       for(unsigned i = 0; i < dim; i++) {
         for(unsigned j = 0; j < dim; j++) {
-          FpNew[i][j] += GradSolDp[i][j];
+          FpOld[i][j] = Fp[i * dim + j];
         }
       }
 
       for(unsigned i = 0; i < dim; i++) {
-        Fp[i].resize(dim);
         for(unsigned j = 0; j < dim; j++) {
-          Fp[i][j] = 0.;
+          Fp[i * dim + j] = 0.;
           for(unsigned k = 0; k < dim; k++) {
-            Fp[i][j] += FpNew[i][k] * FpOld[k][j];
+            Fp[i * dim + j] += FpNew[i][k] * FpOld[k][j];
           }
         }
       }
-
-      particles[iMarker]->SetDeformationGradient(Fp);
-
-      ielOld = iel;
-    }
-    else {
-      break;
     }
+  };
+
+  // the vectors read by the kernel, their local arrays are acquired before the threads start
+  vector < NumericVector* > inputVectors;
+  for(unsigned i = 0; i < dim; i++) {
+    inputVectors.push_back(mysolution->_Sol[indexSolD[i]]);
+    inputVectors.push_back(mysolution->_SolOld[indexSolD[i]]);
   }
+  ThreadedParticleLoop(mymsh, inputVectors, particles, projectParticleBin);
+
+  linea.SetLocalParticles(particles);
   //END loop on particles
 
 
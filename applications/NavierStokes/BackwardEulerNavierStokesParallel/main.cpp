@@ -100,17 +100,19 @@ int main(int argc,char **args) {
   system.SetMgType(V_CYCLE);
   system.SetMaxNumberOfNonLinearIterations(15);
 
-  // time loop parameter
+  // time loop parameter: dt starts at 0.1 and is adapted to keep the local error of backward Euler below 1.e-3
   system.SetIntervalTime(0.1);
-  const unsigned int n_timesteps = 20;
+  system.SetAdaptiveTimeStep(true, 1.e-3, 0.01, 0.5);
+  const double final_time = 2.;
   const unsigned int write_interval = 1;
 
-  for (unsigned time_step = 0; time_step < n_timesteps; time_step++) {
+  for (unsigned time_step = 0; system.GetTime() < final_time - 1.e-10; time_step++) {
 
     // Solving Navier-Stokes system
     std::cout << std::endl;
     std::cout << " *********** Navier-Stokes ************  " << std::endl;
     ml_prob.get_system("Navier-Stokes").MLsolve();
+    std::cout << " Local error estimate: " << system.GetLocalErrorEstimate() << ", next dt: " << system.GetIntervalTime() << std::endl;
 
     //update Solution
     ml_prob.get_system<TransientNonlinearImplicitSystem>("Navier-Stokes").CopySolutionToOldSolution();
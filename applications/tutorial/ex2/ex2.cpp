@@ -14,6 +14,7 @@
 #include "VTKWriter.hpp"
 #include "GMVWriter.hpp"
 #include "LinearImplicitSystem.hpp"
+#include "ThreadedElementLoop.hpp"
 #include "adept.h"
 
 
@@ -214,6 +215,7 @@ void AssemblePoissonProblem(MultiLevelProblem& ml_prob) {
 
   LinearImplicitSystem* mlPdeSys  = &ml_prob.get_system<LinearImplicitSystem> ("Poisson");   // pointer to the linear implicit system named "Poisson"
   const unsigned level = mlPdeSys->GetLevelToAssemble();
+  const bool assembleMatrix = mlPdeSys->GetAssembleMatrix(); // false also on a matrix-free level, where KK is NULL
 
   Mesh*                    msh = ml_prob._ml_msh->GetLevel(level);    // pointer to the mesh (level) object
   elem*                     el = msh->el;  // pointer to the elem object in msh (level)
@@ -266,7 +268,7 @@ void AssemblePoissonProblem(MultiLevelProblem& ml_prob) {
   vector < double > Jac;
   Jac.reserve(maxSize * maxSize);
 
-  KK->zero(); // Set to zero all the entries of the Global Matrix
+  if (assembleMatrix) KK->zero(); // Set to zero all the entries of the Global Matrix
 
   // element loop: each process loops only on the elements that owns
   for (int iel = msh->_elementOffset[iproc]; iel < msh->_elementOffset[iproc + 1]; iel++) {
@@ -289,20 +291,20 @@ void AssemblePoissonProblem(MultiLevelProblem& ml_prob) {
     Jac.resize(nDofu * nDofu);    //resize
     std::fill(Jac.begin(), Jac.end(), 0);    //set Jac to zero
 
+    // cached mappings of the element dofs
+    const int *soluLocalDofs = msh->GetElementSolutionLocalDofs(iel, soluType);    // mapping between solution node and local array entry
+    const unsigned *soluSystemDofs = pdeSys->GetSystemDofs(soluPdeIndex, iel);    // global to global mapping between solution node and pdeSys dof
+    const int *xLocalDofs = msh->GetElementSolutionLocalDofs(iel, xType);    // mapping between coordinates node and local array entry
+
     // local storage of global mapping and solution
+    sol->_Sol[soluIndex]->get_local(soluLocalDofs, nDofu, &solu[0]);      // extraction from the local array and local storage for the solution
     for (unsigned i = 0; i < nDofu; i++) {
-      unsigned solDof = msh->GetSolutionDof(i, iel, soluType);    // global to global mapping between solution node and solution dof
-      solu[i] = (*sol->_Sol[soluIndex])(solDof);      // global extraction and local storage for the solution
-      l2GMap[i] = pdeSys->GetSystemDof(soluIndex, soluPdeIndex, i, iel);    // global to global mapping between solution node and pdeSys dof
+      l2GMap[i] = soluSystemDofs[i];
     }
 
     // local storage of coordinates
-    for (unsigned i = 0; i < nDofx; i++) {
-      unsigned xDof  = msh->GetSolutionDof(i, iel, xType);    // global to global mapping between coordinates node and coordinate dof
-
-      for (unsigned jdim = 0; jdim < dim; jdim++) {
-        x[jdim][i] = (*msh->_topology->_Sol[jdim])(xDof);      // global extraction and local storage for the element coordinates
-      }
+    for (unsigned jdim = 0; jdim < dim; jdim++) {
+      msh->_topology->_Sol[jdim]->get_local(xLocalDofs, nDofx, &x[jdim][0]);      // extraction from the local array and local storage for the element coordinates
     }
 
 
@@ -339,7 +341,7 @@ void AssemblePoissonProblem(MultiLevelProblem& ml_prob) {
         Res[i] += (srcTerm * phi[i] - laplace) * weight;
 
         // *** phi_j loop ***
-        for (unsigned j = 0; j < nDofu; j++) {
+        for (unsigned j = 0; j < nDofu * assembleMatrix; j++) {
           laplace = 0.;
 
           for (unsigned kdim = 0; kdim < dim; kdim++) {
@@ -360,13 +362,13 @@ void AssemblePoissonProblem(MultiLevelProblem& ml_prob) {
     RES->add_vector_blocked(Res, l2GMap);
 
     //store K in the global matrix KK
-    KK->add_matrix_blocked(Jac, l2GMap, l2GMap);
+    if (assembleMatrix) KK->add_matrix_blocked(Jac, l2GMap, l2GMap);
 
   } //end element loop for each process
 
   RES->close();
 
-  KK->close();
+  if (assembleMatrix) KK->close();
 
   // ***************** END ASSEMBLY *******************
 }
@@ -388,18 +390,13 @@ void AssemblePoissonProblem_AD(MultiLevelProblem& ml_prob) {
   //  levelMax is the Maximum level of the MultiLevelProblem
   //  assembleMatrix is a flag that tells if only the residual or also the matrix should be assembled
 
-  // call the adept stack object
-
-
-  adept::Stack& s = FemusInit::_adeptStack;
-
   //  extract pointers to the several objects that we are going to use
 
   LinearImplicitSystem* mlPdeSys  = &ml_prob.get_system<LinearImplicitSystem> ("Poisson");   // pointer to the linear implicit system named "Poisson"
   const unsigned level = mlPdeSys->GetLevelToAssemble();
+  const bool assembleMatrix = mlPdeSys->GetAssembleMatrix(); // false also on a matrix-free level, where KK is NULL
 
   Mesh*                    msh = ml_prob._ml_msh->GetLevel(level);    // pointer to the mesh (level) object
-  elem*                     el = msh->el;  // pointer to the elem object in msh (level)
 
   MultiLevelSolution*    mlSol = ml_prob._ml_sol;  // pointer to the multilevel solution object
   Solution*                sol = ml_prob._ml_sol->GetSolutionLevel(level);    // pointer to the solution (level) object
@@ -412,8 +409,6 @@ void AssemblePoissonProblem_AD(MultiLevelProblem& ml_prob) {
   unsigned dim2 = (3 * (dim - 1) + !(dim - 1));        // dim2 is the number of second order partial derivatives (1,3,6 depending on the dimension)
   const unsigned maxSize = static_cast< unsigned >(ceil(pow(3, dim)));          // conservative: based on line3, quad9, hex27
 
-  unsigned    iproc = msh->processor_id(); // get the process_id (for parallel computation)
-
   //solution variable
   unsigned soluIndex;
   soluIndex = mlSol->GetIndex("u");    // get the position of "u" in the ml_sol object
@@ -422,79 +417,81 @@ void AssemblePoissonProblem_AD(MultiLevelProblem& ml_prob) {
   unsigned soluPdeIndex;
   soluPdeIndex = mlPdeSys->GetSolPdeIndex("u");    // get the position of "u" in the pdeSys object
 
-  vector < adept::adouble >  solu; // local solution
-  solu.reserve(maxSize);
-
-  vector < vector < double > > x(dim);    // local coordinates
   unsigned xType = 2; // get the finite element type for "x", it is always 2 (LAGRANGE QUADRATIC)
 
-  for (unsigned i = 0; i < dim; i++) {
-    x[i].reserve(maxSize);
+  // local storage of each assembly thread, the adept::adouble variables are instead created in the thread that uses them
+  const unsigned nThreads = GetNumberOfAssemblyThreads();
+
+  vector < vector < double > > soluValue(nThreads); // local solution values
+  vector < vector < vector < double > > > x(nThreads, vector < vector < double > > (dim));    // local coordinates
+  vector < vector <double> > phi(nThreads);  // local test function
+  vector < vector <double> > phi_x(nThreads); // local test function first order partial derivatives
+  vector < vector <double> > phi_xx(nThreads); // local test function second order partial derivatives
+  vector < vector< int > > l2GMap(nThreads); // local to global mapping
+  vector < vector< double > > Res(nThreads); // local redidual vector
+  vector < vector < double > > Jac(nThreads);
+
+  for (unsigned ithread = 0; ithread < nThreads; ithread++) {
+    soluValue[ithread].reserve(maxSize);
+    for (unsigned i = 0; i < dim; i++) {
+      x[ithread][i].reserve(maxSize);
+    }
+    phi[ithread].reserve(maxSize);
+    phi_x[ithread].reserve(maxSize * dim);
+    phi_xx[ithread].reserve(maxSize * dim2);
+    l2GMap[ithread].reserve(maxSize);
+    Res[ithread].reserve(maxSize);
+    Jac[ithread].reserve(maxSize * maxSize);
   }
 
-  vector <double> phi;  // local test function
-  vector <double> phi_x; // local test function first order partial derivatives
-  vector <double> phi_xx; // local test function second order partial derivatives
-  double weight; // gauss point weight
+  if (assembleMatrix) KK->zero(); // Set to zero all the entries of the Global Matrix
 
-  phi.reserve(maxSize);
-  phi_x.reserve(maxSize * dim);
-  phi_xx.reserve(maxSize * dim2);
+  // element kernel: it is called by ThreadedElementLoop for each element owned by this process
+  auto assembleElement = [&](const unsigned & iel, const unsigned & ithread) {
 
-  vector< adept::adouble > aRes; // local redidual vector
-  aRes.reserve(maxSize);
+    // the adept stack of this thread
+    adept::Stack& s = FemusInit::GetAdeptStack(ithread);
 
-  vector< int > l2GMap; // local to global mapping
-  l2GMap.reserve(maxSize);
-  vector< double > Res; // local redidual vector
-  Res.reserve(maxSize);
-  vector < double > Jac;
-  Jac.reserve(maxSize * maxSize);
-
-  KK->zero(); // Set to zero all the entries of the Global Matrix
-
-  // element loop: each process loops only on the elements that owns
-  for (int iel = msh->_elementOffset[iproc]; iel < msh->_elementOffset[iproc + 1]; iel++) {
-     
     short unsigned ielGeom = msh->GetElementType(iel);
     unsigned nDofu  = msh->GetElementDofNumber(iel, soluType);    // number of solution element dofs
     unsigned nDofx = msh->GetElementDofNumber(iel, xType);    // number of coordinate element dofs
 
+    vector < adept::adouble >  solu(nDofu); // local solution
+    vector < adept::adouble > aRes(nDofu, 0.); // local redidual vector
+
     // resize local arrays
-    l2GMap.resize(nDofu);
-    solu.resize(nDofu);
+    l2GMap[ithread].resize(nDofu);
+    soluValue[ithread].resize(nDofu);
 
     for (int i = 0; i < dim; i++) {
-      x[i].resize(nDofx);
+      x[ithread][i].resize(nDofx);
     }
 
-    aRes.resize(nDofu);    //resize
-    std::fill(aRes.begin(), aRes.end(), 0);    //set aRes to zero
+    // cached mappings of the element dofs
+    const int *soluLocalDofs = msh->GetElementSolutionLocalDofs(iel, soluType);    // mapping between solution node and local array entry
+    const unsigned *soluSystemDofs = pdeSys->GetSystemDofs(soluPdeIndex, iel);    // global to global mapping between solution node and pdeSys dof
+    const int *xLocalDofs = msh->GetElementSolutionLocalDofs(iel, xType);    // mapping between coordinates node and local array entry
 
     // local storage of global mapping and solution
+    sol->_Sol[soluIndex]->get_local(soluLocalDofs, nDofu, &soluValue[ithread][0]);      // extraction from the local array
     for (unsigned i = 0; i < nDofu; i++) {
-      unsigned solDof = msh->GetSolutionDof(i, iel, soluType);    // global to global mapping between solution node and solution dof
-      solu[i] = (*sol->_Sol[soluIndex])(solDof);      // global extraction and local storage for the solution
-      l2GMap[i] = pdeSys->GetSystemDof(soluIndex, soluPdeIndex, i, iel);    // global to global mapping between solution node and pdeSys dof
+      solu[i] = soluValue[ithread][i];
+      l2GMap[ithread][i] = soluSystemDofs[i];
     }
 
     // local storage of coordinates
-    for (unsigned i = 0; i < nDofx; i++) {
-      unsigned xDof  = msh->GetSolutionDof(i, iel, xType);    // global to global mapping between coordinates node and coordinate dof
-
-      for (unsigned jdim = 0; jdim < dim; jdim++) {
-        x[jdim][i] = (*msh->_topology->_Sol[jdim])(xDof);      // global extraction and local storage for the element coordinates
-      }
+    for (unsigned jdim = 0; jdim < dim; jdim++) {
+      msh->_topology->_Sol[jdim]->get_local(xLocalDofs, nDofx, &x[ithread][jdim][0]);      // extraction from the local array and local storage for the element coordinates
     }
 
-
     // start a new recording of all the operations involving adept::adouble variables
     s.new_recording();
 
     // *** Gauss point loop ***
     for (unsigned ig = 0; ig < msh->_finiteElement[ielGeom][soluType]->GetGaussPointNumber(); ig++) {
       // *** get gauss point weight, test function and test function partial derivatives ***
-      msh->_finiteElement[ielGeom][soluType]->Jacobian(x, ig, weight, phi, phi_x, phi_xx);
+      double weight; // gauss point weight
+      msh->_finiteElement[ielGeom][soluType]->Jacobian(x[ithread], ig, weight, phi[ithread], phi_x[ithread], phi_xx[ithread]);
 
       // evaluate the solution, the solution derivatives and the coordinates in the gauss point
       adept::adouble solu_gss = 0;
@@ -502,11 +499,11 @@ void AssemblePoissonProblem_AD(MultiLevelProblem& ml_prob) {
       vector < double > x_gss(dim, 0.);
 
       for (unsigned i = 0; i < nDofu; i++) {
-        solu_gss += phi[i] * solu[i];
+        solu_gss += phi[ithread][i] * solu[i];
 
         for (unsigned jdim = 0; jdim < dim; jdim++) {
-          gradSolu_gss[jdim] += phi_x[i * dim + jdim] * solu[i];
-          x_gss[jdim] += x[jdim][i] * phi[i];
+          gradSolu_gss[jdim] += phi_x[ithread][i * dim + jdim] * solu[i];
+          x_gss[jdim] += x[ithread][jdim][i] * phi[ithread][i];
         }
       }
 
@@ -516,11 +513,11 @@ void AssemblePoissonProblem_AD(MultiLevelProblem& ml_prob) {
         adept::adouble laplace = 0.;
 
         for (unsigned jdim = 0; jdim < dim; jdim++) {
-          laplace   +=  phi_x[i * dim + jdim] * gradSolu_gss[jdim];
+          laplace   +=  phi_x[ithread][i * dim + jdim] * gradSolu_gss[jdim];
         }
 
         double srcTerm = - GetExactSolutionLaplace(x_gss);
-        aRes[i] += (srcTerm * phi[i] - laplace) * weight;
+        aRes[i] += (srcTerm * phi[ithread][i] - laplace) * weight;
 
       } // end phi_i loop
     } // end gauss point loop
@@ -529,15 +526,13 @@ void AssemblePoissonProblem_AD(MultiLevelProblem& ml_prob) {
     // Add the local Matrix/Vector into the global Matrix/Vector
 
     //copy the value of the adept::adoube aRes in double Res and store
-    Res.resize(nDofu);    //resize
+    Res[ithread].resize(nDofu);    //resize
 
     for (int i = 0; i < nDofu; i++) {
-      Res[i] = - aRes[i].value();
+      Res[ithread][i] = - aRes[i].value();
     }
 
-    RES->add_vector_blocked(Res, l2GMap);
-
-
+    RES->add_vector_blocked(Res[ithread], l2GMap[ithread]);
 
     // define the dependent variables
     s.dependent(&aRes[0], nDofu);
@@ -545,21 +540,27 @@ void AssemblePoissonProblem_AD(MultiLevelProblem& ml_prob) {
     // define the independent variables
     s.independent(&solu[0], nDofu);
 
-    // get the jacobian matrix (ordered by row major )
-    Jac.resize(nDofu * nDofu);    //resize
-    s.jacobian(&Jac[0], true);
+    if (assembleMatrix) {
+      // get the jacobian matrix (ordered by row major )
+      Jac[ithread].resize(nDofu * nDofu);    //resize
+      s.jacobian(&Jac[ithread][0], true);
 
-    //store K in the global matrix KK
-    KK->add_matrix_blocked(Jac, l2GMap, l2GMap);
+      //store K in the global matrix KK
+      KK->add_matrix_blocked(Jac[ithread], l2GMap[ithread], l2GMap[ithread]);
+    }
 
     s.clear_independents();
     s.clear_dependents();
 
-  } //end element loop for each process
+  }; //end element kernel
+
+  // element loop: each process loops only on the elements that owns, shared among the threads
+  std::vector < NumericVector* > inputVectors(1, sol->_Sol[soluIndex]);
+  ThreadedElementLoop(msh, inputVectors, assembleElement);
 
   RES->close();
 
-  KK->close();
+  if (assembleMatrix) KK->close();
 
   // ***************** END ASSEMBLY *******************
 }
@@ -568,7 +569,6 @@ std::pair < double, double > GetErrorNorm(MultiLevelSolution* mlSol) {
   unsigned level = mlSol->_mlMesh->GetNumberOfLevels() - 1u;
   //  extract pointers to the several objects that we are going to use
   Mesh*     msh = mlSol->_mlMesh->GetLevel(level);    // pointer to the mesh (level) object
-  elem*     el  = msh->el;  // pointer to the elem object in msh (level)
   Solution* sol = mlSol->GetSolutionLevel(level);    // pointer to the solution (level) object
 
   const unsigned  dim = msh->GetDimension(); // get the domain dimension of the problem
@@ -579,90 +579,122 @@ std::pair < double, double > GetErrorNorm(MultiLevelSolution* mlSol) {
   soluIndex = mlSol->GetIndex("u");    // get the position of "u" in the ml_sol object
   unsigned soluType = mlSol->GetSolutionType(soluIndex);    // get the finite element type for "u"
 
-  vector < double >  solu; // local solution
-
-  vector < vector < double > > x(dim);    // local coordinates
   unsigned xType = 2; // get the finite element type for "x", it is always 2 (LAGRANGE QUADRATIC)
 
-  vector <double> phi;  // local test function
-  vector <double> phi_x; // local test function first order partial derivatives
-  vector <double> phi_xx; // local test function second order partial derivatives
-  double weight; // gauss point weight
-
-  // reserve memory for the local standar vectors
+  // the elements are processed in batches of consecutive elements with the same geometry, the weights and the
+  // test function partial derivatives at the gauss points of a batch are evaluated together by JacobianBatch;
+  // the batch arrays are structures of arrays with the element index jel running fastest
+  const unsigned batchSize = 32;
   const unsigned maxSize = static_cast< unsigned >(ceil(pow(3, dim)));          // conservative: based on line3, quad9, hex27
-  solu.reserve(maxSize);
-
-  for (unsigned i = 0; i < dim; i++)
-    x[i].reserve(maxSize);
-
-  phi.reserve(maxSize);
-  phi_x.reserve(maxSize * dim);
-  unsigned dim2 = (3 * (dim - 1) + !(dim - 1));        // dim2 is the number of second order partial derivatives (1,3,6 depending on the dimension)
-  phi_xx.reserve(maxSize * dim2);
+  const unsigned maxGaussSize = 64;          // initial reserve only, the batch arrays are resized to the rule of each batch
+
+  vector < double > solu(maxSize); // local solution
+  vector < double > xe(maxSize); // local coordinates of one element
+  vector < double > soluBatch; // local solution of the batch: soluBatch[i * nElements + jel]
+  vector < double > xBatch; // local coordinates of the batch: xBatch[(k * nDofu + i) * nElements + jel]
+  vector < double > weightBatch; // gauss point weights: weightBatch[ig * nElements + jel]
+  vector < double > phi_xBatch; // test function first order partial derivatives: phi_xBatch[((ig * nDofu + i) * dim + k) * nElements + jel]
+
+  soluBatch.reserve(maxSize * batchSize);
+  xBatch.reserve(dim * maxSize * batchSize);
+  weightBatch.reserve(maxGaussSize * batchSize);
+  phi_xBatch.reserve(maxGaussSize * maxSize * dim * batchSize);
+
+  vector < double > solu_gss(batchSize);
+  vector < double > gradSolu_gss(dim * batchSize);
+  vector < double > x_gss(dim * batchSize);
+  vector < double > xPoint(dim);
+  vector < double > exactGradSol(dim);
 
   double seminorm = 0.;
   double l2norm = 0.;
 
   // element loop: each process loops only on the elements that owns
-  for (int iel = msh->_elementOffset[iproc]; iel < msh->_elementOffset[iproc + 1]; iel++) {
+  unsigned elementEnd = msh->_elementOffset[iproc + 1];
+  for (unsigned iel = msh->_elementOffset[iproc]; iel < elementEnd;) {
 
-    
     short unsigned ielGeom = msh->GetElementType(iel);
-    unsigned nDofu  = msh->GetElementDofNumber(iel, soluType);    // number of solution element dofs
-    unsigned nDofx = msh->GetElementDofNumber(iel, xType);    // number of coordinate element dofs
+    unsigned nElements = 1;
+    while (nElements < batchSize && iel + nElements < elementEnd && msh->GetElementType(iel + nElements) == ielGeom) {
+      nElements++;
+    }
 
-    // resize local arrays
-    solu.resize(nDofu);
+    const elem_type* fe = msh->_finiteElement[ielGeom][soluType];
+    unsigned nDofu  = msh->GetElementDofNumber(iel, soluType);    // number of solution element dofs, the same for the whole batch
+    unsigned nGauss = fe->GetGaussPointNumber();
 
-    for (int i = 0; i < dim; i++) {
-      x[i].resize(nDofx);
-    }
+    soluBatch.resize(nDofu * nElements);
+    xBatch.resize(dim * nDofu * nElements);
+    weightBatch.resize(nGauss * nElements);
+    phi_xBatch.resize(nGauss * nDofu * dim * nElements);
 
-    // local storage of global mapping and solution
-    for (unsigned i = 0; i < nDofu; i++) {
-      unsigned solDof = msh->GetSolutionDof(i, iel, soluType);    // global to global mapping between solution node and solution dof
-      solu[i] = (*sol->_Sol[soluIndex])(solDof);      // global extraction and local storage for the solution
-    }
+    // local storage of solution and coordinates: the geometry is evaluated with the first nDofu coordinate dofs
+    for (unsigned jel = 0; jel < nElements; jel++) {
+      const int *soluLocalDofs = msh->GetElementSolutionLocalDofs(iel + jel, soluType);    // mapping between solution node and local array entry
+      const int *xLocalDofs = msh->GetElementSolutionLocalDofs(iel + jel, xType);    // mapping between coordinates node and local array entry
 
-    // local storage of coordinates
-    for (unsigned i = 0; i < nDofx; i++) {
-      unsigned xDof  = msh->GetSolutionDof(i, iel, xType);    // global to global mapping between coordinates node and coordinate dof
+      sol->_Sol[soluIndex]->get_local(soluLocalDofs, nDofu, &solu[0]);
+      for (unsigned i = 0; i < nDofu; i++) {
+        soluBatch[i * nElements + jel] = solu[i];
+      }
 
       for (unsigned jdim = 0; jdim < dim; jdim++) {
-        x[jdim][i] = (*msh->_topology->_Sol[jdim])(xDof);  // global extraction and local storage for the element coordinates
+        msh->_topology->_Sol[jdim]->get_local(xLocalDofs, nDofu, &xe[0]);
+        for (unsigned i = 0; i < nDofu; i++) {
+          xBatch[(jdim * nDofu + i) * nElements + jel] = xe[i];
+        }
       }
     }
 
+    // *** get gauss point weights and test function partial derivatives of the whole batch ***
+    fe->JacobianBatch(&xBatch[0], nElements, &weightBatch[0], &phi_xBatch[0]);
+
     // *** Gauss point loop ***
-    for (unsigned ig = 0; ig < msh->_finiteElement[ielGeom][soluType]->GetGaussPointNumber(); ig++) {
-      // *** get gauss point weight, test function and test function partial derivatives ***
-      msh->_finiteElement[ielGeom][soluType]->Jacobian(x, ig, weight, phi, phi_x, phi_xx);
+    for (unsigned ig = 0; ig < nGauss; ig++) {
+      const double* phi = fe->GetPhi(ig);    // test function, the same for all the elements
+      const double* weight = &weightBatch[ig * nElements];
 
       // evaluate the solution, the solution derivatives and the coordinates in the gauss point
-      double solu_gss = 0;
-      vector < double > gradSolu_gss(dim, 0.);
-      vector < double > x_gss(dim, 0.);
+      std::fill(solu_gss.begin(), solu_gss.begin() + nElements, 0.);
+      std::fill(gradSolu_gss.begin(), gradSolu_gss.begin() + dim * nElements, 0.);
+      std::fill(x_gss.begin(), x_gss.begin() + dim * nElements, 0.);
 
       for (unsigned i = 0; i < nDofu; i++) {
-        solu_gss += phi[i] * solu[i];
+        const double* solui = &soluBatch[i * nElements];
+        for (unsigned jel = 0; jel < nElements; jel++) {
+          solu_gss[jel] += phi[i] * solui[jel];
+        }
 
         for (unsigned jdim = 0; jdim < dim; jdim++) {
-          gradSolu_gss[jdim] += phi_x[i * dim + jdim] * solu[i];
-          x_gss[jdim] += x[jdim][i] * phi[i];
+          const double* phi_x = &phi_xBatch[((ig * nDofu + i) * dim + jdim) * nElements];
+          const double* xi = &xBatch[(jdim * nDofu + i) * nElements];
+          double* gradSolu = &gradSolu_gss[jdim * nElements];
+          double* xg = &x_gss[jdim * nElements];
+          for (unsigned jel = 0; jel < nElements; jel++) {
+            gradSolu[jel] += phi_x[jel] * solui[jel];
+            xg[jel] += xi[jel] * phi[i];
+          }
         }
       }
 
-      vector <double> exactGradSol(dim);
-      GetExactSolutionGradient(x_gss, exactGradSol);
+      for (unsigned jel = 0; jel < nElements; jel++) {
+        for (unsigned jdim = 0; jdim < dim; jdim++) {
+          xPoint[jdim] = x_gss[jdim * nElements + jel];
+        }
 
-      for (unsigned j = 0; j < dim ; j++) {
-        seminorm   += ((gradSolu_gss[j] - exactGradSol[j]) * (gradSolu_gss[j] - exactGradSol[j])) * weight;
-      }
+        GetExactSolutionGradient(xPoint, exactGradSol);
+
+        for (unsigned j = 0; j < dim ; j++) {
+          double gradError = gradSolu_gss[j * nElements + jel] - exactGradSol[j];
+          seminorm   += gradError * gradError * weight[jel];
+        }
 
-      double exactSol = GetExactSolutionValue(x_gss);
-      l2norm += (exactSol - solu_gss) * (exactSol - solu_gss) * weight;
+        double exactSol = GetExactSolutionValue(xPoint);
+        l2norm += (exactSol - solu_gss[jel]) * (exactSol - solu_gss[jel]) * weight[jel];
+      }
     } // end gauss point loop
+
+    iel += nElements;
   } //end element loop for each process
 
   // add the norms of all processes
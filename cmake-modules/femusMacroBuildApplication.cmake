@@ -17,6 +17,7 @@ TARGET_LINK_LIBRARIES(${appname} ${PETSC_LIBRARIES})
 TARGET_LINK_LIBRARIES(${appname} ${B64_LIBRARIES})
 TARGET_LINK_LIBRARIES(${appname} ${JSONCPP_LIBRARIES})
 TARGET_LINK_LIBRARIES(${appname} ${ADEPT_LIBRARIES})
+TARGET_LINK_LIBRARIES(${appname} ${CMAKE_THREAD_LIBS_INIT})
 
 IF(SLEPC_FOUND)
   TARGET_LINK_LIBRARIES(${appname} ${SLEPC_LIBARIES})
@@ -35,6 +36,11 @@ IF(HDF5_FOUND)
   TARGET_LINK_LIBRARIES(${appname} ${HDF5_LIBRARIES})
 ENDIF(HDF5_FOUND)
 
+# the threaded element and particle loops are templates compiled in the application
+IF(OPENMP_FOUND)
+  SET_TARGET_PROPERTIES(${appname} PROPERTIES COMPILE_FLAGS "${OpenMP_CXX_FLAGS}" LINK_FLAGS "${OpenMP_CXX_FLAGS}")
+ENDIF(OPENMP_FOUND)
+
 FILE(MAKE_DIRECTORY ${PROJECT_BINARY_DIR}/output/)
 FILE(MAKE_DIRECTORY ${PROJECT_BINARY_DIR}/input/)
 FILE(MAKE_DIRECTORY ${PROJECT_BINARY_DIR}/save/)
@@ -26,6 +26,7 @@
 #include "PetscPreconditioner.hpp"
 #include "PetscVector.hpp"
 #include "PetscMatrix.hpp"
+#include "Profiler.hpp"
 #include <iomanip>
 #include <sstream>
 
@@ -50,6 +51,13 @@ namespace femus
 
   // ================================================
 
+  void GmresPetscLinearEquationSolver::SetRelativeTolerance(const double& rtol)
+  {
+    _rtol = static_cast<PetscReal>(rtol);
+  }
+
+  // ================================================
+
   void GmresPetscLinearEquationSolver::BuildBdcIndex(const vector <unsigned>& variable_to_be_solved)
   {
 
@@ -101,12 +109,16 @@ namespace femus
     if(_bdcIndexIsInitialized == 0) BuildBdcIndex(variable_to_be_solved);
 
     //BEGIN ASSEMBLE matrix with Dirichlet penalty BCs by penalty
-    Mat KK = (static_cast<PetscMatrix*>(_KK))->mat();
     if(ksp_clean) {
       this->Clear();
       SetPenalty();
       RemoveNullSpace();
-      this->Init(KK, KK);
+      Mat Amat, Pmat;
+      GetOperators(Amat, Pmat);
+      this->Init(Amat, Pmat);
+    }
+    else {
+      KSPSetTolerances(_ksp, _rtol, _abstol, _dtol, _maxits);
     }
     //END ASSEMBLE
 
@@ -121,10 +133,11 @@ namespace femus
 
     //BEGIN SOLVE and UPDATE
     ZerosBoundaryResiduals();
+    ProfilerRegion kspRegion("KSPSolve");
     KSPSolve(_ksp, (static_cast< PetscVector* >(_RES))->vec(), (static_cast< PetscVector* >(_EPSC))->vec());
+    kspRegion.Stop();
     *_EPS += *_EPSC;
-    _RESC->matrix_mult(*_EPSC, *_KK);
-    *_RES -= *_RESC;
+    UpdateResidual();
     //END SOLVE and UPDATE
 
     //BEGIN PRINT Computational info
@@ -249,9 +262,10 @@ namespace femus
     SetPenalty();
     RemoveNullSpace();
 
-    Mat KK = (static_cast< PetscMatrix* >(_KK))->mat();
+    Mat Amat, Pmat;
+    GetOperators(Amat, Pmat);
 
-    KSPSetOperators(subksp, KK, KK);
+    KSPSetOperators(subksp, Amat, Pmat);
 
     PC subpc;
     KSPGetPC(subksp, &subpc);
@@ -282,7 +296,7 @@ namespace femus
 
   // ================================================
 
-  void GmresPetscLinearEquationSolver::MGSolve(const bool ksp_clean)
+  void GmresPetscLinearEquationSolver::MGSolve(const bool ksp_clean, const bool updateResidual)
   {
 
     PetscLogDouble t1;
@@ -290,9 +304,10 @@ namespace femus
     PetscTime(&t1);
 
     if(ksp_clean) {
-      Mat KK = (static_cast< PetscMatrix* >(_KK))->mat();
+      Mat Amat, Pmat;
+      GetOperators(Amat, Pmat);
 
-      KSPSetOperators(_ksp, KK, KK);
+      KSPSetOperators(_ksp, Amat, Pmat);
 
       KSPSetTolerances(_ksp, _rtol, _abstol, _dtol, _maxits);
 
@@ -302,7 +317,9 @@ namespace femus
 
       KSPSetFromOptions(_ksp);
       KSPGMRESSetRestart(_ksp, _restart);
+      ProfilerRegion kspSetUpRegion("KSPSetUp");
       KSPSetUp(_ksp);
+      kspSetUpRegion.Stop();
 
 //       PetscViewer    viewer;
 //       PetscViewerDrawOpen(PETSC_COMM_WORLD,NULL,NULL,0,0,900,900,&viewer);
@@ -312,24 +329,34 @@ namespace femus
 //       double a;
 //       std::cin>>a;
     }
+    else {
+      // the relative tolerance can change between two solves with the same operators
+      KSPSetTolerances(_ksp, _rtol, _abstol, _dtol, _maxits);
+    }
 
     ZerosBoundaryResiduals();
+    ProfilerRegion kspRegion("KSPSolve");
     KSPSolve(_ksp, (static_cast< PetscVector* >(_RES))->vec(), (static_cast< PetscVector* >(_EPSC))->vec());
+    kspRegion.Stop();
+
+    KSPConvergedReason reason;
+    KSPGetConvergedReason(_ksp, &reason);
+
+    PetscReal rnorm;
+    KSPGetResidualNorm(_ksp, &rnorm);
+    _krylovResidualNorm = rnorm;
 
-    _RESC->matrix_mult(*_EPSC, *_KK);
-    *_RES -= *_RESC;
+    // KSP_CONVERGED_ITS only means that the fixed number of iterations has been done
+    _residualIsUpdated = (updateResidual || (reason != KSP_CONVERGED_RTOL && reason != KSP_CONVERGED_ATOL));
+    if(_residualIsUpdated) {
+      UpdateResidual();
+    }
     *_EPS += *_EPSC;
 
     if(_printSolverInfo) {
       int its;
       KSPGetIterationNumber(_ksp, &its);
 
-      KSPConvergedReason reason;
-      KSPGetConvergedReason(_ksp, &reason);
-
-      PetscReal rnorm;
-      KSPGetResidualNorm(_ksp, &rnorm);
-
       PetscTime(&t2);
       PetscPrintf(PETSC_COMM_WORLD, "       *************** MG linear solver time: %e \n", t2 - t1);
       PetscPrintf(PETSC_COMM_WORLD, "       *************** Number of outer ksp solver iterations = %i \n", its);
@@ -350,12 +377,14 @@ namespace femus
         MatNullSpace   nullsp;
         MatNullSpaceCreate(PETSC_COMM_WORLD, PETSC_FALSE, nullspBase.size(), &nullspBase[0], &nullsp);
 
+        Mat KK = (_KKmf) ? _KKmf->mat() : (static_cast< PetscMatrix* >(_KK))->mat();
+
         PetscBool  isNull;
-        MatNullSpaceTest(nullsp, (static_cast< PetscMatrix* >(_KK))->mat(), &isNull);
+        MatNullSpaceTest(nullsp, KK, &isNull);
         if(!isNull) std::cout << "The null space created for KK is not correct!" << std::endl;
 
-        MatSetNullSpace((static_cast< PetscMatrix* >(_KK))->mat(), nullsp);
-        MatSetTransposeNullSpace((static_cast< PetscMatrix* >(_KK))->mat(), nullsp);
+        MatSetNullSpace(KK, nullsp);
+        MatSetTransposeNullSpace(KK, nullsp);
         MatNullSpaceDestroy(&nullsp);
 
         for(unsigned i = 0; i < nullspBase.size(); i++) {
@@ -414,6 +443,11 @@ namespace femus
   void GmresPetscLinearEquationSolver::SetPenalty()
   {
 
+    if(_KKmf) {
+      _KKmf->SetDirichletRows(_bdcIndex);
+      return;
+    }
+
     Mat KK = (static_cast< PetscMatrix* >(_KK))->mat();
 
     MatSetOption(KK, MAT_NO_OFF_PROC_ZERO_ROWS, PETSC_TRUE);
@@ -424,6 +458,30 @@ namespace femus
 
   // =================================================
 
+  void GmresPetscLinearEquationSolver::GetOperators(Mat& Amat, Mat& Pmat)
+  {
+
+    if(_KKmf) {
+      // there is no assembled matrix on this level: Jacobi needs only the diagonal, that the matrix-free operator provides
+      if(this->_preconditioner_type != JACOBI_PRECOND && this->_preconditioner_type != IDENTITY_PRECOND) {
+        std::cout << "Error in GmresPetscLinearEquationSolver: the matrix-free level " << _msh->GetLevel()
+                  << " needs the JACOBI or the IDENTITY preconditioner" << std::endl;
+        abort();
+      }
+      Amat = _KKmf->mat();
+      Pmat = Amat;
+      return;
+    }
+
+    Mat KK = (static_cast< PetscMatrix* >(_KK))->mat();
+
+    Amat = KK;
+    Pmat = KK;
+
+  }
+
+  // =================================================
+
   void GmresPetscLinearEquationSolver::SetPreconditioner(KSP& subksp, PC& subpc)
   {
 
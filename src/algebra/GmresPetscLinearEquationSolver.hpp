@@ -53,6 +53,12 @@ namespace femus {
       void SetTolerances(const double &rtol, const double &atol, const double &divtol,
                          const unsigned &maxits, const unsigned &restart);
 
+      void SetRelativeTolerance(const double &rtol);
+
+      double GetRelativeTolerance() const {
+        return _rtol;
+      }
+
       void Init(Mat& Amat, Mat &Pmat);
 
       void Solve(const vector <unsigned>& variable_to_be_solved, const bool &ksp_clean);
@@ -68,6 +74,9 @@ namespace femus {
       void GetNullSpaceBase( std::vector < Vec > &nullspBase);
       void ZerosBoundaryResiduals();
       void SetPenalty();
+
+      /** The operator and the preconditioning matrix of the KSP: KK, or the matrix-free operator if any */
+      void GetOperators(Mat& Amat, Mat& Pmat);
       
       void SetRichardsonScaleFactor(const double & richardsonScaleFactor){
 	_richardsonScaleFactor = richardsonScaleFactor;
@@ -76,7 +85,7 @@ namespace femus {
       virtual void BuildBdcIndex(const vector <unsigned> &variable_to_be_solved);
       virtual void SetPreconditioner(KSP& subksp, PC& subpc);
 
-      void MGSolve(const bool ksp_clean);
+      void MGSolve(const bool ksp_clean, const bool updateResidual = true);
 
       inline void MGClear() {
         KSPDestroy(&_ksp);
@@ -44,6 +44,9 @@ LinearEquation::LinearEquation(Solution *other_solution){
   _RESC = NULL;
   _KK = NULL;
   _KKamr = NULL;
+  _KKmf = NULL;
+  _matrixFreeElementAction = NULL;
+  _elementSystemDofStart = 0;
 }
 
 //--------------------------------------------------------------------------------
@@ -67,6 +70,11 @@ unsigned LinearEquation::GetIndex(const char name[]) {
 unsigned LinearEquation::GetSystemDof(const unsigned &index_sol, const unsigned &kkindex_sol,
 				      const unsigned &i, const unsigned &iel) const {
 
+  if(_elementSystemDofOffset.size() != 0 && _SolPdeIndex[kkindex_sol] == index_sol &&
+     iel >= _elementSystemDofStart && iel < _msh->_elementOffset[_iproc + 1]) { // cached owned element
+    return GetSystemDofs(kkindex_sol, iel)[i];
+  }
+
   unsigned soltype =  _SolType[index_sol];
   unsigned idof= _msh->GetSolutionDof(i, iel, soltype);
 
@@ -96,6 +104,42 @@ unsigned LinearEquation::GetSystemDof(const unsigned &index_sol, const unsigned
 }
 
 
+//--------------------------------------------------------------------------------
+void LinearEquation::BuildElementSystemDofTable() {
+
+  unsigned nVars = _SolPdeIndex.size();
+  unsigned elementStart = _msh->_elementOffset[_iproc];
+  unsigned elementEnd = _msh->_elementOffset[_iproc + 1];
+
+  vector < unsigned > offset((elementEnd - elementStart) * nVars + 1);
+  offset[0] = 0;
+  unsigned counter = 0;
+  for(unsigned iel = elementStart; iel < elementEnd; iel++) {
+    for(unsigned k = 0; k < nVars; k++) {
+      offset[counter + 1] = offset[counter] + _msh->GetElementDofNumber(iel, _SolType[_SolPdeIndex[k]]);
+      counter++;
+    }
+  }
+
+  vector < unsigned > dof(offset[counter]);
+  counter = 0;
+  for(unsigned iel = elementStart; iel < elementEnd; iel++) {
+    for(unsigned k = 0; k < nVars; k++) {
+      unsigned soltype = _SolType[_SolPdeIndex[k]];
+      const unsigned *solDof = _msh->GetElementSolutionDofs(iel, soltype);
+      for(unsigned i = 0; i < offset[counter + 1] - offset[counter]; i++) {
+        unsigned isubdom = _msh->IsdomBisectionSearch(solDof[i], soltype);
+        dof[offset[counter] + i] = KKoffset[k][isubdom] + solDof[i] - _msh->_dofOffset[soltype][isubdom];
+      }
+      counter++;
+    }
+  }
+
+  _elementSystemDofStart = elementStart;
+  _elementSystemDof.swap(dof);
+  _elementSystemDofOffset.swap(offset);
+}
+
 //--------------------------------------------------------------------------------
 void LinearEquation::InitPde(const vector <unsigned> &SolPdeIndex_other, const  vector <int> &SolType_other,
 		     const vector <char*> &SolName_other, vector <NumericVector*> *Bdc_other,
@@ -165,6 +209,8 @@ void LinearEquation::InitPde(const vector <unsigned> &SolPdeIndex_other, const
      }
    }
 
+  BuildElementSystemDofTable();
+
   //-----------------------------------------------------------------------------------------------
   int EPSsize= KKIndex[KKIndex.size()-1];
   _EPS = NumericVector::build().release();
@@ -186,16 +232,41 @@ void LinearEquation::InitPde(const vector <unsigned> &SolPdeIndex_other, const
   _RESC->init(*_EPS);
 
 
-  GetSparsityPatternSize();
+  InitMatrix();
+  _KKamr = SparseMatrix::build().release();
+}
+
+//--------------------------------------------------------------------------------
+void LinearEquation::InitMatrix() {
 
-  const unsigned dim = _msh->GetDimension();
-  int KK_UNIT_SIZE_ = pow(5,dim);
-  int KK_size=KKIndex[KKIndex.size()-1u];
-  int KK_local_size =KKoffset[KKIndex.size()-1][processor_id()] - KKoffset[0][processor_id()];
+  if(_KKmf) {
+    delete _KKmf;
+    _KKmf = NULL;
+  }
 
-  _KK = SparseMatrix::build().release();
-  _KK->init(KK_size,KK_size,KK_local_size,KK_local_size,d_nnz,o_nnz);
-  _KKamr = SparseMatrix::build().release();
+  if(_matrixFreeElementAction) {
+    // the matrix-free level never stores its matrix
+    if(_KK) {
+      delete _KK;
+      _KK = NULL;
+    }
+    _KKmf = new MatrixFreeOperator(this, _matrixFreeElementAction);
+  }
+  else if(!_KK) {
+    GetSparsityPatternSize();
+
+    int KK_size=KKIndex[KKIndex.size()-1u];
+    int KK_local_size =KKoffset[KKIndex.size()-1][processor_id()] - KKoffset[0][processor_id()];
+
+    _KK = SparseMatrix::build().release();
+    _KK->init(KK_size,KK_size,KK_local_size,KK_local_size,d_nnz,o_nnz);
+  }
+}
+
+//--------------------------------------------------------------------------------
+void LinearEquation::SetMatrixFreeElementAction(ElementActionFunction elementAction) {
+  _matrixFreeElementAction = elementAction;
+  if(_EPS) InitMatrix(); // InitPde was already called
 }
 
 //--------------------------------------------------------------------------------
@@ -203,6 +274,31 @@ void LinearEquation::AddLevel(){
   _gridn++;
 }
 
+//--------------------------------------------------------------------------------
+std::size_t LinearEquation::GetMemoryUsage() const {
+
+  std::size_t bytes = 0;
+
+  const NumericVector* vectors[4] = {_EPS, _EPSC, _RES, _RESC};
+  for(unsigned i = 0; i < 4; i++) {
+    if(vectors[i]) bytes += vectors[i]->GetMemoryUsage();
+  }
+  if(_KK) bytes += _KK->GetMemoryUsage();
+  if(_KKamr) bytes += _KKamr->GetMemoryUsage();
+  if(_KKmf) bytes += _KKmf->GetMemoryUsage();
+
+  for(unsigned i = 0; i < KKoffset.size(); i++) {
+    bytes += KKoffset[i].capacity() * sizeof(unsigned);
+  }
+  for(unsigned i = 0; i < KKghost_nd.size(); i++) {
+    bytes += KKghost_nd[i].capacity() * sizeof(int);
+  }
+  bytes += (KKghostsize.capacity() + _elementSystemDofOffset.capacity() + _elementSystemDof.capacity()) * sizeof(unsigned);
+  bytes += (KKIndex.capacity() + d_nnz.capacity() + o_nnz.capacity()) * sizeof(int);
+
+  return bytes;
+}
+
 //--------------------------------------------------------------------------------
 void LinearEquation::SetResZero() {
   _RES->zero();
@@ -221,7 +317,8 @@ void LinearEquation::SumEpsCToEps() {
 
 //--------------------------------------------------------------------------------
 void LinearEquation::UpdateResidual() {
-  _RESC->matrix_mult(*_EPSC,*_KK);
+  if(_KKmf) _KKmf->mult(*_EPSC,*_RESC);
+  else _RESC->matrix_mult(*_EPSC,*_KK);
   *_RES -= *_RESC;
 }
 
@@ -234,6 +331,11 @@ void LinearEquation::DeletePde() {
   if(_KKamr)
     delete _KKamr;
 
+  if(_KKmf) {
+    delete _KKmf;
+    _KKmf = NULL;
+  }
+
   if(_EPS)
     delete _EPS;
 
@@ -246,6 +348,9 @@ void LinearEquation::DeletePde() {
   if(_RESC)
     delete _RESC;
 
+  vector < unsigned > ().swap(_elementSystemDofOffset);
+  vector < unsigned > ().swap(_elementSystemDof);
+
 }
 
   void LinearEquation::GetSparsityPatternSize() {
@@ -303,10 +408,9 @@ void LinearEquation::DeletePde() {
       }
 
       for(int i=0; i<_SolPdeIndex.size(); i++) {
-	int ThisSolType=_SolType[_SolPdeIndex[i]];
+	const unsigned *kelDofs = GetSystemDofs(i, kel);
 	for (int j=0;j<nve[i];j++) {
-          int inode=_msh->GetSolutionDof(j, kel, ThisSolType);
-	  dofsVAR[i][j]= GetSystemDof(_SolPdeIndex[i],i,j,kel);
+	  dofsVAR[i][j]= kelDofs[j];
 	}
       }
       for(int i=0;i<_SolPdeIndex.size();i++){
@@ -22,6 +22,7 @@
 #include "Mesh.hpp"
 #include "petscmat.h"
 #include "ParallelObject.hpp"
+#include "MatrixFreeOperator.hpp"
 
 
 namespace femus {
@@ -71,6 +72,31 @@ public:
 			
   unsigned GetSystemDof(const unsigned &soltype, const unsigned &kkindex_sol,
 			const unsigned &i, const unsigned &iel, const vector < vector <unsigned> > &otherKKoffset) const;
+
+  /** Get the contiguous list of the system dofs of the owned element iel for the pde variable kkindex_sol */
+  const unsigned* GetSystemDofs(const unsigned &kkindex_sol, const unsigned &iel) const {
+    unsigned ielIndex = (iel - _elementSystemDofStart) * _SolPdeIndex.size() + kkindex_sol;
+    assert(iel >= _elementSystemDofStart && ielIndex < _elementSystemDofOffset.size() - 1);
+    return &_elementSystemDof[ _elementSystemDofOffset[ielIndex] ];
+  }
+
+  /** Get the number of system dofs of the owned element iel, all the pde variables together */
+  unsigned GetElementSystemDofNumber(const unsigned &iel) const {
+    unsigned ielIndex = (iel - _elementSystemDofStart) * _SolPdeIndex.size();
+    return _elementSystemDofOffset[ielIndex + _SolPdeIndex.size()] - _elementSystemDofOffset[ielIndex];
+  }
+
+  /** Build the element to system dof table (CSR) of the owned elements, for all the pde variables */
+  void BuildElementSystemDofTable();
+
+  /** Use the element action elementAction to apply the operator of this level matrix-free: KK is not allocated (or it is
+   *  released if InitPde was already called). NULL goes back to the assembled matrix */
+  void SetMatrixFreeElementAction(ElementActionFunction elementAction);
+
+  /** Get the matrix-free operator of this level, NULL if the level uses the assembled matrix KK */
+  MatrixFreeOperator* GetMatrixFreeOperator() const {
+    return _KKmf;
+  }
 			
 
   /** To be Added */
@@ -88,6 +114,9 @@ public:
   /** AddLevel */
   void AddLevel();
 
+  /** Bytes owned on this process by the matrices, the vectors and the dof maps of the system */
+  std::size_t GetMemoryUsage() const;
+
   void SwapMatrices(){
     SparseMatrix *Temp = _KK;
     _KK = _KKamr;
@@ -100,6 +129,7 @@ public:
   NumericVector *_EPS, *_EPSC, *_RES, *_RESC;
   SparseMatrix *_KK;
   SparseMatrix *_KKamr;
+  MatrixFreeOperator *_KKmf;
   vector < vector <unsigned> > KKoffset;
   vector < unsigned > KKghostsize;
   vector < vector < int> > KKghost_nd;
@@ -121,6 +151,18 @@ protected:
   const vector <NumericVector*> *_Bdc;
   vector <bool> _SparsityPattern;
 
+  // cached element to system dof table (CSR) of the owned elements, pde variables are contiguous within each element
+  unsigned _elementSystemDofStart;
+  vector < unsigned > _elementSystemDofOffset;
+  vector < unsigned > _elementSystemDof;
+
+  ElementActionFunction _matrixFreeElementAction;
+
+private:
+
+  /** Allocate either the matrix KK or the matrix-free operator, after the system structures are initialized */
+  void InitMatrix();
+
 };
 
 } //end namespace femus
@@ -74,6 +74,12 @@ namespace femus {
                                  const double& divtol, const unsigned& maxits,
                                  const unsigned& restart) = 0;
 
+      /** Set only the relative tolerance, it is applied also to an already initialized solver (e.g. for inexact Newton) */
+      virtual void SetRelativeTolerance(const double& rtol) = 0;
+
+      /** Get the relative tolerance of the solver */
+      virtual double GetRelativeTolerance() const = 0;
+
       virtual KSP* GetKSP() {
         std::cout << "Warning GetKSP() is not available for this smoother\n";
         abort();
@@ -95,7 +101,21 @@ namespace femus {
                               const unsigned &npre, const unsigned &npost
                               ) = 0;
 
-      virtual void MGSolve(const bool ksp_clean) = 0;
+      /** Solves with the outer Krylov solver and the multigrid preconditioner. If updateResidual is false the residual
+       *  is recomputed, with one matrix-vector product, only if the Krylov method does not converge on the relative or
+       *  absolute tolerance (reaching the maximum number of iterations is not convergence) */
+      virtual void MGSolve(const bool ksp_clean, const bool updateResidual = true) = 0;
+
+      /** Returns false if the last MGSolve did not recompute the residual: _RES, and the residuals of the variables
+       *  in Solution, still hold the residual before the solve */
+      bool ResidualIsUpdated() const {
+        return _residualIsUpdated;
+      }
+
+      /** Returns the residual norm, in the norm of the Krylov method, at the end of the last MGSolve */
+      double GetKrylovResidualNorm() const {
+        return _krylovResidualNorm;
+      }
       
       virtual void SetRichardsonScaleFactor(const double & richardsonScaleFactor) = 0; 
 
@@ -189,6 +209,10 @@ namespace femus {
 
       bool _printSolverInfo;
 
+      bool _residualIsUpdated;
+
+      double _krylovResidualNorm;
+
   };
 
   /**
@@ -200,7 +224,9 @@ namespace femus {
     _solver_type(GMRES),
     _preconditioner(NULL),
     _is_initialized(false),
-    same_preconditioner(false) {
+    same_preconditioner(false),
+    _residualIsUpdated(true),
+    _krylovResidualNorm(0.) {
 
     if(igrid == 0) {
       _preconditioner_type = LU_PRECOND;
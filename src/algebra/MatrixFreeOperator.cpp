@@ -0,0 +1,410 @@
+/*=========================================================================
+
+ Program: FEMUS
+ Module: MatrixFreeOperator
+
+ Copyright (c) FEMTTU
+ All rights reserved.
+
+ This software is distributed WITHOUT ANY WARRANTY; without even
+ the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ PURPOSE.  See the above copyright notice for more information.
+
+=========================================================================*/
+
+#include "FemusConfig.hpp"
+
+#ifdef HAVE_PETSC
+
+//----------------------------------------------------------------------------
+// includes :
+//----------------------------------------------------------------------------
+#include <algorithm>
+#include <utility>
+#include "MatrixFreeOperator.hpp"
+#include "LinearEquation.hpp"
+#include "PetscVector.hpp"
+#include "Mesh.hpp"
+#include "ElemType.hpp"
+#include "Solution.hpp"
+
+namespace femus {
+
+  // ==============================================
+  MatrixFreeOperator::MatrixFreeOperator(LinearEquation *linearEquation, ElementActionFunction elementAction) {
+
+    _linearEquation = linearEquation;
+    _msh = linearEquation->_msh;
+    _elementAction = elementAction;
+
+    Vec EPS = (static_cast< PetscVector* >(_linearEquation->_EPS))->vec();
+
+    int ierr;
+    ierr = VecDuplicate(EPS, &_xGhosted);
+    CHKERRABORT(MPI_COMM_WORLD, ierr);
+    ierr = VecDuplicate(EPS, &_yGhosted);
+    CHKERRABORT(MPI_COMM_WORLD, ierr);
+    ierr = VecDuplicate(EPS, &_diagonal);
+    CHKERRABORT(MPI_COMM_WORLD, ierr);
+    _diagonalIsBuilt = false;
+
+    PetscInt size, localSize;
+    ierr = VecGetSize(EPS, &size);
+    CHKERRABORT(MPI_COMM_WORLD, ierr);
+    ierr = VecGetLocalSize(EPS, &localSize);
+    CHKERRABORT(MPI_COMM_WORLD, ierr);
+
+    ierr = MatCreateShell(MPI_COMM_WORLD, localSize, localSize, size, size, this, &_mat);
+    CHKERRABORT(MPI_COMM_WORLD, ierr);
+    ierr = MatShellSetOperation(_mat, MATOP_MULT, (void(*)(void)) MatMultShell);
+    CHKERRABORT(MPI_COMM_WORLD, ierr);
+    ierr = MatShellSetOperation(_mat, MATOP_GET_DIAGONAL, (void(*)(void)) MatGetDiagonalShell);
+    CHKERRABORT(MPI_COMM_WORLD, ierr);
+
+    BuildGeometricFactors();
+    BuildElementLocalDofs();
+
+  }
+
+  // ==============================================
+  MatrixFreeOperator::~MatrixFreeOperator() {
+
+    MatDestroy(&_mat);
+    VecDestroy(&_xGhosted);
+    VecDestroy(&_yGhosted);
+    VecDestroy(&_diagonal);
+
+  }
+
+  // ==============================================
+  std::size_t MatrixFreeOperator::GetMemoryUsage() const {
+
+    // the work vectors and the diagonal have the layout of _EPS
+    return 3 * _linearEquation->_EPS->GetMemoryUsage() +
+           (_geometricFactorOffset.capacity() + _elementLocalDofOffset.capacity()) * sizeof(unsigned) +
+           (_weight.capacity() + _jacobianInverse.capacity()) * sizeof(double) +
+           _elementLocalDof.capacity() * sizeof(int) + _dirichletRows.capacity() * sizeof(PetscInt);
+
+  }
+
+  // ==============================================
+  void MatrixFreeOperator::BuildGeometricFactors() {
+
+    const unsigned dim = _msh->GetDimension();
+    const unsigned xType = 2;
+
+    const unsigned elementStart = _msh->_elementOffset[_iproc];
+    const unsigned elementEnd = _msh->_elementOffset[_iproc + 1];
+
+    _geometricFactorOffset.assign(elementEnd - elementStart + 1, 0);
+
+    for(unsigned iel = elementStart; iel < elementEnd; iel++) {
+      short unsigned ielGeom = _msh->GetElementType(iel);
+      _geometricFactorOffset[iel - elementStart + 1] = _geometricFactorOffset[iel - elementStart] +
+                                                       _msh->_finiteElement[ielGeom][xType]->GetGaussPointNumber();
+    }
+
+    _weight.resize(_geometricFactorOffset.back());
+    _jacobianInverse.resize(_geometricFactorOffset.back() * dim * dim);
+
+    vector < vector < double > > x(dim);
+    vector < vector < double > > jacobianInverse;
+
+    for(unsigned iel = elementStart; iel < elementEnd; iel++) {
+
+      short unsigned ielGeom = _msh->GetElementType(iel);
+      unsigned nDofsX = _msh->GetElementDofNumber(iel, xType);
+      const int* xLocalDofs = _msh->GetElementSolutionLocalDofs(iel, xType);
+
+      for(unsigned k = 0; k < dim; k++) {
+        x[k].resize(nDofsX);
+        _msh->_topology->_Sol[k]->get_local(xLocalDofs, nDofsX, &x[k][0]);
+      }
+
+      const elem_type* fe = _msh->_finiteElement[ielGeom][xType];
+      unsigned igOffset = _geometricFactorOffset[iel - elementStart];
+
+      for(unsigned ig = 0; ig < fe->GetGaussPointNumber(); ig++) {
+        fe->GetJacobian(x, ig, _weight[igOffset + ig], jacobianInverse);
+        double* JacI = &_jacobianInverse[(igOffset + ig) * dim * dim];
+        for(unsigned k = 0; k < dim; k++) {
+          for(unsigned l = 0; l < dim; l++) {
+            JacI[k * dim + l] = jacobianInverse[k][l];
+          }
+        }
+      }
+    }
+
+  }
+
+  // ==============================================
+  void MatrixFreeOperator::BuildElementLocalDofs() {
+
+    const unsigned elementStart = _msh->_elementOffset[_iproc];
+    const unsigned elementEnd = _msh->_elementOffset[_iproc + 1];
+
+    const unsigned ownedStart = _linearEquation->KKoffset[0][_iproc];
+    const unsigned ownedEnd = _linearEquation->KKoffset[_linearEquation->KKIndex.size() - 1][_iproc];
+
+    // the ghost entries follow the owned ones in the local form, in the order given to VecCreateGhost
+    std::vector < std::pair < int, int > > ghostMap;
+    if(_nprocs > 1) {
+      const std::vector < int > &ghosts = _linearEquation->KKghost_nd[_iproc];
+      ghostMap.resize(ghosts.size());
+      for(unsigned i = 0; i < ghosts.size(); i++) {
+        ghostMap[i] = std::make_pair(ghosts[i], static_cast<int>(i));
+      }
+      std::sort(ghostMap.begin(), ghostMap.end());
+    }
+
+    _elementLocalDofOffset.assign(elementEnd - elementStart + 1, 0);
+    for(unsigned iel = elementStart; iel < elementEnd; iel++) {
+      _elementLocalDofOffset[iel - elementStart + 1] = _elementLocalDofOffset[iel - elementStart] +
+                                                       _linearEquation->GetElementSystemDofNumber(iel);
+    }
+
+    _elementLocalDof.resize(_elementLocalDofOffset.back());
+
+    for(unsigned iel = elementStart; iel < elementEnd; iel++) {
+      const unsigned* sysDofs = _linearEquation->GetSystemDofs(0, iel);
+      unsigned start = _elementLocalDofOffset[iel - elementStart];
+      unsigned nDofs = _elementLocalDofOffset[iel - elementStart + 1] - start;
+
+      for(unsigned i = 0; i < nDofs; i++) {
+        int idof = sysDofs[i];
+        if(idof >= static_cast<int>(ownedStart) && idof < static_cast<int>(ownedEnd)) {
+          _elementLocalDof[start + i] = idof - ownedStart;
+        }
+        else {
+          std::vector < std::pair < int, int > >::const_iterator it =
+            std::lower_bound(ghostMap.begin(), ghostMap.end(), std::make_pair(idof, 0));
+          if(it == ghostMap.end() || it->first != idof) {
+            std::cout << "Error in MatrixFreeOperator: dof " << idof << " is neither owned nor ghost" << std::endl;
+            abort();
+          }
+          _elementLocalDof[start + i] = (ownedEnd - ownedStart) + it->second;
+        }
+      }
+    }
+
+  }
+
+  // ==============================================
+  void MatrixFreeOperator::Update() {
+
+    BuildGeometricFactors();
+    _diagonalIsBuilt = false;
+
+    // a new state of the shell makes PCSetUp recompute the Jacobi diagonal
+    int ierr;
+    ierr = MatAssemblyBegin(_mat, MAT_FINAL_ASSEMBLY);
+    CHKERRABORT(MPI_COMM_WORLD, ierr);
+    ierr = MatAssemblyEnd(_mat, MAT_FINAL_ASSEMBLY);
+    CHKERRABORT(MPI_COMM_WORLD, ierr);
+
+  }
+
+  // ==============================================
+  void MatrixFreeOperator::SetDirichletRows(const std::vector < PetscInt > &rows) {
+    _dirichletRows = rows;
+  }
+
+  // ==============================================
+  void MatrixFreeOperator::mult(const NumericVector &x, NumericVector &y) {
+    const PetscVector* xPetsc = static_cast< const PetscVector* >(&x);
+    PetscVector* yPetsc = static_cast< PetscVector* >(&y);
+    yPetsc->close();
+    Apply(const_cast< PetscVector* >(xPetsc)->vec(), yPetsc->vec());
+    yPetsc->close();
+  }
+
+  // ==============================================
+  void MatrixFreeOperator::Apply(Vec x, Vec y) {
+
+    int ierr;
+
+    ierr = VecCopy(x, _xGhosted);
+    CHKERRABORT(MPI_COMM_WORLD, ierr);
+
+    Vec xLocal = _xGhosted;
+    Vec yLocal = _yGhosted;
+    if(_nprocs > 1) {
+      ierr = VecGhostUpdateBegin(_xGhosted, INSERT_VALUES, SCATTER_FORWARD);
+      CHKERRABORT(MPI_COMM_WORLD, ierr);
+      ierr = VecGhostUpdateEnd(_xGhosted, INSERT_VALUES, SCATTER_FORWARD);
+      CHKERRABORT(MPI_COMM_WORLD, ierr);
+      ierr = VecGhostGetLocalForm(_xGhosted, &xLocal);
+      CHKERRABORT(MPI_COMM_WORLD, ierr);
+      ierr = VecGhostGetLocalForm(_yGhosted, &yLocal);
+      CHKERRABORT(MPI_COMM_WORLD, ierr);
+    }
+
+    // zero also the ghost entries, they collect the contributions to the other processes
+    ierr = VecSet(yLocal, 0.);
+    CHKERRABORT(MPI_COMM_WORLD, ierr);
+
+    const PetscScalar* xArray;
+    PetscScalar* yArray;
+    ierr = VecGetArrayRead(xLocal, &xArray);
+    CHKERRABORT(MPI_COMM_WORLD, ierr);
+    ierr = VecGetArray(yLocal, &yArray);
+    CHKERRABORT(MPI_COMM_WORLD, ierr);
+
+    const unsigned dim = _msh->GetDimension();
+    const unsigned elementStart = _msh->_elementOffset[_iproc];
+    const unsigned elementEnd = _msh->_elementOffset[_iproc + 1];
+
+    std::vector < double > xe, ye;
+
+    for(unsigned iel = elementStart; iel < elementEnd; iel++) {
+      const int* localDofs = &_elementLocalDof[_elementLocalDofOffset[iel - elementStart]];
+      unsigned nDofs = _elementLocalDofOffset[iel - elementStart + 1] - _elementLocalDofOffset[iel - elementStart];
+
+      xe.resize(nDofs);
+      ye.assign(nDofs, 0.);
+      for(unsigned i = 0; i < nDofs; i++) {
+        xe[i] = xArray[localDofs[i]];
+      }
+
+      unsigned igOffset = _geometricFactorOffset[iel - elementStart];
+      _elementAction(_msh, iel, &_weight[igOffset], &_jacobianInverse[igOffset * dim * dim], xe, ye);
+
+      for(unsigned i = 0; i < nDofs; i++) {
+        yArray[localDofs[i]] += ye[i];
+      }
+    }
+
+    ierr = VecRestoreArrayRead(xLocal, &xArray);
+    CHKERRABORT(MPI_COMM_WORLD, ierr);
+    ierr = VecRestoreArray(yLocal, &yArray);
+    CHKERRABORT(MPI_COMM_WORLD, ierr);
+
+    if(_nprocs > 1) {
+      ierr = VecGhostRestoreLocalForm(_xGhosted, &xLocal);
+      CHKERRABORT(MPI_COMM_WORLD, ierr);
+      ierr = VecGhostRestoreLocalForm(_yGhosted, &yLocal);
+      CHKERRABORT(MPI_COMM_WORLD, ierr);
+      ierr = VecGhostUpdateBegin(_yGhosted, ADD_VALUES, SCATTER_REVERSE);
+      CHKERRABORT(MPI_COMM_WORLD, ierr);
+      ierr = VecGhostUpdateEnd(_yGhosted, ADD_VALUES, SCATTER_REVERSE);
+      CHKERRABORT(MPI_COMM_WORLD, ierr);
+    }
+
+    ierr = VecCopy(_yGhosted, y);
+    CHKERRABORT(MPI_COMM_WORLD, ierr);
+
+    // identity rows, as in the assembled matrix after MatZeroRows(KK, rows, 1., ...)
+    if(_dirichletRows.size() != 0) {
+      PetscInt ownedStart;
+      ierr = VecGetOwnershipRange(y, &ownedStart, NULL);
+      CHKERRABORT(MPI_COMM_WORLD, ierr);
+      ierr = VecGetArrayRead(x, &xArray);
+      CHKERRABORT(MPI_COMM_WORLD, ierr);
+      ierr = VecGetArray(y, &yArray);
+      CHKERRABORT(MPI_COMM_WORLD, ierr);
+      for(unsigned i = 0; i < _dirichletRows.size(); i++) {
+        yArray[_dirichletRows[i] - ownedStart] = xArray[_dirichletRows[i] - ownedStart];
+      }
+      ierr = VecRestoreArrayRead(x, &xArray);
+      CHKERRABORT(MPI_COMM_WORLD, ierr);
+      ierr = VecRestoreArray(y, &yArray);
+      CHKERRABORT(MPI_COMM_WORLD, ierr);
+    }
+
+  }
+
+  // ==============================================
+  void MatrixFreeOperator::BuildDiagonal() {
+
+    int ierr;
+
+    Vec dLocal = _diagonal;
+    if(_nprocs > 1) {
+      ierr = VecGhostGetLocalForm(_diagonal, &dLocal);
+      CHKERRABORT(MPI_COMM_WORLD, ierr);
+    }
+
+    ierr = VecSet(dLocal, 0.);
+    CHKERRABORT(MPI_COMM_WORLD, ierr);
+
+    PetscScalar* dArray;
+    ierr = VecGetArray(dLocal, &dArray);
+    CHKERRABORT(MPI_COMM_WORLD, ierr);
+
+    const unsigned dim = _msh->GetDimension();
+    const unsigned elementStart = _msh->_elementOffset[_iproc];
+    const unsigned elementEnd = _msh->_elementOffset[_iproc + 1];
+
+    std::vector < double > xe, ye;
+
+    // the diagonal of each element matrix is obtained by applying the element action to the unit vectors
+    for(unsigned iel = elementStart; iel < elementEnd; iel++) {
+      const int* localDofs = &_elementLocalDof[_elementLocalDofOffset[iel - elementStart]];
+      unsigned nDofs = _elementLocalDofOffset[iel - elementStart + 1] - _elementLocalDofOffset[iel - elementStart];
+      unsigned igOffset = _geometricFactorOffset[iel - elementStart];
+
+      xe.assign(nDofs, 0.);
+      for(unsigned i = 0; i < nDofs; i++) {
+        xe[i] = 1.;
+        ye.assign(nDofs, 0.);
+        _elementAction(_msh, iel, &_weight[igOffset], &_jacobianInverse[igOffset * dim * dim], xe, ye);
+        dArray[localDofs[i]] += ye[i];
+        xe[i] = 0.;
+      }
+    }
+
+    ierr = VecRestoreArray(dLocal, &dArray);
+    CHKERRABORT(MPI_COMM_WORLD, ierr);
+
+    if(_nprocs > 1) {
+      ierr = VecGhostRestoreLocalForm(_diagonal, &dLocal);
+      CHKERRABORT(MPI_COMM_WORLD, ierr);
+      ierr = VecGhostUpdateBegin(_diagonal, ADD_VALUES, SCATTER_REVERSE);
+      CHKERRABORT(MPI_COMM_WORLD, ierr);
+      ierr = VecGhostUpdateEnd(_diagonal, ADD_VALUES, SCATTER_REVERSE);
+      CHKERRABORT(MPI_COMM_WORLD, ierr);
+    }
+
+    _diagonalIsBuilt = true;
+
+  }
+
+  // ==============================================
+  void MatrixFreeOperator::GetDiagonal(Vec d) {
+
+    if(!_diagonalIsBuilt) BuildDiagonal();
+
+    int ierr = VecCopy(_diagonal, d);
+    CHKERRABORT(MPI_COMM_WORLD, ierr);
+
+    if(_dirichletRows.size() != 0) {
+      std::vector < PetscScalar > one(_dirichletRows.size(), 1.);
+      ierr = VecSetValues(d, _dirichletRows.size(), &_dirichletRows[0], &one[0], INSERT_VALUES);
+      CHKERRABORT(MPI_COMM_WORLD, ierr);
+      ierr = VecAssemblyBegin(d);
+      CHKERRABORT(MPI_COMM_WORLD, ierr);
+      ierr = VecAssemblyEnd(d);
+      CHKERRABORT(MPI_COMM_WORLD, ierr);
+    }
+
+  }
+
+  // ==============================================
+  PetscErrorCode MatrixFreeOperator::MatMultShell(Mat A, Vec x, Vec y) {
+    void* ctx;
+    MatShellGetContext(A, &ctx);
+    static_cast< MatrixFreeOperator* >(ctx)->Apply(x, y);
+    return 0;
+  }
+
+  // ==============================================
+  PetscErrorCode MatrixFreeOperator::MatGetDiagonalShell(Mat A, Vec d) {
+    void* ctx;
+    MatShellGetContext(A, &ctx);
+    static_cast< MatrixFreeOperator* >(ctx)->GetDiagonal(d);
+    return 0;
+  }
+
+} //end namespace femus
+
+#endif
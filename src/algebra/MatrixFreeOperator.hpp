@@ -0,0 +1,124 @@
+/*=========================================================================
+
+ Program: FEMUS
+ Module: MatrixFreeOperator
+
+ Copyright (c) FEMTTU
+ All rights reserved.
+
+ This software is distributed WITHOUT ANY WARRANTY; without even
+ the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ PURPOSE.  See the above copyright notice for more information.
+
+=========================================================================*/
+
+#ifndef __femus_algebra_MatrixFreeOperator_hpp__
+#define __femus_algebra_MatrixFreeOperator_hpp__
+
+#include "FemusConfig.hpp"
+
+#ifdef HAVE_PETSC
+
+//----------------------------------------------------------------------------
+// includes :
+//----------------------------------------------------------------------------
+#include <vector>
+#include <petscmat.h>
+#include "ParallelObject.hpp"
+
+namespace femus {
+
+//------------------------------------------------------------------------------
+// Forward declarations
+//------------------------------------------------------------------------------
+  class Mesh;
+  class LinearEquation;
+  class NumericVector;
+
+  /**
+   * Element action of a matrix-free operator, it adds A_iel x to y for the owned element iel.
+   * x and y hold the element dofs of all the pde variables, one variable after the other, in the order of
+   * LinearEquation::GetSystemDofs. weight[ig] and jacobianInverse[ig * dim * dim + k * dim + l] are the geometric factors
+   * of the element at the gauss point ig, so that dphi/dx_k = sum_l dphi/dxi_l jacobianInverse[ig * dim * dim + k * dim + l].
+   * The reference gradients at the gauss points and their transpose are given by elem_type::GetReferenceGradients and
+   * elem_type::AddReferenceGradientsTranspose, with the sum factorization on the biquadratic Quad and Hex
+   **/
+  typedef void (*ElementActionFunction)(const Mesh* msh, const unsigned &iel, const double* weight, const double* jacobianInverse,
+                                        const std::vector < double > &x, std::vector < double > &y);
+
+  /**
+   * This class wraps a PETSc MatShell with the layout of the matrix KK of a LinearEquation. The product is computed
+   * element by element with a user element action and geometric factors precomputed at the gauss points, so the
+   * operator can replace the assembled matrix in the Krylov iterations and, with Jacobi or no preconditioner, in the smoothers.
+   **/
+  class MatrixFreeOperator : public ParallelObject {
+
+    public:
+
+      /** Constructor, the system structures of linearEquation must be already initialized (see LinearEquation::InitPde) */
+      MatrixFreeOperator(LinearEquation *linearEquation, ElementActionFunction elementAction);
+
+      /** Destructor */
+      ~MatrixFreeOperator();
+
+      /** Returns the PETSc MatShell */
+      Mat mat() {
+        return _mat;
+      }
+
+      /** Computes y = A x */
+      void mult(const NumericVector &x, NumericVector &y);
+
+      /** To be called after each reassembly of the level: recomputes the geometric factors, in case the mesh moved,
+       *  drops the cached diagonal and marks the operator as changed, so that the preconditioners are set up again */
+      void Update();
+
+      /** Rows of the operator replaced by the identity, as MatZeroRows does with the assembled matrix */
+      void SetDirichletRows(const std::vector < PetscInt > &rows);
+
+      /** Bytes of the geometric factors, of the element dof tables and of the work vectors on this process */
+      std::size_t GetMemoryUsage() const;
+
+    private:
+
+      void BuildGeometricFactors();
+      void BuildElementLocalDofs();
+      void BuildDiagonal();
+
+      void Apply(Vec x, Vec y);
+      void GetDiagonal(Vec d);
+
+      static PetscErrorCode MatMultShell(Mat A, Vec x, Vec y);
+      static PetscErrorCode MatGetDiagonalShell(Mat A, Vec d);
+
+      // member data
+      LinearEquation *_linearEquation;
+      Mesh *_msh;
+      ElementActionFunction _elementAction;
+      Mat _mat;
+
+      // ghosted work vectors with the layout of LinearEquation::_EPS
+      Vec _xGhosted;
+      Vec _yGhosted;
+
+      // geometric factors of the owned elements at the gauss points (CSR, one block per element)
+      std::vector < unsigned > _geometricFactorOffset;
+      std::vector < double > _weight;
+      std::vector < double > _jacobianInverse;
+
+      // element dofs as indices in the local form of the ghosted work vectors (CSR, one block per element)
+      std::vector < unsigned > _elementLocalDofOffset;
+      std::vector < int > _elementLocalDof;
+
+      std::vector < PetscInt > _dirichletRows;
+
+      Vec _diagonal;
+      bool _diagonalIsBuilt;
+
+  };
+
+} //end namespace femus
+
+#endif
+
+#endif
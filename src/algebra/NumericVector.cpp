@@ -77,6 +77,34 @@ namespace femus
     return rvalue;
   }
 
+// ---------------------------------------------------------
+  void NumericVector::l2_linfty_norms(const std::vector < NumericVector* >& vectors,
+                                      std::vector < double >& l2Norms, std::vector < double >& linftyNorms)
+  {
+    l2Norms.resize(vectors.size());
+    linftyNorms.resize(vectors.size());
+
+    for(unsigned i = 0; i < vectors.size(); i++) {
+      vectors[i]->norm_begin();
+    }
+    for(unsigned i = 0; i < vectors.size(); i++) {
+      vectors[i]->norm_end(l2Norms[i], linftyNorms[i]);
+    }
+  }
+
+// ---------------------------------------------------------
+  void NumericVector::l2_norms(const std::vector < NumericVector* >& vectors, std::vector < double >& l2Norms)
+  {
+    l2Norms.resize(vectors.size());
+
+    for(unsigned i = 0; i < vectors.size(); i++) {
+      vectors[i]->l2_norm_begin();
+    }
+    for(unsigned i = 0; i < vectors.size(); i++) {
+      l2Norms[i] = vectors[i]->l2_norm_end();
+    }
+  }
+
 // ---------------------------------------------------------
   double NumericVector::subset_l1_norm(const std::set< int>& indices)
   {
@@ -161,6 +161,11 @@ public:
   /// \f$U=V\f$, and specify WHERE to insert
   virtual void insert (const NumericVector& V,
                        const std::vector< int>& dof_indices) = 0;
+  /// Copies the \p n owned entries of \p V starting at its local position \p vBegin into the owned entries of this vector
+  /// starting at the local position \p begin, with a single pass on the local arrays. If \p mask is not NULL the entries
+  /// whose mask value is not larger than \p maskThreshold are set to zero. The vector must be closed afterwards
+  virtual void insert_local_block (const NumericVector& V, const int vBegin, const int begin, const int n,
+                                   const NumericVector* mask = NULL, const double maskThreshold = 0.) = 0;
   /// \f$ U=V \f$ insert
   virtual void insert (const DenseVector& V,
                        const std::vector< int>& dof_indices) = 0;
@@ -202,6 +207,24 @@ public:
   /// @returns the maximum absolute value of the
   virtual double linfty_norm () const = 0;
 
+  /// Starts the computation of the \f$l_2\f$-norm and of the maximum absolute value, completed by \p norm_end.
+  /// The norms of all the vectors started before the first \p norm_end are completed with a single global reduction
+  virtual void norm_begin () const = 0;
+  /// Completes the computation started by \p norm_begin
+  virtual void norm_end (double &l2Norm, double &linftyNorm) const = 0;
+
+  /// Starts the computation of the \f$l_2\f$-norm only, completed by \p l2_norm_end, as \p norm_begin
+  virtual void l2_norm_begin () const = 0;
+  /// Completes the computation started by \p l2_norm_begin
+  virtual double l2_norm_end () const = 0;
+
+  /// Computes the \f$l_2\f$-norms and the maximum absolute values of several vectors with a single global reduction
+  static void l2_linfty_norms (const std::vector < NumericVector* > &vectors,
+                               std::vector < double > &l2Norms, std::vector < double > &linftyNorms);
+
+  /// Computes the \f$l_2\f$-norms of several vectors with a single global reduction
+  static void l2_norms (const std::vector < NumericVector* > &vectors, std::vector < double > &l2Norms);
+
   /// @returns the \f$l_1\f$-norm of the vector, i.e.
   virtual double subset_l1_norm (const std::set< int> & indices);
   /// @returns the \f$l_2\f$-norm of the vector, i.e.
@@ -218,6 +241,8 @@ public:
   virtual  int first_local_index() const = 0;
   /// @returns the index+1 of the last vector element
   virtual  int last_local_index() const = 0;
+  /// @returns the bytes of the values stored on this process, ghost values included
+  virtual std::size_t GetMemoryUsage() const = 0;
 
   ///Access components, returns \p U(i).
   virtual double operator() (const  int i) const = 0;
@@ -234,6 +259,20 @@ public:
    */
   virtual void get(const std::vector< int>& index, std::vector<double>& values) const;
 
+  /**
+   * Access \p n components at once through indices of the local array (owned entries first, then
+   * ghost entries), copying straight from the array. The indices are resolved once per mesh level,
+   * see Mesh::GetElementSolutionLocalDofs.
+   */
+  virtual void get_local(const int* local_index, const unsigned& n, double* values) const = 0;
+
+  /**
+   * Makes the local array available to the read accessors \p operator(), \p get and \p get_local,
+   * that afterwards only read it. It must be called before reading the vector from several threads
+   * (see ThreadedElementLoop): any write operation releases the array again.
+   */
+  virtual void acquire_local_array() const = 0;
+
   // =====================================
   // algebra FUNCTIONS
   // =====================================
@@ -260,7 +299,8 @@ public:
   /// \f$U+=a*V\f$. Simple vector addition, equal to the
   virtual void add (const double a, const NumericVector& v) = 0;
 
-  /// \f$ U+=v \f$ where \p v is a std::vector !!!fast
+  /// \f$ U+=v \f$ where \p v is a std::vector !!!fast. The add_vector_blocked and add_vector overloads with dof indices
+  /// can be called inside the threaded loops (ThreadedElementLoop, ThreadedParticleLoop), the single entry set and add cannot
   virtual void add_vector_blocked(const std::vector<double>& v,
 			const std::vector< int>& dof_indices) =0;
   
@@ -395,6 +395,22 @@ namespace femus {
     return value;
   }
 
+// ==========================================
+  std::size_t PetscMatrix::GetMemoryUsage() const {
+    if(!this->initialized()) return 0;
+
+    MatInfo info;
+    int ierr = MatGetInfo(_mat, MAT_LOCAL, &info);
+    CHKERRABORT(MPI_COMM_WORLD, ierr);
+    PetscInt localRows, localColumns;
+    ierr = MatGetLocalSize(_mat, &localRows, &localColumns);
+    CHKERRABORT(MPI_COMM_WORLD, ierr);
+
+    // AIJ storage, the parallel matrices keep the diagonal and the off-diagonal blocks in two CSR structures
+    double bytes = info.nz_allocated * (sizeof(PetscScalar) + sizeof(PetscInt)) + 2. * (localRows + 1) * sizeof(PetscInt);
+    return static_cast < std::size_t >((info.memory > bytes) ? info.memory : bytes);
+  }
+
 // ==========================================
   double PetscMatrix::linfty_norm() const {
     assert(this->initialized());
@@ -614,6 +630,9 @@ void PetscMatrix::print_matlab(const std::string& name, const std::string& forma
 
     int ierr = 0;
     // These casts are required for PETSc <= 2.1.5
+#ifdef HAVE_OPENMP
+    #pragma omp critical (PetscInsertion)
+#endif
     ierr = MatSetValues(_mat,
                         m, (int*) &rows[0],
                         n, (int*) &cols[0],
@@ -645,6 +664,11 @@ void PetscMatrix::print_matlab(const std::string& name, const std::string& forma
     assert(m * n == mat_values.size());
 
     //These casts are required for PETSc <= 2.1.5
+#ifdef HAVE_OPENMP
+    // element contributions may come from several threads (see ThreadedElementLoop), in the same critical section
+    // of all the insertions into vectors and matrices (see PetscVector::add_vector_blocked)
+    #pragma omp critical (PetscInsertion)
+#endif
     ierr = MatSetValuesBlocked(_mat, m, &rows[0], n, &cols[0],
                                (PetscScalar*) &mat_values[0], ADD_VALUES);
     CHKERRABORT(MPI_COMM_WORLD, ierr);
@@ -168,6 +168,8 @@ public:
   double l1_norm() const;
   /// Return the linfty-norm of the matrix
   double linfty_norm() const;
+  /// Return the bytes allocated for the local rows (values, column indices and row pointers)
+  std::size_t GetMemoryUsage() const;
 
   /// Petsc matrix has been closed and fully assembled
   bool closed() const;
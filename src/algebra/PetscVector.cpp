@@ -86,6 +86,68 @@ double PetscVector::linfty_norm() const {
   return static_cast<double>(value);
 }
 
+// ============================================
+void PetscVector::norm_begin() const {
+  this->_restore_array();
+  assert(this->closed());
+  PetscReal value = 0.; // not used, the norms are returned by VecNormEnd
+  int ierr = VecNormBegin(_vec, NORM_2, &value);
+  CHKERRABORT(MPI_COMM_WORLD,ierr);
+  ierr = VecNormBegin(_vec, NORM_INFINITY, &value);
+  CHKERRABORT(MPI_COMM_WORLD,ierr);
+}
+
+// ============================================
+void PetscVector::norm_end(double &l2Norm, double &linftyNorm) const {
+  PetscReal value2 = 0., valueInfinity = 0.;
+  int ierr = VecNormEnd(_vec, NORM_2, &value2);
+  CHKERRABORT(MPI_COMM_WORLD,ierr);
+  ierr = VecNormEnd(_vec, NORM_INFINITY, &valueInfinity);
+  CHKERRABORT(MPI_COMM_WORLD,ierr);
+  l2Norm = static_cast<double>(value2);
+  linftyNorm = static_cast<double>(valueInfinity);
+}
+
+// ============================================
+void PetscVector::l2_norm_begin() const {
+  this->_restore_array();
+  assert(this->closed());
+  PetscReal value = 0.; // not used, the norm is returned by VecNormEnd
+  int ierr = VecNormBegin(_vec, NORM_2, &value);
+  CHKERRABORT(MPI_COMM_WORLD,ierr);
+}
+
+// ============================================
+double PetscVector::l2_norm_end() const {
+  PetscReal value = 0.;
+  int ierr = VecNormEnd(_vec, NORM_2, &value);
+  CHKERRABORT(MPI_COMM_WORLD,ierr);
+  return static_cast<double>(value);
+}
+
+// ============================================
+std::size_t PetscVector::GetMemoryUsage() const {
+  if(!this->initialized()) return 0;
+
+  PetscInt localSize = 0;
+  int ierr;
+  if(this->type() == GHOSTED) {
+    Vec localForm;
+    ierr = VecGhostGetLocalForm(_vec, &localForm);
+    CHKERRABORT(MPI_COMM_WORLD,ierr);
+    ierr = VecGetLocalSize(localForm, &localSize);
+    CHKERRABORT(MPI_COMM_WORLD,ierr);
+    ierr = VecGhostRestoreLocalForm(_vec, &localForm);
+    CHKERRABORT(MPI_COMM_WORLD,ierr);
+  }
+  else {
+    ierr = VecGetLocalSize(_vec, &localSize);
+    CHKERRABORT(MPI_COMM_WORLD,ierr);
+  }
+
+  return localSize * sizeof(PetscScalar) + _global_to_local_map.capacity() * sizeof(GlobalToLocalMap::value_type);
+}
+
 // =======================================
 NumericVector& PetscVector::operator += (const NumericVector& v) {
   this->_restore_array();
@@ -135,7 +197,13 @@ void PetscVector::add_vector_blocked(const std::vector<double>& values,
   int dof_size = dof_indices.size();
   assert(values.size() == dof_size);
 
-  int ierr = VecSetValues(_vec,dof_size,&dof_indices[0],&values[0],ADD_VALUES);
+  int ierr;
+#ifdef HAVE_OPENMP
+  // element contributions may come from several threads (see ThreadedElementLoop); PETSc is not thread safe,
+  // all the insertions into vectors and matrices share the same critical section
+  #pragma omp critical (PetscInsertion)
+#endif
+  ierr = VecSetValues(_vec,dof_size,&dof_indices[0],&values[0],ADD_VALUES);
   CHKERRABORT(MPI_COMM_WORLD,ierr);
 
 }
@@ -143,15 +211,23 @@ void PetscVector::add_vector_blocked(const std::vector<double>& values,
 // ===============================================================
 void PetscVector::add_vector(const std::vector<double>& v,
                               const std::vector< int>& dof_indices) {
-  this->_restore_array();
   assert(v.size() == dof_indices.size());
-  for (int i=0; i<(int)v.size(); i++)    this->add(dof_indices[i], v[i]);
+#ifdef HAVE_OPENMP
+  #pragma omp critical (PetscInsertion)
+#endif
+  {
+    this->_restore_array();
+    for (int i=0; i<(int)v.size(); i++)    this->add(dof_indices[i], v[i]);
+  }
 }
 
 // ===========================================================
 void PetscVector::add_vector(const NumericVector& V,
                               const std::vector< int>& dof_indices) {
   assert((int)V.size() == (int)dof_indices.size());
+#ifdef HAVE_OPENMP
+  #pragma omp critical (PetscInsertion)
+#endif
   for (int i=0; i<(int)V.size(); i++) this->add(dof_indices[i], V(i));
 }
 
@@ -174,6 +250,9 @@ void PetscVector::add_vector(const NumericVector& V_in,
 void PetscVector::add_vector(const DenseVector& V,
                               const std::vector<unsigned int>& dof_indices) {
   assert((int)V.size() == dof_indices.size());
+#ifdef HAVE_OPENMP
+  #pragma omp critical (PetscInsertion)
+#endif
   for (int i=0; i<(int)V.size(); i++)  this->add(dof_indices[i], V(i));
 }
 // ====================================================
@@ -310,7 +389,11 @@ void PetscVector::add(const double a_in, const NumericVector& v_in) {
 void PetscVector::insert(const std::vector<double>& v,
                           const std::vector< int>& dof_indices) {
   assert(v.size() == dof_indices.size());
-  for (int i=0; i<(int)v.size(); i++)    this->set(dof_indices[i], v[i]);
+  if (v.size() == 0) return;
+  this->_restore_array();
+  int ierr = VecSetValues(_vec, v.size(), &dof_indices[0], &v[0], INSERT_VALUES);
+  CHKERRABORT(MPI_COMM_WORLD,ierr);
+  this->_is_closed = false;
 }
 
 // =======================================================
@@ -334,6 +417,38 @@ void PetscVector::insert(const DenseSubVector& V,
   for (int i=0; i<(int)V.size(); i++)  this->set(dof_indices[i], V(i));
 }
 
+// =========================================================
+void PetscVector::insert_local_block(const NumericVector& V_in, const int vBegin, const int begin, const int n,
+                                     const NumericVector* mask_in, const double maskThreshold) {
+  const PetscVector* V = static_cast<const PetscVector*>(&V_in);
+  const PetscVector* mask = static_cast<const PetscVector*>(mask_in);
+
+  assert(vBegin + n <= V->local_size());
+  assert(begin + n <= this->local_size());
+
+  // the owned entries come first also in the local form of a ghosted vector
+  V->_get_array();
+  if (mask) mask->_get_array();
+
+  this->_restore_array();
+  PetscScalar* values;
+  int ierr = VecGetArray(_vec, &values);
+  CHKERRABORT(MPI_COMM_WORLD,ierr);
+
+  if (mask) {
+    for (int i=0; i<n; i++) {
+      values[begin + i] = (mask->_values[begin + i] > maskThreshold) ? V->_values[vBegin + i] : 0.;
+    }
+  }
+  else {
+    for (int i=0; i<n; i++) values[begin + i] = V->_values[vBegin + i];
+  }
+
+  ierr = VecRestoreArray(_vec, &values);
+  CHKERRABORT(MPI_COMM_WORLD,ierr);
+  this->_is_closed = false;
+}
+
 // ================================================
 void PetscVector::scale(const double factor_in) {
   this->_restore_array();
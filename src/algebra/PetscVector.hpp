@@ -24,9 +24,13 @@
 #ifdef HAVE_PETSC
 
 // C++ includes
-#include <map>
 #include <vector>
+#include <algorithm>
+#include <utility>
 #include <cstdio>
+#ifdef HAVE_OPENMP
+#include <omp.h>
+#endif
 // Local includes
 #include "NumericVector.hpp"
 #include "PetscMacro.hpp"
@@ -93,7 +97,7 @@ public:
   void clear ();
 
 
-  /// Change the dimension of the vector to \p N. doublehe reserved memory for
+  /// Change the dimension of the vector to \p N. The reserved memory for
   /// this vector remains unchanged if possible, to make things faster, but
   /// this may waste some memory, so take this in the back of your head.
   /// However, if \p N==0 all memory is freed, i.e. if you want to resize
@@ -148,6 +152,9 @@ public:
   void insert (const DenseVector& V, const std::vector<int>& dof_indices);
   /// \f$ U=V \f$ where V is type DenseSubVector
   void insert (const DenseSubVector& V, const std::vector<int>& dof_indices);
+  /// Copies a block of owned entries of V into the owned entries of this vector, see NumericVector
+  void insert_local_block (const NumericVector& V, const int vBegin, const int begin, const int n,
+                           const NumericVector* mask = NULL, const double maskThreshold = 0.);
 
   // ===========================
   // RETURN FUNCTIONS
@@ -167,11 +174,17 @@ public:
   double l2_norm () const;     ///< This function returns the \f$l_2\f$-norm of the vector
   double linfty_norm () const; ///< This function returns the maximum absolute value of the elements of this vector
 
+  void norm_begin () const;    ///< Starts the split-phase computation of the l2 and linfty norms
+  void norm_end (double &l2Norm, double &linftyNorm) const; ///< Completes the split-phase computation of the norms
+  void l2_norm_begin () const; ///< Starts the split-phase computation of the l2 norm only
+  double l2_norm_end () const;  ///< Completes the split-phase computation of the l2 norm
+
 
   int size () const;         ///< This function returns dimension of the vector
   int local_size() const;    ///< This function returns the local size of the vector (index_stop-index_start)
   int first_local_index() const;  ///< This function returns the index of the first vector element
   int last_local_index() const;   ///< This function returns the index of the last vector element
+  std::size_t GetMemoryUsage() const; ///< This function returns the bytes stored on this process, ghost values included
 
   /// Maps the global index \p i to the corresponding global index. If
   /// the index is not a ghost cell, this is done by subtraction the
@@ -179,6 +192,9 @@ public:
   /// to be looked up in the map.
   int map_global_to_local_index(const int i) const;
 
+  /// Access \p n components through local indices, copying straight from the local array.
+  void get_local(const int* local_index, const unsigned& n, double* values) const;
+
   /// Access components, returns \p U(i).
   double operator() (const int i) const;
 
@@ -188,6 +204,11 @@ public:
   /// operator() individually for each index.
   void get(const std::vector<int>& index, std::vector<double>& values) const;
 
+  /// Makes the local array available to the read accessors, see NumericVector::acquire_local_array.
+  void acquire_local_array() const {
+    this->_get_array();
+  }
+
   // ===========================
   // ALGEBRA FUNCTIONS
   // ===========================
@@ -284,30 +305,41 @@ private:
   Vec _vec;
 
   /// If \p true, the actual Petsc array of the values of the vector is currently accessible.
-  /// doublehat means that the members \p _local_form and \p _values are valid.
+  /// That means that the members \p _local_form and \p _values are valid.
   mutable bool _array_is_present;
 
   /// Petsc vector datatype to hold the local form of a ghosted vector.
-  /// doublehe contents of this field are only valid if the vector is
+  /// The contents of this field are only valid if the vector is
   /// ghosted and \p _array_is_present is \p true.
   mutable Vec _local_form;
 
   /// Pointer to the actual Petsc array of the values of the vector.
-  /// doublehis pointer is only valid if \p _array_is_present is \p true.
+  /// This pointer is only valid if \p _array_is_present is \p true.
   mutable PetscScalar* _values;
 
-  /// doubleype for map that maps global to local ghost cells.
-  typedef std::map<int,int> GlobalToLocalMap;
+  /// Type for map that maps global to local ghost cells: (global, local) pairs sorted by global index.
+  typedef std::vector< std::pair<int,int> > GlobalToLocalMap;
+
+  /// Sorts the ghost map entries so that they can be found with a bisection search
+  void _sort_global_to_local_map();
+
+  /// Same as \p map_global_to_local_index, but uses the ownership range cached by \p _get_array
+  int _map_global_to_local_index(const int i) const;
 
   /// Map that maps global to local ghost cells (will be empty if not in ghost cell mode
   GlobalToLocalMap _global_to_local_map;
 
-  /// doublehis boolean value should only be set to false
+  /// This boolean value should only be set to false
   /// for the constructor which takes a PETSc Vec object.
   bool _destroy_vec_on_exit;
 
+  /// Ownership range, queried together with the array.
+  /// The contents of these fields are only valid if \p _array_is_present is \p true.
+  mutable int _first_local_index;
+  mutable int _last_local_index;
+
 #ifndef NDEBUG
-  ///Size of the local form, for being used in assertations.  doublehe
+  ///Size of the local form, for being used in assertations.  The
   /// contents of this field are only valid if the vector is ghosted
   /// and \p _array_is_present is \p true.
   mutable int _local_size;
@@ -325,7 +357,9 @@ inline PetscVector::PetscVector (const ParallelType type)
     _local_form(NULL),
     _values(NULL),
     _global_to_local_map(),
-    _destroy_vec_on_exit(true) {
+    _destroy_vec_on_exit(true),
+    _first_local_index(0),
+    _last_local_index(0) {
   this->_type = type;
 }
 
@@ -334,7 +368,9 @@ inline PetscVector::PetscVector (const int n,const ParallelType type)
     _local_form(NULL),
     _values(NULL),
     _global_to_local_map(),
-    _destroy_vec_on_exit(true) {
+    _destroy_vec_on_exit(true),
+    _first_local_index(0),
+    _last_local_index(0) {
   this->init(n, n, false, type);
 }
 
@@ -345,7 +381,9 @@ inline PetscVector::PetscVector (const int n,
     _local_form(NULL),
     _values(NULL),
     _global_to_local_map(),
-    _destroy_vec_on_exit(true) {
+    _destroy_vec_on_exit(true),
+    _first_local_index(0),
+    _last_local_index(0) {
   this->init(n, n_local, false, type);
 }
 
@@ -357,7 +395,9 @@ inline PetscVector::PetscVector (const int n,
     _local_form(NULL),
     _values(NULL),
     _global_to_local_map(),
-    _destroy_vec_on_exit(true) {
+    _destroy_vec_on_exit(true),
+    _first_local_index(0),
+    _last_local_index(0) {
   this->init(n, n_local, ghost, false, type);
 }
 
@@ -366,7 +406,9 @@ inline PetscVector::PetscVector (Vec v)
     _local_form(NULL),
     _values(NULL),
     _global_to_local_map(),
-    _destroy_vec_on_exit(false) {
+    _destroy_vec_on_exit(false),
+    _first_local_index(0),
+    _last_local_index(0) {
   this->_vec = v;
   this->_is_closed = true;
   this->_is_initialized = true;
@@ -427,7 +469,8 @@ inline PetscVector::PetscVector (Vec v)
       CHKERRABORT(MPI_COMM_WORLD,ierr);
 #endif
       for(unsigned int i=ghost_begin; i<ghost_end; i++)
-        _global_to_local_map[indices[i]] = i-local_size;
+        _global_to_local_map.push_back(std::make_pair(indices[i], i-local_size));
+      _sort_global_to_local_map();
       this->_type = GHOSTED;
 #if !PETSC_VERSION_RELEASE || !PETSC_VERSION_LESS_THAN(3,1,1)
       ierr = ISLocalToGlobalMappingRestoreIndices(mapping, &indices);
@@ -540,9 +583,11 @@ inline void PetscVector::init (const int n,
   this->_type = GHOSTED;
 
   /* Make the global-to-local ghost cell map.  */
+  _global_to_local_map.resize(ghost.size());
   for (int i=0; i<(int)ghost.size(); i++){
-    _global_to_local_map[ghost[i]] = i;
+    _global_to_local_map[i] = std::make_pair(ghost[i], i);
   }
+  _sort_global_to_local_map();
 
   /* Create vector.  */
   ierr = VecCreateGhost (MPI_COMM_WORLD, petsc_n_local, petsc_n,
@@ -692,15 +737,36 @@ inline int PetscVector::map_global_to_local_index (const int i) const {
     return i-first;
   }
 
-  GlobalToLocalMap::const_iterator it = _global_to_local_map.find(i);
-  assert (it!=_global_to_local_map.end());
+  GlobalToLocalMap::const_iterator it = std::lower_bound(_global_to_local_map.begin(), _global_to_local_map.end(),
+                                                         std::make_pair(i, static_cast<int>(0)));
+  assert (it!=_global_to_local_map.end() && it->first == i);
   return it->second+last-first;
 }
 
 
+inline int PetscVector::_map_global_to_local_index (const int i) const {
+  assert (_array_is_present);
+
+  if ((i>=_first_local_index) && (i<_last_local_index))    {
+    return i-_first_local_index;
+  }
+
+  GlobalToLocalMap::const_iterator it = std::lower_bound(_global_to_local_map.begin(), _global_to_local_map.end(),
+                                                         std::make_pair(i, static_cast<int>(0)));
+  assert (it!=_global_to_local_map.end() && it->first == i);
+  return it->second+_last_local_index-_first_local_index;
+}
+
+
+inline void PetscVector::_sort_global_to_local_map() {
+  // local ghost indices are unique, so sorting the pairs sorts by global index
+  std::sort(_global_to_local_map.begin(), _global_to_local_map.end());
+}
+
+
 inline double PetscVector::operator() (const int i) const {
   this->_get_array();
-  const int local_index = this->map_global_to_local_index(i);
+  const int local_index = this->_map_global_to_local_index(i);
 #ifndef NDEBUG
     if (this->type() == GHOSTED) assert(local_index<_local_size);
 #endif
@@ -721,7 +787,7 @@ inline void PetscVector::get(const std::vector<int>& index, std::vector<double>&
   values.resize(num);
 
   for (int i=0; i<num; i++) {
-    const int local_index = this->map_global_to_local_index(index[i]);
+    const int local_index = this->_map_global_to_local_index(index[i]);
 #ifndef NDEBUG
     if (this->type() == GHOSTED) assert(local_index<_local_size);
 #endif
@@ -729,6 +795,18 @@ inline void PetscVector::get(const std::vector<int>& index, std::vector<double>&
   }
 }
 
+
+inline void PetscVector::get_local(const int* local_index, const unsigned& n, double* values) const {
+  this->_get_array();
+
+  for (unsigned i=0; i<n; i++) {
+#ifndef NDEBUG
+    if (this->type() == GHOSTED) assert(local_index[i]<_local_size);
+#endif
+    values[i] = static_cast<double>(_values[local_index[i]]);
+  }
+}
+
 inline double PetscVector::min () const {
   this->_restore_array();
   int index=0, ierr=0;
@@ -760,13 +838,21 @@ inline void PetscVector::swap (NumericVector &other) {
   std::swap(_array_is_present, v._array_is_present);
   std::swap(_local_form, v._local_form);
   std::swap(_values, v._values);
+  std::swap(_first_local_index, v._first_local_index);
+  std::swap(_last_local_index, v._last_local_index);
 }
 
 
 inline void PetscVector::_get_array(void) const {
   assert (this->initialized());
   if (!_array_is_present) {
+#if defined(HAVE_OPENMP) && !defined(NDEBUG)
+    // threads only read: the array has to be acquired before the parallel region, see acquire_local_array
+    assert (!omp_in_parallel());
+#endif
     int ierr=0;
+    ierr = VecGetOwnershipRange (_vec, &_first_local_index, &_last_local_index);
+    CHKERRABORT(MPI_COMM_WORLD,ierr);
     if (this->type() != GHOSTED) {
       ierr = VecGetArray(_vec, &_values);
       CHKERRABORT(MPI_COMM_WORLD,ierr);
@@ -145,7 +145,8 @@ public:
 
     // Operations ---------------------------------
     // Add
-    /** Add the full matrix to the Sparse matrix. */
+    /** Add the full matrix to the Sparse matrix. The add_matrix and add_matrix_blocked overloads can be called inside
+     *  the threaded loops (ThreadedElementLoop, ThreadedParticleLoop), the single entry set and add cannot */
     virtual void add_matrix (const DenseMatrix &dm,
                              const std::vector<unsigned int> &rows,
                              const std::vector<unsigned int> &cols) = 0;
@@ -200,6 +201,9 @@ public:
     /** Return the linfty-norm */
     virtual double linfty_norm () const = 0;
 
+    /** Return the bytes allocated for the local rows */
+    virtual std::size_t GetMemoryUsage () const = 0;
+
     /** Multiplies the matrix with \p arg and stores the result in \p dest. */
     void vector_mult (NumericVector& dest,const NumericVector& arg) const;
 
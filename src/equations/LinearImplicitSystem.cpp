@@ -18,6 +18,7 @@
 #include "SparseMatrix.hpp"
 #include "NumericVector.hpp"
 #include "ElemType.hpp"
+#include "Profiler.hpp"
 #include <iomanip>
 
 namespace femus {
@@ -32,6 +33,7 @@ namespace femus {
     _n_max_linear_iterations(3),
     _final_linear_residual(1.e20),
     _linearAbsoluteConvergenceTolerance(1.e-08),
+    _linearResidualTarget(0.),
     _mg_type(F_CYCLE),
     _npre(1),
     _npost(1),
@@ -43,7 +45,14 @@ namespace femus {
     _MGmatrixFineReuse(false),
     _MGmatrixCoarseReuse(false),
     _printSolverInfo(false),
-    _assembleMatrix(true) {
+    _assembleMatrix(true),
+    _matrixFreeElementAction(NULL),
+    _explicitResidualUpdatePeriod(1),
+    _mgSolveCounter(0),
+    _coarseOperatorReuse(false),
+    _coarseOperatorFreezeSteps(1),
+    _coarseOperatorLevel(-1),
+    _coarseOperatorAge(0) {
         
     _SparsityPattern.resize(0);
     _outer_ksp_solver = "gmres";
@@ -93,6 +102,30 @@ namespace femus {
 
   // ********************************************
 
+  void LinearImplicitSystem::SetMatrixFreeElementAction(ElementActionFunction elementAction) {
+    _matrixFreeElementAction = elementAction;
+
+    // before init, init gives the action to the finest level
+    if(_LinSolver.size() == _gridn) {
+      CheckMatrixFree();
+      _LinSolver[_gridn - 1]->SetMatrixFreeElementAction(_matrixFreeElementAction);
+    }
+  }
+
+  // ********************************************
+
+  void LinearImplicitSystem::CheckMatrixFree() {
+    if(_matrixFreeElementAction) {
+      if(!_ml_msh->GetLevel(_gridn - 1)->GetIfHomogeneous() || (_gridn > 1 && _SmootherType != GMRES_SMOOTHER)) {
+        std::cout << "Error in LinearImplicitSystem: the matrix-free finest level needs "
+                  << "a homogeneous mesh and the Gmres smoother" << std::endl;
+        abort();
+      }
+    }
+  }
+
+  // ********************************************
+
   void LinearImplicitSystem::init() {
 
     _LinSolver.resize(_gridn);
@@ -103,6 +136,10 @@ namespace femus {
       _LinSolver[i] = LinearEquationSolver::build(i, _solution[i], _SmootherType).release();
     }
 
+    // only the finest level is matrix-free, the coarse levels keep their assembled matrices
+    CheckMatrixFree();
+    _LinSolver[_gridn - 1]->SetMatrixFreeElementAction(_matrixFreeElementAction);
+
     for(unsigned i = 0; i < _gridn; i++) {
       _LinSolver[i]->InitPde(_SolSystemPdeIndex, _ml_sol->GetSolType(),
                              _ml_sol->GetSolName(), &_solution[i]->_Bdc, _gridn, _SparsityPattern);
@@ -156,7 +193,7 @@ namespace femus {
 
     _bitFlipCounter = 0;
     
-    clock_t start_mg_time = clock();
+    ProfilerRegion solveRegion("LinearSolve");
 
     unsigned grid0;
 
@@ -183,14 +220,19 @@ namespace femus {
 restart:
       if(ThisIsAMR) _solution[igridn]->InitAMREps();
 
-      clock_t start_preparation_time = clock();
+      ProfilerRegion preparationRegion("Preparation");
 
       _levelToAssemble = igridn; //Be carefull!!!! this is needed in the _assemble_function
       _LinSolver[igridn]->SetResZero();
       _assembleMatrix = true;
-      clock_t start_assembly_time = clock();
+      ProfilerRegion assemblyRegion("Assembly");
       _assemble_system_function(_equation_systems);
-      std::cout << std::endl << " ****** Level Max " << igridn + 1 << " ASSEMBLY TIME:\t" << static_cast<double>((clock() - start_assembly_time)) / CLOCKS_PER_SEC << std::endl;  
+      assemblyRegion.Stop();
+      std::cout << std::endl << " ****** Level Max " << igridn + 1 << " ASSEMBLY TIME:\t" << assemblyRegion.GetElapsedTime() << std::endl;  
+
+      if(_LinSolver[igridn]->GetMatrixFreeOperator()) {
+        _LinSolver[igridn]->GetMatrixFreeOperator()->Update();
+      }
       
       
       if(!_ml_msh->GetLevel(igridn)->GetIfHomogeneous()) {
@@ -211,34 +253,13 @@ restart:
 
       _MGmatrixFineReuse = false;
       _MGmatrixCoarseReuse = (igridn - grid0 > 0) ?  true : _MGmatrixFineReuse;
-      for(unsigned i = igridn; i > 0; i--) {
-        if(_RR[i]) {
-          if(i == igridn)
-            _LinSolver[i - 1u]->_KK->matrix_ABC(*_RR[i], *_LinSolver[i]->_KK, *_PP[i], _MGmatrixFineReuse);
-          else {
-            _LinSolver[i - 1u]->_KK->matrix_ABC(*_RR[i], *_LinSolver[i]->_KK, *_PP[i], _MGmatrixCoarseReuse);
-            if(_LinSolver[i - 1u]->_KKamr) {
-              delete _LinSolver[i - 1u]->_KKamr;
-              _LinSolver[i - 1u]->_KKamr = NULL;
-            }
-          }
-        }
-        else {
-          if(i == igridn)
-            _LinSolver[i - 1u]->_KK->matrix_PtAP(*_PP[i], *_LinSolver[i]->_KK, _MGmatrixFineReuse);
-          else {
-            _LinSolver[i - 1u]->_KK->matrix_PtAP(*_PP[i], *_LinSolver[i]->_KK, _MGmatrixCoarseReuse);
-            if(_LinSolver[i - 1u]->_KKamr) {
-              delete _LinSolver[i - 1u]->_KKamr;
-              _LinSolver[i - 1u]->_KKamr = NULL;
-            }
-          }
-        }
-      }
+      BuildCoarseOperators(igridn, grid0);
 
-      std::cout << std::endl << " ****** Level Max " << igridn + 1 << " PREPARATION TIME:\t" << static_cast<double>((clock() - start_preparation_time)) / CLOCKS_PER_SEC << std::endl;
+      preparationRegion.Stop();
+      std::cout << std::endl << " ****** Level Max " << igridn + 1 << " PREPARATION TIME:\t" << preparationRegion.GetElapsedTime() << std::endl;
 
       if(_MGsolver) {
+        ProfilerRegion mgSetupRegion("MGSetup");
         _LinSolver[igridn]->MGInit(mgSmootherType, igridn + 1, _outer_ksp_solver.c_str());
 
         for(unsigned i = 0; i < igridn + 1; i++) {
@@ -247,6 +268,7 @@ restart:
           else
             _LinSolver[i]->MGSetLevel(_LinSolver[igridn], igridn, _VariablesToBeSolvedIndex, _PP[i], _PP[i], _npre, _npost);
         }
+        mgSetupRegion.Stop();
 
         MGVcycle(igridn, mgSmootherType);
 
@@ -271,10 +293,10 @@ restart:
     }
 
     std::cout << std::endl << " *** Linear " << _solverType << " TIME: " << std::setw(11) << std::setprecision(6) << std::fixed
-              << static_cast<double>((clock() - start_mg_time)) / CLOCKS_PER_SEC << std::endl;
+              << solveRegion.GetElapsedTime() << std::endl;
 	      
     _totalAssemblyTime += 0.;
-    _totalSolverTime += static_cast<double>((clock() - start_mg_time)) / CLOCKS_PER_SEC;     
+    _totalSolverTime += solveRegion.GetElapsedTime();     
   }
 
   // ********************************************
@@ -287,9 +309,20 @@ restart:
     double L2normRes;
 //     std::cout << std::endl;
 
+    // all the residual norms with one global reduction
+    std::vector < NumericVector* > residuals(_SolSystemPdeIndex.size());
+    for(unsigned k = 0; k < _SolSystemPdeIndex.size(); k++) {
+      residuals[k] = _solution[igridn]->_Res[_SolSystemPdeIndex[k]];
+    }
+    std::vector < double > L2norms;
+    NumericVector::l2_norms(residuals, L2norms);
+
+    double L2normResAll = 0.;
+
     for(unsigned k = 0; k < _SolSystemPdeIndex.size(); k++) {
       unsigned indexSol = _SolSystemPdeIndex[k];
-      L2normRes       = _solution[igridn]->_Res[indexSol]->l2_norm();
+      L2normRes       = L2norms[k];
+      L2normResAll   += L2normRes * L2normRes;
       std::cout << "       *************** Level Max " << igridn + 1 << "  Linear Res  L2norm " << std::scientific << _ml_sol->GetSolutionName(indexSol) << " = " << L2normRes << std::endl;
       if(isnan(L2normRes)){
          std::cout << "Warning a bit flip is probably occurred, lets try to restart the solver!" << std::endl;
@@ -302,6 +335,11 @@ restart:
         conv = false;
       }
     }
+
+    if(!conv && sqrt(L2normResAll) < _linearResidualTarget) {
+      std::cout << "       *************** Level Max " << igridn + 1 << "  Linear Res  L2norm below the target " << _linearResidualTarget << std::endl;
+      conv = true;
+    }
   
     if(_bitFlipOccurred){
       _bitFlipCounter += 1;
@@ -331,9 +369,87 @@ restart:
 
   // ********************************************
 
+  void LinearImplicitSystem::BuildCoarseOperators(const unsigned &igridn, const unsigned &grid0) {
+
+    ProfilerRegion coarseOperatorsRegion("CoarseOperators");
+
+    // the symbolic products of the last solve are still valid only for the same finest level in a V-cycle,
+    // and if the finest matrix is the same assembled matrix (not the AMR projected one, rebuilt at each solve)
+    bool reuseAcrossSolves = _coarseOperatorReuse && igridn == grid0 && _coarseOperatorLevel == static_cast < int >(igridn) &&
+                             _ml_msh->GetLevel(igridn)->GetIfHomogeneous();
+
+    // frozen coarse operators: all the solves of the time steps before the next rebuild use the ones already built
+    if(reuseAcrossSolves && _coarseOperatorFreezeSteps > 1 && _coarseOperatorAge < _coarseOperatorFreezeSteps) {
+      std::cout << "   ********* Level Max " << igridn + 1 << " frozen coarse operators (" << _coarseOperatorAge << " time step(s) old)" << std::endl;
+      return;
+    }
+
+    if(_LinSolver[igridn]->GetMatrixFreeOperator()) {
+      // there is no fine matrix for the Galerkin products, the coarse operators are assembled on their own levels
+      for(unsigned i = 0; i < igridn; i++) {
+        _levelToAssemble = i;
+        _LinSolver[i]->SetResZero();
+        _assemble_system_function(_equation_systems);
+      }
+      _levelToAssemble = igridn;
+
+      _coarseOperatorLevel = igridn;
+      _coarseOperatorAge = 0;
+      return;
+    }
+
+    const bool fineReuse = _MGmatrixFineReuse || reuseAcrossSolves;
+    const bool coarseReuse = _MGmatrixCoarseReuse || reuseAcrossSolves;
+
+    for(unsigned i = igridn; i > 0; i--) {
+      if(_RR[i]) {
+        if(i == igridn)
+          _LinSolver[i - 1u]->_KK->matrix_ABC(*_RR[i], *_LinSolver[i]->_KK, *_PP[i], fineReuse);
+        else {
+          _LinSolver[i - 1u]->_KK->matrix_ABC(*_RR[i], *_LinSolver[i]->_KK, *_PP[i], coarseReuse);
+          if(_LinSolver[i - 1u]->_KKamr) {
+            delete _LinSolver[i - 1u]->_KKamr;
+            _LinSolver[i - 1u]->_KKamr = NULL;
+          }
+        }
+      }
+      else {
+        if(i == igridn)
+          _LinSolver[i - 1u]->_KK->matrix_PtAP(*_PP[i], *_LinSolver[i]->_KK, fineReuse);
+        else {
+          _LinSolver[i - 1u]->_KK->matrix_PtAP(*_PP[i], *_LinSolver[i]->_KK, coarseReuse);
+          if(_LinSolver[i - 1u]->_KKamr) {
+            delete _LinSolver[i - 1u]->_KKamr;
+            _LinSolver[i - 1u]->_KKamr = NULL;
+          }
+        }
+      }
+    }
+
+    _coarseOperatorLevel = igridn;
+    _coarseOperatorAge = 0;
+  }
+
+  // ********************************************
+
+  std::size_t LinearImplicitSystem::GetProjectionMemoryUsage(const unsigned &level) const {
+    std::size_t bytes = 0;
+
+    const vector < SparseMatrix* >* matrices[4] = {&_PP, &_RR, &_PPamr, &_RRamr};
+    for(unsigned j = 0; j < 4; j++) {
+      if(level < matrices[j]->size() && (*matrices[j])[level]) {
+        bytes += (*matrices[j])[level]->GetMemoryUsage();
+      }
+    }
+
+    return bytes;
+  }
+
+  // ********************************************
+
   bool LinearImplicitSystem::MGVcycle(const unsigned& level, const MgSmootherType& mgSmootherType) {
 
-    clock_t start_mg_time = clock();
+    ProfilerRegion cycleRegion("LinearCycle");
 
     _LinSolver[level]->SetEpsZero();
 
@@ -343,9 +459,24 @@ restart:
 
       std::cout << "       *************** Linear iteration " << linearIterator + 1 << " ***********" << std::endl;
       bool ksp_clean = !linearIterator * _assembleMatrix;
-      _LinSolver[level]->MGSolve(ksp_clean);
-      _solution[level]->UpdateRes(_SolSystemPdeIndex, _LinSolver[level]->_RES, _LinSolver[level]->KKoffset);
-      linearIsConverged = IsLinearConverged(level);
+      _mgSolveCounter++;
+      bool updateResidual = (1 == _explicitResidualUpdatePeriod ||
+                             (_explicitResidualUpdatePeriod > 1 && 0 == _mgSolveCounter % _explicitResidualUpdatePeriod));
+      _LinSolver[level]->MGSolve(ksp_clean, updateResidual);
+      if(!_LinSolver[level]->ResidualIsUpdated() && _LinSolver[level]->GetKrylovResidualNorm() < _linearAbsoluteConvergenceTolerance) {
+        // the Krylov method has converged, also on the absolute tolerance, and the residual has not been recomputed:
+        // _Res keeps the residual before the solve
+        _bitFlipOccurred = false;
+        _bitFlipCounter = 0;
+        linearIsConverged = true;
+      }
+      else {
+        if(!_LinSolver[level]->ResidualIsUpdated()) {
+          _LinSolver[level]->UpdateResidual();
+        }
+        _solution[level]->UpdateRes(_SolSystemPdeIndex, _LinSolver[level]->_RES, _LinSolver[level]->KKoffset);
+        linearIsConverged = IsLinearConverged(level);
+      }
 
       if(linearIsConverged || _bitFlipOccurred)  break;
     }
@@ -358,7 +489,7 @@ restart:
       _solution[level]->UpdateSol(_SolSystemPdeIndex, _LinSolver[level]->_EPS, _LinSolver[level]->KKoffset);
     }
     std::cout << "       *************** Linear-Cycle TIME:\t" << std::setw(11) << std::setprecision(6) << std::fixed
-              << static_cast<double>((clock() - start_mg_time)) / CLOCKS_PER_SEC << std::endl;
+              << cycleRegion.GetElapsedTime() << std::endl;
     return linearIsConverged;
   }
 
@@ -366,7 +497,12 @@ restart:
 
   bool LinearImplicitSystem::MLVcycle(const unsigned& level) {
 
-    clock_t start_mg_time = clock();
+    if(_LinSolver[level]->GetMatrixFreeOperator()) {
+      std::cout << "Error in LinearImplicitSystem: the matrix-free level needs the MG solver" << std::endl;
+      abort();
+    }
+
+    ProfilerRegion cycleRegion("LinearCycle");
 
     _LinSolver[level]->SetEpsZero();
 
@@ -431,7 +567,7 @@ restart:
     }
 
     std::cout << "\n ************ Linear-Cycle TIME:\t" << std::setw(11) << std::setprecision(6) << std::fixed
-              << static_cast<double>((clock() - start_mg_time)) / CLOCKS_PER_SEC << std::endl;
+              << cycleRegion.GetElapsedTime() << std::endl;
 
     return linearIsConverged;
   }
@@ -494,6 +630,11 @@ restart:
 
   void LinearImplicitSystem::AddSystemLevel() {
 
+    if(_matrixFreeElementAction) {
+      std::cout << "Error in LinearImplicitSystem: new levels are not supported with the matrix-free finest level" << std::endl;
+      abort();
+    }
+
     _equation_systems.AddLevel();
 
     _msh.resize(_gridn + 1);
@@ -1214,7 +1355,7 @@ restart:
 
 ///  std::cout << "************ BEGIN ONE PRE-SMOOTHING *****************"<< std::endl;
 #ifdef DEFAULT_PRINT_TIME
-      std::clock_t start_time = std::clock();
+      double start_time = Profiler::GetWallTime();
 #endif
 #ifdef DEFAULT_PRINT_CONV
       _LinSolver[Level]->_EPS->close();
@@ -1232,8 +1373,8 @@ restart:
       std::cout << " Pre Lev: " << Level << ", res-norm: " << rest.second << " n-its: " << rest.first << std::endl;
 #endif
 #ifdef DEFAULT_PRINT_TIME
-      std::clock_t end_time = std::clock();
-      std::cout << " time =" << double(end_time - start_time) / CLOCKS_PER_SEC << std::endl;
+      double end_time = Profiler::GetWallTime();
+      std::cout << " time =" << end_time - start_time << std::endl;
 #endif
 
       _LinSolver[Level]->_RES->resid(*_LinSolver[Level]->_RESC, *_LinSolver[Level]->_EPS, *_LinSolver[Level]->_KK);   //********** compute the residual
@@ -1269,7 +1410,7 @@ restart:
 ///   std::cout << "************ BEGIN ONE POST-SMOOTHING *****************"<< std::endl;
       // postsmooting (Nc_post)
 #ifdef DEFAULT_PRINT_TIME
-      start_time = std::clock();
+      start_time = Profiler::GetWallTime();
 #endif
 #ifdef DEFAULT_PRINT_CONV
       _LinSolver[Level]->_EPS->close();
@@ -1287,8 +1428,8 @@ restart:
       std::cout << " Post Lev: " << Level << ", res-norm: " << rest.second << " n-its: " << rest.first << std::endl;
 #endif
 #ifdef DEFAULT_PRINT_TIME
-      end_time = std::clock();
-      std::cout << " time =" << double(end_time - start_time) / CLOCKS_PER_SEC << std::endl;
+      end_time = Profiler::GetWallTime();
+      std::cout << " time =" << end_time - start_time << std::endl;
 #endif
 
       _LinSolver[Level]->_RES->resid(*_LinSolver[Level]->_RESC, *_LinSolver[Level]->_EPS, *_LinSolver[Level]->_KK);   //*******  compute the residual
@@ -210,10 +210,47 @@ namespace femus {
       /** enforce sparcity pattern for setting uncoupled variables and save on memory allocation **/
       void SetSparsityPattern(vector < bool > other_sparcity_pattern);
 
+      /** Apply the matrix of the finest level matrix-free with the element action elementAction (see MatrixFreeOperator).
+       * KK is not allocated on the finest level and the assembly function must skip it there (see GetAssembleMatrix): the
+       * coarse operators are assembled on each coarse level instead of the Galerkin products. The finest mesh must be
+       * homogeneous, the smoother Gmres with the Jacobi or no preconditioner, and the linear solver MG. NULL goes back to
+       * the assembled matrix */
+      void SetMatrixFreeElementAction(ElementActionFunction elementAction);
+
+      /** With the MG solver, compute the residual after the outer Krylov solve explicitly (one matrix-vector product on the
+       *  finest level) only every period linear iterations or when the Krylov method does not converge, otherwise the
+       *  Krylov convergence, with the Krylov residual norm below the linear absolute tolerance, is taken as linear
+       *  convergence and the residual is not updated: the residuals _Res of the variables are then the ones before the
+       *  linear solve. 1 (default) always updates it, 0 only when the Krylov method does not converge */
+      void SetExplicitResidualUpdatePeriod(const unsigned &period) {
+        _explicitResidualUpdatePeriod = period;
+      }
+
+      /** Keep the symbolic Galerkin products of the coarse operators across solves, only the numeric products are
+       *  recomputed (V-cycle on a homogeneous mesh, the fine matrix must keep its sparsity pattern). With freezeSteps > 1 the
+       *  coarse operators are recomputed only every freezeSteps time steps, and kept frozen in between */
+      void SetCoarseOperatorReuse(const bool &value, const unsigned &freezeSteps = 1) {
+        _coarseOperatorReuse = value;
+        _coarseOperatorFreezeSteps = freezeSteps;
+      }
+
+      /** Counts one more time step for the coarse operators frozen with SetCoarseOperatorReuse. TransientSystem calls it at each
+       *  time step, a solve loop without TransientSystem calls it at each of its steps */
+      void AdvanceCoarseOperatorAge() {
+        _coarseOperatorAge++;
+      }
+
+      /** Forces the coarse operators to be rebuilt from scratch at the next solve, e.g. when the fine operator changes */
+      void ClearCoarseOperators() {
+        _coarseOperatorLevel = -1;
+      }
+
 
 
+      /** True if the assembly function has to assemble KK on the level to assemble, false if it has to assemble only the
+       *  residual: the matrix is kept, or the level is matrix-free and has no KK */
       bool GetAssembleMatrix() {
-        return _assembleMatrix;
+        return _assembleMatrix && !_LinSolver[_levelToAssemble]->GetMatrixFreeOperator();
       }
 
       vector < SparseMatrix* > &GetProjectionMatrix() {
@@ -223,6 +260,9 @@ namespace femus {
       vector < SparseMatrix* > &GetRestrictionMatrix() {
         return _RR;
       }
+
+      /** Bytes owned on this process by the multigrid and AMR projection and restriction matrices of the level */
+      std::size_t GetProjectionMemoryUsage(const unsigned &level) const;
       vector < SparseMatrix* > _PPamr, _RRamr; 
     protected:
 
@@ -231,11 +271,25 @@ namespace femus {
 
       bool _printSolverInfo;
       bool _assembleMatrix;
+      ElementActionFunction _matrixFreeElementAction;
+      unsigned _explicitResidualUpdatePeriod;
+      unsigned _mgSolveCounter;
+      bool _coarseOperatorReuse;
+      unsigned _coarseOperatorFreezeSteps;
+      int _coarseOperatorLevel;
+      /** time steps since the coarse operators were built */
+      unsigned _coarseOperatorAge;
       void AddAMRLevel(unsigned &AMRCounter);
 
       bool MLVcycle(const unsigned &gridn);
       bool MGVcycle(const unsigned & gridn, const MgSmootherType& mgSmootherType);
 
+      /** Galerkin coarse operators of the levels below igridn, assembled on each level if igridn is matrix-free */
+      void BuildCoarseOperators(const unsigned &igridn, const unsigned &grid0);
+
+      /** Aborts if the matrix-free finest level is not supported by the mesh or the smoother */
+      void CheckMatrixFree();
+
 
       /** Create the Prolongator matrix for the Multigrid solver */
       void Prolongator(const unsigned &gridf);
@@ -264,6 +318,10 @@ namespace femus {
       /** The threshold residual for the linear system Ax=b. */
       double _linearAbsoluteConvergenceTolerance;
 
+      /** The linear iterations also stop when the l2 norm of the residual of all the variables is below this value,
+       *  e.g. the inexact Newton forcing term times the nonlinear residual norm (0, disabled, by default) */
+      double _linearResidualTarget;
+
       /** The max number of linear iterations */
       unsigned int _n_max_linear_iterations;
 
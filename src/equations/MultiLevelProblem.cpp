@@ -23,7 +23,12 @@
 #include "Parameter.hpp"
 #include "MultiLevelMeshTwo.hpp"
 #include "GeomElTypeEnum.hpp"
+#include "LinearImplicitSystem.hpp"
+#include "LinearEquationSolver.hpp"
 #include <iostream>
+#include <iomanip>
+#include <sstream>
+#include <sys/resource.h>
 
 namespace femus {
 
@@ -177,6 +182,80 @@ void MultiLevelProblem::clear ()
 }
 
 
+void MultiLevelProblem::PrintMemoryUsage() const
+{
+  // every process has the same levels and systems, so the rows are the same on all of them
+  std::vector < std::string > rowName;
+  std::vector < double > rowBytes;
+
+  for(unsigned level = 0; level < _ml_msh->GetNumberOfLevels(); level++) {
+    std::ostringstream levelName;
+    levelName << "Level " << level + 1 << " ";
+
+    rowName.push_back(levelName.str() + "Mesh");
+    rowBytes.push_back(_ml_msh->GetLevel(level)->GetMemoryUsage());
+
+    if(_ml_sol) {
+      rowName.push_back(levelName.str() + "Solution");
+      rowBytes.push_back(_ml_sol->GetSolutionLevel(level)->GetMemoryUsage());
+    }
+
+    for(const_system_iterator it = _systems.begin(); it != _systems.end(); it++) {
+      const LinearImplicitSystem* system = dynamic_cast < const LinearImplicitSystem* >(it->second);
+      if(system && level < system->_LinSolver.size()) {
+        rowName.push_back(levelName.str() + it->first + " LinearEquation");
+        rowBytes.push_back(system->_LinSolver[level]->GetMemoryUsage());
+        rowName.push_back(levelName.str() + it->first + " Projections");
+        rowBytes.push_back(system->GetProjectionMemoryUsage(level));
+      }
+    }
+  }
+
+  unsigned n = rowBytes.size();
+  double localTotal = 0.;
+  for(unsigned i = 0; i < n; i++) {
+    localTotal += rowBytes[i];
+  }
+  rowName.push_back("Total");
+  rowBytes.push_back(localTotal);
+  n++;
+
+  std::vector < double > minBytes(n), maxBytes(n), sumBytes(n);
+  MPI_Allreduce(&rowBytes[0], &minBytes[0], n, MPI_DOUBLE, MPI_MIN, MPI_COMM_WORLD);
+  MPI_Allreduce(&rowBytes[0], &maxBytes[0], n, MPI_DOUBLE, MPI_MAX, MPI_COMM_WORLD);
+  MPI_Allreduce(&rowBytes[0], &sumBytes[0], n, MPI_DOUBLE, MPI_SUM, MPI_COMM_WORLD);
+
+  // peak resident set size of the process, ru_maxrss is in kilobytes on Linux
+  struct rusage usage;
+  getrusage(RUSAGE_SELF, &usage);
+  double peak[2] = {usage.ru_maxrss * 1024., -usage.ru_maxrss * 1024.};
+  double peakMaxMin[2];
+  MPI_Allreduce(peak, peakMaxMin, 2, MPI_DOUBLE, MPI_MAX, MPI_COMM_WORLD);
+
+  unsigned width = 9;
+  for(unsigned i = 0; i < n; i++) {
+    width = (rowName[i].size() > width) ? rowName[i].size() : width;
+  }
+
+  const double MB = 1024. * 1024.;
+  std::ios_base::fmtflags flags = std::cout.flags();
+  std::streamsize precision = std::cout.precision();
+
+  cout << endl << " *** Memory usage [MB], over the processes ***" << endl;
+  cout << std::left << " " << std::setw(width) << "Structure" << std::right
+       << std::setw(12) << "Min" << std::setw(12) << "Max" << std::setw(12) << "Sum" << endl;
+  cout << std::fixed << std::setprecision(3);
+  for(unsigned i = 0; i < n; i++) {
+    cout << std::left << " " << std::setw(width) << rowName[i] << std::right << std::setw(12) << minBytes[i] / MB
+         << std::setw(12) << maxBytes[i] / MB << std::setw(12) << sumBytes[i] / MB << endl;
+  }
+  cout << " Peak resident memory of the processes: min " << -peakMaxMin[1] / MB << " max " << peakMaxMin[0] / MB << endl;
+
+  std::cout.flags(flags);
+  std::cout.precision(precision);
+}
+
+
 // void MultiLevelProblem::init()
 // {
 //   const unsigned int n_sys = this->n_systems();
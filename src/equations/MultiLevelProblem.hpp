@@ -150,6 +150,11 @@ public:
     /** Clear all the Sytems PDE structures */
     void clear();
 
+    /** Print, level by level, the memory owned by the mesh, the solution and the linear systems and projection matrices
+     *  of each implicit system (min/max/sum over the processes) and the peak resident memory of the processes.
+     *  Collective on MPI_COMM_WORLD */
+    void PrintMemoryUsage() const;
+
 //   /** init the system pde structures */
 //   void init();
 
@@ -16,7 +16,9 @@
 #include "NonLinearImplicitSystem.hpp"
 #include "LinearEquationSolver.hpp"
 #include "NumericVector.hpp"
+#include "Profiler.hpp"
 #include "iomanip"
+#include <cmath>
 
 namespace femus {
 
@@ -34,7 +36,19 @@ namespace femus {
     _maxNumberOfResidualUpdateIterations(1),
     _debug_nonlinear(false),
     _debug_function(NULL),
-    _debug_function_is_initialized(false)
+    _debug_function_is_initialized(false),
+    _jacobianRebuildFrequency(1),
+    _jacobianRebuildResidualRatio(0.),
+    _jacobianReuseAcrossSolves(false),
+    _jacobianIsBuilt(false),
+    _jacobianLevel(0),
+    _jacobianIsMG(false),
+    _jacobianAge(0),
+    _inexactNewton(false),
+    _inexactNewtonEta0(0.3),
+    _inexactNewtonEtaMax(0.9),
+    _lineSearch(false),
+    _maxNumberOfLineSearchIterations(5)
   {
 
   }
@@ -44,6 +58,7 @@ namespace femus {
   }
 
   void NonLinearImplicitSystem::clear() {
+    ClearJacobian();
   }
 
   // ********************************************
@@ -66,11 +81,23 @@ namespace femus {
     const double absMinNormSol = 1.e-15;
     const double mindeltaNormSol = 1.e-50;
 
+    // all the norms with one global reduction
+    const unsigned nVariables = _SolSystemPdeIndex.size();
+    std::vector < NumericVector* > vectors(3 * nVariables);
+    for(unsigned k = 0; k < nVariables; k++) {
+      unsigned indexSol = _SolSystemPdeIndex[k];
+      vectors[k] = _solution[igridn]->_Res[indexSol];
+      vectors[nVariables + k] = _solution[igridn]->_Eps[indexSol];
+      vectors[2 * nVariables + k] = _solution[igridn]->_Sol[indexSol];
+    }
+    std::vector < double > L2norms;
+    NumericVector::l2_norms(vectors, L2norms);
+
     for(unsigned k = 0; k < _SolSystemPdeIndex.size(); k++) {
       unsigned indexSol = _SolSystemPdeIndex[k];
-      L2normRes    = _solution[igridn]->_Res[indexSol]->l2_norm();
-      L2normEps    = _solution[igridn]->_Eps[indexSol]->l2_norm();
-      L2normSol    = _solution[igridn]->_Sol[indexSol]->l2_norm();
+      L2normRes    = L2norms[k];
+      L2normEps    = L2norms[nVariables + k];
+      L2normSol    = L2norms[2 * nVariables + k];
       L2normEpsDividedSol = L2normEps / (L2normSol + mindeltaNormSol);
 
       std::cout << "     ********* Level Max " << igridn + 1 << " Nonlinear Eps_l2norm/Sol_l2norm " << \
@@ -91,11 +118,142 @@ namespace femus {
 
   // ********************************************
 
+  void NonLinearImplicitSystem::AssembleSystem(const unsigned &igridn, const bool &assembleMatrix) {
+
+    _levelToAssemble = igridn; //Be carefull!!!! this is needed in the _assemble_function
+    _LinSolver[igridn]->SetResZero();
+    _assembleMatrix = assembleMatrix;
+
+    ProfilerRegion assemblyRegion("Assembly");
+    _assemble_system_function(_equation_systems);
+    assemblyRegion.Stop();
+
+    if(assembleMatrix && _LinSolver[igridn]->GetMatrixFreeOperator()) {
+      _LinSolver[igridn]->GetMatrixFreeOperator()->Update();
+    }
+
+    if(!_ml_msh->GetLevel(igridn)->GetIfHomogeneous()) {
+      if(!_RRamr[igridn]) {
+        (_LinSolver[igridn]->_RESC)->matrix_mult_transpose(*_LinSolver[igridn]->_RES, *_PPamr[igridn]);
+      }
+      else {
+        (_LinSolver[igridn]->_RESC)->matrix_mult(*_LinSolver[igridn]->_RES, *_RRamr[igridn]);
+      }
+      *(_LinSolver[igridn]->_RES) = *(_LinSolver[igridn]->_RESC);
+    }
+  }
+
+  // ********************************************
+
+  void NonLinearImplicitSystem::ClearJacobian() {
+    if(_jacobianIsBuilt && _jacobianIsMG) {
+      _LinSolver[_jacobianLevel]->MGClear();
+    }
+    _jacobianIsBuilt = false;
+  }
+
+  // ********************************************
+
+  double NonLinearImplicitSystem::ForcingTerm(const unsigned &nonLinearIterator, const double &residualNorm,
+                                              const double &previousResidualNorm, const double &previousEta) const {
+    // Eisenstat-Walker, choice 2, with the safeguard against a too fast decrease of the forcing term
+    const double gamma = 0.9;
+    const double alpha = 2.;
+
+    if(0 == nonLinearIterator || previousResidualNorm <= 0.) return _inexactNewtonEta0;
+
+    double eta = gamma * pow(residualNorm / previousResidualNorm, alpha);
+    double safeguard = gamma * pow(previousEta, alpha);
+    if(safeguard > 0.1) eta = (eta > safeguard) ? eta : safeguard;
+
+    return (eta < _inexactNewtonEtaMax) ? eta : _inexactNewtonEtaMax;
+  }
+
+  // ********************************************
+
+  bool NonLinearImplicitSystem::LineSearch(const unsigned &igridn, double &residualNorm, const double &eta,
+                                           const std::vector < NumericVector* > &solutionBeforeStep) {
+
+    Solution* solution = _solution[igridn];
+
+    // the Newton step, the solution has already been updated with the full step
+    for(unsigned k = 0; k < _SolSystemPdeIndex.size(); k++) {
+      unsigned indexSol = _SolSystemPdeIndex[k];
+      *(solution->_Eps[indexSol]) = *(solution->_Sol[indexSol]);
+      solution->_Eps[indexSol]->add(-1., *solutionBeforeStep[k]);
+      solution->_Eps[indexSol]->close();
+    }
+
+    // backtracking with the sufficient decrease condition ||R(x + lambda s)|| <= (1 - t lambda (1 - eta)) ||R(x)||
+    const double t = 1.e-4;
+    double lambda = 1.;
+    double trialResidualNorm;
+
+    for(unsigned lineSearchIterator = 0; ; lineSearchIterator++) {
+      AssembleSystem(igridn, false);
+      trialResidualNorm = _LinSolver[igridn]->_RES->l2_norm();
+
+      // a NaN residual never gives a sufficient decrease, the step is shortened
+      const bool residualIsNumber = !isnan(trialResidualNorm);
+
+      if(residualIsNumber && trialResidualNorm <= (1. - t * lambda * (1. - eta)) * residualNorm) break;
+
+      if(lineSearchIterator == _maxNumberOfLineSearchIterations) {
+        if(residualIsNumber) {
+          std::cout << "     ********* Warning: line search did not reach a sufficient decrease" << std::endl;
+          break;
+        }
+
+        // the residual is NaN also with the shortest step: the step is rejected and the solution restored
+        std::cout << "     ********* Error: line search residual is NaN at the step length " << lambda
+                  << ", the Newton step is rejected" << std::endl;
+        for(unsigned k = 0; k < _SolSystemPdeIndex.size(); k++) {
+          unsigned indexSol = _SolSystemPdeIndex[k];
+          *(solution->_Sol[indexSol]) = *solutionBeforeStep[k];
+          solution->_Sol[indexSol]->close();
+          if(solution->_AMR_flag) {
+            solution->_AMREps[indexSol]->add(-lambda, *solution->_Eps[indexSol]);
+            solution->_AMREps[indexSol]->close();
+          }
+          solution->_Eps[indexSol]->zero();
+        }
+        AssembleSystem(igridn, false);
+        return false;
+      }
+
+      double newLambda = 0.5 * lambda;
+      for(unsigned k = 0; k < _SolSystemPdeIndex.size(); k++) {
+        unsigned indexSol = _SolSystemPdeIndex[k];
+        solution->_Sol[indexSol]->add(newLambda - lambda, *solution->_Eps[indexSol]);
+        solution->_Sol[indexSol]->close();
+        if(solution->_AMR_flag) {
+          solution->_AMREps[indexSol]->add(newLambda - lambda, *solution->_Eps[indexSol]);
+          solution->_AMREps[indexSol]->close();
+        }
+      }
+      lambda = newLambda;
+    }
+
+    // the damped step, for the convergence check
+    if(lambda < 1.) {
+      for(unsigned k = 0; k < _SolSystemPdeIndex.size(); k++) {
+        solution->_Eps[_SolSystemPdeIndex[k]]->scale(lambda);
+      }
+    }
+
+    std::cout << "     ********* Line search step length " << lambda << ", Res_l2norm = " << trialResidualNorm << std::endl;
+
+    residualNorm = trialResidualNorm;
+    return true;
+  }
+
+  // ********************************************
+
   void NonLinearImplicitSystem::solve(const MgSmootherType& mgSmootherType) {
 
     _bitFlipCounter = 0;
     
-    clock_t start_mg_time = clock();
+    ProfilerRegion solveRegion("NonLinearSolve");
 
     double totalAssembyTime = 0.;
 
@@ -116,40 +274,76 @@ namespace femus {
 
     unsigned AMRCounter = 0;
 
+    double previousResidualNorm = 0.;
+
     for(unsigned igridn = grid0; igridn < _gridn; igridn++) {     //_igridn
       std::cout << std::endl << "   ****** Start Level Max " << igridn + 1 << " ******" << std::endl;
-      clock_t start_nl_time = clock();
+      double start_nl_time = Profiler::GetWallTime();
 
       bool ThisIsAMR = (_mg_type == F_CYCLE && _AMRtest &&  AMRCounter < _maxAMRlevels && igridn == _gridn - 1u) ? 1 : 0;
+
+      // with inexact Newton the relative tolerance set by the user is the lower bound of the forcing term
+      const double userRelativeTolerance = _LinSolver[igridn]->GetRelativeTolerance();
+      double eta = userRelativeTolerance;
 restart:
       if(ThisIsAMR) _solution[igridn]->InitAMREps();
 
+      // the line search leaves assembled the residual of the accepted solution
+      bool residualIsAssembled = false;
+      double residualNorm = 0.;
+      // ||R_k|| / ||R_k-1|| of the last iteration
+      double residualRatio = 0.;
+
       
       for(unsigned nonLinearIterator = 0; nonLinearIterator < _n_max_nonlinear_iterations; nonLinearIterator++) {
 
         _nonliniteration = nonLinearIterator;
         std::cout << std::endl << "   ********* Nonlinear iteration " << nonLinearIterator + 1 << " *********" << std::endl;
 
-        clock_t start_preparation_time = clock();
-        clock_t start_assembly_time = clock();
-        _levelToAssemble = igridn; //Be carefull!!!! this is needed in the _assemble_function
-        _LinSolver[igridn]->SetResZero();
-        _assembleMatrix = _buildSolver;
-        _assemble_system_function(_equation_systems);
-        std::cout << "   ********* Level Max " << igridn + 1 << " ASSEMBLY TIME:\t" << \
-                  static_cast<double>((clock() - start_assembly_time)) / CLOCKS_PER_SEC << std::endl;
-	
-        if(!_ml_msh->GetLevel(igridn)->GetIfHomogeneous()) {
-          if(!_RRamr[igridn]) {
-            (_LinSolver[igridn]->_RESC)->matrix_mult_transpose(*_LinSolver[igridn]->_RES, *_PPamr[igridn]);
-          }
-          else {
-            (_LinSolver[igridn]->_RESC)->matrix_mult(*_LinSolver[igridn]->_RES, *_RRamr[igridn]);
+        ProfilerRegion preparationRegion("Preparation");
+        double start_assembly_time = Profiler::GetWallTime();
+
+        // Jacobian reuse policy: in between two rebuilds only the residual is assembled and the Jacobian,
+        // the coarse operators and the preconditioner of the last rebuild are used
+        // without _buildSolver the Jacobian is still built when there is none to reuse
+        bool jacobianIsValid = _jacobianIsBuilt && _jacobianLevel == igridn && _jacobianIsMG == _MGsolver;
+        bool rebuildJacobian = !jacobianIsValid || (_buildSolver && ((0 == nonLinearIterator && !_jacobianReuseAcrossSolves) ||
+                                                                     _jacobianAge >= _jacobianRebuildFrequency));
+
+        // the residual ratio trigger is decided before the assembly, so that the system is assembled once
+        if(!rebuildJacobian && _buildSolver && _jacobianRebuildResidualRatio > 0. && nonLinearIterator > 0) {
+          double ratio = (residualIsAssembled) ? residualNorm / previousResidualNorm : residualRatio;
+          if(ratio > _jacobianRebuildResidualRatio) {
+            std::cout << "   ********* Residual ratio " << ratio << ", rebuild the Jacobian" << std::endl;
+            rebuildJacobian = true;
           }
-          *(_LinSolver[igridn]->_RES) = *(_LinSolver[igridn]->_RESC);
         }
 
-        if(_buildSolver) {
+        if(rebuildJacobian || !residualIsAssembled) {
+          AssembleSystem(igridn, rebuildJacobian);
+          residualNorm = _LinSolver[igridn]->_RES->l2_norm();
+        }
+        residualIsAssembled = false;
+        residualRatio = (nonLinearIterator > 0) ? residualNorm / previousResidualNorm : 0.;
+
+        if(_inexactNewton) {
+          eta = ForcingTerm(nonLinearIterator, residualNorm, previousResidualNorm, eta);
+          eta = (eta > userRelativeTolerance) ? eta : userRelativeTolerance;
+          _LinSolver[igridn]->SetRelativeTolerance(eta);
+          // the linear cycles stop at ||R_lin|| < eta ||R||, not only at the absolute tolerance
+          _linearResidualTarget = eta * residualNorm;
+          std::cout << "   ********* Inexact Newton relative tolerance " << eta << std::endl;
+        }
+        previousResidualNorm = residualNorm;
+
+        std::cout << "   ********* Level Max " << igridn + 1 << " ASSEMBLY TIME:\t" << \
+                  (Profiler::GetWallTime() - start_assembly_time) << std::endl;
+
+        bool reuseJacobian = !rebuildJacobian && _jacobianIsBuilt;
+
+        if(rebuildJacobian) {
+
+          ClearJacobian();
 
           _MGmatrixFineReuse = (0 == nonLinearIterator) ? false : true;
           _MGmatrixCoarseReuse = (igridn - grid0 > 0) ?  true : _MGmatrixFineReuse;
@@ -164,35 +358,12 @@ restart:
             }
           }
 
-          clock_t mg_proj_mat_time = clock();
-          for(unsigned i = igridn; i > 0; i--) {
-            if(_RR[i]) {
-              if(i == igridn)
-                _LinSolver[i - 1u]->_KK->matrix_ABC(*_RR[i], *_LinSolver[i]->_KK, *_PP[i], _MGmatrixFineReuse);
-              else {
-                _LinSolver[i - 1u]->_KK->matrix_ABC(*_RR[i], *_LinSolver[i]->_KK, *_PP[i], _MGmatrixCoarseReuse);
-                if(_LinSolver[i - 1u]->_KKamr) {
-                  delete _LinSolver[i - 1u]->_KKamr;
-                  _LinSolver[i - 1u]->_KKamr = NULL;
-                }
-              }
-            }
-            else {
-              if(i == igridn)
-                _LinSolver[i - 1u]->_KK->matrix_PtAP(*_PP[i], *_LinSolver[i]->_KK, _MGmatrixFineReuse);
-              else {
-                _LinSolver[i - 1u]->_KK->matrix_PtAP(*_PP[i], *_LinSolver[i]->_KK, _MGmatrixCoarseReuse);
-                if(_LinSolver[i - 1u]->_KKamr) {
-                  delete _LinSolver[i - 1u]->_KKamr;
-                  _LinSolver[i - 1u]->_KKamr = NULL;
-                }
-              }
-            }
-          }
+          double mg_proj_mat_time = Profiler::GetWallTime();
+          BuildCoarseOperators(igridn, grid0);
           std::cout << "   ********* Level Max " << igridn + 1 << " MG PROJECTION MATRICES TIME:\t" \
-                    << static_cast<double>((clock() - mg_proj_mat_time)) / CLOCKS_PER_SEC << std::endl;
+                    << (Profiler::GetWallTime() - mg_proj_mat_time) << std::endl;
 
-          clock_t mg_init_time = clock();
+          ProfilerRegion mgSetupRegion("MGSetup");
           if(_MGsolver) {
             _LinSolver[igridn]->MGInit(mgSmootherType, igridn + 1, _outer_ksp_solver.c_str());
 
@@ -203,13 +374,34 @@ restart:
                 _LinSolver[i]->MGSetLevel(_LinSolver[igridn], igridn, _VariablesToBeSolvedIndex, _PP[i], _PP[i], _npre, _npost);
             }
           }
+          mgSetupRegion.Stop();
           std::cout << "   ********* Level Max " << igridn + 1 << " MGINIT TIME:\t" \
-                    << static_cast<double>((clock() - mg_init_time)) / CLOCKS_PER_SEC << std::endl;
+                    << mgSetupRegion.GetElapsedTime() << std::endl;
+
+          _jacobianIsBuilt = true;
+          _jacobianLevel = igridn;
+          _jacobianIsMG = _MGsolver;
+          _jacobianAge = 0;
+        }
+        else if(reuseJacobian) {
+          std::cout << "   ********* Level Max " << igridn + 1 << " reuse the Jacobian of " << _jacobianAge << " iteration(s) ago" << std::endl;
+          if(!_ml_msh->GetLevel(igridn)->GetIfHomogeneous()) {
+            _LinSolver[igridn]->SwapMatrices(); // the projected Jacobian
+          }
         }
-        totalAssembyTime += static_cast<double>((clock() - start_assembly_time)) / CLOCKS_PER_SEC;
+        preparationRegion.Stop();
+        totalAssembyTime += (Profiler::GetWallTime() - start_assembly_time);
         std::cout << "   ********* Level Max " << igridn + 1 << " PREPARATION TIME:\t" << \
-                  static_cast<double>((clock() - start_preparation_time)) / CLOCKS_PER_SEC << std::endl;
-        clock_t startUpdateResidualTime = clock();
+                  preparationRegion.GetElapsedTime() << std::endl;
+        double startUpdateResidualTime = Profiler::GetWallTime();
+
+        std::vector < NumericVector* > solutionBeforeStep;
+        if(_lineSearch) {
+          solutionBeforeStep.resize(_SolSystemPdeIndex.size());
+          for(unsigned k = 0; k < _SolSystemPdeIndex.size(); k++) {
+            solutionBeforeStep[k] = _solution[igridn]->_Sol[_SolSystemPdeIndex[k]]->clone().release();
+          }
+        }
 
         for(unsigned updateResidualIterator = 0; updateResidualIterator < _maxNumberOfResidualUpdateIterations; updateResidualIterator++) {
 
@@ -222,35 +414,36 @@ restart:
 
           if(thisIsConverged || updateResidualIterator == _maxNumberOfResidualUpdateIterations - 1) break;
 
-          _LinSolver[igridn]->SetResZero();
-          _assembleMatrix = false;
-          _assemble_system_function(_equation_systems);
-          if(!_ml_msh->GetLevel(igridn)->GetIfHomogeneous()) {
-            if(!_RRamr[igridn]) {
-              (_LinSolver[igridn]->_RESC)->matrix_mult_transpose(*_LinSolver[igridn]->_RES, *_PPamr[igridn]);
-            }
-            else {
-              (_LinSolver[igridn]->_RESC)->matrix_mult(*_LinSolver[igridn]->_RES, *_RRamr[igridn]);
-            }
-            *(_LinSolver[igridn]->_RES) = *(_LinSolver[igridn]->_RESC);
-          }
+          AssembleSystem(igridn, false);
           if(_bitFlipOccurred) break;
         }
 
-        if(_buildSolver) {
+        if(rebuildJacobian || reuseJacobian) {
           if(!_ml_msh->GetLevel(igridn)->GetIfHomogeneous()) {
             _LinSolver[igridn]->SwapMatrices();
           }
-          if(_MGsolver) {
-            _LinSolver[igridn]->MGClear();
+          _jacobianAge++;
+        }
+
+        bool stepIsAccepted = true;
+        if(_lineSearch) {
+          if(!_bitFlipOccurred) {
+            stepIsAccepted = LineSearch(igridn, residualNorm, (_inexactNewton) ? eta : 0., solutionBeforeStep);
+            residualIsAssembled = true;
+          }
+          for(unsigned k = 0; k < solutionBeforeStep.size(); k++) {
+            delete solutionBeforeStep[k];
           }
         }
 
+        // no step gives a finite residual, further iterations would repeat the same step
+        if(!stepIsAccepted) break;
+
         double nonLinearEps;
         bool nonLinearIsConverged = IsNonLinearConverged(igridn, nonLinearEps);
 
         std::cout << "     ********* Linear Cycle + Residual Update-Cycle TIME:\t" << std::setw(11) << std::setprecision(6) << std::fixed
-                  << static_cast<double>((clock() - startUpdateResidualTime)) / CLOCKS_PER_SEC << std::endl;
+                  << (Profiler::GetWallTime() - startUpdateResidualTime) << std::endl;
 
                   
        if (_debug_nonlinear)  {
@@ -276,6 +469,16 @@ restart:
       }
       
       
+      if(_inexactNewton) {
+        _LinSolver[igridn]->SetRelativeTolerance(userRelativeTolerance);
+        _linearResidualTarget = 0.;
+      }
+
+      // the preconditioner hierarchy is kept only on the finest level, for the next solve
+      if(!_jacobianReuseAcrossSolves || igridn + 1 < _gridn || ThisIsAMR || _bitFlipOccurred) {
+        ClearJacobian();
+      }
+
       if(_bitFlipOccurred && _bitFlipCounter == 1){
 	goto restart;
       }
@@ -286,12 +489,12 @@ restart:
 
 
       std::cout << std::endl << "   ****** Nonlinear-Cycle TIME: " << std::setw(11) << std::setprecision(6) << std::fixed
-                << static_cast<double>((clock() - start_nl_time)) / CLOCKS_PER_SEC << std::endl;
+                << (Profiler::GetWallTime() - start_nl_time) << std::endl;
 
       std::cout << std::endl << "   ****** End Level Max " << igridn + 1 << " ******" << std::endl;
     }
 
-    double totalSolverTime = static_cast<double>((clock() - start_mg_time)) / CLOCKS_PER_SEC;
+    double totalSolverTime = solveRegion.GetElapsedTime();
     std::cout << std::endl << "   *** Nonlinear " << _solverType << " TIME: " << std::setw(11) << std::setprecision(6) << std::fixed
               << totalSolverTime <<  " = assembly TIME( " << totalAssembyTime << " ) + "
               << " solver TIME( " << totalSolverTime - totalAssembyTime << " ) " << std::endl;
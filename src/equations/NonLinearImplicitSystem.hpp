@@ -102,7 +102,43 @@ public:
     void SetResidualUpdateConvergenceTolerance(const double & tolerance){
       _linearAbsoluteConvergenceTolerance = tolerance;
     }
-    
+
+    /** Rebuild the Jacobian, the coarse operators and the multigrid preconditioner every rebuildFrequency nonlinear
+     *  iterations, in between only the residual is assembled (default 1, rebuild at every iteration) */
+    void SetJacobianRebuildFrequency(const unsigned &rebuildFrequency) {
+      _jacobianRebuildFrequency = (rebuildFrequency > 0) ? rebuildFrequency : 1;
+    }
+
+    /** Rebuild the Jacobian also when the nonlinear residual ratio ||R_k|| / ||R_k-1|| exceeds ratio (default 0, disabled).
+     *  The ratio is checked before the assembly: without the line search, that assembles R_k, the ratio of the previous
+     *  iteration is used and the Jacobian is rebuilt one iteration later */
+    void SetJacobianRebuildResidualRatio(const double &ratio) {
+      _jacobianRebuildResidualRatio = ratio;
+    }
+
+    /** Keep the Jacobian and the preconditioner of the last nonlinear iteration for the next solve, e.g. the next time step */
+    void SetJacobianReuseAcrossSolves(const bool &value) {
+      _jacobianReuseAcrossSolves = value;
+    }
+
+    /** Discard the Jacobian kept for reuse, e.g. when the time step changes */
+    void ClearJacobian();
+
+    /** Inexact Newton: at each nonlinear iteration the relative tolerance of the linear solver on the finest level is the
+     *  Eisenstat-Walker forcing term eta_k = 0.9 (||R_k|| / ||R_k-1||)^2, with eta_0 = eta0, eta_k <= etaMax and eta_k not smaller
+     *  than the relative tolerance set with SetTolerances */
+    void SetInexactNewton(const bool &value, const double &eta0 = 0.3, const double &etaMax = 0.9) {
+      _inexactNewton = value;
+      _inexactNewtonEta0 = eta0;
+      _inexactNewtonEtaMax = etaMax;
+    }
+
+    /** Backtracking line search on the nonlinear residual norm, the Newton step is halved at most maxIterations times */
+    void SetLineSearch(const bool &value, const unsigned &maxIterations = 5) {
+      _lineSearch = value;
+      _maxNumberOfLineSearchIterations = maxIterations;
+    }
+
 protected:
 
     
@@ -128,6 +164,24 @@ protected:
 
     /** Current nonlinear iteration index */
     unsigned _nonliniteration;
+
+    /** Jacobian reuse policy */
+    unsigned _jacobianRebuildFrequency;
+    double _jacobianRebuildResidualRatio;
+    bool _jacobianReuseAcrossSolves;
+
+    /** State of the Jacobian kept for reuse: level, solver type and nonlinear iterations since it was built */
+    bool _jacobianIsBuilt;
+    unsigned _jacobianLevel;
+    bool _jacobianIsMG;
+    unsigned _jacobianAge;
+
+    /** Inexact Newton and line search */
+    bool _inexactNewton;
+    double _inexactNewtonEta0;
+    double _inexactNewtonEtaMax;
+    bool _lineSearch;
+    unsigned _maxNumberOfLineSearchIterations;
     
     /** Solves the system. */
     virtual void solve (const MgSmootherType& mgSmootherType = MULTIPLICATIVE);
@@ -137,6 +191,18 @@ private:
     /** To be Added */
     void CreateSystemPDEStructure();
 
+    /** Assembles the residual, and the Jacobian if assembleMatrix, on the level igridn */
+    void AssembleSystem(const unsigned &igridn, const bool &assembleMatrix);
+
+    /** Eisenstat-Walker forcing term of the nonlinear iteration nonLinearIterator */
+    double ForcingTerm(const unsigned &nonLinearIterator, const double &residualNorm,
+                       const double &previousResidualNorm, const double &previousEta) const;
+
+    /** Backtracking along the Newton step, residualNorm becomes the residual norm of the accepted solution. Returns false,
+     *  with the solution before the step restored, if the residual is NaN also with the shortest step */
+    bool LineSearch(const unsigned &igridn, double &residualNorm, const double &eta,
+                    const std::vector < NumericVector* > &solutionBeforeStep);
+
 };
 
 
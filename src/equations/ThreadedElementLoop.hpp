@@ -0,0 +1,128 @@
+/*=========================================================================
+
+ Program: FEMuS
+ Module: ThreadedElementLoop
+
+ Copyright (c) FEMuS
+ All rights reserved.
+
+ This software is distributed WITHOUT ANY WARRANTY; without even
+ the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ PURPOSE.  See the above copyright notice for more information.
+
+=========================================================================*/
+
+#ifndef __femus_equations_ThreadedElementLoop_hpp__
+#define __femus_equations_ThreadedElementLoop_hpp__
+
+//----------------------------------------------------------------------------
+// includes :
+//----------------------------------------------------------------------------
+#include "FemusConfig.hpp"
+#include "Mesh.hpp"
+#include "NumericVector.hpp"
+#include "Solution.hpp"
+#include "FemusInit.hpp"
+#include "adept.h"
+
+#include <cassert>
+#include <vector>
+
+#ifdef HAVE_OPENMP
+#include <omp.h>
+#endif
+
+namespace femus {
+
+  /** Get the number of threads used by ThreadedElementLoop */
+  inline unsigned GetNumberOfAssemblyThreads() {
+#ifdef HAVE_OPENMP
+    return omp_get_max_threads();
+#else
+    return 1;
+#endif
+  }
+
+  /**
+   * Makes the data read by the element kernels available before the threads start: the element dof tables and the
+   * element coloring of msh (built when the mesh is completed), the local arrays of the coordinates of msh and of the
+   * vectors in inputVectors. Inside the kernels these objects are only read, through const accessors
+   * (Mesh::GetElementSolutionDofs, Mesh::GetElementSolutionLocalDofs, LinearEquation::GetSystemDofs,
+   * NumericVector::get_local, NumericVector::operator()), so no lazy initialization runs in the parallel region.
+   **/
+  inline void PrepareThreadedLoop(const Mesh* msh, const std::vector < NumericVector* > &inputVectors) {
+
+    assert(msh->GetElementColorNumber() > 0 || msh->_elementOffset[msh->processor_id()] == msh->_elementOffset[msh->processor_id() + 1]);
+
+    for(unsigned k = 0; k < msh->GetDimension(); k++) {
+      msh->_topology->_Sol[k]->acquire_local_array();
+    }
+    for(unsigned i = 0; i < inputVectors.size(); i++) {
+      inputVectors[i]->acquire_local_array();
+    }
+
+    FemusInit::ResizeAdeptStackPool(GetNumberOfAssemblyThreads());
+  }
+
+  /**
+   * Calls assembleElement(iel, ithread) for all the elements owned by this process, 0 <= ithread < GetNumberOfAssemblyThreads().
+   * The elements are processed color by color (see Mesh::BuildElementColoring) and the elements of one color are
+   * shared among the OpenMP threads: elements with the same color have no common dof, so the kernel can accumulate
+   * into per-dof data without races. The insertions into the global matrix and residual (add_matrix_blocked,
+   * add_vector_blocked, and the add_matrix/add_vector overloads with dof indices) share one critical section, then the kernel
+   * can call them directly; the single entry set and add of vectors and matrices are not protected and must not be called.
+   * The kernel must use only per-thread local storage (indexed with ithread) and, for automatic differentiation,
+   * the adept::Stack of its thread, i.e. FemusInit::GetAdeptStack(ithread), that is active while the kernel runs.
+   * All the vectors the kernel reads, besides the coordinates, must be listed in inputVectors (see PrepareThreadedLoop):
+   * the kernel must not write into them, nor call non-const methods of the mesh.
+   **/
+  template < class ElementFunction >
+  void ThreadedElementLoop(const Mesh* msh, const std::vector < NumericVector* > &inputVectors, ElementFunction& assembleElement) {
+
+    PrepareThreadedLoop(msh, inputVectors);
+
+#ifdef HAVE_OPENMP
+
+    const unsigned colorNumber = msh->GetElementColorNumber();
+
+    #pragma omp parallel
+    {
+      const unsigned ithread = omp_get_thread_num();
+
+      // the master thread uses the stack already active, FemusInit::_adeptStack
+      if(ithread != 0) {
+        FemusInit::GetAdeptStack(ithread).activate();
+      }
+
+      for(unsigned icolor = 0; icolor < colorNumber; icolor++) {
+        const unsigned* coloredElements = msh->GetColoredElements(icolor);
+        const int colorSize = msh->GetColoredElements(icolor + 1) - coloredElements;
+
+        #pragma omp for schedule(dynamic, 16)
+        for(int i = 0; i < colorSize; i++) {
+          assembleElement(coloredElements[i], ithread);
+        }
+      }
+
+      if(ithread != 0) {
+        FemusInit::GetAdeptStack(ithread).deactivate();
+      }
+    }
+
+#else
+
+    const unsigned iproc = msh->processor_id();
+
+    for(unsigned iel = msh->_elementOffset[iproc]; iel < msh->_elementOffset[iproc + 1]; iel++) {
+      assembleElement(iel, 0u);
+    }
+
+#endif
+
+  }
+
+} //end namespace femus
+
+
+
+#endif
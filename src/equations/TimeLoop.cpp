@@ -28,6 +28,7 @@
 #include "NumericVector.hpp"
 #include "SparseMatrix.hpp"
 #include "XDMFWriter.hpp"
+#include "Profiler.hpp"
 
 #include "paral.hpp"
 
@@ -113,9 +114,7 @@ double TimeLoop::MGTimeStep(const uint iter, SystemTwo * eqn_in) const {
     *(_x_oold) = *( eqn_in->_LinSolver[eqn_in->GetGridn()-1]->_EPSC );
 
     /// A) Assemblying
-#if  DEFAULT_PRINT_TIME==1
-    std::clock_t start_time=std::clock();
-#endif
+    ProfilerRegion assemblyRegion("Assembly");
 
     for (uint Level = 0 ; Level < eqn_in->GetGridn(); Level++) {
 	eqn_in->SetLevelToAssemble(Level);
@@ -131,9 +130,9 @@ double TimeLoop::MGTimeStep(const uint iter, SystemTwo * eqn_in) const {
 #endif
     }
 
+    assemblyRegion.Stop();
 #if    DEFAULT_PRINT_TIME==1
-    std::clock_t end_time=std::clock();
-    std::cout << " ================ Assembly time = " << double(end_time- start_time) / CLOCKS_PER_SEC
+    std::cout << " ================ Assembly time = " << assemblyRegion.GetElapsedTime()
               << " s " << std::endl;
 #endif
 
@@ -143,16 +142,14 @@ double TimeLoop::MGTimeStep(const uint iter, SystemTwo * eqn_in) const {
 // They only depend on the nodes (dofs!)
 
 /// D) Solution of the linear MGsystem
-#ifdef DEFAULT_PRINT_TIME
-        std::clock_t start_time_sol = std::clock();
-#endif
+        ProfilerRegion solveRegion("LinearSolve");
 
         eqn_in->MGSolve(DEFAULT_EPS_LSOLV, DEFAULT_MAXITS_LSOLV);
 
+        solveRegion.Stop();
 
 #if    DEFAULT_PRINT_TIME==1
-    std::clock_t end_time_sol = std::clock();
-    std::cout << " ================ Solver time = " << double(end_time_sol- start_time_sol) / CLOCKS_PER_SEC
+    std::cout << " ================ Solver time = " << solveRegion.GetElapsedTime()
               << " s "<< std::endl;
 #endif
 
@@ -373,9 +370,7 @@ void TimeLoop::TransientLoop(const MultiLevelProblem & eqnmap)  {
         curr_time += dt;
         _curr_time  = curr_time;
 
-#if DEFAULT_PRINT_TIME==1 // only for cpu time check --------
-        std::clock_t  start_time=std::clock();
-#endif // -------------------------------------------
+        ProfilerRegion timeStepRegion("TimeStep");
 
         // set up the time step
         std::cout << "\n  ** Solving time step " << curr_step
@@ -387,18 +382,17 @@ void TimeLoop::TransientLoop(const MultiLevelProblem & eqnmap)  {
         //  time step for each system, without printing (good)
         OneTimestepEqnLoop(delta_t_step,eqnmap);
 
-#if DEFAULT_PRINT_TIME==1 // only for cpu time check --------
-        std::clock_t    end_time=std::clock();
-#endif  // ------------------------------------------
+        timeStepRegion.Stop();
 
         // print solution
+        ProfilerRegion outputRegion("Output");
         if (delta_t_step%print_step == 0) XDMFWriter::PrintSolLinear(_files.GetOutputPath(),curr_step,curr_time,eqnmap);   //print sol.N.h5 and sol.N.xmf
+        outputRegion.Stop();
 
 
-#if DEFAULT_PRINT_TIME==1 // only for cpu time check --------
-        std::clock_t    end_time2=std::clock();
-        std::cout <<" Time solver ----->= "   << double(end_time- start_time)/ CLOCKS_PER_SEC
-                  <<" Time printing ----->= " << double(end_time2- end_time) / CLOCKS_PER_SEC <<
+#if DEFAULT_PRINT_TIME==1 // wall-clock time check --------
+        std::cout <<" Time solver ----->= "   << timeStepRegion.GetElapsedTime()
+                  <<" Time printing ----->= " << outputRegion.GetElapsedTime() <<
                   std::endl;
 #endif  // ------------------------------------------
 
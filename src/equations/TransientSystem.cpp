@@ -22,10 +22,34 @@
 #include "LinearImplicitSystem.hpp"
 #include "NonLinearImplicitSystem.hpp"
 #include "NumericVector.hpp"
+#include "Profiler.hpp"
 #include "MonolithicFSINonLinearImplicitSystem.hpp"
 
+#include <cmath>
+
 namespace femus {
 
+  // the Jacobian kept for reuse by a nonlinear system is no longer valid when dt changes
+  static inline void ClearOperator(NonLinearImplicitSystem* system) {
+    system->ClearJacobian();
+    system->ClearCoarseOperators();
+  }
+
+  static inline void ClearOperator(LinearImplicitSystem* system) {
+    system->ClearCoarseOperators();
+  }
+
+  static inline void ClearOperator(System* system) {
+  }
+
+  // the coarse operators frozen by SetCoarseOperatorReuse age by one time step
+  static inline void AdvanceOperatorAge(LinearImplicitSystem* system) {
+    system->AdvanceCoarseOperatorAge();
+  }
+
+  static inline void AdvanceOperatorAge(System* system) {
+  }
+
 
 
 // ------------------------------------------------------------
@@ -40,7 +64,17 @@ TransientSystem<Base>::TransientSystem (MultiLevelProblem& ml_probl,
   _time(0.),
   _time_step(0),
   _dt(0.1),
-  _assembleCounter(0)
+  _assembleCounter(0),
+  _operatorRebuildPeriod(1),
+  _adaptiveTimeStep(false),
+  _adaptiveTolerance(1.e-3),
+  _dtMin(0.),
+  _dtMax(1.e10),
+  _maxNumberOfRejectedSteps(10),
+  _dtOperator(0.),
+  _dtPrevious(0.),
+  _errorEstimate(0.),
+  _errorPrevious(0.)
 {
 
 }
@@ -54,6 +88,13 @@ TransientSystem<Base>::~TransientSystem ()
 template <class Base>
 void TransientSystem<Base>::clear ()
 {
+  for(unsigned ig = 0; ig < _solOldOld.size(); ig++) {
+    for(unsigned k = 0; k < _solOldOld[ig].size(); k++) {
+      if(_solOldOld[ig][k]) delete _solOldOld[ig][k];
+    }
+  }
+  _solOldOld.clear();
+
   // clear the parent data
   Base::clear();
 
@@ -71,87 +112,171 @@ void TransientSystem<Base>::CopySolutionToOldSolution() {
 template <class Base>
 void TransientSystem<Base>::MLsolve() {
 
-  double dtOld = _dt;
+  // call the parent solver
+  Base::_MLsolver = true;
+  Base::_MGsolver = false;
+
+  SolveTimeStep(MULTIPLICATIVE);
+
+}
+
+template <class Base>
+void TransientSystem<Base>::MGsolve( const MgSmootherType& mgSmootherType ) {
+
+  // call the parent solver
+  Base::_MLsolver = false;
+  Base::_MGsolver = true;
+
+  SolveTimeStep(mgSmootherType);
+
+}
+
+template <class Base>
+void TransientSystem<Base>::SolveTimeStep( const MgSmootherType& mgSmootherType ) {
+
+  ProfilerRegion timeStepRegion("TimeStep");
 
   if (_is_selective_timestep) {
     _dt = _get_time_interval_function(_time);
   }
 
+  for(unsigned rejectedSteps = 0; ; rejectedSteps++) {
 
-  if(_assembleCounter % 1 == 0 || _dt != dtOld){
-    std::cout<<"Assemble Matrix\n";
-    Base::_buildSolver = true;
-    if( _dt != dtOld )
+    const bool dtChanged = ( _dt != _dtOperator );
+    if( dtChanged ){
+      ClearOperator(this);
+      _dtOperator = _dt;
       _assembleCounter = 0;
-  }
-  else{
-    std::cout<<"Do not Assemble Matrix";
-    Base::_buildSolver = false;
-  }
-  std::cout<<"assemble counter = "<<_assembleCounter<<std::endl;
-  _assembleCounter++;
+    }
+    AdvanceOperatorAge(this);
+    // with the same dt the operator is rebuilt only every _operatorRebuildPeriod steps
+    Base::_buildSolver = ( dtChanged || _assembleCounter % _operatorRebuildPeriod == 0 );
+    if( Base::_buildSolver ) std::cout<<"Assemble Matrix\n";
+    std::cout<<"assemble counter = "<<_assembleCounter<<std::endl;
+    _assembleCounter++;
 
+    //update time
+    _time += _dt;
 
-  //update time
-  _time += _dt;
+    //update time step
+    _time_step++;
 
-  //update time step
-  _time_step++;
+    std::cout << " Simulation Time: " << _time << "   TimeStep: " << _time_step << "   dt: " << _dt << std::endl;
 
-  std::cout << " Simulation Time: " << _time << "   TimeStep: " << _time_step << std::endl;
+    //update boundary condition
+    this->_ml_sol->UpdateBdc(_time);
 
-   //update boundary condition
-  this->_ml_sol->UpdateBdc(_time);
+    Base::solve( mgSmootherType );
 
-  // call the parent solver
-  Base::_MLsolver = true;
-  Base::_MGsolver = false;
+    if( !_adaptiveTimeStep || _is_selective_timestep ) break;
 
-  Base::solve();
+    // the error estimate needs the solution of two steps before
+    if( _dtPrevious == 0. ) {
+      _errorEstimate = 0.;
+      break;
+    }
 
-}
+    _errorEstimate = EstimateLocalError();
+    std::cout << " Local error estimate: " << _errorEstimate << std::endl;
 
-template <class Base>
-void TransientSystem<Base>::MGsolve( const MgSmootherType& mgSmootherType ) {
+    if( _errorEstimate <= _adaptiveTolerance || _dt <= _dtMin || rejectedSteps == _maxNumberOfRejectedSteps ) break;
 
-  double dtOld = _dt;
+    // reject the step and repeat it with a smaller dt
+    std::cout << " Time step rejected" << std::endl;
+    for (unsigned ig = 0; ig < this->_gridn; ig++) {
+      this->_solution[ig]->ResetSolutionToOldSolution();
+    }
+    _time -= _dt;
+    _time_step--;
 
-  if (_is_selective_timestep) {
-    _dt = _get_time_interval_function(_time);
+    double factor = 0.9 * sqrt(_adaptiveTolerance / _errorEstimate);
+    _dt *= (factor > 0.2) ? factor : 0.2;
+    _dt = (_dt > _dtMin) ? _dt : _dtMin;
   }
 
+  if( _adaptiveTimeStep && !_is_selective_timestep ) {
 
-  if(_assembleCounter % 1 == 0 || _dt != dtOld){
-    std::cout<<"Assemble Matrix\n";
-    Base::_buildSolver = true;
-    if( _dt != dtOld )
-      _assembleCounter = 0;
-  }
-  else{
-    std::cout<<"Do not Assemble Matrix";
-    Base::_buildSolver = false;
+    SaveOldSolutionHistory();
+
+    double dtNext = _dt;
+    if( _dtPrevious != 0. ) {
+      // PI controller for an error estimate of order 2 = (order of the scheme + 1)
+      const double errorMin = 1.e-10 * _adaptiveTolerance;
+      double error = (_errorEstimate > errorMin) ? _errorEstimate : errorMin;
+      double errorPrevious = (_errorPrevious > errorMin) ? _errorPrevious : error;
+      double factor = 0.9 * pow(_adaptiveTolerance / error, 0.7 / 2.) * pow(errorPrevious / _adaptiveTolerance, 0.4 / 2.);
+      factor = (factor > 0.2) ? factor : 0.2;
+      factor = (factor < 5.) ? factor : 5.;
+      dtNext = _dt * factor;
+    }
+    _errorPrevious = _errorEstimate;
+    _dtPrevious = _dt;
+
+    dtNext = (dtNext > _dtMin) ? dtNext : _dtMin;
+    dtNext = (dtNext < _dtMax) ? dtNext : _dtMax;
+    // small changes of dt would only force the rebuild of the operator
+    _dt = (fabs(dtNext - _dt) > 0.1 * _dt) ? dtNext : _dt;
   }
-  std::cout<<"assemble counter = "<<_assembleCounter<<std::endl;
-  _assembleCounter++;
 
+}
+
+template <class Base>
+double TransientSystem<Base>::EstimateLocalError() const {
 
-  //update time
-  _time += _dt;
+  // the solution is compared with the predictor x_n + dt (x_n - x_n-1) / dt_n-1, for backward Euler the local
+  // truncation error is dt / (2 dt + dt_n-1) times their difference
+  const double predictorFactor = _dt / _dtPrevious;
+  const double errorFactor = _dt / (2. * _dt + _dtPrevious);
 
-  //update time step
-  _time_step++;
+  const unsigned ig = this->_gridn - 1u;
+  Solution* solution = this->_solution[ig];
 
-  std::cout << " Simulation Time:  " << _time << "   TimeStep: " << _time_step << std::endl;
+  double error = 0.;
+  for(unsigned k = 0; k < this->_SolSystemPdeIndex.size(); k++) {
+    unsigned indexSol = this->_SolSystemPdeIndex[k];
+    if( !solution->_SolOld[indexSol] || !_solOldOld[ig][k] ) continue;
 
-   //update boundary condition
-  this->_ml_sol->UpdateBdc(_time);
+    std::unique_ptr < NumericVector > difference = solution->_Sol[indexSol]->clone();
+    difference->add(-(1. + predictorFactor), *solution->_SolOld[indexSol]);
+    difference->add(predictorFactor, *_solOldOld[ig][k]);
 
-  // call the parent solver
-  Base::_MLsolver = false;
-  Base::_MGsolver = true;
+    double solutionNorm = solution->_Sol[indexSol]->l2_norm();
+    double variableError = errorFactor * difference->l2_norm() / ((solutionNorm > 1.e-10) ? solutionNorm : 1.);
+    error = (error > variableError) ? error : variableError;
+  }
+
+  return error;
+}
 
-  Base::solve( mgSmootherType );
+template <class Base>
+void TransientSystem<Base>::SaveOldSolutionHistory() {
+
+  _solOldOld.resize(this->_gridn);
+  for (unsigned ig = 0; ig < this->_gridn; ig++) {
+    _solOldOld[ig].resize(this->_SolSystemPdeIndex.size(), NULL);
+    for(unsigned k = 0; k < this->_SolSystemPdeIndex.size(); k++) {
+      NumericVector* solOld = this->_solution[ig]->_SolOld[this->_SolSystemPdeIndex[k]];
+      if( !solOld ) continue;
+      if( !_solOldOld[ig][k] ) {
+        _solOldOld[ig][k] = solOld->clone().release();
+      }
+      else {
+        *_solOldOld[ig][k] = *solOld;
+      }
+    }
+  }
+}
 
+template <class Base>
+void TransientSystem<Base>::SetAdaptiveTimeStep(const bool &value, const double &tolerance,
+                                               const double &dtMin, const double &dtMax, const unsigned &maxNumberOfRejectedSteps) {
+  _adaptiveTimeStep = value;
+  _adaptiveTolerance = tolerance;
+  _dtMin = dtMin;
+  _dtMax = dtMax;
+  _maxNumberOfRejectedSteps = maxNumberOfRejectedSteps;
+  _dtPrevious = 0.;
+  _errorPrevious = 0.;
 }
 
 
@@ -17,6 +17,7 @@
 #define __femus_equations_TransientSystem_hpp__
 
 #include <string>
+#include <vector>
 
 #include "MgSmootherEnum.hpp"
 #include "MgTypeEnum.hpp"
@@ -33,6 +34,7 @@ class NonLinearImplicitSystem;
 class ExplicitSystem;
 class MultiLevelProblem;
 class System;
+class NumericVector;
 
 
 /**
@@ -115,12 +117,39 @@ public:
         _time = time;
     };
 
+    /** Adaptive time step: the local error of each step is estimated from the difference between the solution and its
+     *  linear extrapolation from the two previous steps (first order schemes, e.g. backward Euler), the step is rejected and
+     *  repeated with a smaller dt if the relative error is larger than tolerance, otherwise the next dt is chosen with a PI
+     *  controller within [dtMin, dtMax]. The GetTimeInterval function, if attached, has the precedence */
+    void SetAdaptiveTimeStep(const bool &value, const double &tolerance = 1.e-3,
+                             const double &dtMin = 0., const double &dtMax = 1.e10, const unsigned &maxNumberOfRejectedSteps = 10);
+
+    /** While dt does not change the operator is rebuilt only every period time steps (default 1, every step). In between
+     *  a nonlinear system keeps its Jacobian and preconditioner, if SetJacobianReuseAcrossSolves is set */
+    void SetOperatorRebuildPeriod(const unsigned &period) {
+        _operatorRebuildPeriod = (period > 0) ? period : 1;
+    };
+
+    /** Get the relative local error estimate of the last time step */
+    double GetLocalErrorEstimate() const {
+        return _errorEstimate;
+    };
+
 protected:
 
     double _dt;
 
 private:
 
+    /** Solves one time step, with the adaptive time step it is repeated until the step is accepted */
+    void SolveTimeStep(const MgSmootherType& mgSmootherType);
+
+    /** Relative local error estimate of the time step just solved */
+    double EstimateLocalError() const;
+
+    /** Saves the old solution as the solution of two steps before, for the next error estimate */
+    void SaveOldSolutionHistory();
+
     bool _is_selective_timestep;
 
     double _time;
@@ -131,6 +160,23 @@ private:
     double (* _get_time_interval_function)(const double time);
 
     unsigned _assembleCounter;
+    unsigned _operatorRebuildPeriod;
+
+    /** Adaptive time step */
+    bool _adaptiveTimeStep;
+    double _adaptiveTolerance;
+    double _dtMin;
+    double _dtMax;
+    unsigned _maxNumberOfRejectedSteps;
+
+    /** dt of the last solve, the operator of the system is kept only while dt does not change */
+    double _dtOperator;
+
+    /** dt, relative error estimate and solution of the last accepted steps */
+    double _dtPrevious;
+    double _errorEstimate;
+    double _errorPrevious;
+    std::vector < std::vector < NumericVector* > > _solOldOld;
 
 };
 
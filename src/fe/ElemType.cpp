@@ -39,6 +39,7 @@ namespace femus {
   elem_type::elem_type(const char* geom_elem, const char* order_gauss) : _gauss(geom_elem, order_gauss)
   {
     isMpGDAllocated = false;
+    _sumFactorization = false;
     
       if ( !strcmp(geom_elem, "quad") || !strcmp(geom_elem, "tri") ) { //QUAD or TRI ///@todo delete in the destructor 
            _gauss_bdry = new  Gauss("line",order_gauss);
@@ -1069,6 +1070,8 @@ namespace femus {
 
     //std::cout << std::endl;
 
+    if(!strcmp(geom_elem, "quad") && _SolType == 2) BuildSumFactorization();
+
     delete linearElement;
 
 
@@ -1490,6 +1493,8 @@ namespace femus {
 
     //std::cout << std::endl;
 
+    if(!strcmp(geom_elem, "hex") && _SolType == 2) BuildSumFactorization();
+
     delete linearElement;
 
   }
@@ -1502,7 +1507,7 @@ namespace femus {
   {
 
     jacobianMatrix.resize(1);
-    jacobianMatrix[1].resize(1);
+    jacobianMatrix[0].resize(1);
 
 
     type Jac = 0.;
@@ -2200,6 +2205,361 @@ namespace femus {
       }
     }
   }
+//---------------------------------------------------------------------------------------------------------
+
+  void elem_type_1D::JacobianBatch(const double* vt, const unsigned& nElements, double* Weight, double* gradphi) const
+  {
+
+    const unsigned n = nElements;
+    std::vector < double > jac(n);
+
+    for(unsigned ig = 0; ig < _gauss.GetGaussPointsNumber(); ig++) {
+
+      for(unsigned jel = 0; jel < n; jel++) jac[jel] = 0.;
+
+      for(int inode = 0; inode < _nc; inode++) {
+        const double dxi = _dphidxi[ig][inode];
+        const double* x = vt + inode * n;
+        for(unsigned jel = 0; jel < n; jel++) jac[jel] += dxi * x[jel];
+      }
+
+      const double weight = _gauss.GetGaussWeightsPointer()[ig];
+      double* w = Weight + ig * n;
+      for(unsigned jel = 0; jel < n; jel++) {
+        w[jel] = jac[jel] * weight;
+        jac[jel] = 1. / jac[jel];
+      }
+
+      for(int inode = 0; inode < _nc; inode++) {
+        const double dxi = _dphidxi[ig][inode];
+        double* g = gradphi + (ig * _nc + inode) * n;
+        for(unsigned jel = 0; jel < n; jel++) g[jel] = dxi * jac[jel];
+      }
+    }
+
+  }
+
+//---------------------------------------------------------------------------------------------------------
+
+  void elem_type_2D::JacobianBatch(const double* vt, const unsigned& nElements, double* Weight, double* gradphi) const
+  {
+
+    const unsigned n = nElements;
+    std::vector < double > jac(4 * n);
+    double* J00 = &jac[0];
+    double* J01 = J00 + n;
+    double* J10 = J01 + n;
+    double* J11 = J10 + n;
+
+    for(unsigned ig = 0; ig < _gauss.GetGaussPointsNumber(); ig++) {
+
+      for(unsigned jel = 0; jel < 4 * n; jel++) jac[jel] = 0.;
+
+      for(int inode = 0; inode < _nc; inode++) {
+        const double dxi = _dphidxi[ig][inode];
+        const double deta = _dphideta[ig][inode];
+        const double* x = vt + inode * n;
+        const double* y = vt + (_nc + inode) * n;
+        for(unsigned jel = 0; jel < n; jel++) {
+          J00[jel] += dxi * x[jel];
+          J01[jel] += dxi * y[jel];
+          J10[jel] += deta * x[jel];
+          J11[jel] += deta * y[jel];
+        }
+      }
+
+      // replace the Jacobian matrix with its inverse
+      const double weight = _gauss.GetGaussWeightsPointer()[ig];
+      double* w = Weight + ig * n;
+      for(unsigned jel = 0; jel < n; jel++) {
+        const double det = J00[jel] * J11[jel] - J01[jel] * J10[jel];
+        const double idet = 1. / det;
+        const double a00 = J00[jel];
+        w[jel] = det * weight;
+        J00[jel] = J11[jel] * idet;
+        J01[jel] = -J01[jel] * idet;
+        J10[jel] = -J10[jel] * idet;
+        J11[jel] = a00 * idet;
+      }
+
+      for(int inode = 0; inode < _nc; inode++) {
+        const double dxi = _dphidxi[ig][inode];
+        const double deta = _dphideta[ig][inode];
+        double* gx = gradphi + (ig * _nc + inode) * 2 * n;
+        double* gy = gx + n;
+        for(unsigned jel = 0; jel < n; jel++) {
+          gx[jel] = dxi * J00[jel] + deta * J01[jel];
+          gy[jel] = dxi * J10[jel] + deta * J11[jel];
+        }
+      }
+    }
+
+  }
+
+//---------------------------------------------------------------------------------------------------------
+
+  void elem_type_3D::JacobianBatch(const double* vt, const unsigned& nElements, double* Weight, double* gradphi) const
+  {
+
+    const unsigned n = nElements;
+    std::vector < double > jac(9 * n), jacI(9 * n);
+    double* J[3][3];
+    double* JI[3][3];
+    for(unsigned k = 0; k < 3; k++) {
+      for(unsigned l = 0; l < 3; l++) {
+        J[k][l] = &jac[(3 * k + l) * n];
+        JI[k][l] = &jacI[(3 * k + l) * n];
+      }
+    }
+
+    for(unsigned ig = 0; ig < _gauss.GetGaussPointsNumber(); ig++) {
+
+      for(unsigned jel = 0; jel < 9 * n; jel++) jac[jel] = 0.;
+
+      for(int inode = 0; inode < _nc; inode++) {
+        const double dxez[3] = {_dphidxi[ig][inode], _dphideta[ig][inode], _dphidzeta[ig][inode]};
+        for(unsigned l = 0; l < 3; l++) {
+          const double* x = vt + (l * _nc + inode) * n;
+          for(unsigned k = 0; k < 3; k++) {
+            double* Jkl = J[k][l];
+            for(unsigned jel = 0; jel < n; jel++) Jkl[jel] += dxez[k] * x[jel];
+          }
+        }
+      }
+
+      const double weight = _gauss.GetGaussWeightsPointer()[ig];
+      double* w = Weight + ig * n;
+      for(unsigned jel = 0; jel < n; jel++) {
+        const double det = (J[0][0][jel] * (J[1][1][jel] * J[2][2][jel] - J[1][2][jel] * J[2][1][jel]) +
+                            J[0][1][jel] * (J[1][2][jel] * J[2][0][jel] - J[1][0][jel] * J[2][2][jel]) +
+                            J[0][2][jel] * (J[1][0][jel] * J[2][1][jel] - J[1][1][jel] * J[2][0][jel]));
+        const double idet = 1. / det;
+        w[jel] = det * weight;
+        JI[0][0][jel] = (-J[1][2][jel] * J[2][1][jel] + J[1][1][jel] * J[2][2][jel]) * idet;
+        JI[0][1][jel] = (J[0][2][jel] * J[2][1][jel] - J[0][1][jel] * J[2][2][jel]) * idet;
+        JI[0][2][jel] = (-J[0][2][jel] * J[1][1][jel] + J[0][1][jel] * J[1][2][jel]) * idet;
+        JI[1][0][jel] = (J[1][2][jel] * J[2][0][jel] - J[1][0][jel] * J[2][2][jel]) * idet;
+        JI[1][1][jel] = (-J[0][2][jel] * J[2][0][jel] + J[0][0][jel] * J[2][2][jel]) * idet;
+        JI[1][2][jel] = (J[0][2][jel] * J[1][0][jel] - J[0][0][jel] * J[1][2][jel]) * idet;
+        JI[2][0][jel] = (-J[1][1][jel] * J[2][0][jel] + J[1][0][jel] * J[2][1][jel]) * idet;
+        JI[2][1][jel] = (J[0][1][jel] * J[2][0][jel] - J[0][0][jel] * J[2][1][jel]) * idet;
+        JI[2][2][jel] = (-J[0][1][jel] * J[1][0][jel] + J[0][0][jel] * J[1][1][jel]) * idet;
+      }
+
+      for(int inode = 0; inode < _nc; inode++) {
+        const double dxi = _dphidxi[ig][inode];
+        const double deta = _dphideta[ig][inode];
+        const double dzeta = _dphidzeta[ig][inode];
+        for(unsigned k = 0; k < 3; k++) {
+          double* g = gradphi + ((ig * _nc + inode) * 3 + k) * n;
+          const double* JIk0 = JI[k][0];
+          const double* JIk1 = JI[k][1];
+          const double* JIk2 = JI[k][2];
+          for(unsigned jel = 0; jel < n; jel++) {
+            g[jel] = dxi * JIk0[jel] + deta * JIk1[jel] + dzeta * JIk2[jel];
+          }
+        }
+      }
+    }
+
+  }
+
+//---------------------------------------------------------------------------------------------------------
+
+  // out = M in along the direction d of a tensor with extents n, the extent of the direction d becomes nOut;
+  // M is stored as [a * 3 + i], a the 1D gauss point and i the 1D dof, and it is applied transposed if transpose is true
+  static void ContractTensorDirection(const double* M, const bool& transpose, const unsigned& d, unsigned* n, const unsigned& dim,
+                                      const unsigned& nOut, const double* in, double* out)
+  {
+
+    unsigned before = 1, after = 1;
+    for(unsigned k = 0; k < d; k++) before *= n[k];
+    for(unsigned k = d + 1; k < dim; k++) after *= n[k];
+    const unsigned nIn = n[d];
+
+    for(unsigned b = 0; b < before; b++) {
+      for(unsigned o = 0; o < nOut; o++) {
+        double* outBlock = out + (b * nOut + o) * after;
+        for(unsigned c = 0; c < after; c++) outBlock[c] = 0.;
+        for(unsigned i = 0; i < nIn; i++) {
+          const double m = (transpose) ? M[i * 3 + o] : M[o * 3 + i];
+          const double* inBlock = in + (b * nIn + i) * after;
+          for(unsigned c = 0; c < after; c++) outBlock[c] += m * inBlock[c];
+        }
+      }
+    }
+    n[d] = nOut;
+
+  }
+
+//---------------------------------------------------------------------------------------------------------
+
+  void elem_type::BuildSumFactorization()
+  {
+
+    const unsigned nGauss = _gauss.GetGaussPointsNumber();
+    const double* xiGauss = _gauss.GetGaussWeightsPointer() + nGauss;
+    const double tolerance = 1.e-10;
+
+    // the 1D gauss points are the distinct coordinates of the gauss points in the first direction
+    std::vector < double > xi1D;
+    for(unsigned ig = 0; ig < nGauss; ig++) {
+      unsigned a = 0;
+      while(a < xi1D.size() && fabs(xi1D[a] - xiGauss[ig]) > tolerance) a++;
+      if(a == xi1D.size()) xi1D.push_back(xiGauss[ig]);
+    }
+    _nGauss1D = xi1D.size();
+
+    unsigned nTensor = 1;
+    for(unsigned k = 0; k < _dim; k++) nTensor *= _nGauss1D;
+    if(nTensor != nGauss || _nGauss1D > 5) return;
+
+    // position of each gauss point in the tensor-product ordering, all the directions must use the same 1D points
+    _tensorGaussPoint.resize(nGauss);
+    std::vector < bool > isUsed(nGauss, false);
+    for(unsigned ig = 0; ig < nGauss; ig++) {
+      unsigned index = 0;
+      for(unsigned k = 0; k < _dim; k++) {
+        unsigned a = 0;
+        while(a < _nGauss1D && fabs(xi1D[a] - xiGauss[k * nGauss + ig]) > tolerance) a++;
+        if(a == _nGauss1D) return;
+        index = index * _nGauss1D + a;
+      }
+      if(isUsed[index]) return;
+      isUsed[index] = true;
+      _tensorGaussPoint[ig] = index;
+    }
+
+    // the 1D dofs 0, 1, 2 of the biquadratic element are at -1, 0, 1
+    _phi1D.resize(_nGauss1D * 3);
+    _dphi1D.resize(_nGauss1D * 3);
+    for(unsigned a = 0; a < _nGauss1D; a++) {
+      double x = xi1D[a];
+      _phi1D[a * 3]     = 0.5 * x * (x - 1.);
+      _phi1D[a * 3 + 1] = (1. - x) * (1. + x);
+      _phi1D[a * 3 + 2] = 0.5 * x * (x + 1.);
+      _dphi1D[a * 3]     = x - 0.5;
+      _dphi1D[a * 3 + 1] = -2. * x;
+      _dphi1D[a * 3 + 2] = x + 0.5;
+    }
+
+    _tensorDof.resize(_nc);
+    for(int i = 0; i < _nc; i++) {
+      unsigned index = 0;
+      for(unsigned k = 0; k < _dim; k++) {
+        index = index * 3 + _IND[i][k];
+      }
+      _tensorDof[i] = index;
+    }
+
+    // the products of the 1D tables must give the tabulated derivatives
+    for(unsigned ig = 0; ig < nGauss; ig++) {
+      const double* dphi[3] = {GetDPhiDXi(ig), (_dim > 1) ? GetDPhiDEta(ig) : NULL, (_dim > 2) ? GetDPhiDZeta(ig) : NULL};
+      unsigned a[3];
+      for(unsigned k = 0, index = _tensorGaussPoint[ig]; k < _dim; k++) {
+        a[_dim - 1 - k] = index % _nGauss1D;
+        index /= _nGauss1D;
+      }
+      for(int i = 0; i < _nc; i++) {
+        for(unsigned l = 0; l < _dim; l++) {
+          double product = 1.;
+          for(unsigned k = 0; k < _dim; k++) {
+            product *= (k == l) ? _dphi1D[a[k] * 3 + _IND[i][k]] : _phi1D[a[k] * 3 + _IND[i][k]];
+          }
+          if(fabs(product - dphi[l][i]) > tolerance) return;
+        }
+      }
+    }
+
+    _sumFactorization = true;
+
+  }
+
+//---------------------------------------------------------------------------------------------------------
+
+  void elem_type::GetReferenceGradients(const double* x, double* gradXi) const
+  {
+
+    const unsigned nGauss = _gauss.GetGaussPointsNumber();
+
+    if(!_sumFactorization) {
+      for(unsigned ig = 0; ig < nGauss; ig++) {
+        const double* dphi[3] = {GetDPhiDXi(ig), (_dim > 1) ? GetDPhiDEta(ig) : NULL, (_dim > 2) ? GetDPhiDZeta(ig) : NULL};
+        for(unsigned l = 0; l < _dim; l++) {
+          double value = 0.;
+          for(int i = 0; i < _nc; i++) {
+            value += dphi[l][i] * x[i];
+          }
+          gradXi[ig * _dim + l] = value;
+        }
+      }
+      return;
+    }
+
+    // O(n^(dim+1)) operations per component instead of O(n^(2 dim)), n the number of 1D dofs or gauss points
+    double tensorDofs[27];
+    double work[2][125];
+    for(int i = 0; i < _nc; i++) {
+      tensorDofs[_tensorDof[i]] = x[i];
+    }
+
+    for(unsigned l = 0; l < _dim; l++) {
+      unsigned n[3] = {3, 3, 3};
+      const double* in = tensorDofs;
+      for(unsigned k = 0; k < _dim; k++) {
+        double* out = work[k % 2];
+        ContractTensorDirection((k == l) ? &_dphi1D[0] : &_phi1D[0], false, k, n, _dim, _nGauss1D, in, out);
+        in = out;
+      }
+      for(unsigned ig = 0; ig < nGauss; ig++) {
+        gradXi[ig * _dim + l] = in[_tensorGaussPoint[ig]];
+      }
+    }
+
+  }
+
+//---------------------------------------------------------------------------------------------------------
+
+  void elem_type::AddReferenceGradientsTranspose(const double* fluxXi, double* y) const
+  {
+
+    const unsigned nGauss = _gauss.GetGaussPointsNumber();
+
+    if(!_sumFactorization) {
+      for(unsigned ig = 0; ig < nGauss; ig++) {
+        const double* dphi[3] = {GetDPhiDXi(ig), (_dim > 1) ? GetDPhiDEta(ig) : NULL, (_dim > 2) ? GetDPhiDZeta(ig) : NULL};
+        for(int i = 0; i < _nc; i++) {
+          double value = 0.;
+          for(unsigned l = 0; l < _dim; l++) {
+            value += dphi[l][i] * fluxXi[ig * _dim + l];
+          }
+          y[i] += value;
+        }
+      }
+      return;
+    }
+
+    double tensorFlux[125];
+    double work[2][125];
+
+    for(unsigned l = 0; l < _dim; l++) {
+      for(unsigned ig = 0; ig < nGauss; ig++) {
+        tensorFlux[_tensorGaussPoint[ig]] = fluxXi[ig * _dim + l];
+      }
+      unsigned n[3] = {_nGauss1D, _nGauss1D, _nGauss1D};
+      const double* in = tensorFlux;
+      for(unsigned k = 0; k < _dim; k++) {
+        double* out = work[k % 2];
+        ContractTensorDirection((k == l) ? &_dphi1D[0] : &_phi1D[0], true, k, n, _dim, 3, in, out);
+        in = out;
+      }
+      for(int i = 0; i < _nc; i++) {
+        y[i] += in[_tensorDof[i]];
+      }
+    }
+
+  }
+
 } //end namespace femus
 
 
@@ -95,6 +95,27 @@ namespace femus
 
       virtual void JacobianSur(const vector < vector < double > >& vt, const unsigned& ig, double& Weight,
                                vector < double >& other_phi, vector < double >& gradphi, vector < double >& normal) const = 0;
+
+      /** Evaluate weights and physical shape function gradients for nElements elements at all the gauss points.
+       * The buffers are structure of arrays with the element index running fastest, so that the inner loops vectorize:
+       * vt[(k * nDofs + inode) * nElements + jel] is the k-th coordinate of the node inode of the element jel,
+       * Weight[ig * nElements + jel] and gradphi[((ig * nDofs + inode) * dim + k) * nElements + jel].
+       * The shape functions do not depend on the element, use GetPhi(ig) */
+      virtual void JacobianBatch(const double* vt, const unsigned& nElements, double* Weight, double* gradphi) const = 0;
+
+      /** Evaluate the reference gradient of the field with element dofs x at all the gauss points, gradXi[ig * dim + l].
+       * For the biquadratic Quad and Hex with a tensor-product gauss rule it uses the sum factorization with the 1D
+       * shape functions, otherwise the tabulated shape function derivatives */
+      void GetReferenceGradients(const double* x, double* gradXi) const;
+
+      /** Transpose of GetReferenceGradients: y[i] += sum_ig sum_l dphi_i/dxi_l(ig) fluxXi[ig * dim + l] */
+      void AddReferenceGradientsTranspose(const double* fluxXi, double* y) const;
+
+      /** Returns true if GetReferenceGradients and AddReferenceGradientsTranspose use the sum factorization */
+      bool IsSumFactorized() const {
+        return _sumFactorization;
+      }
+
       /** To be Added */
       virtual double* GetPhi(const unsigned& ig) const = 0;
 
@@ -204,6 +225,18 @@ namespace femus
       const Gauss _gauss;
             Gauss* _gauss_bdry;
 
+      /** Build the 1D tables of the sum factorization, if the element and the gauss rule are tensor products */
+      void BuildSumFactorization();
+
+      // sum factorization: 1D shape functions and derivatives [a * 3 + i] at the 1D gauss points a, position of each dof
+      // and of each gauss point in the tensor-product ordering (first direction outermost)
+      bool _sumFactorization;
+      unsigned _nGauss1D;
+      std::vector < double > _phi1D;
+      std::vector < double > _dphi1D;
+      std::vector < unsigned > _tensorDof;
+      std::vector < unsigned > _tensorGaussPoint;
+
       /**  @deprecated */
       bool isMpGDAllocated;
       double**      _phi_mapGD;
@@ -293,6 +326,8 @@ namespace femus
         JacobianSur_type(vt, ig, Weight, phi, gradphi, normal);
       }
 
+      void JacobianBatch(const double* vt, const unsigned& nElements, double* Weight, double* gradphi) const;
+
       inline double* GetPhi(const unsigned& ig) const {
         return _phi[ig];
       }
@@ -409,6 +444,8 @@ namespace femus
         JacobianSur_type(vt, ig, Weight, phi, gradphi, normal);
       }
 
+      void JacobianBatch(const double* vt, const unsigned& nElements, double* Weight, double* gradphi) const;
+
       inline double* GetPhi(const unsigned& ig) const {
         return _phi[ig];
       }
@@ -543,6 +580,8 @@ namespace femus
       }
 
 
+      void JacobianBatch(const double* vt, const unsigned& nElements, double* Weight, double* gradphi) const;
+
       //---------------------------------------------------------------------------------------------------------
       inline double* GetPhi(const unsigned& ig) const {
         return _phi[ig];
@@ -0,0 +1,311 @@
+/*=========================================================================
+
+ Program: FEMuS
+ Module: ElementSearchGrid
+
+ Copyright (c) FEMuS
+ All rights reserved.
+
+ This software is distributed WITHOUT ANY WARRANTY; without even
+ the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ PURPOSE.  See the above copyright notice for more information.
+
+=========================================================================*/
+
+//----------------------------------------------------------------------------
+// includes :
+//----------------------------------------------------------------------------
+#include "ElementSearchGrid.hpp"
+#include "Marker.hpp"
+#include "Mesh.hpp"
+#include "Solution.hpp"
+
+#include <cmath>
+#include <climits>
+#include <cstdlib>
+#include <limits>
+
+namespace femus {
+
+  ElementSearchGrid::ElementSearchGrid() :
+    _sol(NULL),
+    _s(0.),
+    _dim(0) {
+    _cellOffset.assign(1, 0);
+  }
+
+
+  ElementSearchGrid::ElementSearchGrid(Solution *sol, const double &s) {
+    Build(sol, s);
+  }
+
+
+  void ElementSearchGrid::Build(Solution *sol, const double &s) {
+
+    _sol = sol;
+    _s = s;
+
+    Mesh *msh = sol->GetMesh();
+    _dim = msh->GetDimension();
+
+    unsigned elementStart = msh->_elementOffset[_iproc];
+    unsigned elementEnd = msh->_elementOffset[_iproc + 1];
+    unsigned nel = elementEnd - elementStart;
+
+    _element.resize(nel);
+    _elementBoxMin.assign(nel * _dim, std::numeric_limits < double >::max());
+    _elementBoxMax.assign(nel * _dim, -std::numeric_limits < double >::max());
+    _elementCenter.resize(nel * _dim);
+
+    _xMin.assign(_dim, std::numeric_limits < double >::max());
+    _xMax.assign(_dim, -std::numeric_limits < double >::max());
+
+    //BEGIN element bounding boxes
+    for(unsigned iel = elementStart; iel < elementEnd; iel++) {
+      unsigned ie = iel - elementStart;
+      _element[ie] = iel;
+
+      unsigned nDofs = msh->GetElementDofNumber(iel, 2);
+      for(unsigned i = 0; i < nDofs; i++) {
+        unsigned idof = msh->GetSolutionDof(i, iel, 2);
+        for(unsigned k = 0; k < _dim; k++) {
+          double xk = Marker::GetCoordinates(sol, k, idof, s);
+          if(xk < _elementBoxMin[ie * _dim + k]) _elementBoxMin[ie * _dim + k] = xk;
+          if(xk > _elementBoxMax[ie * _dim + k]) _elementBoxMax[ie * _dim + k] = xk;
+          if(i == nDofs - 1) _elementCenter[ie * _dim + k] = xk;  // interior node
+        }
+      }
+
+      for(unsigned k = 0; k < _dim; k++) {
+        if(_elementBoxMin[ie * _dim + k] < _xMin[k]) _xMin[k] = _elementBoxMin[ie * _dim + k];
+        if(_elementBoxMax[ie * _dim + k] > _xMax[k]) _xMax[k] = _elementBoxMax[ie * _dim + k];
+      }
+    }
+    //END element bounding boxes
+
+    //BEGIN grid size: about one cell per element
+    _nCells.assign(_dim, 1);
+    _h.assign(_dim, 1.);
+
+    if(nel > 0) {
+      double maxLength = 0.;
+      for(unsigned k = 0; k < _dim; k++) {
+        maxLength = (_xMax[k] - _xMin[k] > maxLength) ? _xMax[k] - _xMin[k] : maxLength;
+      }
+      double minLength = (maxLength > 0.) ? 1.e-6 * maxLength : 1.;
+
+      double volume = 1.;
+      for(unsigned k = 0; k < _dim; k++) {
+        double length = (_xMax[k] - _xMin[k] > minLength) ? _xMax[k] - _xMin[k] : minLength;
+        volume *= length;
+      }
+      double h = pow(volume / nel, 1. / _dim);
+
+      for(unsigned k = 0; k < _dim; k++) {
+        double length = (_xMax[k] - _xMin[k] > minLength) ? _xMax[k] - _xMin[k] : minLength;
+        double n = ceil(length / h);
+        _nCells[k] = (n < 1.) ? 1 : ((n > nel) ? nel : static_cast < unsigned >(n));
+        _h[k] = length / _nCells[k];
+      }
+    }
+
+    unsigned nCells = 1;
+    for(unsigned k = 0; k < _dim; k++) {
+      nCells *= _nCells[k];
+    }
+    //END grid size
+
+    //BEGIN fill the cells, counting first and then storing
+    std::vector < unsigned > cellIndex(_dim);
+    std::vector < unsigned > cellMin(_dim), cellMax(_dim);
+    std::vector < double > x(_dim);
+
+    _cellOffset.assign(nCells + 1, 0);
+
+    for(unsigned pass = 0; pass < 2; pass++) {
+      std::vector < unsigned > counter;
+      if(pass == 1) {
+        for(unsigned c = 0; c < nCells; c++) {
+          _cellOffset[c + 1] += _cellOffset[c];
+        }
+        _cellElement.resize(_cellOffset[nCells]);
+        counter.assign(_cellOffset.begin(), _cellOffset.end() - 1);
+      }
+
+      for(unsigned ie = 0; ie < nel; ie++) {
+        for(unsigned k = 0; k < _dim; k++) x[k] = _elementBoxMin[ie * _dim + k];
+        GetCell(x, cellMin);
+        for(unsigned k = 0; k < _dim; k++) x[k] = _elementBoxMax[ie * _dim + k];
+        GetCell(x, cellMax);
+
+        cellIndex = cellMin;
+        while(true) {
+          unsigned c = 0;
+          for(int k = _dim - 1; k >= 0; k--) {
+            c = c * _nCells[k] + cellIndex[k];
+          }
+          if(pass == 0) {
+            _cellOffset[c + 1]++;
+          }
+          else {
+            _cellElement[counter[c]] = ie;
+            counter[c]++;
+          }
+
+          unsigned k = 0;
+          while(k < _dim && cellIndex[k] == cellMax[k]) {
+            cellIndex[k] = cellMin[k];
+            k++;
+          }
+          if(k == _dim) break;
+          cellIndex[k]++;
+        }
+      }
+    }
+    //END fill the cells
+  }
+
+
+  unsigned ElementSearchGrid::GetCell(const std::vector < double > &x, std::vector < unsigned > &cellIndex) const {
+
+    unsigned c = 0;
+    cellIndex.resize(_dim);
+    for(int k = _dim - 1; k >= 0; k--) {
+      double ck = floor((x[k] - _xMin[k]) / _h[k]);
+      cellIndex[k] = (ck < 0.) ? 0 : ((ck >= _nCells[k]) ? _nCells[k] - 1 : static_cast < unsigned >(ck));
+      c = c * _nCells[k] + cellIndex[k];
+    }
+    return c;
+  }
+
+
+  unsigned ElementSearchGrid::GetClosestElement(const std::vector < double > &x, const unsigned &cell, double &distance2) const {
+
+    unsigned closest = UINT_MAX;
+    for(unsigned j = _cellOffset[cell]; j < _cellOffset[cell + 1]; j++) {
+      unsigned ie = _cellElement[j];
+      double d2 = 0.;
+      for(unsigned k = 0; k < _dim; k++) {
+        double dk = _elementCenter[ie * _dim + k] - x[k];
+        d2 += dk * dk;
+      }
+      if(d2 < distance2) {
+        distance2 = d2;
+        closest = ie;
+      }
+    }
+    return closest;
+  }
+
+
+  void ElementSearchGrid::GetCandidateElements(const std::vector < double > &x, std::vector < unsigned > &candidates) const {
+
+    candidates.resize(0);
+    if(_element.size() == 0) return;
+
+    std::vector < unsigned > cellIndex;
+    unsigned cell = GetCell(x, cellIndex);
+
+    for(unsigned j = _cellOffset[cell]; j < _cellOffset[cell + 1]; j++) {
+      unsigned ie = _cellElement[j];
+      bool inside = true;
+      for(unsigned k = 0; k < _dim; k++) {
+        double tolerance = 1.e-10 * _h[k];
+        if(x[k] < _elementBoxMin[ie * _dim + k] - tolerance || x[k] > _elementBoxMax[ie * _dim + k] + tolerance) {
+          inside = false;
+          break;
+        }
+      }
+      if(inside) candidates.push_back(_element[ie]);
+    }
+  }
+
+
+  unsigned ElementSearchGrid::GetStartElement(const std::vector < double > &x) const {
+
+    if(_element.size() == 0) return UINT_MAX;
+
+    std::vector < unsigned > candidates;
+    GetCandidateElements(x, candidates);
+
+    Mesh *msh = _sol->GetMesh();
+    unsigned elementStart = msh->_elementOffset[_iproc];
+
+    if(candidates.size() > 0) {
+      unsigned start = candidates[0];
+      double distance2 = std::numeric_limits < double >::max();
+      for(unsigned i = 0; i < candidates.size(); i++) {
+        unsigned ie = candidates[i] - elementStart;
+        double d2 = 0.;
+        for(unsigned k = 0; k < _dim; k++) {
+          double dk = _elementCenter[ie * _dim + k] - x[k];
+          d2 += dk * dk;
+        }
+        if(d2 < distance2) {
+          distance2 = d2;
+          start = candidates[i];
+        }
+      }
+      return start;
+    }
+
+    // x is in no bounding box: search the rings of cells around the closest cell,
+    // one more ring after the first element is found since its element could be closer
+    std::vector < unsigned > center;
+    GetCell(x, center);
+
+    unsigned maxRadius = 0;
+    for(unsigned k = 0; k < _dim; k++) {
+      maxRadius = (_nCells[k] > maxRadius) ? _nCells[k] : maxRadius;
+    }
+
+    unsigned closest = UINT_MAX;
+    double distance2 = std::numeric_limits < double >::max();
+    unsigned lastRadius = maxRadius;
+
+    std::vector < int > cellMin(_dim), cellMax(_dim), cellIndex(_dim);
+    for(unsigned r = 0; r <= lastRadius; r++) {
+      for(unsigned k = 0; k < _dim; k++) {
+        cellMin[k] = (static_cast < int >(center[k]) - static_cast < int >(r) > 0) ? center[k] - r : 0;
+        cellMax[k] = (center[k] + r < _nCells[k]) ? center[k] + r : _nCells[k] - 1;
+      }
+
+      cellIndex = cellMin;
+      while(true) {
+        bool onRing = false;
+        unsigned c = 0;
+        for(int k = _dim - 1; k >= 0; k--) {
+          if(static_cast < unsigned >(abs(cellIndex[k] - static_cast < int >(center[k]))) == r) onRing = true;
+          c = c * _nCells[k] + cellIndex[k];
+        }
+        if(onRing) {
+          unsigned ie = GetClosestElement(x, c, distance2);
+          if(ie != UINT_MAX) closest = ie;
+        }
+
+        unsigned k = 0;
+        while(k < _dim && cellIndex[k] == cellMax[k]) {
+          cellIndex[k] = cellMin[k];
+          k++;
+        }
+        if(k == _dim) break;
+        cellIndex[k]++;
+      }
+
+      if(closest != UINT_MAX && lastRadius == maxRadius) {
+        lastRadius = r + 1;
+      }
+    }
+
+    return (closest != UINT_MAX) ? _element[closest] : UINT_MAX;
+  }
+
+
+  void ElementSearchGrid::GetStartElements(const std::vector < std::vector < double > > &x, std::vector < unsigned > &elem) const {
+    elem.resize(x.size());
+    for(unsigned i = 0; i < x.size(); i++) {
+      elem[i] = GetStartElement(x[i]);
+    }
+  }
+
+} //end namespace femus
@@ -0,0 +1,90 @@
+/*=========================================================================
+
+ Program: FEMuS
+ Module: ElementSearchGrid
+
+ Copyright (c) FEMuS
+ All rights reserved.
+
+ This software is distributed WITHOUT ANY WARRANTY; without even
+ the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ PURPOSE.  See the above copyright notice for more information.
+
+=========================================================================*/
+
+#ifndef __femus_ism_ElementSearchGrid_hpp__
+#define __femus_ism_ElementSearchGrid_hpp__
+
+//----------------------------------------------------------------------------
+// includes :
+//----------------------------------------------------------------------------
+#include "ParallelObject.hpp"
+
+#include <vector>
+
+namespace femus {
+
+  class Solution;
+
+  /**
+   * Uniform bucket grid over the bounding boxes of the elements owned by this process, used to choose the element
+   * from which Marker::GetElement starts its neighbor walk. Every cell lists the elements whose bounding box overlaps it,
+   * so a point is resolved by looking at one cell instead of scanning the elements of the process.
+   * The bounding boxes are computed at the time s of the moving mesh (see Marker::GetCoordinates):
+   * the grid has to be built again with Build when the mesh moves.
+   **/
+  class ElementSearchGrid : public ParallelObject {
+
+    public:
+
+      ElementSearchGrid();
+
+      ElementSearchGrid(Solution *sol, const double &s);
+
+      /** Builds the grid on the elements owned by this process, not collective */
+      void Build(Solution *sol, const double &s);
+
+      /** Returns the elements whose bounding box contains x, local to this process */
+      void GetCandidateElements(const std::vector < double > &x, std::vector < unsigned > &candidates) const;
+
+      /** Returns the element of this process that is the best start for the search of x:
+       * the candidate with the closest interior node, or, if no bounding box contains x, the closest element of the
+       * nearest non-empty cells. Returns UINT_MAX if this process has no elements */
+      unsigned GetStartElement(const std::vector < double > &x) const;
+
+      /** Batched GetStartElement for many points */
+      void GetStartElements(const std::vector < std::vector < double > > &x, std::vector < unsigned > &elem) const;
+
+      double GetTime() const {
+        return _s;
+      }
+
+    private:
+
+      unsigned GetCell(const std::vector < double > &x, std::vector < unsigned > &cellIndex) const;
+      unsigned GetClosestElement(const std::vector < double > &x, const unsigned &cell, double &distance2) const;
+
+      Solution *_sol;
+      double _s;
+      unsigned _dim;
+
+      std::vector < double > _xMin;
+      std::vector < double > _xMax;
+      std::vector < double > _h;
+      std::vector < unsigned > _nCells;
+
+      /** bounding boxes and interior nodes of the local elements, element by element */
+      std::vector < unsigned > _element;
+      std::vector < double > _elementBoxMin;
+      std::vector < double > _elementBoxMax;
+      std::vector < double > _elementCenter;
+
+      /** elements of each cell, the cell c lists _cellElement[_cellOffset[c]] ... _cellElement[_cellOffset[c + 1] - 1] */
+      std::vector < unsigned > _cellOffset;
+      std::vector < unsigned > _cellElement;
+
+  };
+
+} //end namespace femus
+
+#endif
@@ -18,7 +18,9 @@
 //----------------------------------------------------------------------------
 #include "Marker.hpp"
 #include "Line.hpp"
+#include "ParticleArrays.hpp"
 #include "NumericVector.hpp"
+#include <algorithm>
 #include <cmath>
 #include "PolynomialBases.hpp"
 #include <boost/math/special_functions/ellint_1.hpp>
@@ -72,22 +74,27 @@ namespace femus
     _time.assign(10, 0);
 
     _size = x.size();
-
-    std::vector < Marker*> particles(_size);
-
     _dim = _mesh->GetDimension();
+    _solType = solType;
+    _MPMSize = 0;
 
     _markerOffset.resize(_nprocs + 1);
-    _markerOffset[_nprocs] = _size;
-
-    _particles.resize(_size);
-    _printList.resize(_size);
 
+    // the element search is done by all the processes together, only the owner keeps the marker
+    ElementSearchGrid searchGrid(_sol, 0.);
     for(unsigned j = 0; j < _size; j++) {
-      particles[j] = new Marker(x[j], mass[j], markerType[j], _sol, solType, true);
+      Marker *marker = new Marker(x[j], mass[j], markerType[j], _sol, solType, true, &searchGrid);
+      _MPMSize = marker->GetMPMSize();
+      if(marker->GetMarkerProc(_sol) == _iproc) {
+        _particles.push_back(marker);
+        _markerId.push_back(j);
+      }
+      else {
+        delete marker;
+      }
     }
-    Reorder(particles);
 
+    UpdateLine();
   }
 
   Line::Line(const std::vector < std::vector < double > > x,
@@ -101,348 +108,31 @@ namespace femus
     _time.assign(10, 0);
 
     _size = x.size();
-
-    std::vector < Marker*> particles(_size);
-
     _dim = _mesh->GetDimension();
+    _solType = solType;
+    _MPMSize = 0;
 
     _markerOffset.resize(_nprocs + 1);
-    _markerOffset[_nprocs] = _size;
-
-    _particles.resize(_size);
-    _printList.resize(_size);
-
-    for(unsigned j = 0; j < _size; j++) {
-      particles[j] = new Marker(x[j], 0., markerType[j], _sol, solType, true);
-    }
-    Reorder(particles);
-  }
-
-  void Line::Reorder(std::vector < Marker*> &particles)
-  {
-
-    //BEGIN TEST ASSIGNATION
-
-//     std::vector <double> xtry(_dim);
-//     std::vector <double> xitry(_dim);
-//
-//
-//     for(unsigned j = 0; j < _size; j++) {
-//
-//       unsigned proc;
-//       unsigned elem;
-//       proc = particles[j]->GetMarkerProc();
-//       elem = particles[j]->GetMarkerElement();
-//
-//       std::cout << "proc = " << proc << " , " << "elem = " << elem <<
-//                 " , " << std::endl;
-//       particles[j]->GetMarkerCoordinates(xtry);
-//       for(unsigned i = 0 ; i < _dim; i++) {
-//         std::cout << "x[" << i << "]=" << xtry[i] << std::endl;
-//       }
-//       particles[j]->GetMarkerLocalCoordinatesLine(xitry);
-//       for(unsigned i = 0 ; i < _dim; i++) {
-//         std::cout << "xi[" << i << "]=" << xitry[i] << std::endl;
-//       }
-//     }
-//
-//
-//     for(unsigned j = 0; j < _size; j++) {
-//       _particles[j] = particles[j];
-//     }
-//
-//     std::cout << " ------------------------------------------------------------------------------------------------ " << std::endl;
-//
-//     for(unsigned j = 0; j < _size; j++) {
-//
-//       unsigned proc;
-//       unsigned elem;
-//       proc = _particles[j]->GetMarkerProc();
-//       elem = _particles[j]->GetMarkerElement();
-//       std::cout << "proc = " << proc << " , " << "elem = " << elem <<
-//                 " , " << std::endl;
-//       _particles[j]->GetMarkerCoordinates(xtry);
-//       for(unsigned i = 0 ; i < _dim; i++) {
-//         std::cout << "x[" << i << "]=" << xtry[i] << std::endl;
-//       }
-//       _particles[j]->GetMarkerLocalCoordinatesLine(xitry);
-//       for(unsigned i = 0 ; i < _dim; i++) {
-//         std::cout << "xi[" << i << "]=" << xitry[i] << std::endl;
-//       }
-//     }
-
-
-    //END TEST ASSIGNATION
-
-
-//     std::cout << "FIRST OF ALL" << std::endl;
-//     for(unsigned i = 0; i < _size; i++) {
-//       unsigned proc;
-//       particles[i]->GetMarkerProcLine(proc);
-//       unsigned elem;
-//       particles[i]->GetMarkerElementLine(elem);
-//       std::cout << "Particle: " << i << " , " << "Processor: " << proc << " , "
-//                 << "Element: " << elem << " " << std::endl;
-//     }
-
-    //BEGIN reorder the markers by proc
-    unsigned counter = 0;
-
-    for(unsigned iproc = 0; iproc < _nprocs; iproc++) {
-      _markerOffset[iproc] = counter;
-
-      //unsigned  offsetCounter = counter;
-      for(unsigned j = 0; j < _size; j++) {
-        unsigned markerProc = particles[j]->GetMarkerProc(_sol);
-
-        if(markerProc == iproc) {
-          _particles[counter] = particles[j];
-          _printList[j] = counter;
-          counter++;
-        }
-      }
-    }
-
-    //END reorder the markers by proc
-
-
-
-
-//     std::cout << "AFTER THE REORDERING BY PROC" << std::endl;
-//     for(unsigned i = 0; i < _size; i++) {
-//       unsigned proc;
-//       _particles[i]->GetMarkerProcLine(proc);
-//       unsigned elem;
-//       _particles[i]->GetMarkerElementLine(elem);
-//       std::cout << "Particle: " << i << " , " << "Processor: " << proc << " , "
-//                 << "Element: " << elem << " " << std::endl;
-//     }
-//
-//     for(unsigned iproc = 0; iproc <= _nprocs; iproc++) {
-//       std::cout << "_markerOffset[" << iproc << "]= " << _markerOffset[iproc] << std::endl;
-//     }
-
-//         for(unsigned i = 0; i < _size; i++) {
-//           std::cout << "_printList[ " << i << "] = " << _printList[i] << std::endl;
-//         }
-//
-//
-//         std::cout << " ------------------------------------------------------------------------------------------------ " << std::endl;
-
-
-    //BEGIN reorder markers also by element
 
+    ElementSearchGrid searchGrid(_sol, 0.);
     for(unsigned j = 0; j < _size; j++) {
-      particles[j] = _particles[j];
-    }
-
-    std::vector < unsigned> printList(_size);
-    printList = _printList;
-
-    unsigned meshElements = _mesh->GetNumberOfElements();
-    std::vector< bool > elementList(meshElements, false);
-
-
-    //flags to see if we already ordered by that element, 0 = not considered yet
-//     for(unsigned iFlag = 0; iFlag < meshElements; iFlag++) {
-//       elementList[iFlag] = 0;
-//     }
-
-    for(unsigned iproc = 0; iproc < _nprocs; iproc++) {
-
-      bool someMarkersOutsideDomain = false;
-      counter = 0;
-
-      for(unsigned jp = _markerOffset[iproc]; jp < _markerOffset[iproc + 1]; jp++) {
-
-        unsigned jel;
-        jel = particles[jp]->GetMarkerElement();
-
-        if(jel != UINT_MAX) {
-
-          if(elementList[jel] == false) {
-
-            elementList[jel] = true;
-
-            _particles[_markerOffset[iproc] + counter] = particles[jp];
-
-            for(unsigned iList = 0; iList < _size; iList++) {
-              if(printList[iList] == jp) {
-                _printList[iList] = _markerOffset[iproc] + counter;
-                break;
-              }
-            }
-
-            counter++;
-
-
-            for(unsigned ip = jp + 1; ip < _markerOffset[iproc + 1]; ip++) {
-              unsigned iel;
-              iel = particles[ip]->GetMarkerElement();
-
-              if(iel == jel) {
-                _particles[_markerOffset[iproc] + counter] = particles[ip];
-
-                for(unsigned iList = 0; iList < _size; iList++) {
-                  if(printList[iList] == ip) {
-                    _printList[iList] = _markerOffset[iproc] + counter;
-                    break;
-                  }
-                }
-
-                counter++;
-              }
-            }
-          }
-        }
-        else {
-          someMarkersOutsideDomain = true;
-        }
+      Marker *marker = new Marker(x[j], 0., markerType[j], _sol, solType, true, &searchGrid);
+      _MPMSize = marker->GetMPMSize();
+      if(marker->GetMarkerProc(_sol) == _iproc) {
+        _particles.push_back(marker);
+        _markerId.push_back(j);
       }
-
-      if(someMarkersOutsideDomain == true) {
-        if(iproc == 0) {
-          for(unsigned i = 0; i < _size; i++) {
-            unsigned iel = particles[i]->GetMarkerElement();
-
-            if(iel == UINT_MAX) {
-
-              _particles[_markerOffset[0] + counter] = particles[i];
-
-              for(unsigned iList = 0; iList < _size; iList++) {
-                if(printList[iList] == i) {
-                  _printList[iList] = _markerOffset[0] + counter;
-                  break;
-                }
-              }
-
-              counter++;
-            }
-          }
-        }
-        else {
-          std::cout << "warning" << std::endl;
-          std::cout << "the marker is outside the domain but not in iproc 0" << std::endl;
-          abort();
-        }
+      else {
+        delete marker;
       }
-
-    }
-
-
-
-
-    //END reorder markers also by element
-
-
-
-//     //BEGIN reorder markers also by element
-//
-//     for(unsigned j = 0; j < _size; j++) {
-//       particles[j] = _particles[j];
-//     }
-//
-//     unsigned* elementList = new unsigned [_sol->GetMesh()->GetNumberOfElements()];
-//
-//     std::cout << "number of elements = " <<  _sol->GetMesh()->GetNumberOfElements() << std::endl;
-//
-//     std::vector < unsigned> printList(_size);
-//
-//     //flags to see if we already ordered by that element, 0 = not considered yet
-//     for(unsigned iFlag = 0; iFlag < _mesh->GetNumberOfElements(); iFlag++) {
-//       elementList[iFlag] = 0;
-//     }
-//
-//     printList = _printList;
-//
-//     for(unsigned iproc = 0; iproc < _nprocs; iproc++) {
-//
-//       counter = 0;
-//
-//       for(unsigned jp = _markerOffset[iproc]; jp < _markerOffset[iproc + 1]; jp++) {
-//
-//         unsigned jel;
-//         jel = particles[jp]->GetMarkerElement();
-//
-// 	std::cout<< " Marker in element jel = " << jel << std::endl;
-//
-//         if(elementList[jel] == 0) {
-//
-//           elementList[jel] = 1;
-//
-//           _particles[_markerOffset[iproc] + counter] = particles[jp];
-//           for(unsigned iList = 0; iList < _size; iList++) {
-//             if(printList[iList] == jp) {
-//               _printList[iList] = _markerOffset[iproc] + counter;
-//               break;
-//             }
-//           }
-//           counter++;
-//
-//
-//           for(unsigned ip = _markerOffset[iproc]; ip < _markerOffset[iproc + 1]; ip++) {
-//             unsigned iel;
-//             iel = particles[ip]->GetMarkerElement();
-//             if(ip != jp && iel == jel) {
-//               //std::cout << " jel =" << jel << " , " << "ip = " << ip << " , " << "jp = " << jp <<  std::endl;
-//               elementList[iel] = 1;
-//               _particles[_markerOffset[iproc] + counter] = particles[ip];
-//               for(unsigned iList = 0; iList < _size; iList++) {
-//                 if(printList[iList] == ip) {
-//                   _printList[iList] = _markerOffset[iproc] + counter;
-//                   break;
-//                 }
-//               }
-//               counter++;
-//             }
-//           }
-//         }
-//       }
-//     }
-//
-//     //END reorder markers also by element
-
-//         for(unsigned i = 0; i < _size; i++) {
-//           std::cout << "_printList[ " << i << "] = " << _printList[i] << std::endl;
-//         }
-
-
-//     std::cout << "AFTER THE REORDERING BY ELEM" << std::endl;
-//     for(unsigned i = 0; i < _size; i++) {
-//       unsigned proc;
-//       _particles[i]->GetMarkerProcLine(proc);
-//       unsigned elem;
-//       _particles[i]->GetMarkerElementLine(elem);
-//       std::cout << "Particle: " << i << " , " << "Processor: " << proc << " , "
-//                 << "Element: " << elem << " " << "Pointer: " << _particles[i] << std::endl;
-//     }
-
-
-    _line.resize(_size + 1);
-
-    for(unsigned j = 0; j < _size; j++) {
-      _particles[_printList[j]]->GetMarkerCoordinates(_line[j]);
     }
 
-    _particles[_printList[0]]->GetMarkerCoordinates(_line[_size]);
-
-    // delete[] elementList;
-    // std::vector < unsigned > ().swap(printList);
-
-
-//     for(unsigned i=0;i<_size;i++){
-//       if(_printList[i] == 3395){
-// 	std::cout << i<< std::endl;
-//       }
-//     }
-//
-//     exit(0);
-  };
+    UpdateLine();
+  }
 
   Line::~Line()
   {
-    for(unsigned j = 0; j < _size; j++) {
-      //std::cout << j << " " << _particles[j] << std::endl<< std::flush;
+    for(unsigned j = 0; j < _particles.size(); j++) {
       delete _particles[j];
     }
   }
@@ -450,264 +140,68 @@ namespace femus
   void Line::UpdateLine()
   {
 
-    std::vector < Marker*> particles(_size);
-    std::vector < unsigned> printList(_size);
-
-    for(unsigned j = 0; j < _size; j++) {
-      particles[j] = _particles[j];
+    //BEGIN reorder the owned markers by element, the markers outside the domain (UINT_MAX) go last
+    unsigned localSize = _particles.size();
+    std::vector < std::pair < unsigned, unsigned > > elemOrder(localSize);
+    for(unsigned i = 0; i < localSize; i++) {
+      elemOrder[i] = std::make_pair(_particles[i]->GetMarkerElement(), i);
     }
+    std::sort(elemOrder.begin(), elemOrder.end());
 
-    printList = _printList;
-
-
-    //BEGIN TEST ASSIGNATION
-
-//     std::vector <double> xtry(_dim);
-//     std::vector <double> xitry(_dim);
-//
-//
-//     for(unsigned j = 0; j < _size; j++) {
-//
-//       unsigned proc;
-//       unsigned elem;
-//       proc = particles[j]->GetMarkerProc();
-//       elem = particles[j]->GetMarkerElement();
-//
-//       std::cout << "proc = " << proc << " , " << "elem = " << elem <<
-//                 " , " << std::endl;
-//       particles[j]->GetMarkerCoordinates(xtry);
-//       for(unsigned i = 0 ; i < _dim; i++) {
-//         std::cout << "x[" << i << "]=" << xtry[i] << std::endl;
-//       }
-//       particles[j]->GetMarkerLocalCoordinatesLine(xitry);
-//       for(unsigned i = 0 ; i < _dim; i++) {
-//         std::cout << "xi[" << i << "]=" << xitry[i] << std::endl;
-//       }
-//     }
-//
-//
-//     for(unsigned j = 0; j < _size; j++) {
-//       _particles[j] = particles[j];
-//     }
-//
-//     std::cout << " ------------------------------------------------------------------------------------------------ " << std::endl;
-//
-//     for(unsigned j = 0; j < _size; j++) {
-//
-//       unsigned proc;
-//       unsigned elem;
-//       proc = _particles[j]->GetMarkerProc();
-//       elem = _particles[j]->GetMarkerElement();
-//       std::cout << "proc = " << proc << " , " << "elem = " << elem <<
-//                 " , " << std::endl;
-//       _particles[j]->GetMarkerCoordinates(xtry);
-//       for(unsigned i = 0 ; i < _dim; i++) {
-//         std::cout << "x[" << i << "]=" << xtry[i] << std::endl;
-//       }
-//       _particles[j]->GetMarkerLocalCoordinatesLine(xitry);
-//       for(unsigned i = 0 ; i < _dim; i++) {
-//         std::cout << "xi[" << i << "]=" << xitry[i] << std::endl;
-//       }
-//     }
-
-
-    //END TEST ASSIGNATION
-
-
-
-
-
-
-
-//     std::cout << "FIRST OF ALL ----------------------- UPDATE LINE" << std::endl;
-//     for(unsigned i = 0; i < _size; i++) {
-//       unsigned proc;
-//       unsigned elem;
-//       std::vector <double> chiappe;
-//       chiappe = _particles[_printList[i]]->GetIprocMarkerCoordinates();
-//       proc = _particles[_printList[i]]->GetMarkerProc();
-//       elem = _particles[_printList[i]]->GetMarkerElement();
-//       std::cout << "Particle: " << i << " , " << "Processor: " << proc << " , "
-//                 << "Element: " << elem << " ";
-//       for(unsigned i = 0; i < _dim; i++) {
-//         std::cout << "x[" << i << "]=" << chiappe[i] << " ";
-//       }
-//       std::cout << std::endl;
-//     }
-
-    //BEGIN reorder the markers by proc
-    unsigned counter = 0;
-
-    for(unsigned iproc = 0; iproc < _nprocs; iproc++) {
-      _markerOffset[iproc] = counter;
-
-      for(unsigned j = 0; j < _size; j++) {
-        unsigned markerProc = particles[j]->GetMarkerProc(_sol);
-
-        if(markerProc == iproc) {
-          _particles[counter] = particles[j];
-
-          for(unsigned iList = 0; iList < _size; iList++) {
-            if(printList[iList] == j) {
-              _printList[iList] = counter;
-              break;
-            }
-          }
-
-          counter++;
-        }
-      }
+    std::vector < Marker*> particles(_particles);
+    std::vector < unsigned > markerId(_markerId);
+    for(unsigned i = 0; i < localSize; i++) {
+      _particles[i] = particles[elemOrder[i].second];
+      _markerId[i] = markerId[elemOrder[i].second];
     }
+    //END reorder the owned markers by element
 
-    //END reorder the markers by proc
+    //BEGIN offsets of the markers of each process
+    std::vector < unsigned > size(_nprocs);
+    MPI_Allgather(&localSize, 1, MPI_UNSIGNED, &size[0], 1, MPI_UNSIGNED, PETSC_COMM_WORLD);
 
-//     for(unsigned iproc = 0; iproc <= _nprocs; iproc++) {
-//       std::cout << "_markerOffset[" << iproc << "]= " << _markerOffset[iproc] << std::endl;
-//     }
-
-//     std::cout << "-----------------------------------------  UPDATE LINE  BY PROCS  -----------------------------------------" << std::endl;
-//     for(unsigned i = 0; i < _size; i++) {
-//       unsigned proc;
-//       unsigned elem;
-//       proc = _particles[i]->GetMarkerProc();
-//       elem = _particles[i]->GetMarkerElement();
-//       std::cout << "Particle: " << i << " , " << "Processor: " << proc << " , "
-//                 << "Element: " << elem << " " << std::endl;
-//     }
-
-
-
-    //BEGIN reorder markers also by element
-
-    for(unsigned j = 0; j < _size; j++) {
-      particles[j] = _particles[j];
+    _markerOffset[0] = 0;
+    for(unsigned jproc = 0; jproc < _nprocs; jproc++) {
+      _markerOffset[jproc + 1] = _markerOffset[jproc] + size[jproc];
     }
 
-    printList = _printList;
-
-    unsigned meshElements = _mesh->GetNumberOfElements();
-    std::vector< bool > elementList(meshElements, false);
-
-
-    //flags to see if we already ordered by that element, 0 = not considered yet
-//     for(unsigned iFlag = 0; iFlag < meshElements; iFlag++) {
-//       elementList[iFlag] = 0;
-//     }
-
-    for(unsigned iproc = 0; iproc < _nprocs; iproc++) {
-
-      bool someMarkersOutsideDomain = false;
-      counter = 0;
-
-      for(unsigned jp = _markerOffset[iproc]; jp < _markerOffset[iproc + 1]; jp++) {
-
-        unsigned jel;
-        jel = particles[jp]->GetMarkerElement();
-
-        if(jel != UINT_MAX) {
-
-          if(elementList[jel] == false) {
-
-            elementList[jel] = true;
-
-            _particles[_markerOffset[iproc] + counter] = particles[jp];
-
-            for(unsigned iList = 0; iList < _size; iList++) {
-              if(printList[iList] == jp) {
-                _printList[iList] = _markerOffset[iproc] + counter;
-                break;
-              }
-            }
-
-            counter++;
-
-
-            for(unsigned ip = jp + 1; ip < _markerOffset[iproc + 1]; ip++) {
-              unsigned iel;
-              iel = particles[ip]->GetMarkerElement();
-
-              if(iel == jel) {
-                _particles[_markerOffset[iproc] + counter] = particles[ip];
-
-                for(unsigned iList = 0; iList < _size; iList++) {
-                  if(printList[iList] == ip) {
-                    _printList[iList] = _markerOffset[iproc] + counter;
-                    break;
-                  }
-                }
-
-                counter++;
-              }
-            }
-          }
-        }
-        else {
-          someMarkersOutsideDomain = true;
-        }
-      }
-
-      if(someMarkersOutsideDomain == true) {
-        if(iproc == 0) {
-          for(unsigned i = 0; i < _size; i++) {
-            unsigned iel = particles[i]->GetMarkerElement();
-
-            if(iel == UINT_MAX) {
-
-              _particles[_markerOffset[0] + counter] = particles[i];
-
-              for(unsigned iList = 0; iList < _size; iList++) {
-                if(printList[iList] == i) {
-                  _printList[iList] = _markerOffset[0] + counter;
-                  break;
-                }
-              }
-
-              counter++;
-            }
-          }
-        }
-        else {
-          std::cout << "warning" << std::endl;
-          std::cout << "the marker is outside the domain but not in iproc 0" << std::endl;
-          abort();
-        }
+    if(_markerOffset[_nprocs] != _size) {
+      std::cout << "Error in Line::UpdateLine(): " << _markerOffset[_nprocs] << " markers on the processes instead of " << _size << std::endl;
+      abort();
+    }
+    //END offsets of the markers of each process
+
+    //BEGIN gather the coordinates of all the markers, the global index comes first in each packet
+    unsigned packSize = 1 + _dim;
+    std::vector < double > localLine(localSize * packSize);
+    for(unsigned i = 0; i < localSize; i++) {
+      std::vector < double > x = _particles[i]->GetIprocMarkerCoordinates();
+      localLine[i * packSize] = _markerId[i];
+      for(unsigned k = 0; k < _dim; k++) {
+        localLine[i * packSize + 1 + k] = x[k];
       }
-
     }
 
-
-
-
-    //END reorder markers also by element
-
-    for(unsigned j = 0; j < _size; j++) {
-
-      _particles[_printList[j]]->GetMarkerCoordinates(_line[j]);
+    std::vector < int > recvSize(_nprocs);
+    std::vector < int > recvOffset(_nprocs);
+    for(unsigned jproc = 0; jproc < _nprocs; jproc++) {
+      recvSize[jproc] = size[jproc] * packSize;
+      recvOffset[jproc] = _markerOffset[jproc] * packSize;
     }
 
-    _particles[_printList[0]]->GetMarkerCoordinates(_line[_size]);
-
-    //delete[] elementList;
-    //std::vector < unsigned > ().swap(printList);
-    //std::vector < unsigned > ().swap(elementList);
-
-
-//     std::cout << "-----------------------------------------  UPDATE LINE  BY ELEMENTS-----------------------------------------" << std::endl;
-//     for(unsigned i = 0; i < _size; i++) {
-//       unsigned proc;
-//       unsigned elem;
-//       //std::vector <double> chiappe;
-//       //chiappe = _particles[_printList[i]]->GetIprocMarkerCoordinates();
-//       proc = _particles[i]->GetMarkerProc(_sol);
-//       elem = _particles[i]->GetMarkerElement();
-//       std::cout << "Particle: " << i << " , " << "Processor: " << proc << " , "
-//                 << "Element: " << elem << " " <<  " "  ;
-// //       for(unsigned j = 0; j < _dim; j++) {
-// //         std::cout << "x[" << j << "]=" << chiappe[j] << " " ;
-// //       }
-//       std::cout << std::endl;
-//     }
+    std::vector < double > line(_size * packSize + 1);
+    MPI_Allgatherv((localSize > 0) ? &localLine[0] : NULL, localSize * packSize, MPI_DOUBLE,
+                   &line[0], &recvSize[0], &recvOffset[0], MPI_DOUBLE, PETSC_COMM_WORLD);
 
+    _line.resize(_size + 1);
+    for(unsigned i = 0; i < _size; i++) {
+      unsigned j = static_cast < unsigned >(line[i * packSize]);
+      _line[j].assign(&line[i * packSize + 1], &line[i * packSize + 1] + _dim);
+    }
+    if(_size > 0) {
+      _line[_size] = _line[0];
+    }
+    //END gather the coordinates of all the markers
 
   }
 
@@ -753,7 +247,7 @@ namespace femus
 
     //BEGIN Numerical integration scheme
 
-    for(unsigned iMarker = _markerOffset[_iproc]; iMarker < _markerOffset[_iproc + 1]; iMarker++) {
+    for(unsigned iMarker = 0; iMarker < _particles.size(); iMarker++) {
       _particles[iMarker]->InitializeMarkerForAdvection(order);
     }
 
@@ -766,16 +260,18 @@ namespace femus
 
     while(integrationIsOverCounter != _size) {
 
-      MyVector <unsigned> integrationIsOverCounterProc(1, 0);
-      integrationIsOverCounterProc.stack();
+      unsigned integrationIsOverCounterProc = 0;
 
       //BEGIN LOCAL ADVECTION INSIDE IPROC
       clock_t startTime = clock();
       unsigned counter = 0;
 
-      for(unsigned iMarker = _markerOffset[_iproc]; iMarker < _markerOffset[_iproc + 1]; iMarker++) {
+      std::vector < unsigned > elemAtStart(_particles.size());
+      for(unsigned iMarker = 0; iMarker < _particles.size(); iMarker++) {
+        elemAtStart[iMarker] = _particles[iMarker]->GetMarkerElement();
+      }
 
-        //std::cout << _printList[iMarker] <<" "<<std::flush;
+      for(unsigned iMarker = 0; iMarker < _particles.size(); iMarker++) {
 
         unsigned currentElem = _particles[iMarker]->GetMarkerElement();
         bool markerOutsideDomain = (currentElem != UINT_MAX) ? false : true;
@@ -898,7 +394,7 @@ namespace femus
         }
 
         if(step == UINT_MAX || markerOutsideDomain) {
-          integrationIsOverCounterProc[_iproc] += 1;
+          integrationIsOverCounterProc += 1;
         }
 
         //if(counter > maxload) break;
@@ -910,13 +406,7 @@ namespace femus
       startTime = clock();
       //END LOCAL ADVECTION INSIDE IPROC
 
-      integrationIsOverCounter = 0;
-
-      for(unsigned jproc = 0; jproc < _nprocs; jproc++) {
-        integrationIsOverCounterProc.broadcast(jproc);
-        integrationIsOverCounter += integrationIsOverCounterProc[jproc];
-        integrationIsOverCounterProc.clearBroadcast();
-      }
+      MPI_Allreduce(&integrationIsOverCounterProc, &integrationIsOverCounter, 1, MPI_UNSIGNED, MPI_SUM, PETSC_COMM_WORLD);
 
 //       MPI_Barrier( PETSC_COMM_WORLD );
 //       _time[1] += static_cast<double>((clock() - startTime)) / CLOCKS_PER_SEC;
@@ -925,95 +415,7 @@ namespace femus
       // std::cout << "DOPO integrationIsOverCounter = " << integrationIsOverCounter << std::endl;
 
       //BEGIN exchange on information
-
-      //std::cout << " ----------------------------------PROCESSES EXCHANGE INFO ---------------------------------- " << std::endl;
-      for(unsigned jproc = 0; jproc < _nprocs; jproc++) {
-        for(unsigned iMarker = _markerOffset[jproc]; iMarker < _markerOffset[jproc + 1]; iMarker++) {
-          unsigned elem =  _particles[iMarker]->GetMarkerElement();
-          MPI_Bcast(& elem, 1, MPI_UNSIGNED, jproc, PETSC_COMM_WORLD);
-          _particles[iMarker]->SetMarkerElement(elem);
-
-          unsigned step =  _particles[iMarker]->GetIprocMarkerStep();
-          MPI_Bcast(& step, 1, MPI_UNSIGNED, jproc, PETSC_COMM_WORLD);
-          _particles[iMarker]->SetIprocMarkerStep(step);
-
-          if(elem != UINT_MAX) {    // if it is outside jproc, ACTUALLY IF WE ARE HERE IT COULD STILL BE IN JPROC but not outside the domain
-            unsigned mproc = _particles[iMarker]->GetMarkerProc(_sol);
-            _particles[iMarker]->SetMarkerProc(mproc);
-
-            if(mproc != jproc) {
-              unsigned prevElem = _particles[iMarker]->GetIprocMarkerPreviousElement();
-              _particles[iMarker]->GetMarkerS(n, order, s);
-              _particles[iMarker]->GetElement(prevElem, jproc, _sol, s);
-              _particles[iMarker]->SetIprocMarkerPreviousElement(prevElem);
-            }
-
-            elem = _particles[iMarker]->GetMarkerElement();
-
-            if(elem != UINT_MAX) {    // if it is not outside the domain
-              unsigned mproc = _particles[iMarker]->GetMarkerProc(_sol);
-
-              if(mproc != jproc) {
-                if(jproc == _iproc) {
-
-                  unsigned step =  _particles[iMarker]->GetIprocMarkerStep();
-                  MPI_Send(& step, 1, MPI_UNSIGNED, mproc, order + 1, PETSC_COMM_WORLD);
-
-                  unsigned istep = step % order;
-
-                  if(istep != 0) {
-                    K = _particles[iMarker]->GetIprocMarkerK();
-
-                    for(int i = 0; i < order; i++) {
-                      MPI_Send(&K[i][0], _dim, MPI_DOUBLE, mproc, i , PETSC_COMM_WORLD);
-                    }
-
-                    x0 = _particles[iMarker]->GetIprocMarkerOldCoordinates();
-                    MPI_Send(&x0[0], _dim, MPI_DOUBLE, mproc, order , PETSC_COMM_WORLD);
-                  }
-
-                  _particles[iMarker]->FreeVariables();
-
-                }
-                else if(mproc == _iproc) {
-
-                  _particles[iMarker]->InitializeVariables(order);
-
-                  unsigned step;
-                  MPI_Recv(& step, 1, MPI_UNSIGNED, jproc, order + 1, PETSC_COMM_WORLD, MPI_STATUS_IGNORE);
-                  _particles[iMarker]->SetIprocMarkerStep(step);
-
-                  unsigned istep = step % order;
-
-                  if(istep != 0) {
-                    for(int i = 0; i < order; i++) {
-                      MPI_Recv(&K[i][0], _dim, MPI_DOUBLE, jproc, i , PETSC_COMM_WORLD, MPI_STATUS_IGNORE);
-                      _particles[iMarker]->SetIprocMarkerK(K);
-                    }
-
-                    MPI_Recv(&x0[0], _dim, MPI_DOUBLE, jproc, order , PETSC_COMM_WORLD, MPI_STATUS_IGNORE);
-                    _particles[iMarker]->SetIprocMarkerOldCoordinates(x0);
-
-                  }
-                }
-              }
-            }
-          }
-
-          if(elem == UINT_MAX && jproc != 0) {    // elem = UINT_MAX, but not yet in jproc = 0
-            if(jproc == _iproc) {
-              x = _particles[iMarker]->GetIprocMarkerCoordinates();
-              MPI_Send(&x[0], _dim, MPI_DOUBLE, 0, 1 , PETSC_COMM_WORLD);
-              _particles[iMarker]->FreeVariables();
-            }
-            else if(_iproc == 0) {
-              _particles[iMarker]->InitializeX();
-              MPI_Recv(&x[0], _dim, MPI_DOUBLE, jproc, 1 , PETSC_COMM_WORLD, MPI_STATUS_IGNORE);
-              _particles[iMarker]->SetIprocMarkerCoordinates(x);
-            }
-          }
-        }
-      }
+      MigrateMarkers(n, order, elemAtStart);
 
       MPI_Barrier(PETSC_COMM_WORLD);
       _time[1] += static_cast<double>((clock() - startTime)) / CLOCKS_PER_SEC;
@@ -1075,19 +477,228 @@ namespace femus
   }
 
 
-  unsigned Line::NumberOfParticlesOutsideTheDomain()
+  void Line::MigrateMarkers(const unsigned& n, const unsigned& order, const std::vector < unsigned >& elemAtStart)
   {
 
+    // a marker that left this process is packed for the process that owns its new element and the element
+    // search continues there; a marker that left the domain goes to the process 0.
+    // order = 0 is the MPM update: the search is done at s = 0
+    double s = 0.;
+    unsigned packSize = 5 + (2 + order) * _dim + _MPMSize + _dim * _dim;
+    std::vector < std::vector < double > > sendBuffer(_nprocs);
+    std::vector < double > recvBuffer;
+
+    for(unsigned iMarker = 0; iMarker < elemAtStart.size(); iMarker++) {
+      unsigned elem = _particles[iMarker]->GetMarkerElement();
+
+      if(elem != elemAtStart[iMarker]) {
+        if(elem == UINT_MAX) {
+          if(_iproc != 0) PackMarker(iMarker, order, sendBuffer[0]);
+        }
+        else {
+          unsigned mproc = _particles[iMarker]->GetMarkerProc(_sol);
+          if(mproc != _iproc) {
+            PackMarker(iMarker, order, sendBuffer[mproc]);
+          }
+        }
+      }
+    }
+
+    std::vector < double > x(_dim);
+    std::vector < double > x0(_dim);
+    std::vector < std::vector < double > > K(order, std::vector < double > (_dim));
+    std::vector < double > MPMQuantities(_MPMSize);
+    std::vector < std::vector < double > > Fp(_dim, std::vector < double > (_dim));
+
+    while(true) {
+
+      unsigned localSendSize = 0;
+      for(unsigned jproc = 0; jproc < _nprocs; jproc++) {
+        localSendSize += sendBuffer[jproc].size();
+      }
+      unsigned sendSize;
+      MPI_Allreduce(&localSendSize, &sendSize, 1, MPI_UNSIGNED, MPI_SUM, PETSC_COMM_WORLD);
+      if(sendSize == 0) break;
+
+      ExchangeMarkerBuffers(sendBuffer, recvBuffer);
+
+      for(unsigned i = 0; i < recvBuffer.size(); i += packSize) {
+        const double *packet = &recvBuffer[i];
+        unsigned markerId = static_cast < unsigned >(packet[0]);
+        MarkerType markerType = static_cast < MarkerType >(static_cast < int >(packet[1]));
+        unsigned elem = static_cast < unsigned >(packet[2]);
+        unsigned prevElem = static_cast < unsigned >(packet[3]);
+        unsigned step = static_cast < unsigned >(packet[4]);
+        packet += 5;
+
+        x.assign(packet, packet + _dim);
+        x0.assign(packet + _dim, packet + 2 * _dim);
+        for(unsigned j = 0; j < order; j++) {
+          K[j].assign(packet + (2 + j) * _dim, packet + (3 + j) * _dim);
+        }
+        packet += (2 + order) * _dim;
+        MPMQuantities.assign(packet, packet + _MPMSize);
+        for(unsigned j = 0; j < _dim; j++) {
+          Fp[j].assign(packet + _MPMSize + j * _dim, packet + _MPMSize + (j + 1) * _dim);
+        }
+
+        Marker *marker = new Marker(markerType, _solType, _dim);
+        marker->InitializeVariables(order);
+        marker->SetIprocMarkerCoordinates(x);
+        marker->SetIprocMarkerOldCoordinates(x0);
+        marker->SetIprocMarkerK(K);
+        marker->SetMPMQuantities(MPMQuantities);
+        marker->SetDeformationGradient(Fp);
+        marker->SetIprocMarkerStep(step);
+        marker->SetMarkerElement(elem);
+        marker->SetIprocMarkerPreviousElement(prevElem);
+
+        _particles.push_back(marker);
+        _markerId.push_back(markerId);
+        unsigned iMarker = _particles.size() - 1;
+
+        if(elem == UINT_MAX) {   // the marker left the domain, the process 0 keeps it
+          continue;
+        }
+
+        if(order > 0) marker->GetMarkerS(n, order, s);
+        marker->GetElementSerial(prevElem, _sol, s);
+        marker->SetIprocMarkerPreviousElement(prevElem);
+
+        elem = marker->GetMarkerElement();
+        if(elem == UINT_MAX) {
+          marker->SetIprocMarkerStep(UINT_MAX);
+          if(_iproc != 0) PackMarker(iMarker, order, sendBuffer[0]);
+        }
+        else {
+          unsigned mproc = marker->GetMarkerProc(_sol);
+          if(mproc != _iproc) {
+            PackMarker(iMarker, order, sendBuffer[mproc]);
+          }
+        }
+      }
+    }
+
+    // remove the markers that left this process
     unsigned counter = 0;
+    for(unsigned iMarker = 0; iMarker < _particles.size(); iMarker++) {
+      if(_particles[iMarker] != NULL) {
+        _particles[counter] = _particles[iMarker];
+        _markerId[counter] = _markerId[iMarker];
+        counter++;
+      }
+    }
+    _particles.resize(counter);
+    _markerId.resize(counter);
+  }
+
+
+  void Line::PackMarker(const unsigned& iMarker, const unsigned& order, std::vector < double >& buffer)
+  {
+
+    // packet: global index, marker type, element, previous element, step, x, x0, K, MPM quantities and Fp
+    Marker *marker = _particles[iMarker];
+    unsigned packSize = 5 + (2 + order) * _dim + _MPMSize + _dim * _dim;
+    unsigned packStart = buffer.size();
+
+    buffer.push_back(_markerId[iMarker]);
+    buffer.push_back(marker->GetMarkerType());
+    buffer.push_back(marker->GetMarkerElement());
+    buffer.push_back(marker->GetIprocMarkerPreviousElement());
+    buffer.push_back(marker->GetIprocMarkerStep());
+
+    std::vector < double > x = marker->GetIprocMarkerCoordinates();
+    x.resize(_dim, 0.);
+    buffer.insert(buffer.end(), x.begin(), x.end());
+
+    std::vector < double > x0 = marker->GetIprocMarkerOldCoordinates();
+    x0.resize(_dim, 0.);
+    buffer.insert(buffer.end(), x0.begin(), x0.end());
+
+    std::vector < std::vector < double > > K = marker->GetIprocMarkerK();
+    K.resize(order);
+    for(unsigned j = 0; j < order; j++) {
+      K[j].resize(_dim, 0.);
+      buffer.insert(buffer.end(), K[j].begin(), K[j].end());
+    }
+
+    std::vector < double > MPMQuantities = marker->GetMPMQuantities();
+    MPMQuantities.resize(_MPMSize, 0.);
+    buffer.insert(buffer.end(), MPMQuantities.begin(), MPMQuantities.end());
+
+    std::vector < std::vector < double > > Fp = marker->GetDeformationGradient();
+    Fp.resize(_dim);
+    for(unsigned j = 0; j < _dim; j++) {
+      Fp[j].resize(_dim, 0.);
+      buffer.insert(buffer.end(), Fp[j].begin(), Fp[j].end());
+    }
+
+    if(buffer.size() != packStart + packSize) {
+      std::cout << "Error in Line::PackMarker(): wrong packet size" << std::endl;
+      abort();
+    }
+
+    delete marker;
+    _particles[iMarker] = NULL;
+  }
+
+
+  void Line::ExchangeMarkerBuffers(std::vector < std::vector < double > >& sendBuffer, std::vector < double >& recvBuffer)
+  {
+
+    // sparse exchange: after the sizes are known only the processes that actually share markers communicate
+    std::vector < int > sendSize(_nprocs), recvSize(_nprocs);
+    for(unsigned jproc = 0; jproc < _nprocs; jproc++) {
+      sendSize[jproc] = sendBuffer[jproc].size();
+    }
+    MPI_Alltoall(&sendSize[0], 1, MPI_INT, &recvSize[0], 1, MPI_INT, PETSC_COMM_WORLD);
+
+    std::vector < int > recvOffset(_nprocs + 1, 0);
+    for(unsigned jproc = 0; jproc < _nprocs; jproc++) {
+      recvOffset[jproc + 1] = recvOffset[jproc] + recvSize[jproc];
+    }
+    recvBuffer.resize(recvOffset[_nprocs]);
+
+    std::vector < MPI_Request > request;
+    request.reserve(2 * _nprocs);
+    for(unsigned jproc = 0; jproc < _nprocs; jproc++) {
+      if(recvSize[jproc] > 0) {
+        request.resize(request.size() + 1);
+        MPI_Irecv(&recvBuffer[recvOffset[jproc]], recvSize[jproc], MPI_DOUBLE, jproc, 1, PETSC_COMM_WORLD, &request.back());
+      }
+    }
+    for(unsigned jproc = 0; jproc < _nprocs; jproc++) {
+      if(sendSize[jproc] > 0) {
+        request.resize(request.size() + 1);
+        MPI_Isend(&sendBuffer[jproc][0], sendSize[jproc], MPI_DOUBLE, jproc, 1, PETSC_COMM_WORLD, &request.back());
+      }
+    }
+    if(!request.empty()) {
+      MPI_Waitall(request.size(), &request[0], MPI_STATUSES_IGNORE);
+    }
+
+    for(unsigned jproc = 0; jproc < _nprocs; jproc++) {
+      std::vector < double > ().swap(sendBuffer[jproc]);
+    }
+  }
+
 
-    for(unsigned iMarker = _markerOffset[0]; iMarker < _markerOffset[1]; iMarker++) {
+  unsigned Line::NumberOfParticlesOutsideTheDomain()
+  {
+
+    unsigned localCounter = 0;
+
+    for(unsigned iMarker = 0; iMarker < _particles.size(); iMarker++) {
       unsigned elem =  _particles[iMarker]->GetMarkerElement();
 
       if(elem == UINT_MAX) {
-        counter++;
+        localCounter++;
       }
     }
 
+    unsigned counter;
+    MPI_Allreduce(&localCounter, &counter, 1, MPI_UNSIGNED, MPI_SUM, PETSC_COMM_WORLD);
+
     return counter;
   }
 
@@ -1110,27 +721,28 @@ namespace femus
     _sol->_Sol[solIndexMat]->zero();
 
 
-    // set all element with at least one marker to 3 and all nodes of the element to 1
-    for(unsigned iMarker = _markerOffset[_iproc]; iMarker < _markerOffset[_iproc + 1]; iMarker++) {
+    // set all element with at least one marker to 3 and all nodes of the element to 1,
+    // the markers are grouped by element (see UpdateLine) so every element is set once
+    unsigned ielOld = UINT_MAX;
+    for(unsigned iMarker = 0; iMarker < _particles.size(); iMarker++) {
 
       unsigned iel = _particles[iMarker]->GetMarkerElement();
-      unsigned ielType =  _mesh->GetElementType(iel);
-      bool elementUpdate = (aX.find(iel) != aX.end()) ? false : true;     //update if iel was never updated
+      if(iel == UINT_MAX) break;
 
-      std::vector <double> xi1 = _particles[iMarker]->GetMarkerLocalCoordinates();
+      bool elementUpdate = (aX.find(iel) != aX.end()) ? false : true;     //update if iel was never updated
 
       _particles[iMarker]->FindLocalCoordinates(2., aX[iel], elementUpdate, _sol, s);
 
-      std::vector <double> xi = _particles[iMarker]->GetMarkerLocalCoordinates();
+      if(iel != ielOld) {
+        for(unsigned j = 0; j < _mesh->GetElementDofNumber(iel, solTypeM); j++) {
+          unsigned jdof = _mesh->GetSolutionDof(j, iel, solTypeM);
+          _sol->_Sol[solIndexM]->set(jdof, 1.);
+        }
 
-      for(unsigned j = 0; j < _mesh->GetElementDofNumber(iel, solTypeM); j++) {
-        unsigned jdof = _mesh->GetSolutionDof(j, iel, solTypeM);
-        _sol->_Sol[solIndexM]->set(jdof, 1.);
+        unsigned idofMat = _mesh->GetSolutionDof(0, iel, solTypeMat);
+        _sol->_Sol[solIndexMat]->set(idofMat, 3.);
+        ielOld = iel;
       }
-
-      unsigned idofMat = _mesh->GetSolutionDof(0, iel, solTypeMat);
-      _sol->_Sol[solIndexMat]->set(idofMat, 3.);
-
     }
     _sol->_Sol[solIndexM]->close();
     _sol->_Sol[solIndexMat]->close();
@@ -1192,14 +804,18 @@ namespace femus
     _sol->_Sol[solIndexMat]->close();
 
 
-    for(unsigned iMarker = _markerOffset[_iproc]; iMarker < _markerOffset[_iproc + 1]; iMarker++) {
+    ielOld = UINT_MAX;
+    for(unsigned iMarker = 0; iMarker < _particles.size(); iMarker++) {
 
       unsigned iel = _particles[iMarker]->GetMarkerElement();
-      unsigned ielType =  _mesh->GetElementType(iel);
-      for(unsigned j = 0; j < _mesh->GetElementDofNumber(iel, solTypeM); j++) {
+      if(iel == UINT_MAX) break;
 
-        unsigned jdof = _mesh->GetSolutionDof(j, iel, solTypeM);
-        _sol->_Sol[solIndexM]->set(jdof, 1.);
+      if(iel != ielOld) {
+        for(unsigned j = 0; j < _mesh->GetElementDofNumber(iel, solTypeM); j++) {
+          unsigned jdof = _mesh->GetSolutionDof(j, iel, solTypeM);
+          _sol->_Sol[solIndexM]->set(jdof, 1.);
+        }
+        ielOld = iel;
       }
     }
     _sol->_Sol[solIndexM]->close();
@@ -1210,104 +826,103 @@ namespace femus
   void Line::UpdateLineMPM()
   {
 
+    std::vector < unsigned > elemAtStart(_particles.size());
 
-    for(unsigned iMarker = _markerOffset[_iproc]; iMarker < _markerOffset[_iproc + 1]; iMarker++) {
+    for(unsigned iMarker = 0; iMarker < _particles.size(); iMarker++) {
       unsigned elem =  _particles[iMarker]->GetMarkerElement();
-      _particles[iMarker]->GetElementSerial(elem, _sol, 0.);
-      _particles[iMarker]->SetIprocMarkerPreviousElement(elem);
+      elemAtStart[iMarker] = elem;
+      if(elem != UINT_MAX) {
+        _particles[iMarker]->GetElementSerial(elem, _sol, 0.);
+        _particles[iMarker]->SetIprocMarkerPreviousElement(elem);
+      }
     }
 
-    for(unsigned jproc = 0; jproc < _nprocs; jproc++) {
-      for(unsigned iMarker = _markerOffset[jproc]; iMarker < _markerOffset[jproc + 1]; iMarker++) {
-
-        unsigned elem =  _particles[iMarker]->GetMarkerElement();
-        MPI_Bcast(& elem, 1, MPI_UNSIGNED, jproc, PETSC_COMM_WORLD);
-        _particles[iMarker]->SetMarkerElement(elem);
-
-        if(elem != UINT_MAX) {
-          unsigned mproc = _particles[iMarker]->GetMarkerProc(_sol); //WARNING you don't know if this is your real process
-          _particles[iMarker]->SetMarkerProc(mproc);
-
-          if(mproc != jproc) {  //this means, if we think the particle moved from jproc (which means element serial shouldn't have found the actual element)
-            unsigned prevElem = _particles[iMarker]->GetIprocMarkerPreviousElement();
-            _particles[iMarker]->GetElement(prevElem, jproc, _sol, 0.);
-            _particles[iMarker]->SetIprocMarkerPreviousElement(prevElem);
-          }
+    //BEGIN find new _elem and _mproc
+    unsigned order = 0;
+    MigrateMarkers(0, order, elemAtStart);
+    //END find new _elem and _mproc
 
-          elem = _particles[iMarker]->GetMarkerElement(); //TODO shouldn't this be inside the if ? If we don't go in the if I think we already know who elem is
+    UpdateLine();
 
-          if(elem != UINT_MAX) {    // if it is not outside the domain
-            unsigned mproc = _particles[iMarker]->GetMarkerProc(_sol);  //actual mproc
+  }
 
-            if(mproc != jproc) {  //there is no need to send/receive if the particle didn't change process (which is when mproc == jproc)
-              if(jproc == _iproc) {
 
-                unsigned order = 0;
-                std::vector <double> MPMQuantities = _particles[iMarker]->GetMPMQuantities();
-                unsigned MPMsize =  _particles[iMarker]->GetMPMSize();
-                MPI_Send(&MPMQuantities[0], MPMsize, MPI_DOUBLE, mproc, order, PETSC_COMM_WORLD);
+  void Line::GetLocalParticles(ParticleArrays& particles)
+  {
 
-                std::vector < std::vector < double > > Fp = _particles[iMarker]->GetDeformationGradient();
-                for(unsigned i = 0; i < _dim; i++) {
-                  MPI_Send(&Fp[i][0], _dim, MPI_DOUBLE, mproc, order + 1, PETSC_COMM_WORLD);
-                }
+    // the markers outside the domain, kept by the process 0, are not copied
+    unsigned size = 0;
+    for(unsigned iMarker = 0; iMarker < _particles.size(); iMarker++) {
+      if(_particles[iMarker]->GetMarkerElement() != UINT_MAX) size++;
+    }
 
-                _particles[iMarker]->FreeVariables();
+    unsigned MPMSize = _MPMSize;
+    particles.Resize(size, _dim, MPMSize);
 
-              }
-              else if(mproc == _iproc) {
+    unsigned i = 0;
+    for(unsigned iMarker = 0; iMarker < _particles.size(); iMarker++) {
+      Marker *marker = _particles[iMarker];
+      if(marker->GetMarkerElement() == UINT_MAX) continue;
 
-                unsigned order = 0;
-                _particles[iMarker]->InitializeVariables(order);
+      particles._marker[i] = iMarker;
+      particles._elem[i] = marker->GetMarkerElement();
 
-                unsigned MPMsize =  _particles[iMarker]->GetMPMSize();
-                std::vector <double> MPMQuantities(MPMsize);
+      std::vector < double > x = marker->GetIprocMarkerCoordinates();
+      std::vector < double > xi = marker->GetMarkerLocalCoordinates();
+      std::vector < double > MPMQuantities = marker->GetMPMQuantities();
+      std::vector < std::vector < double > > Fp = marker->GetDeformationGradient();
 
-                MPI_Recv(&MPMQuantities[0], MPMsize, MPI_DOUBLE, jproc, order, PETSC_COMM_WORLD, MPI_STATUS_IGNORE);
-                _particles[iMarker]->SetMPMQuantities(MPMQuantities);
+      for(unsigned k = 0; k < _dim; k++) {
+        particles._x[i * _dim + k] = x[k];
+        particles._xi[i * _dim + k] = (xi.size() == _dim) ? xi[k] : 0.;
+      }
+      for(unsigned q = 0; q < MPMSize && q < MPMQuantities.size(); q++) {
+        particles._MPMQuantities[i * MPMSize + q] = MPMQuantities[q];
+      }
+      for(unsigned k = 0; k < Fp.size(); k++) {
+        for(unsigned l = 0; l < Fp[k].size(); l++) {
+          particles._Fp[(i * _dim + k) * _dim + l] = Fp[k][l];
+        }
+      }
+      i++;
+    }
 
-                std::vector < std::vector < double > > Fp(_dim);
-                for(unsigned i = 0; i < _dim; i++) {
-                  Fp[i].resize(_dim);
-                }
+    particles.BuildElementBins();
+  }
 
-                for(unsigned i = 0; i < _dim; i++) {
-                  MPI_Recv(&Fp[i][0], _dim, MPI_DOUBLE, jproc, order + 1, PETSC_COMM_WORLD, MPI_STATUS_IGNORE);
-                }
-                _particles[iMarker]->SetDeformationGradient(Fp);
 
-              }
-            }
-          }
-        }
+  void Line::SetLocalParticles(const ParticleArrays& particles)
+  {
 
-        if(elem == UINT_MAX && jproc != 0) {    // elem = UINT_MAX, but not yet in jproc = 0
-          if(jproc == _iproc) {
-            std::vector<double> x(_dim);
-            x = _particles[iMarker]->GetIprocMarkerCoordinates();
-            MPI_Send(&x[0], _dim, MPI_DOUBLE, 0, 1 , PETSC_COMM_WORLD);
-            _particles[iMarker]->FreeVariables();
-          }
-          else if(_iproc == 0) {
-            std::vector<double> x(_dim);
-            _particles[iMarker]->InitializeX();
-            MPI_Recv(&x[0], _dim, MPI_DOUBLE, jproc, 1 , PETSC_COMM_WORLD, MPI_STATUS_IGNORE);
-            _particles[iMarker]->SetIprocMarkerCoordinates(x);
-          }
-        }
+    unsigned MPMSize = particles.GetMPMSize();
+    std::vector < double > x(_dim);
+    std::vector < double > MPMQuantities(MPMSize);
+    std::vector < std::vector < double > > Fp(_dim, std::vector < double > (_dim));
+
+    for(unsigned i = 0; i < particles.GetSize(); i++) {
+      unsigned iMarker = particles.GetMarkerIndex(i);
+      if(iMarker >= _particles.size()) {
+        std::cout << "Error in Line::SetLocalParticles(): the particles do not match the markers of this process" << std::endl;
+        abort();
       }
-    }
 
-    //END find new _elem and _mproc
-
-    UpdateLine();
+      x.assign(particles.GetCoordinates(i), particles.GetCoordinates(i) + _dim);
+      MPMQuantities.assign(particles.GetMPMQuantities(i), particles.GetMPMQuantities(i) + MPMSize);
+      const double *Fpi = particles.GetDeformationGradient(i);
+      for(unsigned k = 0; k < _dim; k++) {
+        Fp[k].assign(Fpi + k * _dim, Fpi + (k + 1) * _dim);
+      }
 
+      _particles[iMarker]->SetIprocMarkerCoordinates(x);
+      _particles[iMarker]->SetMPMQuantities(MPMQuantities);
+      _particles[iMarker]->SetDeformationGradient(Fp);
+    }
   }
 
   void Line::SetParticlesMass(const double& volume, const double& density)
   {
     double particlesMass = density * volume / _size;
-    for(unsigned i = _markerOffset[_iproc]; i < _markerOffset[_iproc  + 1]; i++) {
+    for(unsigned i = 0; i < _particles.size(); i++) {
       _particles[i]->SetMarkerMass(particlesMass);
     }
   }
@@ -1315,7 +930,7 @@ namespace femus
 
   void Line::ScaleParticleMass(double scale(const std::vector <double>& x))
   {
-    for(unsigned i = _markerOffset[_iproc]; i < _markerOffset[_iproc  + 1]; i++) {
+    for(unsigned i = 0; i < _particles.size(); i++) {
       std::vector<double> x(_dim);
       x = _particles[i]->GetIprocMarkerCoordinates();
       double mass = _particles[i]->GetMarkerMass();
@@ -1332,7 +947,7 @@ namespace femus
     std::vector < double > xMinLocal(_dim, 1.0e100);
     std::vector < double > xMaxLocal(_dim, -1.0e100);
     std::vector< double > x;
-    for(unsigned i = _markerOffset[_iproc]; i < _markerOffset[_iproc  + 1]; i++) {
+    for(unsigned i = 0; i < _particles.size(); i++) {
       x = _particles[i]->GetIprocMarkerCoordinates();
       for(unsigned k = 0; k < _dim; k++) {
 	xMinLocal[k] = (x[k] < xMinLocal[k]) ? x[k] : xMinLocal[k];
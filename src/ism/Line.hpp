@@ -32,6 +32,8 @@
 namespace femus
 {
 
+  class ParticleArrays;
+
   class Line : public ParallelObject
   {
     public:
@@ -65,12 +67,19 @@ namespace femus
         return _markerOffset;
       }
 
+      /** The markers owned by this process, grouped by element; the process 0 also holds the markers outside the domain, last */
       std::vector <Marker*> GetParticles() {
         return _particles;
       }
 
+      /** Global index of the owned markers, their position in the coordinates given to the constructor */
+      std::vector <unsigned> GetMarkerIds() {
+        return _markerId;
+      }
+
       void AdvectionParallel(const unsigned& n, const double& T, const unsigned& order, ForceFunction Force = NULL);
 
+      /** Groups the owned markers by element and gathers in _line the coordinates of all the markers, by global index */
       void UpdateLine();
 
       unsigned NumberOfParticlesOutsideTheDomain();
@@ -79,6 +88,13 @@ namespace femus
 
       void UpdateLineMPM();
 
+      /** Copies the markers owned by this process, inside the domain, into structure-of-arrays buffers grouped by element;
+       * the copy is valid until the markers migrate, SetLocalParticles writes the updated quantities back */
+      void GetLocalParticles(ParticleArrays& particles);
+
+      /** Writes back to the markers the coordinates, the MPM quantities and the deformation gradient of particles */
+      void SetLocalParticles(const ParticleArrays& particles);
+
       void SetParticlesMass(const double& volume, const double& density);
 
       void ScaleParticleMass(double scale(const std::vector <double>& x));
@@ -87,13 +103,21 @@ namespace femus
 
     private:
       std::vector < std::vector < double > > _line;
-      std::vector < Marker*> _particles;
-      std::vector < unsigned > _markerOffset;
-      std::vector < unsigned > _printList;
+      std::vector < Marker*> _particles; // the markers owned by this process
+      std::vector < unsigned > _markerId; // global index of the owned markers, used for _line
+      std::vector < unsigned > _markerOffset; // the markers of the process iproc are _markerOffset[iproc] <= i < _markerOffset[iproc + 1] in the process order
       unsigned _size;
       unsigned _dim;
-      
-      void Reorder(std::vector < Marker*> &particles);
+      unsigned _solType;
+      unsigned _MPMSize;
+
+      /** Moves to their new owner the markers that left this process during the local advection sweep,
+       * in rounds of packed exchanges, with all their data: the sender deletes the marker and the receiver creates it;
+       * order = 0 is the MPM update, the element search is done at s = 0 */
+      void MigrateMarkers(const unsigned &n, const unsigned &order, const std::vector < unsigned > &elemAtStart);
+      /** Packs the owned marker iMarker for its new owner and deletes it, _particles[iMarker] is set to NULL */
+      void PackMarker(const unsigned &iMarker, const unsigned &order, std::vector < double > &buffer);
+      void ExchangeMarkerBuffers(std::vector < std::vector < double > > &sendBuffer, std::vector < double > &recvBuffer);
 
       static const double _a[4][4][4];
       static const double _b[4][4];
@@ -174,7 +174,8 @@ namespace femus
     {0.}
   };
 
-  void Marker::GetElement(const bool &useInitialSearch, const unsigned &initialElem, Solution* sol, const double &s)
+  void Marker::GetElement(const bool &useInitialSearch, const unsigned &initialElem, Solution* sol, const double &s,
+                          const ElementSearchGrid *searchGrid)
   {
 
     std::vector < unsigned > processorMarkerFlag(_nprocs, 3);
@@ -187,29 +188,34 @@ namespace femus
     if (useInitialSearch || _iproc != ielProc) {
 
       //BEGIN SMART search
-      // look to the closest element among a restricted list
+      // look to the closest element among a restricted list, or ask the search grid if it was built at this time
 
       iel = UINT_MAX;
 
       double modulus = 1.e10;
 
-      for (int jel = sol->GetMesh()->_elementOffset[_iproc]; jel < sol->GetMesh()->_elementOffset[_iproc + 1]; jel += 25) {
+      if (searchGrid != NULL && searchGrid->GetTime() == s) {
+        iel = searchGrid->GetStartElement(_x);
+      }
+      else {
+        for (int jel = sol->GetMesh()->_elementOffset[_iproc]; jel < sol->GetMesh()->_elementOffset[_iproc + 1]; jel += 25) {
 
-        unsigned interiorNode = sol->GetMesh()->GetElementDofNumber(jel, 2) - 1;
-        unsigned jDof  = sol->GetMesh()->GetSolutionDof(interiorNode, jel, 2);    // global to global mapping between coordinates node and coordinate dof
+          unsigned interiorNode = sol->GetMesh()->GetElementDofNumber(jel, 2) - 1;
+          unsigned jDof  = sol->GetMesh()->GetSolutionDof(interiorNode, jel, 2);    // global to global mapping between coordinates node and coordinate dof
 
-        double distance2 = 0;
+          double distance2 = 0;
 
-        for (unsigned k = 0; k < _dim; k++) {
-          double dk = GetCoordinates(sol, k, jDof, s) - _x[k];   // global extraction and local storage for the element coordinates
-          distance2 += dk * dk;
-        }
+          for (unsigned k = 0; k < _dim; k++) {
+            double dk = GetCoordinates(sol, k, jDof, s) - _x[k];   // global extraction and local storage for the element coordinates
+            distance2 += dk * dk;
+          }
 
-        double modulusKel = sqrt(distance2);
+          double modulusKel = sqrt(distance2);
 
-        if (modulusKel < modulus) {
-          iel = jel;
-          modulus = modulusKel;
+          if (modulusKel < modulus) {
+            iel = jel;
+            modulus = modulusKel;
+          }
         }
       }
 
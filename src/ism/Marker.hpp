@@ -25,12 +25,14 @@
 #include "vector"
 #include "map"
 #include "MyVector.hpp"
+#include "ElementSearchGrid.hpp"
 
 namespace femus {
 
   class Marker : public ParallelObject {
     public:
-      Marker(std::vector < double > x, const double &mass, const MarkerType &markerType, Solution *sol, const unsigned & solType, const bool &debug = false) {
+      Marker(std::vector < double > x, const double &mass, const MarkerType &markerType, Solution *sol, const unsigned & solType, const bool &debug = false,
+             const ElementSearchGrid *searchGrid = NULL) {
         double s1 = 0.;
         _x = x;
         _markerType = markerType;
@@ -39,7 +41,7 @@ namespace femus {
         _step = 0;
 
         _MPMSize = 3 * _dim + 1; //removed density
-        GetElement(1, UINT_MAX, sol, s1);
+        GetElement(1, UINT_MAX, sol, s1, searchGrid);
 
         if(_iproc == _mproc) {
           std::vector < std::vector < std::vector < std::vector < double > > > >aX;
@@ -75,7 +77,20 @@ namespace femus {
         }
       };
 
-      double GetCoordinates(Solution *sol, const unsigned &k, const unsigned &i , const double &s) {
+      /** Marker that migrates to this process, without element search: the state is set by Line::MigrateMarkers */
+      Marker(const MarkerType &markerType, const unsigned &solType, const unsigned &dim) {
+        _markerType = markerType;
+        _solType = solType;
+        _dim = dim;
+        _step = 0;
+        _elem = UINT_MAX;
+        _previousElem = UINT_MAX;
+        _mproc = _iproc;
+
+        _MPMSize = 3 * _dim + 1;
+      };
+
+      static double GetCoordinates(Solution *sol, const unsigned &k, const unsigned &i , const double &s) {
         if(!sol->GetIfFSI()) {
           return (*sol->GetMesh()->_topology->_Sol[k])(i);
         }
@@ -321,6 +336,10 @@ namespace femus {
         _x.resize(_dim);
       }
 
+      void FreeX() {
+        std::vector < double > ().swap(_x);
+      }
+
       void FreeVariables() {
         std::vector < double > ().swap(_xi);
         std::vector < double > ().swap(_x0);
@@ -329,7 +348,8 @@ namespace femus {
         std::vector <  std::vector < double > > ().swap(_Fp);
       }
 
-      void GetElement(const bool &useInitialSearch, const unsigned &initialElem, Solution *sol, const double &s);
+      void GetElement(const bool &useInitialSearch, const unsigned &initialElem, Solution *sol, const double &s,
+                      const ElementSearchGrid *searchGrid = NULL);
       void GetElementSerial(unsigned &initialElem, Solution *sol, const double &s);
       void GetElement(unsigned &previousElem, const unsigned &previousMproc, Solution *sol, const double &s);
 
@@ -0,0 +1,77 @@
+/*=========================================================================
+
+ Program: FEMuS
+ Module: ParticleArrays
+
+ Copyright (c) FEMuS
+ All rights reserved.
+
+ This software is distributed WITHOUT ANY WARRANTY; without even
+ the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ PURPOSE.  See the above copyright notice for more information.
+
+=========================================================================*/
+
+//----------------------------------------------------------------------------
+// includes :
+//----------------------------------------------------------------------------
+#include "ParticleArrays.hpp"
+
+#include <algorithm>
+#include <cstdlib>
+#include <iostream>
+
+namespace femus {
+
+  void ParticleArrays::Resize(const unsigned &size, const unsigned &dim, const unsigned &MPMSize) {
+
+    _dim = dim;
+    _MPMSize = MPMSize;
+
+    _marker.resize(size);
+    _elem.resize(size);
+    _x.resize(size * dim);
+    _xi.resize(size * dim);
+    _MPMQuantities.resize(size * MPMSize);
+    _Fp.resize(size * dim * dim);
+
+    _binElement.clear();
+    _binOffset.assign(1, 0);
+  }
+
+
+  void ParticleArrays::BuildElementBins() {
+
+    unsigned size = _elem.size();
+
+    _binElement.clear();
+    _binOffset.assign(1, 0);
+
+    for(unsigned i = 0; i < size; i++) {
+      if(i == 0 || _elem[i] != _elem[i - 1]) {
+        if(i > 0) {
+          _binOffset.push_back(i);
+        }
+        _binElement.push_back(_elem[i]);
+      }
+    }
+    if(size > 0) {
+      _binOffset.push_back(size);
+    }
+
+    // a bin split in two would be scattered twice by the element loops
+    std::vector < unsigned > binElement(_binElement);
+    std::sort(binElement.begin(), binElement.end());
+    if(std::adjacent_find(binElement.begin(), binElement.end()) != binElement.end()) {
+      std::cout << "Error in ParticleArrays::BuildElementBins(): the particles are not grouped by element" << std::endl;
+      abort();
+    }
+  }
+
+
+  std::size_t ParticleArrays::GetMemoryUsage() const {
+    return (_marker.capacity() + _elem.capacity() + _binElement.capacity() + _binOffset.capacity()) * sizeof(unsigned)
+           + (_x.capacity() + _xi.capacity() + _MPMQuantities.capacity() + _Fp.capacity()) * sizeof(double);
+  }
+
+} //end namespace femus
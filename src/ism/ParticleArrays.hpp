@@ -0,0 +1,158 @@
+/*=========================================================================
+
+ Program: FEMuS
+ Module: ParticleArrays
+
+ Copyright (c) FEMuS
+ All rights reserved.
+
+ This software is distributed WITHOUT ANY WARRANTY; without even
+ the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ PURPOSE.  See the above copyright notice for more information.
+
+=========================================================================*/
+
+#ifndef __femus_ism_ParticleArrays_hpp__
+#define __femus_ism_ParticleArrays_hpp__
+
+//----------------------------------------------------------------------------
+// includes :
+//----------------------------------------------------------------------------
+#include <cstddef>
+#include <vector>
+
+namespace femus {
+
+  /**
+   * Structure-of-arrays copy of the markers owned by one process, filled by Line::GetLocalParticles and written back
+   * by Line::SetLocalParticles. It is a packed working copy for the MPM particle loops: the particle data are stored
+   * by the Marker objects of Line, each process holds only the markers it owns and they migrate with Line::UpdateLineMPM.
+   * The particles are grouped by host element, in the order of Line::UpdateLine: the particles of the element bin ib are
+   * GetBinBegin(ib) <= i < GetBinEnd(ib), so the loops over the particles of an element read contiguous memory.
+   * Vector and tensor quantities are stored particle by particle: x[i * dim + k], Fp[(i * dim + k) * dim + l],
+   * MPMQuantities[i * MPMSize + q] with the layout of Marker (displacement, velocity, acceleration, mass).
+   **/
+  class ParticleArrays {
+
+    public:
+
+      ParticleArrays() :
+        _dim(0),
+        _MPMSize(0) {
+      }
+
+      /** Sets the number of particles and clears the element bins */
+      void Resize(const unsigned &size, const unsigned &dim, const unsigned &MPMSize);
+
+      /** Builds the element bins, the particles must already be grouped by element */
+      void BuildElementBins();
+
+      unsigned GetSize() const {
+        return _elem.size();
+      }
+
+      unsigned GetDimension() const {
+        return _dim;
+      }
+
+      unsigned GetMPMSize() const {
+        return _MPMSize;
+      }
+
+      unsigned GetNumberOfBins() const {
+        return _binElement.size();
+      }
+
+      unsigned GetBinElement(const unsigned &ib) const {
+        return _binElement[ib];
+      }
+
+      unsigned GetBinBegin(const unsigned &ib) const {
+        return _binOffset[ib];
+      }
+
+      unsigned GetBinEnd(const unsigned &ib) const {
+        return _binOffset[ib + 1];
+      }
+
+      /** Index of the particle among the markers of this process in the Line it was copied from */
+      unsigned GetMarkerIndex(const unsigned &i) const {
+        return _marker[i];
+      }
+
+      unsigned GetElement(const unsigned &i) const {
+        return _elem[i];
+      }
+
+      double GetMass(const unsigned &i) const {
+        return _MPMQuantities[i * _MPMSize + 3 * _dim];
+      }
+
+      double *GetCoordinates(const unsigned &i) {
+        return &_x[i * _dim];
+      }
+
+      const double *GetCoordinates(const unsigned &i) const {
+        return &_x[i * _dim];
+      }
+
+      double *GetLocalCoordinates(const unsigned &i) {
+        return &_xi[i * _dim];
+      }
+
+      const double *GetLocalCoordinates(const unsigned &i) const {
+        return &_xi[i * _dim];
+      }
+
+      double *GetMPMQuantities(const unsigned &i) {
+        return &_MPMQuantities[i * _MPMSize];
+      }
+
+      const double *GetMPMQuantities(const unsigned &i) const {
+        return &_MPMQuantities[i * _MPMSize];
+      }
+
+      double *GetDisplacement(const unsigned &i) {
+        return &_MPMQuantities[i * _MPMSize];
+      }
+
+      double *GetVelocity(const unsigned &i) {
+        return &_MPMQuantities[i * _MPMSize + _dim];
+      }
+
+      double *GetAcceleration(const unsigned &i) {
+        return &_MPMQuantities[i * _MPMSize + 2 * _dim];
+      }
+
+      double *GetDeformationGradient(const unsigned &i) {
+        return &_Fp[i * _dim * _dim];
+      }
+
+      const double *GetDeformationGradient(const unsigned &i) const {
+        return &_Fp[i * _dim * _dim];
+      }
+
+      std::size_t GetMemoryUsage() const;
+
+    private:
+
+      friend class Line;
+
+      unsigned _dim;
+      unsigned _MPMSize;
+
+      std::vector < unsigned > _marker;
+      std::vector < unsigned > _elem;
+      std::vector < double > _x;
+      std::vector < double > _xi;
+      std::vector < double > _MPMQuantities;
+      std::vector < double > _Fp;
+
+      std::vector < unsigned > _binElement;
+      std::vector < unsigned > _binOffset;
+
+  };
+
+} //end namespace femus
+
+#endif
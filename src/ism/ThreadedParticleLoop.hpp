@@ -0,0 +1,87 @@
+/*=========================================================================
+
+ Program: FEMuS
+ Module: ThreadedParticleLoop
+
+ Copyright (c) FEMuS
+ All rights reserved.
+
+ This software is distributed WITHOUT ANY WARRANTY; without even
+ the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ PURPOSE.  See the above copyright notice for more information.
+
+=========================================================================*/
+
+#ifndef __femus_ism_ThreadedParticleLoop_hpp__
+#define __femus_ism_ThreadedParticleLoop_hpp__
+
+//----------------------------------------------------------------------------
+// includes :
+//----------------------------------------------------------------------------
+#include "FemusConfig.hpp"
+#include "FemusInit.hpp"
+#include "ParticleArrays.hpp"
+#include "ThreadedElementLoop.hpp"
+#include "adept.h"
+
+#ifdef HAVE_OPENMP
+#include <omp.h>
+#endif
+
+namespace femus {
+
+  /**
+   * Calls binFunction(ib, ithread) for all the element bins of particles, 0 <= ithread < GetNumberOfAssemblyThreads().
+   * Every bin holds all the particles of one element of msh, so the particle data of different bins never overlap and
+   * the kernel can update them freely. Bins of neighboring elements share grid dofs: the kernel accumulates the
+   * element contributions in per-thread local storage and then adds them with add_vector_blocked/add_matrix_blocked,
+   * that share one critical section with all the other insertions into PETSc vectors and matrices. As in ThreadedElementLoop, automatic differentiation must use
+   * FemusInit::GetAdeptStack(ithread), that is active while the kernel runs.
+   * The grid data are prepared before the threads start by PrepareThreadedLoop: all the vectors the kernel reads,
+   * besides the coordinates of msh, must be listed in inputVectors, and the kernel has to read the grid only through
+   * the const accessors of the prebuilt tables (Mesh::GetElementSolutionLocalDofs, LinearEquation::GetSystemDofs,
+   * NumericVector::get_local). The kernel must not write into the input vectors.
+   **/
+  template < class BinFunction >
+  void ThreadedParticleLoop(const Mesh* msh, const std::vector < NumericVector* > &inputVectors,
+                            const ParticleArrays& particles, BinFunction& binFunction) {
+
+    const int binNumber = particles.GetNumberOfBins();
+
+    PrepareThreadedLoop(msh, inputVectors);
+
+#ifdef HAVE_OPENMP
+
+    #pragma omp parallel
+    {
+      const unsigned ithread = omp_get_thread_num();
+
+      if(ithread != 0) {
+        FemusInit::GetAdeptStack(ithread).activate();
+      }
+
+      #pragma omp for schedule(dynamic, 4)
+      for(int ib = 0; ib < binNumber; ib++) {
+        binFunction(ib, ithread);
+      }
+
+      if(ithread != 0) {
+        FemusInit::GetAdeptStack(ithread).deactivate();
+      }
+    }
+
+#else
+
+    for(int ib = 0; ib < binNumber; ib++) {
+      binFunction(ib, 0u);
+    }
+
+#endif
+
+  }
+
+} //end namespace femus
+
+
+
+#endif
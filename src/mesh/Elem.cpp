@@ -209,6 +209,15 @@ namespace femus
   {
   }
 
+  std::size_t elem::GetMemoryUsage() const
+  {
+    return _elementLevel.GetMemoryUsage() + _elementType.GetMemoryUsage() + _elementGroup.GetMemoryUsage() +
+           _elementMaterial.GetMemoryUsage() + _elementDof.GetMemoryUsage() + _elementNearFace.GetMemoryUsage() +
+           _childElem.GetMemoryUsage() + _childElemDof.GetMemoryUsage() + _elementNearVertex.GetMemoryUsage() +
+           _elementNearElement.GetMemoryUsage() +
+           (_elementOffset.capacity() + _materialElementCounter.capacity()) * sizeof(unsigned);
+  }
+
   void elem::DeleteElementNearVertex()
   {
     _elementNearVertex.clear();
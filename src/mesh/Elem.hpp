@@ -237,6 +237,9 @@ namespace femus {
       std::vector<unsigned> GetMaterialElementCounter(){
         return _materialElementCounter;
       }
+
+      /** Bytes owned by the element structures on this process */
+      std::size_t GetMemoryUsage() const;
       
       
     private:
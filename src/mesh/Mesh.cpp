@@ -19,6 +19,7 @@
 #include "Mesh.hpp"
 #include "MeshGeneration.hpp"
 #include "MeshMetisPartitioning.hpp"
+#include "MeshParMetisPartitioning.hpp"
 #include "GambitIO.hpp"
 #include "MED_IO.hpp"
 #include "NumericVector.hpp"
@@ -46,6 +47,7 @@ namespace femus
   unsigned Mesh::_dimension = 2;
   unsigned Mesh::_ref_index = 4; // 8*DIM[2]+4*DIM[1]+2*DIM[0];
   unsigned Mesh::_face_index = 2; // 4*DIM[2]+2*DIM[1]+1*DIM[0];
+  unsigned Mesh::_meshCounter = 0;
 
 //------------------------------------------------------------------------------------------------------
   Mesh::Mesh()
@@ -53,6 +55,10 @@ namespace femus
 
     _coarseMsh = NULL;
 
+    // all the processes build the meshes in the same order, then the id is the same on all of them
+    _meshId = _meshCounter;
+    _meshCounter++;
+
     for(int i = 0; i < 5; i++) {
       _ProjCoarseToFine[i] = NULL;
     }
@@ -159,8 +165,8 @@ namespace femus
     std::vector < int > partition;
     partition.reserve(GetNumberOfNodes());
     partition.resize(GetNumberOfElements());
-    MeshMetisPartitioning meshMetisPartitioning(*this);
-    meshMetisPartitioning.DoPartition(partition, false);
+    MeshParMetisPartitioning meshParMetisPartitioning(*this);
+    meshParMetisPartitioning.DoPartition(partition, false);
     FillISvector(partition);
     partition.resize(0);
 
@@ -198,6 +204,9 @@ namespace femus
     el->ScatterElementDof();
     el->ScatterElementNearFace();
 
+    BuildElementSolutionDofTables();
+    BuildElementColoring();
+
     _amrRestriction.resize(3);
 
   };
@@ -236,8 +245,8 @@ namespace femus
     std::vector < int > partition;
     partition.reserve(GetNumberOfNodes());
     partition.resize(GetNumberOfElements());
-    MeshMetisPartitioning meshMetisPartitioning(*this);
-    meshMetisPartitioning.DoPartition(partition, false);
+    MeshParMetisPartitioning meshParMetisPartitioning(*this);
+    meshParMetisPartitioning.DoPartition(partition, false);
     FillISvector(partition);
     partition.resize(0);
 
@@ -273,6 +282,9 @@ namespace femus
     el->ScatterElementDof();
     el->ScatterElementNearFace();
 
+    BuildElementSolutionDofTables();
+    BuildElementColoring();
+
     _amrRestriction.resize(3);
 
   }
@@ -366,6 +378,9 @@ namespace femus
   void Mesh::FillISvector(vector < int >& partition)
   {
 
+    // the element and node numbering is about to change
+    ClearElementSolutionDofTables();
+
     //BEGIN Initialization for k = 0,1,2,3,4
 
     std::vector < unsigned > mapping;
@@ -660,6 +675,11 @@ namespace femus
   unsigned Mesh::GetSolutionDof(const unsigned& i, const unsigned& iel, const short unsigned& solType) const
   {
 
+    if(_elementSolutionDofOffset[solType].size() != 0 &&
+        iel >= _elementOffset[_iproc] && iel < _elementOffset[_iproc + 1]) { // cached owned element
+      return _elementSolutionDof[solType][ _elementSolutionDofOffset[solType][iel - _elementOffset[_iproc]] + i ];
+    }
+
     unsigned dof;
 
     switch(solType) {
@@ -712,6 +732,191 @@ namespace femus
     return dof;
   }
 
+// *******************************************************
+
+  void Mesh::BuildElementSolutionDofTable(const short unsigned& solType)
+  {
+
+    unsigned elementStart = _elementOffset[_iproc];
+    unsigned elementEnd = _elementOffset[_iproc + 1];
+
+    std::vector < unsigned > offset(elementEnd - elementStart + 1);
+    offset[0] = 0;
+
+    for(unsigned iel = elementStart; iel < elementEnd; iel++) {
+      offset[iel - elementStart + 1] = offset[iel - elementStart] + GetElementDofNumber(iel, solType);
+    }
+
+    std::vector < unsigned > dof(offset[elementEnd - elementStart]);
+
+    for(unsigned iel = elementStart; iel < elementEnd; iel++) {
+      unsigned *ielDof = &dof[ offset[iel - elementStart] ];
+      unsigned nDofs = offset[iel - elementStart + 1] - offset[iel - elementStart];
+
+      for(unsigned i = 0; i < nDofs; i++) {
+        ielDof[i] = GetSolutionDof(i, iel, solType);
+      }
+    }
+
+    // local array indices: owned dofs first, then the ghost dofs in the order given to the ghosted vectors
+    unsigned ownedStart = _dofOffset[solType][_iproc];
+    unsigned ownedEnd = _dofOffset[solType][_iproc + 1];
+
+    std::vector < std::pair < unsigned, int > > ghostLocalIndex;
+    if(solType < 3 && _ghostDofs[solType].size() > _iproc) {
+      const std::vector < int > &ghostDofs = _ghostDofs[solType][_iproc];
+      ghostLocalIndex.resize(ghostDofs.size());
+      for(unsigned i = 0; i < ghostDofs.size(); i++) {
+        ghostLocalIndex[i] = std::make_pair(static_cast < unsigned >(ghostDofs[i]), static_cast < int >(ownedEnd - ownedStart + i));
+      }
+      std::sort(ghostLocalIndex.begin(), ghostLocalIndex.end());
+    }
+
+    std::vector < int > localDof(dof.size());
+
+    for(unsigned i = 0; i < dof.size(); i++) {
+      if(dof[i] >= ownedStart && dof[i] < ownedEnd) {
+        localDof[i] = dof[i] - ownedStart;
+      }
+      else {
+        std::vector < std::pair < unsigned, int > >::const_iterator it =
+          std::lower_bound(ghostLocalIndex.begin(), ghostLocalIndex.end(), std::make_pair(dof[i], static_cast < int >(0)));
+        if(it == ghostLocalIndex.end() || it->first != dof[i]) {
+          std::cout << "Error in Mesh::BuildElementSolutionDofTable(): dof " << dof[i] << " of type " << solType
+                    << " is neither owned nor ghost on process " << _iproc << std::endl;
+          abort();
+        }
+        localDof[i] = it->second;
+      }
+    }
+
+    _elementSolutionDof[solType].swap(dof);
+    _elementSolutionLocalDof[solType].swap(localDof);
+    _elementSolutionDofOffset[solType].swap(offset);
+  }
+
+// *******************************************************
+
+  void Mesh::BuildElementSolutionDofTables()
+  {
+    for(unsigned solType = 0; solType < 5; solType++) {
+      BuildElementSolutionDofTable(solType);
+    }
+  }
+
+// *******************************************************
+
+  void Mesh::ClearElementSolutionDofTables()
+  {
+    for(unsigned k = 0; k < 5; k++) {
+      std::vector < unsigned > ().swap(_elementSolutionDofOffset[k]);
+      std::vector < unsigned > ().swap(_elementSolutionDof[k]);
+      std::vector < int > ().swap(_elementSolutionLocalDof[k]);
+    }
+
+    std::vector < unsigned > ().swap(_elementColorOffset);
+    std::vector < unsigned > ().swap(_coloredElements);
+  }
+
+  std::size_t Mesh::GetMemoryUsage() const
+  {
+    // a node of a std::map holds the value and, roughly, four pointers
+    const std::size_t mapNodeOverhead = 4 * sizeof(void*);
+
+    std::size_t bytes = (_topology) ? _topology->GetMemoryUsage() : 0;
+    bytes += (el) ? el->GetMemoryUsage() : 0;
+
+    bytes += (_elementOffset.capacity() + _elementColorOffset.capacity() + _coloredElements.capacity()) * sizeof(unsigned);
+    for(unsigned k = 0; k < 5; k++) {
+      bytes += (_ownSize[k].capacity() + _dofOffset[k].capacity() +
+                _elementSolutionDofOffset[k].capacity() + _elementSolutionDof[k].capacity()) * sizeof(unsigned);
+      bytes += _elementSolutionLocalDof[k].capacity() * sizeof(int);
+      for(unsigned jproc = 0; jproc < _ghostDofs[k].size(); jproc++) {
+        bytes += _ghostDofs[k][jproc].capacity() * sizeof(int);
+      }
+    }
+    for(unsigned k = 0; k < 2; k++) {
+      bytes += _originalOwnSize[k].capacity() * sizeof(unsigned);
+      bytes += _ownedGhostMap[k].size() * (sizeof(std::pair < const unsigned, unsigned >) + mapNodeOverhead);
+    }
+    for(unsigned i = 0; i < _coords.size(); i++) {
+      bytes += _coords[i].capacity() * sizeof(double);
+    }
+    for(unsigned i = 0; i < _amrRestriction.size(); i++) {
+      for(std::map < unsigned, std::map < unsigned, double > >::const_iterator it = _amrRestriction[i].begin(); it != _amrRestriction[i].end(); it++) {
+        bytes += sizeof(*it) + mapNodeOverhead + it->second.size() * (sizeof(std::pair < const unsigned, double >) + mapNodeOverhead);
+      }
+    }
+    for(unsigned i = 0; i < _amrSolidMark.size(); i++) {
+      bytes += _amrSolidMark[i].size() * (sizeof(std::pair < const unsigned, bool >) + mapNodeOverhead);
+    }
+
+    for(unsigned itype = 0; itype < 3; itype++) {
+      for(unsigned jtype = 0; jtype < 3; jtype++) {
+        if(_ProjQitoQj[itype][jtype]) bytes += _ProjQitoQj[itype][jtype]->GetMemoryUsage();
+      }
+    }
+    for(unsigned solType = 0; solType < 5; solType++) {
+      if(_ProjCoarseToFine[solType]) bytes += _ProjCoarseToFine[solType]->GetMemoryUsage();
+    }
+
+    return bytes;
+  }
+
+// *******************************************************
+
+  void Mesh::BuildElementColoring()
+  {
+
+    unsigned elementStart = _elementOffset[_iproc];
+    unsigned elementEnd = _elementOffset[_iproc + 1];
+    unsigned nOwnedElements = elementEnd - elementStart;
+
+    // greedy coloring: the first color not used by the owned elements sharing a vertex with iel
+    std::vector < unsigned > color(nOwnedElements, UINT_MAX);
+    std::vector < unsigned > colorCounter;
+    std::vector < unsigned > lastUsedBy;
+
+    for(unsigned iel = elementStart; iel < elementEnd; iel++) {
+      for(unsigned j = 1; j < el->GetElementNearElementSize(iel, 1); j++) {
+        unsigned jel = el->GetElementNearElement(iel, j);
+
+        if(jel >= elementStart && jel < elementEnd && color[jel - elementStart] != UINT_MAX) {
+          lastUsedBy[ color[jel - elementStart] ] = iel;
+        }
+      }
+
+      unsigned icolor = 0;
+
+      while(icolor < colorCounter.size() && lastUsedBy[icolor] == iel) {
+        icolor++;
+      }
+
+      if(icolor == colorCounter.size()) {
+        colorCounter.push_back(0);
+        lastUsedBy.push_back(UINT_MAX);
+      }
+
+      color[iel - elementStart] = icolor;
+      colorCounter[icolor]++;
+    }
+
+    _elementColorOffset.assign(colorCounter.size() + 1, 0);
+
+    for(unsigned icolor = 0; icolor < colorCounter.size(); icolor++) {
+      _elementColorOffset[icolor + 1] = _elementColorOffset[icolor] + colorCounter[icolor];
+    }
+
+    _coloredElements.resize(nOwnedElements);
+    colorCounter.assign(colorCounter.size(), 0);
+
+    for(unsigned iel = elementStart; iel < elementEnd; iel++) {
+      unsigned icolor = color[iel - elementStart];
+      _coloredElements[ _elementColorOffset[icolor] + colorCounter[icolor] ] = iel;
+      colorCounter[icolor]++;
+    }
+  }
+
 // *******************************************************
 
   unsigned Mesh::GetSolutionDof(const unsigned& ielc, const unsigned& i0, const unsigned& i1, const short unsigned& solType, const Mesh* mshc) const
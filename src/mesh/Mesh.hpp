@@ -124,6 +124,11 @@ public:
       return _level;
     }
 
+    /** Get the id of this mesh, every mesh object (e.g. a new AMR level) has a different id */
+    unsigned GetMeshId() const {
+      return _meshId;
+    }
+
     /** Set the dimension of the problem (1D, 2D, 3D) */
     void SetDimension(const unsigned &dim) {
       Mesh::_dimension = dim;
@@ -149,6 +154,48 @@ public:
     /** Performs a bisection search to find the processor of the given dof */
     unsigned IsdomBisectionSearch(const unsigned &dof, const short unsigned &solType) const;
 
+    /** Get the contiguous list of the solution dofs of the owned element iel. The tables are built when the mesh is
+     *  completed (see BuildElementSolutionDofTables), so this accessor only reads and can be called from threads */
+    const unsigned* GetElementSolutionDofs(const unsigned &iel, const short unsigned &solType) const {
+      assert(iel >= _elementOffset[_iproc] && iel < _elementOffset[_iproc + 1]);
+      assert(_elementSolutionDofOffset[solType].size() != 0);
+      return &_elementSolutionDof[solType][ _elementSolutionDofOffset[solType][iel - _elementOffset[_iproc]] ];
+    }
+
+    /** Get the local array indices of the solution dofs of the owned element iel, valid for all the vectors of a Solution
+     *  on this mesh with fe type -solType- (owned entries first, then ghost entries), see NumericVector::get_local */
+    const int* GetElementSolutionLocalDofs(const unsigned &iel, const short unsigned &solType) const {
+      assert(iel >= _elementOffset[_iproc] && iel < _elementOffset[_iproc + 1]);
+      assert(_elementSolutionDofOffset[solType].size() != 0);
+      return &_elementSolutionLocalDof[solType][ _elementSolutionDofOffset[solType][iel - _elementOffset[_iproc]] ];
+    }
+
+    /** Build the element to solution dof tables (CSR) of the owned elements for all the fe types */
+    void BuildElementSolutionDofTables();
+
+    /** Free the element to solution dof tables and the element coloring */
+    void ClearElementSolutionDofTables();
+
+    /** Bytes owned on this process by the topology, the element structures, the dof maps, the cached tables and the
+     *  projection matrices of this mesh (the std::map containers are estimated) */
+    std::size_t GetMemoryUsage() const;
+
+    /** Build a coloring of the owned elements: elements with the same color do not share any vertex, then any dof.
+     *  It is built when the mesh is completed, together with the element dof tables */
+    void BuildElementColoring();
+
+    /** Get the number of element colors */
+    unsigned GetElementColorNumber() const {
+      assert(_elementColorOffset.size() != 0);
+      return _elementColorOffset.size() - 1u;
+    }
+
+    /** Get the owned elements with color icolor, they are stored in [ GetColoredElements(icolor), GetColoredElements(icolor + 1) ) */
+    const unsigned* GetColoredElements(const unsigned &icolor) const {
+      assert(icolor < _elementColorOffset.size());
+      return _coloredElements.data() + _elementColorOffset[icolor];
+    }
+
     /** To be added */
     const unsigned GetFaceIndex() const {
       return Mesh::_face_index;
@@ -256,6 +303,8 @@ private:
     int _nelem;                                //< number of elements
     unsigned _nnodes;                          //< number of nodes
     unsigned _level;                           //< level of mesh in the multilevel hierarchy
+    unsigned _meshId;                          //< id of this mesh object
+    static unsigned _meshCounter;              //< number of mesh objects created so far
     static unsigned _dimension;                //< dimension of the problem
     static unsigned _ref_index;
     static unsigned _face_index;
@@ -277,6 +326,18 @@ private:
     std::vector < std::map < unsigned,  std::map < unsigned, double  > > > _amrRestriction;
     std::vector < std::map < unsigned, bool > > _amrSolidMark;
 
+    /** Build the element to solution dof table (CSR) of the owned elements for the fe type -solType- */
+    void BuildElementSolutionDofTable(const short unsigned &solType);
+
+    // cached element to solution dof tables (CSR) of the owned elements
+    vector < unsigned > _elementSolutionDofOffset[5];
+    vector < unsigned > _elementSolutionDof[5];
+    vector < int > _elementSolutionLocalDof[5];
+
+    // owned elements grouped by color (CSR)
+    vector < unsigned > _elementColorOffset;
+    vector < unsigned > _coloredElements;
+
 };
 
 } //end namespace femus
@@ -0,0 +1,311 @@
+/*=========================================================================
+
+ Program: FEMuS
+ Module: MeshParMetisPartitioning
+
+ Copyright (c) FEMuS
+ All rights reserved.
+
+ This software is distributed WITHOUT ANY WARRANTY; without even
+ the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ PURPOSE.  See the above copyright notice for more information.
+
+=========================================================================*/
+
+//----------------------------------------------------------------------------
+// includes :
+//----------------------------------------------------------------------------
+#include "MeshParMetisPartitioning.hpp"
+#include "MeshMetisPartitioning.hpp"
+#include "Mesh.hpp"
+#include "FemusConfig.hpp"
+
+#ifdef HAVE_PETSC
+#include <petscconf.h>
+#endif
+
+#ifdef PETSC_HAVE_PARMETIS
+#include "parmetis.h"
+#endif
+
+//C++ include
+#include <iostream>
+#include <algorithm>
+
+
+namespace femus
+{
+
+  using std::cout;
+  using std::endl;
+
+
+  MeshParMetisPartitioning::MeshParMetisPartitioning(Mesh& mesh) : MeshPartitioning(mesh)
+  {
+
+  }
+
+
+//------------------------------------------------------------------------------------------------------
+  void MeshParMetisPartitioning::DoPartition(std::vector <int>& epart, const bool& AMR)
+  {
+
+    int nelem = _mesh.GetNumberOfElements();
+
+    epart.resize(nelem);
+
+    if(_nprocs == 1) {
+      epart.assign(nelem, 0);
+      return;
+    }
+    else if(_nprocs > nelem) {
+      std::cout << "Error in MeshParMetisPartitioning::DoPartition, the number of processes " << _nprocs
+                << " is greater than the number of elements " << nelem << ": refine the coarse mesh or use fewer processes" << std::endl;
+      abort();
+    }
+    else if(_nprocs == nelem) {
+      for(unsigned i = 0; i < nelem; i++) {
+        epart[i] = i;
+      }
+      return;
+    }
+
+#ifndef PETSC_HAVE_PARMETIS
+
+    if(_iproc == 0) {
+      std::cout << " Warning: PETSc was not configured with parmetis, every process partitions the whole mesh with METIS" << std::endl;
+    }
+    MeshMetisPartitioning(_mesh).DoPartition(epart, AMR);
+
+#else
+
+    // every process hands to parmetis a contiguous block of elements
+    std::vector < int > elmdist(_nprocs + 1);
+    std::vector < int > blockSize(_nprocs), blockOffset(_nprocs);
+    for(int isdom = 0; isdom <= _nprocs; isdom++) {
+      elmdist[isdom] = (static_cast < long > (nelem) * isdom) / _nprocs;
+    }
+    for(int isdom = 0; isdom < _nprocs; isdom++) {
+      blockOffset[isdom] = elmdist[isdom];
+      blockSize[isdom] = elmdist[isdom + 1] - elmdist[isdom];
+    }
+
+    unsigned elementStart = elmdist[_iproc];
+    unsigned elementEnd = elmdist[_iproc + 1];
+    unsigned nLocalElements = elementEnd - elementStart;
+
+    std::vector < int > eptr(nLocalElements + 1);
+    eptr[0] = 0;
+    for(unsigned iel = elementStart; iel < elementEnd; iel++) {
+      eptr[iel - elementStart + 1] = eptr[iel - elementStart] + _mesh.el->GetElementDofNumber(iel, 2);
+    }
+
+    std::vector < int > eind(eptr[nLocalElements]);
+    unsigned counter = 0;
+    for(unsigned iel = elementStart; iel < elementEnd; iel++) {
+      unsigned ndofs = _mesh.el->GetElementDofNumber(iel, 2);
+      for(unsigned inode = 0; inode < ndofs; inode++) {
+        eind[counter] = _mesh.el->GetElementDofIndex(iel, inode);
+        counter++;
+      }
+    }
+
+    int ncommon = (AMR || _mesh.GetDimension() == 1) ? 1 : _mesh.GetDimension() + 1;
+    std::vector < int > part;
+    DoPartition(elmdist, eptr, eind, ncommon, part);
+
+    // FillISvector renumbers the replicated elements and nodes, so every process needs the whole partition
+    MPI_Allgatherv(&part[0], nLocalElements, MPI_INT, &epart[0], &blockSize[0], &blockOffset[0], MPI_INT, MPI_COMM_WORLD);
+
+#endif
+
+    return;
+  }
+
+//------------------------------------------------------------------------------------------------------
+  void MeshParMetisPartitioning::DoPartition(const std::vector < int > &elmdist, const std::vector < int > &eptr,
+                                             const std::vector < int > &eind, const int &ncommon, std::vector < int > &part)
+  {
+
+    unsigned nLocalElements = elmdist[_iproc + 1] - elmdist[_iproc];
+    part.assign(nLocalElements, 0);
+
+    if(_nprocs == 1) return;
+
+#ifndef PETSC_HAVE_PARMETIS
+
+    std::cout << "Error in MeshParMetisPartitioning::DoPartition, PETSc was not configured with parmetis" << std::endl;
+    abort();
+
+#else
+
+    for(int isdom = 0; isdom < _nprocs; isdom++) {
+      if(elmdist[isdom + 1] == elmdist[isdom]) {
+        std::cout << "Error in MeshParMetisPartitioning::DoPartition, the process " << isdom << " has no elements" << std::endl;
+        abort();
+      }
+    }
+
+    std::vector < idx_t > elmdistParmetis(elmdist.begin(), elmdist.end());
+    std::vector < idx_t > eptrParmetis(eptr.begin(), eptr.end());
+    std::vector < idx_t > eindParmetis(eind.begin(), eind.end());
+
+    idx_t wgtflag = 0;
+    idx_t numflag = 0;
+    idx_t ncon = 1;
+    idx_t ncommonParmetis = ncommon;
+    idx_t nparts = _nprocs;
+    std::vector < real_t > tpwgts(nparts, 1. / nparts);
+    real_t ubvec = 1.05;
+    idx_t options[3] = {0, 0, 0};
+    idx_t edgecut;
+    std::vector < idx_t > partParmetis(nLocalElements);
+
+    MPI_Comm comm = MPI_COMM_WORLD;
+
+    int err = ParMETIS_V3_PartMeshKway(&elmdistParmetis[0], &eptrParmetis[0], &eindParmetis[0], NULL, &wgtflag, &numflag, &ncon,
+                                       &ncommonParmetis, &nparts, &tpwgts[0], &ubvec, options, &edgecut, &partParmetis[0], &comm);
+
+    if(err == METIS_OK) {
+      if(_iproc == 0) std::cout << " PARMETIS PARTITIONING IS OK " << std::endl;
+    }
+    else {
+      cout << " PARMETIS_ERROR " << endl;
+      exit(1);
+    }
+
+    part.assign(partParmetis.begin(), partParmetis.end());
+
+#endif
+
+  }
+
+//------------------------------------------------------------------------------------------------------
+  void MeshParMetisPartitioning::RedistributeElements(const std::vector < int > &elmdist, const std::vector < int > &eptr,
+                                                      const std::vector < int > &eind, const std::vector < int > &part,
+                                                      std::vector < int > &elementIds, std::vector < int > &ownedEptr,
+                                                      std::vector < int > &ownedEind)
+  {
+
+    unsigned nLocalElements = elmdist[_iproc + 1] - elmdist[_iproc];
+
+    // elements and nodes sent to each process
+    std::vector < int > sendElementCount(_nprocs, 0), sendNodeCount(_nprocs, 0);
+    for(unsigned i = 0; i < nLocalElements; i++) {
+      sendElementCount[part[i]]++;
+      sendNodeCount[part[i]] += eptr[i + 1] - eptr[i];
+    }
+
+    std::vector < int > sendElementOffset(_nprocs + 1, 0), sendNodeOffset(_nprocs + 1, 0);
+    for(int isdom = 0; isdom < _nprocs; isdom++) {
+      sendElementOffset[isdom + 1] = sendElementOffset[isdom] + sendElementCount[isdom];
+      sendNodeOffset[isdom + 1] = sendNodeOffset[isdom] + sendNodeCount[isdom];
+    }
+
+    // the elements are packed by destination, in increasing global index within each destination
+    std::vector < int > sendIds(nLocalElements), sendSizes(nLocalElements), sendNodes(eptr[nLocalElements]);
+    std::vector < int > elementPosition(sendElementOffset.begin(), sendElementOffset.end() - 1);
+    std::vector < int > nodePosition(sendNodeOffset.begin(), sendNodeOffset.end() - 1);
+    for(unsigned i = 0; i < nLocalElements; i++) {
+      int isdom = part[i];
+      sendIds[elementPosition[isdom]] = elmdist[_iproc] + i;
+      sendSizes[elementPosition[isdom]] = eptr[i + 1] - eptr[i];
+      elementPosition[isdom]++;
+      for(int j = eptr[i]; j < eptr[i + 1]; j++) {
+        sendNodes[nodePosition[isdom]] = eind[j];
+        nodePosition[isdom]++;
+      }
+    }
+
+    std::vector < int > recvElementCount(_nprocs), recvNodeCount(_nprocs);
+    MPI_Alltoall(&sendElementCount[0], 1, MPI_INT, &recvElementCount[0], 1, MPI_INT, MPI_COMM_WORLD);
+    MPI_Alltoall(&sendNodeCount[0], 1, MPI_INT, &recvNodeCount[0], 1, MPI_INT, MPI_COMM_WORLD);
+
+    std::vector < int > recvElementOffset(_nprocs + 1, 0), recvNodeOffset(_nprocs + 1, 0);
+    for(int isdom = 0; isdom < _nprocs; isdom++) {
+      recvElementOffset[isdom + 1] = recvElementOffset[isdom] + recvElementCount[isdom];
+      recvNodeOffset[isdom + 1] = recvNodeOffset[isdom] + recvNodeCount[isdom];
+    }
+
+    std::vector < int > recvSizes(recvElementOffset[_nprocs]);
+    elementIds.resize(recvElementOffset[_nprocs]);
+    ownedEind.resize(recvNodeOffset[_nprocs]);
+
+    // the blocks arrive in process order and the processes hold increasing global indices, so elementIds is sorted
+    MPI_Alltoallv(sendIds.data(), sendElementCount.data(), sendElementOffset.data(), MPI_INT,
+                  elementIds.data(), recvElementCount.data(), recvElementOffset.data(), MPI_INT, MPI_COMM_WORLD);
+    MPI_Alltoallv(sendSizes.data(), sendElementCount.data(), sendElementOffset.data(), MPI_INT,
+                  recvSizes.data(), recvElementCount.data(), recvElementOffset.data(), MPI_INT, MPI_COMM_WORLD);
+    MPI_Alltoallv(sendNodes.data(), sendNodeCount.data(), sendNodeOffset.data(), MPI_INT,
+                  ownedEind.data(), recvNodeCount.data(), recvNodeOffset.data(), MPI_INT, MPI_COMM_WORLD);
+
+    ownedEptr.resize(elementIds.size() + 1);
+    ownedEptr[0] = 0;
+    for(unsigned i = 0; i < elementIds.size(); i++) {
+      ownedEptr[i + 1] = ownedEptr[i] + recvSizes[i];
+    }
+
+  }
+
+//------------------------------------------------------------------------------------------------------
+  void MeshParMetisPartitioning::RedistributeNodes(const std::vector < int > &nodedist, const std::vector < std::vector < double > > &coords,
+                                                   const std::vector < int > &ownedEind, std::vector < int > &nodeIds,
+                                                   std::vector < std::vector < double > > &ownedCoords)
+  {
+
+    const unsigned dim = coords.size();
+
+    nodeIds = ownedEind;
+    std::sort(nodeIds.begin(), nodeIds.end());
+    nodeIds.erase(std::unique(nodeIds.begin(), nodeIds.end()), nodeIds.end());
+
+    // the sorted nodes are grouped by the process that holds their coordinates
+    std::vector < int > requestCount(_nprocs, 0);
+    for(unsigned i = 0; i < nodeIds.size(); i++) {
+      int isdom = std::upper_bound(nodedist.begin(), nodedist.end(), nodeIds[i]) - nodedist.begin() - 1;
+      requestCount[isdom]++;
+    }
+
+    std::vector < int > answerCount(_nprocs);
+    MPI_Alltoall(&requestCount[0], 1, MPI_INT, &answerCount[0], 1, MPI_INT, MPI_COMM_WORLD);
+
+    std::vector < int > requestOffset(_nprocs + 1, 0), answerOffset(_nprocs + 1, 0);
+    for(int isdom = 0; isdom < _nprocs; isdom++) {
+      requestOffset[isdom + 1] = requestOffset[isdom] + requestCount[isdom];
+      answerOffset[isdom + 1] = answerOffset[isdom] + answerCount[isdom];
+    }
+
+    std::vector < int > requestedNodes(answerOffset[_nprocs]);
+    MPI_Alltoallv(nodeIds.data(), requestCount.data(), requestOffset.data(), MPI_INT,
+                  requestedNodes.data(), answerCount.data(), answerOffset.data(), MPI_INT, MPI_COMM_WORLD);
+
+    // the coordinates of the requested nodes, dim values per node
+    std::vector < double > answerCoords(requestedNodes.size() * dim);
+    for(unsigned i = 0; i < requestedNodes.size(); i++) {
+      for(unsigned k = 0; k < dim; k++) {
+        answerCoords[i * dim + k] = coords[k][requestedNodes[i] - nodedist[_iproc]];
+      }
+    }
+
+    for(int isdom = 0; isdom < _nprocs; isdom++) {
+      requestCount[isdom] *= dim;
+      requestOffset[isdom] *= dim;
+      answerCount[isdom] *= dim;
+      answerOffset[isdom] *= dim;
+    }
+
+    std::vector < double > recvCoords(nodeIds.size() * dim);
+    MPI_Alltoallv(answerCoords.data(), answerCount.data(), answerOffset.data(), MPI_DOUBLE,
+                  recvCoords.data(), requestCount.data(), requestOffset.data(), MPI_DOUBLE, MPI_COMM_WORLD);
+
+    ownedCoords.resize(dim);
+    for(unsigned k = 0; k < dim; k++) {
+      ownedCoords[k].resize(nodeIds.size());
+      for(unsigned i = 0; i < nodeIds.size(); i++) {
+        ownedCoords[k][i] = recvCoords[i * dim + k];
+      }
+    }
+
+  }
+
+}
@@ -0,0 +1,79 @@
+/*=========================================================================
+
+ Program: FEMuS
+ Module: MeshParMetisPartitioning
+
+ Copyright (c) FEMuS
+ All rights reserved.
+
+ This software is distributed WITHOUT ANY WARRANTY; without even
+ the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ PURPOSE.  See the above copyright notice for more information.
+
+=========================================================================*/
+
+#ifndef __femus_mesh_MeshParMetisPartitioning_hpp__
+#define __femus_mesh_MeshParMetisPartitioning_hpp__
+
+//----------------------------------------------------------------------------
+// includes :
+//----------------------------------------------------------------------------
+#include <vector>
+#include "MeshPartitioning.hpp"
+
+namespace femus {
+
+
+class Mesh;
+
+
+/**
+ * This is the \p MeshParMetisPartitioning class. This class calls the parmetis algorithm for
+ * mesh partitioning: every process passes to parmetis only its own block of elements, so the
+ * partitioning work and memory are distributed. The distributed interface works on a distributed
+ * element list and moves the elements, and the coordinates of their nodes, to the processes that
+ * own them.
+*/
+
+class MeshParMetisPartitioning : public MeshPartitioning {
+
+public:
+
+    /** Constructor */
+    MeshParMetisPartitioning(Mesh& mesh);
+
+    /** destructor */
+    ~MeshParMetisPartitioning() {};
+
+    /** New ParMetis parallel partitioning:
+     *  for coarse and AMR mesh. The element structures of the mesh are still replicated at this stage, so the
+     *  distributed partition is gathered on all the processes. If PETSc was not configured with parmetis it
+     *  warns and uses \p MeshMetisPartitioning */
+    void DoPartition( std::vector < int > &epart, const bool &AMR );
+
+    /** Partitioning of a distributed element list: the process iproc holds the elements elmdist[iproc] <= iel <
+     *  elmdist[iproc + 1], with the nodes of its i-th element in eind[eptr[i]], ..., eind[eptr[i + 1] - 1]. On
+     *  return part[i] is the process of the i-th local element. Every process must hold at least one element */
+    void DoPartition( const std::vector < int > &elmdist, const std::vector < int > &eptr, const std::vector < int > &eind,
+                      const int &ncommon, std::vector < int > &part );
+
+    /** Redistribution of a distributed element list (see DoPartition): each local element is sent to the process
+     *  part[i]. On return the process holds only its own elements, with global indices elementIds in increasing
+     *  order and nodes in ownedEind[ownedEptr[i]], ..., ownedEind[ownedEptr[i + 1] - 1] */
+    void RedistributeElements( const std::vector < int > &elmdist, const std::vector < int > &eptr, const std::vector < int > &eind,
+                               const std::vector < int > &part, std::vector < int > &elementIds,
+                               std::vector < int > &ownedEptr, std::vector < int > &ownedEind );
+
+    /** Redistribution of the node coordinates: the process iproc holds the coordinates of the nodes nodedist[iproc] <=
+     *  inode < nodedist[iproc + 1] in coords[k][inode - nodedist[iproc]]. On return nodeIds are the nodes of ownedEind
+     *  in increasing order, and ownedCoords[k][i] the coordinates of the node nodeIds[i] */
+    void RedistributeNodes( const std::vector < int > &nodedist, const std::vector < std::vector < double > > &coords,
+                            const std::vector < int > &ownedEind, std::vector < int > &nodeIds,
+                            std::vector < std::vector < double > > &ownedCoords );
+
+};
+
+
+}
+
+#endif
@@ -19,6 +19,7 @@
 
 #include "Mesh.hpp"
 #include "MeshMetisPartitioning.hpp"
+#include "MeshParMetisPartitioning.hpp"
 #include "MeshRefinement.hpp"
 #include "NumericVector.hpp"
 #include "GeomElTypeEnum.hpp"
@@ -399,7 +400,8 @@ namespace femus {
     MeshMetisPartitioning meshMetisPartitioning(_mesh);
 
     if(AMR == true) {
-      meshMetisPartitioning.DoPartition(partition, AMR);
+      MeshParMetisPartitioning meshParMetisPartitioning(_mesh);
+      meshParMetisPartitioning.DoPartition(partition, AMR);
     }
     else {
       meshMetisPartitioning.DoPartition(partition, *mshc);
@@ -447,6 +449,9 @@ namespace femus {
     _mesh.el->ScatterElementDof();
     _mesh.el->ScatterElementNearFace();
 
+    _mesh.BuildElementSolutionDofTables();
+    _mesh.BuildElementColoring();
+
     std::vector < std::map < unsigned,  std::map < unsigned, double  > > >& restriction = _mesh.GetAmrRestrictionMap();
     if(AMR) {
       _mesh.el->GetAMRRestriction(&_mesh);
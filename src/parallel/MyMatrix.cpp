@@ -252,6 +252,12 @@ namespace femus {
     return _size;
   }
 
+  // ******************
+  template <class Type> std::size_t MyMatrix<Type>::GetMemoryUsage() const {
+    return (_mat.capacity() + _mat2.capacity()) * sizeof(Type) + _offset.capacity() * sizeof(unsigned) +
+           _rowOffset.GetMemoryUsage() + _rowSize.GetMemoryUsage() + _matSize.GetMemoryUsage();
+  }
+
   template <class Type> unsigned MyMatrix<Type>::size(const unsigned &i) {
     return (_matIsAllocated) ? _rowSize[i] : 0;
   }
@@ -71,6 +71,9 @@ namespace femus {
       
       unsigned size(const unsigned &i);
 
+      // ******************
+      std::size_t GetMemoryUsage() const;
+
       // ******************
       unsigned begin();
 
@@ -120,6 +120,11 @@ namespace femus {
     return _size;
   }
 
+  // ******************
+  template <class Type> std::size_t MyVector<Type>::GetMemoryUsage() const {
+    return (_vec.capacity() + _vec2.capacity()) * sizeof(Type) + _offset.capacity() * sizeof(unsigned);
+  }
+
   // ******************
   template <class Type> unsigned MyVector<Type>::begin() {
     return _begin;
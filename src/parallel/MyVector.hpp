@@ -61,6 +61,9 @@ namespace femus {
       // ******************
       unsigned size();
 
+      // ******************
+      std::size_t GetMemoryUsage() const;
+
       // ******************
       unsigned begin();
 
@@ -0,0 +1,166 @@
+/*=========================================================================
+
+ Program: FEMUS
+ Module: AsyncOutputQueue
+
+ Copyright (c) FEMTTU
+ All rights reserved.
+
+ This software is distributed WITHOUT ANY WARRANTY; without even
+ the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ PURPOSE.  See the above copyright notice for more information.
+
+=========================================================================*/
+
+//----------------------------------------------------------------------------
+// includes :
+//----------------------------------------------------------------------------
+#include "AsyncOutputQueue.hpp"
+#include <b64/b64.h>
+#include <fstream>
+#include <iostream>
+#include <cstdlib>
+#include <cstring>
+
+namespace femus {
+
+  void OutputBuffer::AppendEncodedArray(const void* data, const unsigned &size) {
+    _textSegments.push_back(_text.str());
+    _text.str("");
+
+    _encodedArrays.resize(_encodedArrays.size() + 1);
+    std::vector < char > &array = _encodedArrays.back();
+    array.resize(sizeof(unsigned) + size);
+    memcpy(&array[0], &size, sizeof(unsigned));
+    if(size > 0) memcpy(&array[sizeof(unsigned)], data, size);
+  }
+
+
+  void OutputBuffer::Append(const OutputBuffer &buffer) {
+    if(buffer._encodedArrays.empty()) {
+      _text << buffer._text.str();
+    }
+    else {
+      _textSegments.push_back(_text.str() + buffer._textSegments[0]);
+      _textSegments.insert(_textSegments.end(), buffer._textSegments.begin() + 1, buffer._textSegments.end());
+      _encodedArrays.insert(_encodedArrays.end(), buffer._encodedArrays.begin(), buffer._encodedArrays.end());
+      _text.str("");
+      _text << buffer._text.str();
+    }
+  }
+
+
+  void OutputBuffer::Encode() {
+    std::ostringstream encoded;
+    for(unsigned i = 0; i < _encodedArrays.size(); i++) {
+      encoded << _textSegments[i];
+      EncodeArray(_encodedArrays[i], encoded);
+    }
+    encoded << _text.str();
+
+    _textSegments.clear();
+    _encodedArrays.clear();
+    _text.str("");
+    _text << encoded.str();
+  }
+
+
+  void OutputBuffer::EncodeArray(const std::vector < char > &array, std::ostream &out) {
+
+    const unsigned size = array.size() - sizeof(unsigned);
+
+    // the size and the array are encoded separately, as VTK expects
+    std::vector < char > enc;
+    size_t cch = b64::b64_encode(&array[0], sizeof(unsigned), NULL, 0);
+    enc.resize(cch);
+    b64::b64_encode(&array[0], sizeof(unsigned), &enc[0], cch);
+    out.write(&enc[0], cch);
+
+    if(size > 0) {
+      cch = b64::b64_encode(&array[sizeof(unsigned)], size, NULL, 0);
+      enc.resize(cch);
+      b64::b64_encode(&array[sizeof(unsigned)], size, &enc[0], cch);
+      out.write(&enc[0], cch);
+    }
+  }
+
+
+  void OutputBuffer::WriteToFile(const std::string &filename) const {
+
+    std::ofstream fout(filename.c_str(), std::ios::binary);
+    if(!fout.is_open()) {
+      std::cout << std::endl << " The output file " << filename << " cannot be opened.\n";
+      abort();
+    }
+
+    for(unsigned i = 0; i < _encodedArrays.size(); i++) {
+      fout << _textSegments[i];
+      EncodeArray(_encodedArrays[i], fout);
+    }
+    fout << _text.str();
+
+    fout.close();
+  }
+
+
+  AsyncOutputQueue::AsyncOutputQueue(const unsigned &maxQueueSize) :
+    _maxQueueSize((maxQueueSize > 0) ? maxQueueSize : 1), _busy(false), _stop(false) {
+    _thread = std::thread(&AsyncOutputQueue::Run, this);
+  }
+
+
+  AsyncOutputQueue::~AsyncOutputQueue() {
+    {
+      std::unique_lock < std::mutex > lock(_mutex);
+      _stop = true;
+    }
+    _queueChanged.notify_all();
+    _thread.join();
+  }
+
+
+  void AsyncOutputQueue::Push(OutputBuffer* buffer, const std::string &filename) {
+    {
+      std::unique_lock < std::mutex > lock(_mutex);
+      while(_queue.size() >= _maxQueueSize) {
+        _queueChanged.wait(lock);
+      }
+      _queue.push_back(std::make_pair(buffer, filename));
+    }
+    _queueChanged.notify_all();
+  }
+
+
+  void AsyncOutputQueue::Flush() {
+    std::unique_lock < std::mutex > lock(_mutex);
+    while(!_queue.empty() || _busy) {
+      _queueChanged.wait(lock);
+    }
+  }
+
+
+  void AsyncOutputQueue::Run() {
+    std::unique_lock < std::mutex > lock(_mutex);
+    while(true) {
+      while(_queue.empty() && !_stop) {
+        _queueChanged.wait(lock);
+      }
+      // the pending buffers are written also when stopping
+      if(_queue.empty()) break;
+
+      std::pair < OutputBuffer*, std::string > job = _queue.front();
+      _queue.pop_front();
+      _busy = true;
+      lock.unlock();
+      _queueChanged.notify_all();
+
+      job.first->WriteToFile(job.second);
+      delete job.first;
+
+      lock.lock();
+      _busy = false;
+      _queueChanged.notify_all();
+    }
+  }
+
+}
@@ -0,0 +1,111 @@
+/*=========================================================================
+
+ Program: FEMUS
+ Module: AsyncOutputQueue
+
+ Copyright (c) FEMTTU
+ All rights reserved.
+
+ This software is distributed WITHOUT ANY WARRANTY; without even
+ the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ PURPOSE.  See the above copyright notice for more information.
+
+=========================================================================*/
+
+#ifndef __femus_solution_AsyncOutputQueue_hpp__
+#define __femus_solution_AsyncOutputQueue_hpp__
+
+//----------------------------------------------------------------------------
+// includes :
+//----------------------------------------------------------------------------
+#include <vector>
+#include <deque>
+#include <string>
+#include <sstream>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+
+namespace femus {
+
+  /**
+   * Staging buffer of an output file. The text is streamed into Text() and the binary arrays to be base64 encoded
+   * (VTK-XML binary format) are copied with AppendEncodedArray, so the solution can change as soon as the writer returns.
+   * The encoding and the file I/O are done by WriteToFile, possibly on the thread of an AsyncOutputQueue.
+   **/
+  class OutputBuffer {
+
+    public:
+
+      OutputBuffer() {};
+
+      ~OutputBuffer() {};
+
+      /** Stream for the text, also for raw binary data with write() */
+      std::ostringstream& Text() {
+        return _text;
+      }
+
+      /** Copies size bytes of data, printed as the base64 encoding of the unsigned size followed by the encoding of data */
+      void AppendEncodedArray(const void* data, const unsigned &size);
+
+      /** Appends the content of buffer */
+      void Append(const OutputBuffer &buffer);
+
+      /** Encodes the arrays in the text, e.g. before caching the buffer */
+      void Encode();
+
+      /** Encodes the arrays and writes the buffer to the file filename */
+      void WriteToFile(const std::string &filename) const;
+
+    private:
+
+      static void EncodeArray(const std::vector < char > &array, std::ostream &out);
+
+      // text before each encoded array
+      std::vector < std::string > _textSegments;
+      std::vector < std::vector < char > > _encodedArrays;
+      std::ostringstream _text;
+
+  };
+
+
+  /**
+   * Bounded queue of output buffers written by a background thread, so the time loop continues while the files are
+   * encoded and written. Push blocks while the queue is full, Flush waits for all the pending files.
+   * The background thread does not call MPI.
+   **/
+  class AsyncOutputQueue {
+
+    public:
+
+      /** Constructor, at most maxQueueSize buffers wait to be written */
+      AsyncOutputQueue(const unsigned &maxQueueSize);
+
+      /** Destructor, writes the pending buffers */
+      ~AsyncOutputQueue();
+
+      /** Queues buffer, that is deleted after it has been written to filename */
+      void Push(OutputBuffer* buffer, const std::string &filename);
+
+      /** Waits until all the queued buffers have been written */
+      void Flush();
+
+    private:
+
+      void Run();
+
+      unsigned _maxQueueSize;
+      std::deque < std::pair < OutputBuffer*, std::string > > _queue;
+      bool _busy;
+      bool _stop;
+
+      std::mutex _mutex;
+      std::condition_variable _queueChanged;
+      std::thread _thread;
+
+  };
+
+}
+
+#endif
@@ -23,6 +23,7 @@ PURPOSE.  See the above copyright notice for more information.
 #include "FemusConfig.hpp"
 #include "FemusDefault.hpp"
 #include "ParsedFunction.hpp"
+#include "Profiler.hpp"
 
 
 
@@ -31,6 +32,8 @@ PURPOSE.  See the above copyright notice for more information.
 #include <iomanip>
 #include <sstream>
 #include <sys/stat.h>
+#include <set>
+#include <algorithm>
 
 namespace femus
 {
@@ -123,6 +126,7 @@ namespace femus
     _order.resize(n + 1u);
     _solName.resize(n + 1u);
     _bdcType.resize(n + 1u);
+    _bdcCache.resize(n + 1u);
     _solTimeOrder.resize(n + 1u);
     _pdeType.resize(n + 1u);
     _testIfPressure.resize(n + 1u);
@@ -501,11 +505,93 @@ namespace femus
   void MultiLevelSolution::UpdateBdc(const double time)
   {
 
+    ProfilerRegion bdcRegion("BoundaryConditions");
+
     for(int k = 0; k < _solName.size(); k++) {
       if(!strcmp(_bdcType[k], "Time_dependent")) {
-        GenerateBdc(k, 0, time);
+        if(!UpdateBdcFromCache(k, time)) {
+          GenerateBdc(k, 0, time);
+        }
+      }
+    }
+  }
+
+//---------------------------------------------------------------------------------------------------
+  bool MultiLevelSolution::UpdateBdcFromCache(const unsigned int k, const double time)
+  {
+
+    // the values of all levels are evaluated before any of them is inserted: if the cache is not valid or the Dirichlet
+    // dofs have changed on some process, all the processes leave the vectors untouched and rebuild with GenerateBdc
+    int rebuild = 0;
+    for(unsigned igridn = 0; igridn < _gridn; igridn++) {
+      if(_solution[igridn]->_ResEpsBdcFlag[k]) {
+        if(_bdcCache[k].size() <= igridn || _bdcCache[k][igridn].meshId != static_cast < int >(_mlMesh->GetLevel(igridn)->GetMeshId())) {
+          rebuild = 1;
+        }
+      }
+    }
+
+    std::vector < std::vector < int > > dofs(_gridn);
+    std::vector < std::vector < double > > values(_gridn);
+    std::vector < double > xx(3);
+
+    for(unsigned igridn = 0; igridn < _gridn && !rebuild; igridn++) {
+      if(_solution[igridn]->_ResEpsBdcFlag[k]) {
+        const BoundaryDofCache &cache = _bdcCache[k][igridn];
+
+        dofs[igridn].reserve(cache.dof.size());
+        values[igridn].reserve(cache.dof.size());
+
+        for(unsigned i = 0; i < cache.dof.size(); i++) {
+          double value = 0.;
+
+          if(_useParsedBCFunction) {
+            if(!cache.isDirichlet[i]) continue;
+
+            if(!Ishomogeneous(k, cache.faceIndex[i] - 1u)) {
+              ParsedFunction* bdcfunc = (ParsedFunction*)(GetBdcFunction(k, cache.faceIndex[i] - 1u));
+              double xyzt[4] = {cache.xyz[3 * i], cache.xyz[3 * i + 1], cache.xyz[3 * i + 2], time};
+              value = (*bdcfunc)(xyzt);
+            }
+          }
+          else {
+            xx[0] = cache.xyz[3 * i];
+            xx[1] = cache.xyz[3 * i + 1];
+            xx[2] = cache.xyz[3 * i + 2];
+            bool test = (_bdcFuncSetMLProb) ?
+                        _SetBoundaryConditionFunctionMLProb(_mlBCProblem, xx, _solName[k], value, cache.faceIndex[i], time) :
+                        _SetBoundaryConditionFunction(xx, _solName[k], value, cache.faceIndex[i], time);
+
+            if(test != cache.isDirichlet[i]) {  // the Dirichlet dofs have changed
+              rebuild = 1;
+              break;
+            }
+
+            if(!test) continue;
+          }
+
+          dofs[igridn].push_back(cache.dof[i]);
+          values[igridn].push_back(value);
+        }
       }
     }
+
+    int rebuildAll;
+    MPI_Allreduce(&rebuild, &rebuildAll, 1, MPI_INT, MPI_MAX, MPI_COMM_WORLD);
+    if(rebuildAll) return false;
+
+    for(unsigned igridn = 0; igridn < _gridn; igridn++) {
+      if(_solution[igridn]->_ResEpsBdcFlag[k]) {
+        _solution[igridn]->_Sol[k]->insert(values[igridn], dofs[igridn]);
+
+        if(_fixSolutionAtOnePoint[k] == true  && igridn == 0 && _iproc == 0) {
+          _solution[igridn]->_Sol[k]->set(0, 0.);
+        }
+        _solution[igridn]->_Sol[k]->close();
+      }
+    }
+
+    return true;
   }
 
 
@@ -527,6 +613,12 @@ namespace femus
           _solution[igridn]->_Bdc[k]->set(j, 2.);
         }
 
+        // exterior boundary visits, in element order, for the boundary dof cache
+        std::vector < int > visitDof;
+        std::vector < int > visitCoordinateDof;
+        std::vector < int > visitFaceIndex;
+        std::vector < bool > visitIsDirichlet;
+
         if(_solType[k] < 3) {  // boundary condition for lagrangian elements
           for(int iel = msh->_elementOffset[_iproc]; iel < msh->_elementOffset[_iproc + 1]; iel++) {
             for(unsigned jface = 0; jface < msh->GetElementFaceNumber(iel); jface++) {
@@ -558,6 +650,11 @@ namespace femus
                   if(_useParsedBCFunction) {
                     unsigned int faceIndex = msh->el->GetBoundaryIndex(iel, jface);
 
+                    visitDof.push_back(msh->GetSolutionDof(i, iel, _solType[k]));
+                    visitCoordinateDof.push_back(inode_coord_Metis);
+                    visitFaceIndex.push_back(faceIndex);
+                    visitIsDirichlet.push_back(GetBoundaryCondition(k, faceIndex - 1u) == DIRICHLET);
+
                     if(GetBoundaryCondition(k, faceIndex - 1u) == DIRICHLET) {
                       unsigned inode_Metis = msh->GetSolutionDof(i, iel, _solType[k]);
                       _solution[igridn]->_Bdc[k]->set(inode_Metis, 0.);
@@ -586,6 +683,11 @@ namespace femus
                                 _SetBoundaryConditionFunctionMLProb(_mlBCProblem, xx, _solName[k], value, msh->el->GetBoundaryIndex(iel, jface), time) :
                                 _SetBoundaryConditionFunction(xx, _solName[k], value, msh->el->GetBoundaryIndex(iel, jface), time);
 
+                    visitDof.push_back(msh->GetSolutionDof(i, iel, _solType[k]));
+                    visitCoordinateDof.push_back(inode_coord_Metis);
+                    visitFaceIndex.push_back(msh->el->GetBoundaryIndex(iel, jface));
+                    visitIsDirichlet.push_back(test);
+
                     if(test) {
                       unsigned idof = msh->GetSolutionDof(i, iel, _solType[k]);
                       _solution[igridn]->_Bdc[k]->set(idof, 0.);
@@ -603,6 +705,39 @@ namespace femus
         }
         _solution[igridn]->_Sol[k]->close();
         _solution[igridn]->_Bdc[k]->close();
+
+        // one cache entry for each (dof, boundary index) pair, ordered by the last visit so that
+        // a dof shared by faces with different values gets the same value as in the element loop
+        if(_bdcCache[k].size() < _gridn) _bdcCache[k].resize(_gridn);
+        BoundaryDofCache &cache = _bdcCache[k][igridn];
+        cache.dof.resize(0);
+        cache.xyz.resize(0);
+        cache.faceIndex.resize(0);
+        cache.isDirichlet.resize(0);
+
+        std::set < std::pair < int, int > > visited;
+        std::vector < unsigned > entries;
+        for(int v = visitDof.size() - 1; v >= 0; v--) {
+          if(visited.insert(std::make_pair(visitDof[v], visitFaceIndex[v])).second) {
+            entries.push_back(v);
+          }
+        }
+        std::reverse(entries.begin(), entries.end());
+
+        cache.dof.reserve(entries.size());
+        cache.xyz.reserve(3 * entries.size());
+        cache.faceIndex.reserve(entries.size());
+        cache.isDirichlet.reserve(entries.size());
+        for(unsigned j = 0; j < entries.size(); j++) {
+          unsigned v = entries[j];
+          cache.dof.push_back(visitDof[v]);
+          for(unsigned d = 0; d < 3; d++) {
+            cache.xyz.push_back((*msh->_topology->_Sol[d])(visitCoordinateDof[v]));
+          }
+          cache.faceIndex.push_back(visitFaceIndex[v]);
+          cache.isDirichlet.push_back(visitIsDirichlet[v]);
+        }
+        cache.meshId = msh->GetMeshId();
       }
     }
 
@@ -263,6 +263,25 @@ private:
     /** Array of solution, dimension number of levels */
     vector < Solution* >  _solution;
 
+    /** Exterior boundary dofs of a variable on one level with their coordinates and boundary index, built by GenerateBdc
+     *  so that UpdateBdc evaluates the time dependent Dirichlet values without looping over the elements */
+    struct BoundaryDofCache {
+      BoundaryDofCache() : meshId(-1) {}
+      int meshId;
+      std::vector < int > dof;
+      std::vector < double > xyz;
+      std::vector < int > faceIndex;
+      std::vector < bool > isDirichlet;
+    };
+
+    /** Updates the Dirichlet values of the variable k on all levels from the cached boundary dofs,
+     *  returns false, on all the processes and without changing the solution, if on any process the cache
+     *  is not valid or the Dirichlet dofs have changed */
+    bool UpdateBdcFromCache(const unsigned int k, const double time);
+
+    /** Boundary dof caches, [variable][level] */
+    vector < vector < BoundaryDofCache > > _bdcCache;
+
 
 
     /** This group of vectors has the size of the number of added solutions */
@@ -317,34 +317,16 @@ namespace femus {
 
   void Solution::UpdateSol(const vector <unsigned> &_SolPdeIndex,  NumericVector* _EPS, const vector <vector <unsigned> > &KKoffset) {
 
-    PetscScalar zero = 0.;
-
     for(unsigned k = 0; k < _SolPdeIndex.size(); k++) {
       unsigned indexSol = _SolPdeIndex[k];
       unsigned soltype =  _SolType[indexSol];
 
-      int loc_offset_EPS = KKoffset[k][processor_id()];
-
-      int glob_offset_eps = _msh->_dofOffset[soltype][processor_id()];
+      // the owned dofs of the variable are a contiguous block of the owned dofs of the system vector
+      int loc_offset_EPS = KKoffset[k][processor_id()] - _EPS->first_local_index();
 
-      vector <int> index(_msh->_ownSize[soltype][processor_id()]);
-
-      for(int i = 0; i < _msh->_ownSize[soltype][processor_id()]; i++) {
-        index[i] = loc_offset_EPS + i;
-      }
-
-      vector <double> valueEPS(_msh->_ownSize[soltype][processor_id()]);
-      _EPS->get(index, valueEPS);
-      //vector <double> valueRES(_msh->_ownSize[soltype][processor_id()]);
-      //_RES->get(index,valueRES);
-
-      for(int i = 0; i < _msh->_ownSize[soltype][processor_id()]; i++) {
-        _Eps[indexSol]->set(i + glob_offset_eps, valueEPS[i]);
-        //if ((*_Bdc[indexSol])(i+glob_offset_eps)>1.1) _Res[indexSol]->set(i+glob_offset_eps,valueRES[i]);
-        //else _Res[indexSol]->set(i+glob_offset_eps,zero);
-      }
+      int glob_offset_eps = _msh->_dofOffset[soltype][processor_id()] - _Eps[indexSol]->first_local_index();
 
-      //_Res[indexSol]->close();
+      _Eps[indexSol]->insert_local_block(*_EPS, loc_offset_EPS, glob_offset_eps, _msh->_ownSize[soltype][processor_id()]);
       _Eps[indexSol]->close();
     }
 
@@ -369,33 +351,17 @@ namespace femus {
 //--------------------------------------------------------------------------------
   void Solution::UpdateRes(const vector <unsigned> &_SolPdeIndex, NumericVector* _RES, const vector <vector <unsigned> > &KKoffset) {
 
-    PetscScalar zero = 0.;
-
     for(unsigned k = 0; k < _SolPdeIndex.size(); k++) {
       unsigned indexSol = _SolPdeIndex[k];
       unsigned soltype =  _SolType[indexSol];
 
-      int loc_offset_RES = KKoffset[k][processor_id()];
-
-      int glob_offset_res = _msh->_dofOffset[soltype][processor_id()];
+      int loc_offset_RES = KKoffset[k][processor_id()] - _RES->first_local_index();
 
-      vector <int> index(_msh->_ownSize[soltype][processor_id()]);
-
-      for(int i = 0; i < _msh->_ownSize[soltype][processor_id()]; i++) {
-        index[i] = loc_offset_RES + i;
-      }
+      int glob_offset_res = _msh->_dofOffset[soltype][processor_id()] - _Res[indexSol]->first_local_index();
 
-      vector <double> valueRES(_msh->_ownSize[soltype][processor_id()]);
-      _RES->get(index, valueRES);
-
-      for(int i = 0; i < _msh->_ownSize[soltype][processor_id()]; i++) {
-        if((*_Bdc[indexSol])(i + glob_offset_res) > 1.1) {
-          _Res[indexSol]->set(i + glob_offset_res, valueRES[i]);
-        }
-        else {
-          _Res[indexSol]->set(i + glob_offset_res, zero);
-        }
-      }
+      // zero residual on the Dirichlet dofs (_Bdc <= 1.1)
+      _Res[indexSol]->insert_local_block(*_RES, loc_offset_RES, glob_offset_res, _msh->_ownSize[soltype][processor_id()],
+                                         _Bdc[indexSol], 1.1);
 
       _Res[indexSol]->close();
     }
@@ -1154,6 +1120,31 @@ namespace femus {
     }
   }
 
+  std::size_t Solution::GetMemoryUsage() const {
+    std::size_t bytes = 0;
+
+    const vector <NumericVector*>* vectors[6] = {&_Sol, &_SolOld, &_Res, &_Eps, &_AMREps, &_Bdc};
+    for(unsigned j = 0; j < 6; j++) {
+      for(unsigned i = 0; i < vectors[j]->size(); i++) {
+        if((*vectors[j])[i]) bytes += (*vectors[j])[i]->GetMemoryUsage();
+      }
+    }
+
+    for(unsigned i = 0; i < _GradVec.size(); i++) {
+      for(unsigned k = 0; k < _GradVec[i].size(); k++) {
+        if(_GradVec[i][k]) bytes += _GradVec[i][k]->GetMemoryUsage();
+      }
+    }
+
+    for(unsigned solType = 0; solType < 5; solType++) {
+      for(unsigned k = 0; k < _GradMat[solType].size(); k++) {
+        if(_GradMat[solType][k]) bytes += _GradMat[solType][k]->GetMemoryUsage();
+      }
+    }
+
+    return bytes;
+  }
+
 
 } //end namespace femus
 
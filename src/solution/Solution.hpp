@@ -80,6 +80,9 @@ namespace femus {
       
       void ResetSolutionToOldSolution();
 
+      /** Bytes owned on this process by the vectors and the gradient matrices of all the variables */
+      std::size_t GetMemoryUsage() const;
+
       /** Get a const solution (Numeric Vector) by name */
       const NumericVector& GetSolutionName(const char* var) const {
         return *_Sol[GetIndex(var)];
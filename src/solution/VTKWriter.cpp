@@ -19,7 +19,6 @@
 #include "VTKWriter.hpp"
 #include "MultiLevelProblem.hpp"
 #include "NumericVector.hpp"
-#include <b64/b64.h>
 #include <iostream>
 #include <fstream>
 #include <sstream>
@@ -28,22 +27,34 @@
 #include <iomanip>
 #include <algorithm>
 #include "Files.hpp"
+#include "AsyncOutputQueue.hpp"
+#include "Profiler.hpp"
 
 namespace femus {
 
-
   short unsigned int VTKWriter::femusToVtkCellType[3][6] = {{12, 10, 13, 9, 5, 3}, {25, 24, 26, 23, 22, 21}, {29, 24, 32, 28, 34, 21}};
   //http://www.vtk.org/doc/nightly/html/vtkCellType_8h.html#ab1d6fd1f3177b8a2a32bb018807151f8aff535f3b1a33b5e51d1ef1e3aed69447
 
   VTKWriter::VTKWriter( MultiLevelSolution* ml_sol ): Writer( ml_sol ) {
     _debugOutput = false;
+    _pointsBuffer = NULL;
+    _cellsBuffer = NULL;
+    _cachedMeshId = -1;
+    _cachedMeshIndex = 0;
   }
 
   VTKWriter::VTKWriter( MultiLevelMesh* ml_mesh ): Writer( ml_mesh ) {
     _debugOutput = false;
+    _pointsBuffer = NULL;
+    _cellsBuffer = NULL;
+    _cachedMeshId = -1;
+    _cachedMeshIndex = 0;
   }
 
-  VTKWriter::~VTKWriter(){}
+  VTKWriter::~VTKWriter() {
+    if( _pointsBuffer != NULL ) delete _pointsBuffer;
+    if( _cellsBuffer != NULL ) delete _cellsBuffer;
+  }
 
    void VTKWriter::Write(const std::string output_path, const char order[], const std::vector < std::string >& vars, const unsigned time_step ) {
        Write(_gridn, output_path, order, vars, time_step );
@@ -52,12 +63,16 @@ namespace femus {
   
   void VTKWriter::Write(const unsigned my_level, const std::string output_path, const char order[], const std::vector < std::string >& vars, const unsigned time_step ) {
       
+    ProfilerRegion outputRegion("Output");
+
     std::ostringstream level_name_stream;    
     level_name_stream << ".level" << my_level;
     std::string level_name(level_name_stream.str());   
        
     // *********** open vtu files *************
-    std::ofstream fout;
+    // the vtu file is staged in memory, the arrays are encoded when the buffer is written (see Writer::WriteOutputBuffer)
+    OutputBuffer* vtuBuffer = new OutputBuffer;
+    std::ostringstream& fout = vtuBuffer->Text();
 
     std::string dirnamePVTK = "VTKParallelFiles/";
     Files files;
@@ -76,12 +91,6 @@ namespace femus {
     std::ostringstream filename;
     filename << output_path << "/" << dirnamePVTK << filename_prefix << level_name << "." << _iproc << "." << time_step << "." << order << ".vtu";
 
-    fout.open( filename.str().c_str() );
-    if( !fout.is_open() ) {
-      std::cout << std::endl << " The output file " << filename.str() << " cannot be opened.\n";
-      abort();
-    }
-
     // *********** write vtu header ************
     fout << "<?xml version=\"1.0\"?>" << std::endl;
     fout << "<VTKFile type = \"UnstructuredGrid\" version=\"0.1\" byte_order=\"LittleEndian\">" << std::endl;
@@ -158,23 +167,24 @@ namespace femus {
     // initialize common buffer_void memory
     unsigned buffer_size = ( dim_array_coord[0] > dim_array_conn[0] ) ? dim_array_coord[0] : dim_array_conn[0];
     void* buffer_void = new char [buffer_size];
-    char* buffer_char = static_cast <char*>( buffer_void );
-
-    size_t cch;
-    cch = b64::b64_encode( &buffer_char[0], buffer_size , NULL, 0 );
-    vector <char> enc;
-    enc.resize( cch );
-    char* pt_char;
 
     fout  << "    <Piece NumberOfPoints= \"" << nvt << "\" NumberOfCells= \"" << nel << "\" >" << std::endl;
 
-    //-----------------------------------------------------------------------------------------------
-    // print coordinates *********************************************Solu*******************************************
-    fout  << "      <Points>" << std::endl;
-    fout  << "        <DataArray type=\"Float32\" NumberOfComponents=\"3\" format=\"binary\">" << std::endl;
-
+    // pvtu mesh arrays
     Pfout << "    <PPoints>" << std::endl;
     Pfout << "      <PDataArray type=\"Float32\" NumberOfComponents=\"3\" format=\"binary\"/>" << std::endl;
+    Pfout << "    </PPoints>" << std::endl;
+    Pfout << "    <PCells>" << std::endl;
+    Pfout << "      <PDataArray type=\"Int32\" Name=\"connectivity\" format=\"binary\"/>" << std::endl;
+    Pfout << "      <PDataArray type=\"Int32\" Name=\"offsets\" format=\"binary\"/>" << std::endl;
+    Pfout << "      <PDataArray type=\"UInt16\" Name=\"types\" format=\"binary\"/>" << std::endl;
+    Pfout << "    </PCells>" << std::endl;
+    Pfout << "    <PCellData Scalars=\"scalars\">" << std::endl;
+    Pfout << "      <PDataArray type=\"UInt16\" Name=\"Metis partition\" format=\"binary\"/>" << std::endl;
+    Pfout << "      <PDataArray type=\"Float32\" Name=\"" << "Material" << "\" format=\"binary\"/>" << std::endl;
+    Pfout << "      <PDataArray type=\"Float32\" Name=\"" << "Group" << "\" format=\"binary\"/>" << std::endl;
+    Pfout << "      <PDataArray type=\"Float32\" Name=\"" << "TYPE" << "\" format=\"binary\"/>" << std::endl;
+    Pfout << "      <PDataArray type=\"Float32\" Name=\"" << "Level" << "\" format=\"binary\"/>" << std::endl;
 
     NumericVector* mysol;
     mysol = NumericVector::build().release();
@@ -189,338 +199,286 @@ namespace femus {
                    mesh->_ghostDofs[index][_iproc], false, GHOSTED );
     }
 
-    // point pointer to common mamory area buffer of void type;
-    float* var_coord = static_cast<float*>( buffer_void );
-
-    for( int i = 0; i < 3; i++ ) {
-      if( !_surface ) {
-        mysol->matrix_mult( *mesh->_topology->_Sol[i],
-                            *mesh->GetQitoQjProjection( index, 2 ) );
-        if( _graph && i == 2 ) {
-          unsigned indGraph = _ml_sol->GetIndex( _graphVariable.c_str() );
-          mysol->matrix_mult( *solution->_Sol[indGraph],
-                              *mesh->GetQitoQjProjection( index, _ml_sol->GetSolutionType( indGraph ) ) );
+    // with the cached mesh output the points, if they do not depend on the solution, and the cells are built
+    // and encoded once per mesh, the following time steps reuse them
+    bool printCells = !_cachedMeshOutput || _cellsBuffer == NULL || _cachedMeshId != static_cast < int >( mesh->GetMeshId() ) || _cachedMeshIndex != index;
+    bool staticPoints = !( _ml_sol != NULL && _moving_mesh ) && !_graph && !_surface;
+    bool printPoints = printCells || _pointsBuffer == NULL || !staticPoints;
+
+    if( printPoints ) {
+      if( _pointsBuffer != NULL ) delete _pointsBuffer;
+      _pointsBuffer = new OutputBuffer;
+      std::ostringstream& meshOut = _pointsBuffer->Text();
+
+      //-----------------------------------------------------------------------------------------------
+      // print coordinates *********************************************Solu*******************************************
+      meshOut  << "      <Points>" << std::endl;
+      meshOut  << "        <DataArray type=\"Float32\" NumberOfComponents=\"3\" format=\"binary\">" << std::endl;
+
+      // point pointer to common mamory area buffer of void type;
+      float* var_coord = static_cast<float*>( buffer_void );
+
+      for( int i = 0; i < 3; i++ ) {
+        if( !_surface ) {
+          mysol->matrix_mult( *mesh->_topology->_Sol[i],
+                              *mesh->GetQitoQjProjection( index, 2 ) );
+          if( _graph && i == 2 ) {
+            unsigned indGraph = _ml_sol->GetIndex( _graphVariable.c_str() );
+            mysol->matrix_mult( *solution->_Sol[indGraph],
+                                *mesh->GetQitoQjProjection( index, _ml_sol->GetSolutionType( indGraph ) ) );
+          }
+        }
+        else {
+          unsigned indSurfVar = _ml_sol->GetIndex( _surfaceVariables[i].c_str() );
+          mysol->matrix_mult( *solution->_Sol[indSurfVar],
+                              *mesh->GetQitoQjProjection( index, _ml_sol->GetSolutionType( indSurfVar ) ) );
         }
-      }
-      else {
-        unsigned indSurfVar = _ml_sol->GetIndex( _surfaceVariables[i].c_str() );
-        mysol->matrix_mult( *solution->_Sol[indSurfVar],
-                            *mesh->GetQitoQjProjection( index, _ml_sol->GetSolutionType( indSurfVar ) ) );
-      }
-      for( unsigned ii = 0; ii < nvtOwned; ii++ ) {
-        var_coord[ ii * 3 + i] = ( *mysol )( ii +  dofOffset );
-      }
-      if( _ml_sol != NULL && _moving_mesh  && _ml_mesh->GetLevel( 0 )->GetDimension() > i )  { // if moving mesh
-        unsigned indDXDYDZ = _ml_sol->GetIndex( _moving_vars[i].c_str() );
-        mysol->matrix_mult( *solution->_Sol[indDXDYDZ],
-                            *mesh->GetQitoQjProjection( index, _ml_sol->GetSolutionType( indDXDYDZ ) ) );
         for( unsigned ii = 0; ii < nvtOwned; ii++ ) {
-          var_coord[ii * 3 + i] += ( *mysol )( ii +  dofOffset );
+          var_coord[ ii * 3 + i] = ( *mysol )( ii +  dofOffset );
         }
-      }
-    }
-    unsigned offset_ig = 3 * nvtOwned;
-
-    //print ghost nodes
-    for( int i = 0; i < 3; i++ ) {
-      if( !_surface ) {
-        mysol->matrix_mult( *mesh-> _topology->_Sol[i],
-                            *mesh-> GetQitoQjProjection( index, 2 ) );
-        if( _graph && i == 2 ) {
-          unsigned indGraphVar = _ml_sol->GetIndex( _graphVariable.c_str() );
-          mysol->matrix_mult( *solution->_Sol[indGraphVar],
-                              *mesh->GetQitoQjProjection( index, _ml_sol->GetSolutionType( indGraphVar ) ) );
+        if( _ml_sol != NULL && _moving_mesh  && _ml_mesh->GetLevel( 0 )->GetDimension() > i )  { // if moving mesh
+          unsigned indDXDYDZ = _ml_sol->GetIndex( _moving_vars[i].c_str() );
+          mysol->matrix_mult( *solution->_Sol[indDXDYDZ],
+                              *mesh->GetQitoQjProjection( index, _ml_sol->GetSolutionType( indDXDYDZ ) ) );
+          for( unsigned ii = 0; ii < nvtOwned; ii++ ) {
+            var_coord[ii * 3 + i] += ( *mysol )( ii +  dofOffset );
+          }
         }
       }
-      else {
-        unsigned indSurfVar = _ml_sol->GetIndex( _surfaceVariables[i].c_str() );
-        mysol->matrix_mult( *solution->_Sol[indSurfVar],
-                            *mesh->GetQitoQjProjection( index, _ml_sol->GetSolutionType( indSurfVar ) ) );
-      }
-      for( std::map <unsigned, unsigned>::iterator it = ghostMap.begin(); it != ghostMap.end(); ++it ) {
-        var_coord[ offset_ig + 3 * it->second + i ] = ( *mysol )( it->first );
+      unsigned offset_ig = 3 * nvtOwned;
+
+      //print ghost nodes
+      for( int i = 0; i < 3; i++ ) {
+        if( !_surface ) {
+          mysol->matrix_mult( *mesh-> _topology->_Sol[i],
+                              *mesh-> GetQitoQjProjection( index, 2 ) );
+          if( _graph && i == 2 ) {
+            unsigned indGraphVar = _ml_sol->GetIndex( _graphVariable.c_str() );
+            mysol->matrix_mult( *solution->_Sol[indGraphVar],
+                                *mesh->GetQitoQjProjection( index, _ml_sol->GetSolutionType( indGraphVar ) ) );
+          }
+        }
+        else {
+          unsigned indSurfVar = _ml_sol->GetIndex( _surfaceVariables[i].c_str() );
+          mysol->matrix_mult( *solution->_Sol[indSurfVar],
+                              *mesh->GetQitoQjProjection( index, _ml_sol->GetSolutionType( indSurfVar ) ) );
+        }
+        for( std::map <unsigned, unsigned>::iterator it = ghostMap.begin(); it != ghostMap.end(); ++it ) {
+          var_coord[ offset_ig + 3 * it->second + i ] = ( *mysol )( it->first );
+        }
       }
-    }
 
-    for( int i = 0; i < 3; i++ ) { // if moving mesh
-      if( _ml_sol != NULL && _moving_mesh  && mesh->GetDimension() > i )  {
-        unsigned indDXDYDZ = _ml_sol->GetIndex( _moving_vars[i].c_str() );
-        mysol->matrix_mult( *solution->_Sol[indDXDYDZ],
-                            *mesh->GetQitoQjProjection( index, _ml_sol->GetSolutionType( indDXDYDZ ) ) );
-        for( std::map <unsigned, unsigned>::iterator it = ghostMap.begin(); it != ghostMap.end(); ++it ) {
-          var_coord[ offset_ig + 3 * it->second + i ] += ( *mysol )( it->first );
+      for( int i = 0; i < 3; i++ ) { // if moving mesh
+        if( _ml_sol != NULL && _moving_mesh  && mesh->GetDimension() > i )  {
+          unsigned indDXDYDZ = _ml_sol->GetIndex( _moving_vars[i].c_str() );
+          mysol->matrix_mult( *solution->_Sol[indDXDYDZ],
+                              *mesh->GetQitoQjProjection( index, _ml_sol->GetSolutionType( indDXDYDZ ) ) );
+          for( std::map <unsigned, unsigned>::iterator it = ghostMap.begin(); it != ghostMap.end(); ++it ) {
+            var_coord[ offset_ig + 3 * it->second + i ] += ( *mysol )( it->first );
+          }
         }
       }
-    }
 
-    cch = b64::b64_encode( &dim_array_coord[0], sizeof( dim_array_coord ), NULL, 0 );
-    b64::b64_encode( &dim_array_coord[0], sizeof( dim_array_coord ), &enc[0], cch );
-    pt_char = &enc[0];
-    for( unsigned i = 0; i < cch; i++, pt_char++ ) fout << *pt_char;
+      //print coordinates array
+      _pointsBuffer->AppendEncodedArray( &var_coord[0], dim_array_coord[0] );
+      meshOut << std::endl;
 
-    //print coordinates array
-    cch = b64::b64_encode( &var_coord[0], dim_array_coord[0] , NULL, 0 );
-    b64::b64_encode( &var_coord[0], dim_array_coord[0], &enc[0], cch );
-    pt_char = &enc[0];
-    for( unsigned i = 0; i < cch; i++, pt_char++ ) fout << *pt_char;
-    fout << std::endl;
+      meshOut  << "        </DataArray>" << std::endl;
+      meshOut  << "      </Points>" << std::endl;
 
-    fout  << "        </DataArray>" << std::endl;
-    fout  << "      </Points>" << std::endl;
-    Pfout << "    </PPoints>" << std::endl;
-    //-----------------------------------------------------------------------------------------------
+      if( _cachedMeshOutput && staticPoints ) _pointsBuffer->Encode();
+    }
+    vtuBuffer->Append( *_pointsBuffer );
+
+    if( printCells ) {
+      if( _cellsBuffer != NULL ) delete _cellsBuffer;
+      _cellsBuffer = new OutputBuffer;
+      std::ostringstream& meshOut = _cellsBuffer->Text();
+
+      //-----------------------------------------------------------------------------------------------
+
+      //-----------------------------------------------------------------------------------------------
+      // Printing of element connectivity - offset - format type  *
+      meshOut  << "      <Cells>" << std::endl;
+      //-----------------------------------------------------------------------------------------------
+      //print connectivity
+      meshOut  << "        <DataArray type=\"Int32\" Name=\"connectivity\" format=\"binary\">" << std::endl;
+
+      // point pointer to common mamory area buffer of void type;
+      int* var_conn = static_cast <int*>( buffer_void );
+      icount = 0;
+      for( int iel = elemetOffset; iel < elemetOffsetp1; iel++ ) {
+        for( unsigned j = 0; j < mesh->GetElementDofNumber( iel, index ); j++ ) {
+          unsigned loc_vtk_conn = (mesh->GetElementType( iel ) == 0)? FemusToVTKorToXDMFConn[j] : j;
+          unsigned jdof = mesh->GetSolutionDof( loc_vtk_conn, iel, index );
+          var_conn[icount] = ( jdof >= dofOffset ) ? jdof - dofOffset : nvtOwned + ghostMap[jdof];
+          icount++;
+        }
+      }
 
-    //-----------------------------------------------------------------------------------------------
-    // Printing of element connectivity - offset - format type  *
-    fout  << "      <Cells>" << std::endl;
-    Pfout << "    <PCells>" << std::endl;
-    //-----------------------------------------------------------------------------------------------
-    //print connectivity
-    fout  << "        <DataArray type=\"Int32\" Name=\"connectivity\" format=\"binary\">" << std::endl;
-    Pfout << "      <PDataArray type=\"Int32\" Name=\"connectivity\" format=\"binary\"/>" << std::endl;
+      //print connectivity array
+      _cellsBuffer->AppendEncodedArray( &var_conn[0], dim_array_conn[0] );
+      meshOut << std::endl;
+      meshOut << "        </DataArray>" << std::endl;
+      //------------------------------------------------------------------------------------------------
 
-    // point pointer to common mamory area buffer of void type;
-    int* var_conn = static_cast <int*>( buffer_void );
-    icount = 0;
-    for( int iel = elemetOffset; iel < elemetOffsetp1; iel++ ) {
-      for( unsigned j = 0; j < mesh->GetElementDofNumber( iel, index ); j++ ) {
-        unsigned loc_vtk_conn = (mesh->GetElementType( iel ) == 0)? FemusToVTKorToXDMFConn[j] : j;
-        unsigned jdof = mesh->GetSolutionDof( loc_vtk_conn, iel, index );
-        var_conn[icount] = ( jdof >= dofOffset ) ? jdof - dofOffset : nvtOwned + ghostMap[jdof];
+      //-------------------------------------------------------------------------------------------------
+      //printing offset
+      meshOut  << "        <DataArray type=\"Int32\" Name=\"offsets\" format=\"binary\">" << std::endl;
+
+      // point pointer to common memory area buffer of void type;
+      int* var_off = static_cast <int*>( buffer_void );
+      icount = 0;
+      int offset_el = 0;
+      // print offset array
+      for( int iel = elemetOffset; iel < elemetOffsetp1; iel++ ) {
+        offset_el += mesh->GetElementDofNumber( iel, index );
+        var_off[icount] = offset_el;
         icount++;
       }
-    }
-
-    //print connectivity dimension
-    cch = b64::b64_encode( &dim_array_conn[0], sizeof( dim_array_conn ), NULL, 0 );
-    b64::b64_encode( &dim_array_conn[0], sizeof( dim_array_conn ), &enc[0], cch );
-    pt_char = &enc[0];
-    for( unsigned i = 0; i < cch; i++, pt_char++ ) fout << *pt_char;
-
-    //print connectivity array
-    cch = b64::b64_encode( &var_conn[0], dim_array_conn[0] , NULL, 0 );
-    b64::b64_encode( &var_conn[0], dim_array_conn[0], &enc[0], cch );
-    pt_char = &enc[0];
-    for( unsigned i = 0; i < cch; i++, pt_char++ ) fout << *pt_char;
-    fout << std::endl;
-    fout << "        </DataArray>" << std::endl;
-    //------------------------------------------------------------------------------------------------
 
-    //-------------------------------------------------------------------------------------------------
-    //printing offset
-    fout  << "        <DataArray type=\"Int32\" Name=\"offsets\" format=\"binary\">" << std::endl;
-    Pfout << "      <PDataArray type=\"Int32\" Name=\"offsets\" format=\"binary\"/>" << std::endl;
-
-    // point pointer to common memory area buffer of void type;
-    int* var_off = static_cast <int*>( buffer_void );
-    icount = 0;
-    int offset_el = 0;
-    // print offset array
-    for( int iel = elemetOffset; iel < elemetOffsetp1; iel++ ) {
-      offset_el += mesh->GetElementDofNumber( iel, index );
-      var_off[icount] = offset_el;
-      icount++;
-    }
+      //print offset array
+      _cellsBuffer->AppendEncodedArray( &var_off[0], dim_array_off[0] );
 
-    //print offset dimension
-    cch = b64::b64_encode( &dim_array_off[0], sizeof( dim_array_off ), NULL, 0 );
-    b64::b64_encode( &dim_array_off[0], sizeof( dim_array_off ), &enc[0], cch );
-    pt_char = &enc[0];
-    for( unsigned i = 0; i < cch; i++, pt_char++ ) fout << *pt_char;
+      meshOut  << std::endl;
 
-    //print offset array
-    cch = b64::b64_encode( &var_off[0], dim_array_off[0] , NULL, 0 );
-    b64::b64_encode( &var_off[0], dim_array_off[0], &enc[0], cch );
-    pt_char = &enc[0];
-    for( unsigned i = 0; i < cch; i++, pt_char++ ) fout << *pt_char;
+      meshOut  << "        </DataArray>" << std::endl;
 
-    fout  << std::endl;
+      //--------------------------------------------------------------------------------------------------
 
-    fout  << "        </DataArray>" << std::endl;
+      //--------------------------------------------------------------------------------------------------
 
-    //--------------------------------------------------------------------------------------------------
+      //Element format type : 23:Serendipity(8-nodes)  28:Quad9-Biquadratic
+      meshOut  << "        <DataArray type=\"UInt16\" Name=\"types\" format=\"binary\">" << std::endl;
 
-    //--------------------------------------------------------------------------------------------------
+      // point pointer to common mamory area buffer of void type;
+      unsigned short* var_type = static_cast <unsigned short*>( buffer_void );
+      icount = 0;
+      for( int iel = elemetOffset; iel < elemetOffsetp1; iel++ ) {
+        short unsigned ielt = mesh->GetElementType( iel );
+        var_type[icount] = femusToVtkCellType[index][ielt];
+        icount++;
+      }
 
-    //Element format type : 23:Serendipity(8-nodes)  28:Quad9-Biquadratic
-    fout  << "        <DataArray type=\"UInt16\" Name=\"types\" format=\"binary\">" << std::endl;
-    Pfout << "      <PDataArray type=\"UInt16\" Name=\"types\" format=\"binary\"/>" << std::endl;
+      //print element format array
+      _cellsBuffer->AppendEncodedArray( &var_type[0], dim_array_type[0] );
 
-    // point pointer to common mamory area buffer of void type;
-    unsigned short* var_type = static_cast <unsigned short*>( buffer_void );
-    icount = 0;
-    for( int iel = elemetOffset; iel < elemetOffsetp1; iel++ ) {
-      short unsigned ielt = mesh->GetElementType( iel );
-      var_type[icount] = femusToVtkCellType[index][ielt];
-      icount++;
-    }
+      meshOut  << std::endl;
+      meshOut  << "        </DataArray>" << std::endl;
+      //----------------------------------------------------------------------------------------------------
+  //
+      meshOut  << "      </Cells>" << std::endl;
+      //--------------------------------------------------------------------------------------------------
 
-    //print element format dimension
-    cch = b64::b64_encode( &dim_array_type[0], sizeof( dim_array_type ), NULL, 0 );
-    b64::b64_encode( &dim_array_type[0], sizeof( dim_array_type ), &enc[0], cch );
-    pt_char = &enc[0];
-    for( unsigned i = 0; i < cch; i++, pt_char++ ) fout << *pt_char;
-
-    //print element format array
-    cch = b64::b64_encode( &var_type[0], dim_array_type[0] , NULL, 0 );
-    b64::b64_encode( &var_type[0], dim_array_type[0], &enc[0], cch );
-    pt_char = &enc[0];
-    for( unsigned i = 0; i < cch; i++, pt_char++ ) fout << *pt_char;
-
-    fout  << std::endl;
-    fout  << "        </DataArray>" << std::endl;
-    //----------------------------------------------------------------------------------------------------
-//
-    fout  << "      </Cells>" << std::endl;
-    Pfout << "    </PCells>" << std::endl;
-    //--------------------------------------------------------------------------------------------------
+      // /Print Cell Data ****************************************************************************
+      meshOut  << "      <CellData Scalars=\"scalars\">" << std::endl;
 
-    // /Print Cell Data ****************************************************************************
-    fout  << "      <CellData Scalars=\"scalars\">" << std::endl;
-    Pfout << "    <PCellData Scalars=\"scalars\">" << std::endl;
+      unsigned short* var_reg = static_cast <unsigned short*>( buffer_void );
 
-    unsigned short* var_reg = static_cast <unsigned short*>( buffer_void );
+      // Print Metis Partitioning
+      meshOut  << "        <DataArray type=\"UInt16\" Name=\"Metis partition\" format=\"binary\">" << std::endl;
 
-    // Print Metis Partitioning
-    fout  << "        <DataArray type=\"UInt16\" Name=\"Metis partition\" format=\"binary\">" << std::endl;
-    Pfout << "      <PDataArray type=\"UInt16\" Name=\"Metis partition\" format=\"binary\"/>" << std::endl;
+      // point pointer to common mamory area buffer of void type;
+      unsigned short* var_proc = static_cast <unsigned short*>( buffer_void );
 
-    // point pointer to common mamory area buffer of void type;
-    unsigned short* var_proc = static_cast <unsigned short*>( buffer_void );
+      icount = 0;
+      for( int iel = elemetOffset; iel < elemetOffsetp1; iel++ ) {
+        var_proc[icount] = _iproc;
+        icount++;
+      }
 
-    icount = 0;
-    for( int iel = elemetOffset; iel < elemetOffsetp1; iel++ ) {
-      var_proc[icount] = _iproc;
-      icount++;
-    }
+      //print regions array
+      _cellsBuffer->AppendEncodedArray( &var_proc[0], dim_array_reg[0] );
 
-    //print regions dimension
-    cch = b64::b64_encode( &dim_array_reg[0], sizeof( dim_array_reg ), NULL, 0 );
-    b64::b64_encode( &dim_array_reg[0], sizeof( dim_array_reg ), &enc[0], cch );
-    pt_char = &enc[0];
-    for( unsigned i = 0; i < cch; i++, pt_char++ ) fout << *pt_char;
+      meshOut  << std::endl;
+      meshOut  << "        </DataArray>" << std::endl;
 
+      //BEGIN SARA&GIACOMO
 
-    //print regions array
-    cch = b64::b64_encode( &var_proc[0], dim_array_reg[0] , NULL, 0 );
-    b64::b64_encode( &var_proc[0], dim_array_reg[0], &enc[0], cch );
-    pt_char = &enc[0];
-    for( unsigned i = 0; i < cch; i++, pt_char++ ) fout << *pt_char;
+      //-------------------------------------------MATERIAL---------------------------------------------------------
 
-    fout  << std::endl;
-    fout  << "        </DataArray>" << std::endl;
+      //NumericVector& material =  mesh->_topology->GetSolutionName( "Material" );
 
+      meshOut  << "        <DataArray type=\"Float32\" Name=\"" << "Material" << "\" format=\"binary\">" << std::endl;
+      // point pointer to common memory area buffer of void type;
+      float* var_el = static_cast< float*>( buffer_void );
+      icount = 0;
+      for( int iel = elemetOffset; iel < elemetOffsetp1; iel++ ) {
+        var_el[icount] = mesh->GetElementMaterial(iel); 
+        icount++;
+      }
 
-    //BEGIN SARA&GIACOMO
+      //print solution on element array
+      _cellsBuffer->AppendEncodedArray( &var_el[0], dim_array_elvar[0] );
+      meshOut << std::endl;
+      meshOut << "        </DataArray>" << std::endl;
 
+      //------------------------------------------------------GROUP-----------------------------------------------------------
 
-    //-------------------------------------------MATERIAL---------------------------------------------------------
+      //NumericVector& group =  mesh->_topology->GetSolutionName( "Group" );
 
-    //NumericVector& material =  mesh->_topology->GetSolutionName( "Material" );
+      meshOut  << "        <DataArray type=\"Float32\" Name=\"" << "Group" << "\" format=\"binary\">" << std::endl;
+      // point pointer to common memory area buffer of void type;
+      var_el = static_cast< float*>( buffer_void );
+      icount = 0;
+      for( int iel = elemetOffset; iel < elemetOffsetp1; iel++ ) {
+        var_el[icount] = mesh->GetElementGroup(iel);
+        icount++;
+      }
+      //print solution on element array
+      _cellsBuffer->AppendEncodedArray( &var_el[0], dim_array_elvar[0] );
+      meshOut << std::endl;
+      meshOut << "        </DataArray>" << std::endl;
 
-    fout  << "        <DataArray type=\"Float32\" Name=\"" << "Material" << "\" format=\"binary\">" << std::endl;
-    Pfout << "      <PDataArray type=\"Float32\" Name=\"" << "Material" << "\" format=\"binary\"/>" << std::endl;
-    // point pointer to common memory area buffer of void type;
-    float* var_el = static_cast< float*>( buffer_void );
-    icount = 0;
-    for( int iel = elemetOffset; iel < elemetOffsetp1; iel++ ) {
-      var_el[icount] = mesh->GetElementMaterial(iel); 
-      icount++;
-    }
+      //-------------------------------------------------------TYPE--------------------------------------------------
+     // NumericVector& type =  mesh->_topology->GetSolutionName( "Type" );
 
-    //print solution on element dimension
-    cch = b64::b64_encode( &dim_array_elvar[0], sizeof( dim_array_elvar ), NULL, 0 );
-    b64::b64_encode( &dim_array_elvar[0], sizeof( dim_array_elvar ), &enc[0], cch );
-    pt_char = &enc[0];
-    for( unsigned i = 0; i < cch; i++, pt_char++ ) fout << *pt_char;
-    //print solution on element array
-    cch = b64::b64_encode( &var_el[0], dim_array_elvar[0] , NULL, 0 );
-    b64::b64_encode( &var_el[0], dim_array_elvar[0], &enc[0], cch );
-    pt_char = &enc[0];
-    for( unsigned i = 0; i < cch; i++, pt_char++ ) fout << *pt_char;
-    fout << std::endl;
-    fout << "        </DataArray>" << std::endl;
+      meshOut  << "        <DataArray type=\"Float32\" Name=\"" << "TYPE" << "\" format=\"binary\">" << std::endl;
+      // point pointer to common memory area buffer of void type;
+      var_el = static_cast< float*>( buffer_void );
+      icount = 0;
+      for( int iel = elemetOffset; iel < elemetOffsetp1; iel++ ) {
+        var_el[icount] = mesh->GetElementType(iel);
+        icount++;
+      }
+      //print solution on element array
+      _cellsBuffer->AppendEncodedArray( &var_el[0], dim_array_elvar[0] );
+      meshOut << std::endl;
+      meshOut << "        </DataArray>" << std::endl;
 
-    //------------------------------------------------------GROUP-----------------------------------------------------------
+      //-------------------------------------------------------TYPE--------------------------------------------------
+      meshOut  << "      <DataArray type=\"Float32\" Name=\"" << "Level" << "\" format=\"binary\">" << std::endl;
+      // point pointer to common memory area buffer of void type;
+      var_el = static_cast< float*>( buffer_void );
+      icount = 0;
+      for( int iel = elemetOffset; iel < elemetOffsetp1; iel++ ) {
+        var_el[icount] = mesh->el->GetElementLevel(iel);
+        icount++;
+      }
+      //print solution on element array
+      _cellsBuffer->AppendEncodedArray( &var_el[0], dim_array_elvar[0] );
+      meshOut << std::endl;
+      meshOut << "        </DataArray>" << std::endl;
 
-    //NumericVector& group =  mesh->_topology->GetSolutionName( "Group" );
+      //END SARA&GIACOMO
 
-    fout  << "        <DataArray type=\"Float32\" Name=\"" << "Group" << "\" format=\"binary\">" << std::endl;
-    Pfout << "      <PDataArray type=\"Float32\" Name=\"" << "Group" << "\" format=\"binary\"/>" << std::endl;
-    // point pointer to common memory area buffer of void type;
-    var_el = static_cast< float*>( buffer_void );
-    icount = 0;
-    for( int iel = elemetOffset; iel < elemetOffsetp1; iel++ ) {
-      var_el[icount] = mesh->GetElementGroup(iel);
-      icount++;
-    }
-    //print solution on element dimension
-    cch = b64::b64_encode( &dim_array_elvar[0], sizeof( dim_array_elvar ), NULL, 0 );
-    b64::b64_encode( &dim_array_elvar[0], sizeof( dim_array_elvar ), &enc[0], cch );
-    pt_char = &enc[0];
-    for( unsigned i = 0; i < cch; i++, pt_char++ ) fout << *pt_char;
-    //print solution on element array
-    cch = b64::b64_encode( &var_el[0], dim_array_elvar[0] , NULL, 0 );
-    b64::b64_encode( &var_el[0], dim_array_elvar[0], &enc[0], cch );
-    pt_char = &enc[0];
-    for( unsigned i = 0; i < cch; i++, pt_char++ ) fout << *pt_char;
-    fout << std::endl;
-    fout << "        </DataArray>" << std::endl;
-
-    //-------------------------------------------------------TYPE--------------------------------------------------
-   // NumericVector& type =  mesh->_topology->GetSolutionName( "Type" );
-
-    fout  << "        <DataArray type=\"Float32\" Name=\"" << "TYPE" << "\" format=\"binary\">" << std::endl;
-    Pfout << "      <PDataArray type=\"Float32\" Name=\"" << "TYPE" << "\" format=\"binary\"/>" << std::endl;
-    // point pointer to common memory area buffer of void type;
-    var_el = static_cast< float*>( buffer_void );
-    icount = 0;
-    for( int iel = elemetOffset; iel < elemetOffsetp1; iel++ ) {
-      var_el[icount] = mesh->GetElementType(iel);
-      icount++;
+      if( _cachedMeshOutput ) {
+        _cellsBuffer->Encode();
+        _cachedMeshId = mesh->GetMeshId();
+        _cachedMeshIndex = index;
+      }
     }
-    //print solution on element dimension
-    cch = b64::b64_encode( &dim_array_elvar[0], sizeof( dim_array_elvar ), NULL, 0 );
-    b64::b64_encode( &dim_array_elvar[0], sizeof( dim_array_elvar ), &enc[0], cch );
-    pt_char = &enc[0];
-    for( unsigned i = 0; i < cch; i++, pt_char++ ) fout << *pt_char;
-    //print solution on element array
-    cch = b64::b64_encode( &var_el[0], dim_array_elvar[0] , NULL, 0 );
-    b64::b64_encode( &var_el[0], dim_array_elvar[0], &enc[0], cch );
-    pt_char = &enc[0];
-    for( unsigned i = 0; i < cch; i++, pt_char++ ) fout << *pt_char;
-    fout << std::endl;
-    fout << "        </DataArray>" << std::endl;
-
-    
-    //-------------------------------------------------------TYPE--------------------------------------------------
-    fout  << "      <DataArray type=\"Float32\" Name=\"" << "Level" << "\" format=\"binary\">" << std::endl;
-    Pfout << "      <PDataArray type=\"Float32\" Name=\"" << "Level" << "\" format=\"binary\"/>" << std::endl;
-    // point pointer to common memory area buffer of void type;
-    var_el = static_cast< float*>( buffer_void );
-    icount = 0;
-    for( int iel = elemetOffset; iel < elemetOffsetp1; iel++ ) {
-      var_el[icount] = mesh->el->GetElementLevel(iel);
-      icount++;
+    vtuBuffer->Append( *_cellsBuffer );
+
+    if( !_cachedMeshOutput ) {
+      delete _pointsBuffer;
+      _pointsBuffer = NULL;
+      delete _cellsBuffer;
+      _cellsBuffer = NULL;
     }
-    //print solution on element dimension
-    cch = b64::b64_encode( &dim_array_elvar[0], sizeof( dim_array_elvar ), NULL, 0 );
-    b64::b64_encode( &dim_array_elvar[0], sizeof( dim_array_elvar ), &enc[0], cch );
-    pt_char = &enc[0];
-    for( unsigned i = 0; i < cch; i++, pt_char++ ) fout << *pt_char;
-    //print solution on element array
-    cch = b64::b64_encode( &var_el[0], dim_array_elvar[0] , NULL, 0 );
-    b64::b64_encode( &var_el[0], dim_array_elvar[0], &enc[0], cch );
-    pt_char = &enc[0];
-    for( unsigned i = 0; i < cch; i++, pt_char++ ) fout << *pt_char;
-    fout << std::endl;
-    fout << "        </DataArray>" << std::endl;
-    
-    
-    //END SARA&GIACOMO
 
     if( _ml_sol == NULL ) {
-      delete [] var_proc;
+      delete [] static_cast < char* >( buffer_void );
     }
 
     bool print_all = 0;
@@ -561,17 +519,8 @@ namespace femus {
               icount++;
             }
 
-            //print solution on element dimension
-            cch = b64::b64_encode( &dim_array_elvar[0], sizeof( dim_array_elvar ), NULL, 0 );
-            b64::b64_encode( &dim_array_elvar[0], sizeof( dim_array_elvar ), &enc[0], cch );
-            pt_char = &enc[0];
-            for( unsigned i = 0; i < cch; i++, pt_char++ ) fout << *pt_char;
-
             //print solution on element array
-            cch = b64::b64_encode( &var_el[0], dim_array_elvar[0] , NULL, 0 );
-            b64::b64_encode( &var_el[0], dim_array_elvar[0], &enc[0], cch );
-            pt_char = &enc[0];
-            for( unsigned i = 0; i < cch; i++, pt_char++ ) fout << *pt_char;
+            vtuBuffer->AppendEncodedArray( &var_el[0], dim_array_elvar[0] );
             fout << std::endl;
             fout << "        </DataArray>" << std::endl;
           }
@@ -609,12 +558,6 @@ namespace femus {
             fout  << "        <DataArray type=\"Float32\" Name=\"" << printName << "\" format=\"binary\">" << std::endl;
             Pfout << "      <PDataArray type=\"Float32\" Name=\"" << printName << "\" format=\"binary\"/>" << std::endl;
 
-            //print solutions on nodes dimension
-            cch = b64::b64_encode( &dim_array_ndvar[0], sizeof( dim_array_ndvar ), NULL, 0 );
-            b64::b64_encode( &dim_array_ndvar[0], sizeof( dim_array_ndvar ), &enc[0], cch );
-            pt_char = &enc[0];
-            for( unsigned i = 0; i < cch; i++, pt_char++ ) fout << *pt_char;
-
             unsigned offset_iprc = mesh->_dofOffset[index][_iproc];
             unsigned nvt_ig = mesh->_ownSize[index][_iproc];
 
@@ -640,10 +583,7 @@ namespace femus {
               var_nd[ offset_ig + it->second ] = ( *mysol )( it->first );
             }
 
-            cch = b64::b64_encode( &var_nd[0], dim_array_ndvar [0], NULL, 0 );
-            b64::b64_encode( &var_nd[0], dim_array_ndvar [0], &enc[0], cch );
-            pt_char = &enc[0];
-            for( unsigned i = 0; i < cch; i++, pt_char++ ) fout << *pt_char;
+            vtuBuffer->AppendEncodedArray( &var_nd[0], dim_array_ndvar[0] );
             fout << std::endl;
 
             fout  << "        </DataArray>" << std::endl;
@@ -660,13 +600,12 @@ namespace femus {
     fout << "    </Piece>" << std::endl;
     fout << "  </UnstructuredGrid>" << std::endl;
     fout << "</VTKFile>" << std::endl;
-    fout.close();
+    WriteOutputBuffer( vtuBuffer, filename.str() );
 
     Pfout << "  </PUnstructuredGrid>" << std::endl;
     Pfout << "</VTKFile>" << std::endl;
     Pfout.close();
 
-
     //-----------------------------------------------------------------------------------------------------
     //free memory
     delete mysol;
@@ -677,4 +616,3 @@ namespace femus {
 
 } //end namespace femus
 
-
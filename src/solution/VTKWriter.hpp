@@ -58,6 +58,12 @@ public:
 
     bool _debugOutput;
 
+    /** staged points and cells of the vtu file, kept between the time steps with the cached mesh output */
+    OutputBuffer* _pointsBuffer;
+    OutputBuffer* _cellsBuffer;
+    int _cachedMeshId;
+    unsigned _cachedMeshIndex;
+
     /** femus to vtk cell type map */
     static short unsigned int femusToVtkCellType[3][6];
     static short unsigned int elementDofNumber[3][6];
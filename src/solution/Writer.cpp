@@ -28,6 +28,7 @@
 #include "VTKWriter.hpp"
 #include "GMVWriter.hpp"
 #include "XDMFWriter.hpp"
+#include "AsyncOutputQueue.hpp"
 
 
 
@@ -43,6 +44,8 @@ namespace femus {
     _moving_mesh = 0;
     _graph = false;
     _surface = false;
+    _asyncOutputQueue = NULL;
+    _cachedMeshOutput = false;
   }
 
   Writer::Writer( MultiLevelMesh* ml_mesh ):
@@ -52,9 +55,38 @@ namespace femus {
     _moving_mesh = 0;
     _graph = false;
     _surface = false;
+    _asyncOutputQueue = NULL;
+    _cachedMeshOutput = false;
   }
 
-  Writer::~Writer() { }
+  Writer::~Writer() {
+    if( _asyncOutputQueue != NULL ) delete _asyncOutputQueue;
+  }
+
+
+  void Writer::SetAsynchronousOutput( const bool &value, const unsigned &maxQueueSize ) {
+    if( _asyncOutputQueue != NULL ) {
+      delete _asyncOutputQueue;
+      _asyncOutputQueue = NULL;
+    }
+    if( value ) _asyncOutputQueue = new AsyncOutputQueue( maxQueueSize );
+  }
+
+
+  void Writer::Flush() {
+    if( _asyncOutputQueue != NULL ) _asyncOutputQueue->Flush();
+  }
+
+
+  void Writer::WriteOutputBuffer( OutputBuffer* buffer, const std::string &filename ) {
+    if( _asyncOutputQueue != NULL ) {
+      _asyncOutputQueue->Push( buffer, filename );
+    }
+    else {
+      buffer->WriteToFile( filename );
+      delete buffer;
+    }
+  }
 
 
   std::unique_ptr<Writer> Writer::build(const WriterEnum format, MultiLevelSolution * ml_sol)  {
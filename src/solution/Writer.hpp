@@ -36,6 +36,8 @@ namespace femus {
   class MultiLevelSolution;
   class SparseMatrix;
   class Vector;
+  class OutputBuffer;
+  class AsyncOutputQueue;
 
 
   class Writer : public ParallelObject {
@@ -72,6 +74,19 @@ namespace femus {
     void SetSurfaceVariables( std::vector < std::string > &surfaceVariable );
     void UnsetSurfaceVariables(){ _surface = false;};
 
+    /** Asynchronous output: Write copies the fields in staging buffers and returns, the encoding and the file I/O
+     * are done by a background thread. At most maxQueueSize files per process wait to be written */
+    void SetAsynchronousOutput( const bool &value, const unsigned &maxQueueSize = 2 );
+
+    /** Waits until the files of the asynchronous output have been written */
+    void Flush();
+
+    /** Cached mesh output: the topology, and the geometry if the mesh is not moving (see SetMovingMesh), is built
+     * once per mesh and reused by the following time steps */
+    void SetCachedMeshOutput( const bool &value ) {
+      _cachedMeshOutput = value;
+    }
+
   protected:
 
     /** a flag to move the output mesh */
@@ -98,6 +113,15 @@ namespace femus {
     /** map from femus connectivity to vtk-connectivity for paraview visualization */
     static const unsigned FemusToVTKorToXDMFConn[27];
 
+    /** Writes buffer to filename, in the background with the asynchronous output. It takes the ownership of buffer */
+    void WriteOutputBuffer( OutputBuffer* buffer, const std::string &filename );
+
+    /** the queue of the asynchronous output, NULL for the synchronous output */
+    AsyncOutputQueue* _asyncOutputQueue;
+
+    /** a flag to reuse the mesh output of the previous time steps */
+    bool _cachedMeshOutput;
+
 
 
   private:
@@ -20,10 +20,12 @@
 #include "XDMFWriter.hpp"
 #include "MultiLevelProblem.hpp"
 #include "NumericVector.hpp"
+#include "Profiler.hpp"
 #include <cstdio>
 #include <fstream>
 #include <iostream>
 #include <algorithm>
+#include <climits>
 #include <cstring>
 #include <sstream>
 #include <iomanip>
@@ -55,10 +57,16 @@ namespace femus {
 
   XDMFWriter::XDMFWriter( MultiLevelSolution* ml_sol ) : Writer( ml_sol ) {
     _debugOutput = false;
+    _parallelHDF5 = true;
+    _hdf5ChunkSize = 0;
+    _hdf5CompressionLevel = 0;
   }
 
   XDMFWriter::XDMFWriter( MultiLevelMesh* ml_mesh ) : Writer( ml_mesh ) {
     _debugOutput = false;
+    _parallelHDF5 = true;
+    _hdf5ChunkSize = 0;
+    _hdf5CompressionLevel = 0;
   }
 
   XDMFWriter::~XDMFWriter() {}
@@ -67,6 +75,8 @@ namespace femus {
 
 #ifdef HAVE_HDF5
 
+    ProfilerRegion outputRegion("Output");
+
     bool print_all = 0;
     for( unsigned ivar = 0; ivar < vars.size(); ivar++ ) {
       print_all += !( vars[ivar].compare( "All" ) ) + !( vars[ivar].compare( "all" ) ) + !( vars[ivar].compare( "ALL" ) );
@@ -87,9 +97,12 @@ namespace femus {
     Solution* solution = _ml_sol->GetSolutionLevel( _gridn - 1 );
 
     /// @todo I assume that the mesh is not mixed
+    // the element type of the first element of the lowest rank with elements: a rank may own no elements
     std::string type_elem;
     unsigned iel0 = mesh->_elementOffset[_iproc];
-    unsigned elemtype = mesh->GetElementType( iel0 );
+    unsigned localElemtype = ( iel0 < mesh->_elementOffset[_iproc + 1] ) ? mesh->GetElementType( iel0 ) : UINT_MAX;
+    unsigned elemtype;
+    MPI_Allreduce( &localElemtype, &elemtype, 1, MPI_UNSIGNED, MPI_MIN, MPI_COMM_WORLD );
 
     type_elem = XDMFWriter::type_el[index_nd][elemtype];
 
@@ -147,6 +160,23 @@ namespace femus {
     hdf5_filename2 << filename_prefix << ".level" << _gridn << "." << time_step << "." << order << ".h5";
     hdf5_filename << output_path << "/" <<  hdf5_filename2.str();
 
+    // with the cached mesh output the topology, and the geometry of a fixed mesh, are printed once per mesh
+    // in a shared HDF5 file, the time steps refer to its datasets
+    bool movingMesh = ( _ml_sol != NULL && _moving_mesh );
+    std::ostringstream mesh_filename;
+    std::ostringstream mesh_filename2;
+    if( _cachedMeshOutput ) {
+      mesh_filename2 << filename_prefix << ".level" << _gridn << ".mesh" << mesh->GetMeshId() << "." << order << ".h5";
+    }
+    else {
+      mesh_filename2 << hdf5_filename2.str();
+    }
+    mesh_filename << output_path << "/" <<  mesh_filename2.str();
+    std::string geometry_filename2 = ( movingMesh ) ? hdf5_filename2.str() : mesh_filename2.str();
+    // the mesh file name contains path, prefix, level, mesh id and order: a mesh file written under another name is not reused
+    bool printMesh = !_cachedMeshOutput || _cachedMeshFile[index_nd] != mesh_filename.str();
+    bool printCoordinates = printMesh || movingMesh;
+
     // head ************************************************
     fout << "<?xml version=\"1.0\" ?>" << std::endl;
     fout << "<!DOCTYPE Xdmf SYSTEM \"Xdmf.dtd []\">" << std::endl;
@@ -157,27 +187,27 @@ namespace femus {
     fout << "<Topology Type=\"" << type_elem << "\" Dimensions=\"" << nel << "\">" << std::endl;
     //Connectivity
     fout << "<DataStructure DataType=\"Int\" Dimensions=\"" << nel << " " << ndofs << "\"" << "  Format=\"HDF\">" << std::endl;
-    fout << hdf5_filename2.str() << ":/CONNECTIVITY" << std::endl;
+    fout << mesh_filename2.str() << ":/CONNECTIVITY" << std::endl;
     fout << "</DataStructure>" << std::endl;
     fout << "</Topology>" << std::endl;
     fout << "<Geometry Type=\"X_Y_Z\">" << std::endl;
     //Node_X
     fout << "<DataStructure DataType=\"Double\" Precision=\"8\" Dimensions=\"" << nvt << "  1\"" << "  Format=\"HDF\">" << std::endl;
-    fout << hdf5_filename2.str() << ":/NODES_X1" << std::endl;
+    fout << geometry_filename2 << ":/NODES_X1" << std::endl;
     fout << "</DataStructure>" << std::endl;
     //Node_Y
     fout << "<DataStructure DataType=\"Double\" Precision=\"8\" Dimensions=\"" << nvt << "  1\"" << "  Format=\"HDF\">" << std::endl;
-    fout << hdf5_filename2.str() << ":/NODES_X2" << std::endl;
+    fout << geometry_filename2 << ":/NODES_X2" << std::endl;
     fout << "</DataStructure>" << std::endl;
     //Node_Z
     fout << "<DataStructure DataType=\"Double\" Precision=\"8\" Dimensions=\"" << nvt << "  1\"" << "  Format=\"HDF\">" << std::endl;
-    fout << hdf5_filename2.str() << ":/NODES_X3" << std::endl;
+    fout << geometry_filename2 << ":/NODES_X3" << std::endl;
     fout << "</DataStructure>" << std::endl;
     fout << "</Geometry>" << std::endl;
     //Metis partitions
     fout << "<Attribute Name=\"" << "Domain_partitions" << "\" AttributeType=\"Scalar\" Center=\"Cell\">" << std::endl;
     fout << "<DataItem DataType=\"Double\" Dimensions=\"" << nel << "  1\""  << "  Format=\"HDF\">" << std::endl;
-    fout << hdf5_filename2.str() << ":/DOMAIN_PARTITIONS" << std::endl;
+    fout << mesh_filename2.str() << ":/DOMAIN_PARTITIONS" << std::endl;
     fout << "</DataItem>" << std::endl;
     fout << "</Attribute>" << std::endl;
 
@@ -188,7 +218,7 @@ namespace femus {
         //Printing biquadratic solution on the nodes
         if( _ml_sol->GetSolutionType( indx ) < 3 ) {
           std::string solName =  _ml_sol->GetSolutionName( indx );
-          for( int name = 0; name < 1 + 3 * _debugOutput * solution->_ResEpsBdcFlag[i]; name++ ) {
+          for( int name = 0; name < 1 + 3 * _debugOutput * solution->_ResEpsBdcFlag[indx]; name++ ) {
             std::string printName;
             if( name == 0 ) printName = solName;
             else if( name == 1 ) printName = "Bdc" + solName;
@@ -203,7 +233,7 @@ namespace femus {
         }
         else if( _ml_sol->GetSolutionType( indx ) >= 3 ) {   //Printing picewise constant solution on the element
           std::string solName =  _ml_sol->GetSolutionName( indx );
-          for( int name = 0; name < 1 + 3 * _debugOutput * solution->_ResEpsBdcFlag[i]; name++ ) {
+          for( int name = 0; name < 1 + 3 * _debugOutput * solution->_ResEpsBdcFlag[indx]; name++ ) {
             std::string printName;
             if( name == 0 ) printName = solName;
             else if( name == 1 ) printName = "Bdc" + solName;
@@ -227,15 +257,25 @@ namespace femus {
     //END XMF FILE PRINT
 
     //BEGIN HD5 FILE PRINT
+#ifdef H5_HAVE_PARALLEL
+    if( _parallelHDF5 && _nprocs > 1 ) {
+      ParallelHDF5Write( hdf5_filename.str(), mesh_filename.str(), printMesh, index_nd, elemtype, print_all, vars, numVector );
+      if( _cachedMeshOutput ) _cachedMeshFile[index_nd] = mesh_filename.str();
+      delete numVector;
+      return;
+    }
+#endif
+
     hid_t file_id;
     if( _iproc == 0 ) file_id = H5Fcreate( hdf5_filename.str().c_str(), H5F_ACC_TRUNC, H5P_DEFAULT, H5P_DEFAULT );
-    hsize_t dimsf[2];
-    herr_t status;
-    hid_t dataspace;
-    hid_t dataset;
+    hid_t mesh_file_id = file_id;
+    if( _iproc == 0 && _cachedMeshOutput && printMesh ) {
+      mesh_file_id = H5Fcreate( mesh_filename.str().c_str(), H5F_ACC_TRUNC, H5P_DEFAULT, H5P_DEFAULT );
+    }
+    hid_t coordinates_file_id = ( movingMesh ) ? file_id : mesh_file_id;
 
     //BEGIN COORDINATES
-    for( int i = 0; i < 3; i++ ) {
+    for( int i = 0; i < 3 * printCoordinates; i++ ) {
       numVector->matrix_mult( *mesh->_topology->_Sol[i], *mesh->GetQitoQjProjection( index_nd, 2 ) );
       numVector->localize_to_one( vector1, 0 );
 
@@ -250,23 +290,16 @@ namespace femus {
       }
 
       if( _iproc == 0 ) {
-        dimsf[0] = nvt ;
-        dimsf[1] = 1;
         std::ostringstream Name;
         Name << "/NODES_X" << i + 1;
-        dataspace = H5Screate_simple( 2, dimsf, NULL );
-        dataset   = H5Dcreate( file_id, Name.str().c_str(), H5T_NATIVE_DOUBLE,
-                               dataspace, H5P_DEFAULT, H5P_DEFAULT, H5P_DEFAULT );
-        status = H5Dwrite( dataset, H5T_NATIVE_DOUBLE, H5S_ALL, H5S_ALL, H5P_DEFAULT, &vector1[0] );
-        H5Sclose( dataspace );
-        H5Dclose( dataset );
+        WriteHDF5Dataset( coordinates_file_id, H5P_DEFAULT, Name.str(), H5T_NATIVE_DOUBLE, nvt, 0, nvt, &vector1[0] );
       }
     } //end 3d loop
     //END COORDINATES
 
     //BEGIN CONNETTIVITY
     unsigned icount = 0;
-    for( unsigned isdom = 0; isdom < _nprocs; isdom++ ) {
+    for( unsigned isdom = 0; isdom < _nprocs * printMesh; isdom++ ) {
       mesh->el->LocalizeElementDof( isdom );
       if( _iproc == 0 ) {
         for( unsigned iel = mesh->_elementOffset[isdom]; iel < mesh->_elementOffset[isdom + 1]; iel++ ) {
@@ -280,21 +313,14 @@ namespace femus {
       mesh->el->FreeLocalizedElementDof();
     }
 
-    if(_iproc == 0) {
-      dimsf[0] = nel * ndofs ;
-      dimsf[1] = 1;
-      dataspace = H5Screate_simple( 2, dimsf, NULL );
-      dataset   = H5Dcreate( file_id, "/CONNECTIVITY", H5T_NATIVE_INT,
-                             dataspace, H5P_DEFAULT, H5P_DEFAULT, H5P_DEFAULT );
-      status   = H5Dwrite( dataset, H5T_NATIVE_INT, H5S_ALL, H5S_ALL, H5P_DEFAULT, &var_conn[0] );
-      H5Sclose( dataspace );
-      H5Dclose( dataset );
+    if(_iproc == 0 && printMesh) {
+      WriteHDF5Dataset( mesh_file_id, H5P_DEFAULT, "/CONNECTIVITY", H5T_NATIVE_INT, nel * ndofs, 0, nel * ndofs, &var_conn[0] );
     }
 
     //END CONNETTIVITY
 
     //BEGIN METIS PARTITIONING
-    if( _iproc == 0 ) {
+    if( _iproc == 0 && printMesh ) {
       unsigned icount = 0;
       for( int isdom = 0; isdom < _nprocs; isdom++ ) {
         for( unsigned ii = mesh->_elementOffset[isdom]; ii < mesh->_elementOffset[isdom + 1]; ii++ ) {
@@ -302,14 +328,7 @@ namespace femus {
           icount++;
         }
       }
-      dimsf[0] = nel;
-      dimsf[1] = 1;
-      dataspace = H5Screate_simple( 2, dimsf, NULL );
-      dataset   = H5Dcreate( file_id, "/DOMAIN_PARTITIONS", H5T_NATIVE_DOUBLE,
-                             dataspace, H5P_DEFAULT, H5P_DEFAULT, H5P_DEFAULT );
-      status   = H5Dwrite( dataset, H5T_NATIVE_DOUBLE, H5S_ALL, H5S_ALL, H5P_DEFAULT, &vector1[0] );
-      H5Sclose( dataspace );
-      H5Dclose( dataset );
+      WriteHDF5Dataset( mesh_file_id, H5P_DEFAULT, "/DOMAIN_PARTITIONS", H5T_NATIVE_DOUBLE, nel, 0, nel, &vector1[0] );
     }
     //END METIS PARTITIONING
 
@@ -319,7 +338,7 @@ namespace femus {
       for( unsigned i = 0; i < ( 1 - print_all ) *vars.size() + print_all * _ml_sol->GetSolutionSize(); i++ ) {
         unsigned indx = ( print_all == 0 ) ? _ml_sol->GetIndex( vars[i].c_str() ) : i;
         if( _ml_sol->GetSolutionType( indx ) >= 3 ) {
-          for( int name = 0; name < 1 + 3 * _debugOutput * solution->_ResEpsBdcFlag[i]; name++ ) {
+          for( int name = 0; name < 1 + 3 * _debugOutput * solution->_ResEpsBdcFlag[indx]; name++ ) {
 
             std::string solName =  _ml_sol->GetSolutionName( indx );
             std::string printName;
@@ -346,14 +365,7 @@ namespace femus {
             }
 
             if( _iproc == 0 ) {
-              dimsf[0] = nel;
-              dimsf[1] = 1;
-              dataspace = H5Screate_simple( 2, dimsf, NULL );
-              dataset   = H5Dcreate( file_id, printName.c_str(), H5T_NATIVE_DOUBLE,
-                                     dataspace, H5P_DEFAULT, H5P_DEFAULT, H5P_DEFAULT );
-              status   = H5Dwrite( dataset, H5T_NATIVE_DOUBLE, H5S_ALL, H5S_ALL, H5P_DEFAULT, &vector1[0] );
-              H5Sclose( dataspace );
-              H5Dclose( dataset );
+              WriteHDF5Dataset( file_id, H5P_DEFAULT, printName, H5T_NATIVE_DOUBLE, nel, 0, nel, &vector1[0] );
             }
           }
         }
@@ -364,7 +376,7 @@ namespace femus {
       for( unsigned i = 0; i < ( 1 - print_all ) *vars.size() + print_all * _ml_sol->GetSolutionSize(); i++ ) {
         unsigned indx = ( print_all == 0 ) ? _ml_sol->GetIndex( vars[i].c_str() ) : i;
         if( _ml_sol->GetSolutionType( indx ) < 3 ) {
-          for( int name = 0; name < 1 + 3 * _debugOutput * solution->_ResEpsBdcFlag[i]; name++ ) {
+          for( int name = 0; name < 1 + 3 * _debugOutput * solution->_ResEpsBdcFlag[indx]; name++ ) {
 
             std::string solName =  _ml_sol->GetSolutionName( indx );
             std::string printName;
@@ -392,14 +404,7 @@ namespace femus {
             numVector->localize_to_one( vector1, 0 );
 
             if( _iproc == 0 ) {
-              dimsf[0] = nvt;
-              dimsf[1] = 1;
-              dataspace = H5Screate_simple( 2, dimsf, NULL );
-              dataset   = H5Dcreate( file_id, printName.c_str(), H5T_NATIVE_DOUBLE,
-                                     dataspace, H5P_DEFAULT, H5P_DEFAULT, H5P_DEFAULT );
-              status   = H5Dwrite( dataset, H5T_NATIVE_DOUBLE, H5S_ALL, H5S_ALL, H5P_DEFAULT, &vector1[0] );
-              H5Sclose( dataspace );
-              H5Dclose( dataset );
+              WriteHDF5Dataset( file_id, H5P_DEFAULT, printName, H5T_NATIVE_DOUBLE, nvt, 0, nvt, &vector1[0] );
             }
           }
         }
@@ -409,6 +414,8 @@ namespace femus {
     //END SOLUTION
 
     if( _iproc == 0 ) H5Fclose( file_id );
+    if( _iproc == 0 && _cachedMeshOutput && printMesh ) H5Fclose( mesh_file_id );
+    if( _cachedMeshOutput ) _cachedMeshFile[index_nd] = mesh_filename.str();
 
     //END HD5 FILE PRINT
 
@@ -419,6 +426,192 @@ namespace femus {
     return;
   }
 
+
+  void XDMFWriter::ParallelHDF5Write( const std::string &hdf5_filename, const std::string &mesh_filename, const bool &printMesh,
+                                      const unsigned &index_nd, const unsigned &elemtype, const bool &print_all,
+                                      const std::vector < std::string >& vars, NumericVector* numVector ) {
+
+#ifdef H5_HAVE_PARALLEL
+
+    Mesh* mesh = _ml_mesh->GetLevel( _gridn - 1 );
+    Solution* solution = ( _ml_sol != NULL ) ? _ml_sol->GetSolutionLevel( _gridn - 1 ) : NULL;
+
+    unsigned nvt = mesh->_dofOffset[index_nd][_nprocs];
+    unsigned nel = mesh->GetNumberOfElements();
+    unsigned dim = mesh->GetDimension();
+    unsigned ndofs = mesh->el->GetNVE( elemtype, index_nd );
+
+    // owned rows of the node and element datasets
+    unsigned nodeOffset = mesh->_dofOffset[index_nd][_iproc];
+    unsigned nodeSize = mesh->_dofOffset[index_nd][_iproc + 1] - nodeOffset;
+    unsigned elementOffset = mesh->_elementOffset[_iproc];
+    unsigned elementSize = mesh->_elementOffset[_iproc + 1] - elementOffset;
+
+    std::vector < double > vector1( ( nodeSize > elementSize ) ? nodeSize + 1 : elementSize + 1 );
+    std::vector < int > var_conn( elementSize * ndofs + 1 );
+
+    bool movingMesh = ( _ml_sol != NULL && _moving_mesh );
+    bool separateMeshFile = ( mesh_filename != hdf5_filename );
+
+    hid_t plist_id = H5Pcreate( H5P_FILE_ACCESS );
+    H5Pset_fapl_mpio( plist_id, MPI_COMM_WORLD, MPI_INFO_NULL );
+    hid_t file_id = H5Fcreate( hdf5_filename.c_str(), H5F_ACC_TRUNC, H5P_DEFAULT, plist_id );
+    hid_t mesh_file_id = file_id;
+    if( separateMeshFile && printMesh ) {
+      mesh_file_id = H5Fcreate( mesh_filename.c_str(), H5F_ACC_TRUNC, H5P_DEFAULT, plist_id );
+    }
+    hid_t coordinates_file_id = ( movingMesh ) ? file_id : mesh_file_id;
+    H5Pclose( plist_id );
+
+    hid_t xferList = H5Pcreate( H5P_DATASET_XFER );
+    H5Pset_dxpl_mpio( xferList, H5FD_MPIO_COLLECTIVE );
+
+    //BEGIN COORDINATES
+    for( int i = 0; i < 3 * ( printMesh || movingMesh ); i++ ) {
+      numVector->matrix_mult( *mesh->_topology->_Sol[i], *mesh->GetQitoQjProjection( index_nd, 2 ) );
+      for( unsigned ii = 0; ii < nodeSize; ii++ ) {
+        vector1[ii] = ( *numVector )( nodeOffset + ii );
+      }
+
+      if( _ml_sol != NULL && _moving_mesh && dim > i ) {
+        unsigned varind_DXDYDZ = _ml_sol->GetIndex( _moving_vars[i].c_str() );
+        numVector->matrix_mult( *solution->_Sol[varind_DXDYDZ],
+                                *mesh->GetQitoQjProjection( index_nd, _ml_sol->GetSolutionType( varind_DXDYDZ ) ) );
+        for( unsigned ii = 0; ii < nodeSize; ii++ ) {
+          vector1[ii] += ( *numVector )( nodeOffset + ii );
+        }
+      }
+
+      std::ostringstream Name;
+      Name << "/NODES_X" << i + 1;
+      WriteHDF5Dataset( coordinates_file_id, xferList, Name.str(), H5T_NATIVE_DOUBLE, nvt, nodeOffset, nodeSize, &vector1[0] );
+    }
+    //END COORDINATES
+
+    if( printMesh ) {
+      //BEGIN CONNETTIVITY
+      unsigned icount = 0;
+      for( unsigned iel = elementOffset; iel < elementOffset + elementSize; iel++ ) {
+        for( unsigned j = 0; j < ndofs; j++ ) {
+          unsigned vtk_loc_conn = FemusToVTKorToXDMFConn[j];
+          var_conn[icount] = mesh->GetSolutionDof( vtk_loc_conn, iel, index_nd );
+          icount++;
+        }
+      }
+      WriteHDF5Dataset( mesh_file_id, xferList, "/CONNECTIVITY", H5T_NATIVE_INT, nel * ndofs, elementOffset * ndofs, elementSize * ndofs, &var_conn[0] );
+      //END CONNETTIVITY
+
+      //BEGIN METIS PARTITIONING
+      for( unsigned ii = 0; ii < elementSize; ii++ ) {
+        vector1[ii] = _iproc;
+      }
+      WriteHDF5Dataset( mesh_file_id, xferList, "/DOMAIN_PARTITIONS", H5T_NATIVE_DOUBLE, nel, elementOffset, elementSize, &vector1[0] );
+      //END METIS PARTITIONING
+    }
+
+    //BEGIN SOLUTION
+    if( _ml_sol != NULL )  {
+      for( unsigned i = 0; i < ( 1 - print_all ) *vars.size() + print_all * _ml_sol->GetSolutionSize(); i++ ) {
+        unsigned indx = ( print_all == 0 ) ? _ml_sol->GetIndex( vars[i].c_str() ) : i;
+        unsigned solType = _ml_sol->GetSolutionType( indx );
+        for( int name = 0; name < 1 + 3 * _debugOutput * solution->_ResEpsBdcFlag[indx]; name++ ) {
+
+          std::string solName =  _ml_sol->GetSolutionName( indx );
+          std::string printName;
+          NumericVector* printVector;
+          if( name == 0 ) {
+            printVector = solution->_Sol[indx];
+            printName = solName;
+          }
+          else if( name == 1 ) {
+            printVector = solution->_Bdc[indx];
+            printName = "Bdc" + solName;
+          }
+          else if( name == 2 ) {
+            printVector = solution->_Res[indx];
+            printName = "Res" + solName;
+          }
+          else {
+            printVector = solution->_Eps[indx];
+            printName = "Eps" + solName;
+          }
+
+          if( solType >= 3 ) {   // discontinuous solution, the dofs of the owned elements are owned
+            for( unsigned ii = 0; ii < elementSize; ii++ ) {
+              vector1[ii] = ( *printVector )( mesh->GetSolutionDof( 0, elementOffset + ii, solType ) );
+            }
+            WriteHDF5Dataset( file_id, xferList, printName, H5T_NATIVE_DOUBLE, nel, elementOffset, elementSize, &vector1[0] );
+          }
+          else {   // lagrangian solution, projected on the output nodes
+            numVector->matrix_mult( *printVector, *mesh->GetQitoQjProjection( index_nd, solType ) );
+            for( unsigned ii = 0; ii < nodeSize; ii++ ) {
+              vector1[ii] = ( *numVector )( nodeOffset + ii );
+            }
+            WriteHDF5Dataset( file_id, xferList, printName, H5T_NATIVE_DOUBLE, nvt, nodeOffset, nodeSize, &vector1[0] );
+          }
+        }
+      }
+    }
+    //END SOLUTION
+
+    H5Pclose( xferList );
+    H5Fclose( file_id );
+    if( separateMeshFile && printMesh ) H5Fclose( mesh_file_id );
+
+#endif
+
+    return;
+  }
+
+
+  void XDMFWriter::WriteHDF5Dataset( hid_t file_id, hid_t xferList, const std::string &name, hid_t memType,
+                                     const hsize_t &globalSize, const hsize_t &offset, const hsize_t &localSize, const void* data ) const {
+
+#ifdef HAVE_HDF5
+
+    hsize_t dimsf[2] = {globalSize, 1};
+    hid_t filespace = H5Screate_simple( 2, dimsf, NULL );
+
+    hid_t createList = H5P_DEFAULT;
+    unsigned compressionLevel = _hdf5CompressionLevel;
+#if defined(H5_HAVE_PARALLEL) && !H5_VERSION_GE(1,10,2)
+    // filters in parallel HDF5 are supported only from version 1.10.2
+    if( xferList != H5P_DEFAULT ) compressionLevel = 0;
+#endif
+    if( ( _hdf5ChunkSize > 0 || compressionLevel > 0 ) && globalSize > 0 ) {
+      hsize_t chunkdims[2] = {( _hdf5ChunkSize > 0 ) ? _hdf5ChunkSize : 65536, 1};
+      if( chunkdims[0] > globalSize ) chunkdims[0] = globalSize;
+      createList = H5Pcreate( H5P_DATASET_CREATE );
+      H5Pset_chunk( createList, 2, chunkdims );
+      if( compressionLevel > 0 ) H5Pset_deflate( createList, ( compressionLevel < 9 ) ? compressionLevel : 9 );
+    }
+
+    hid_t dataset = H5Dcreate( file_id, name.c_str(), memType, filespace, H5P_DEFAULT, createList, H5P_DEFAULT );
+
+    // every rank takes part in the collective write, also with no rows
+    hsize_t start[2] = {offset, 0};
+    hsize_t count[2] = {localSize, 1};
+    hsize_t memdims[2] = {( localSize > 0 ) ? localSize : 1, 1};
+    hid_t memspace = H5Screate_simple( 2, memdims, NULL );
+    if( localSize > 0 ) {
+      H5Sselect_hyperslab( filespace, H5S_SELECT_SET, start, NULL, count, NULL );
+    }
+    else {
+      H5Sselect_none( filespace );
+      H5Sselect_none( memspace );
+    }
+
+    H5Dwrite( dataset, memType, memspace, filespace, xferList, data );
+
+    if( createList != H5P_DEFAULT ) H5Pclose( createList );
+    H5Sclose( memspace );
+    H5Sclose( filespace );
+    H5Dclose( dataset );
+
+#endif
+
+  }
+
   void XDMFWriter::write_solution_wrapper( const std::string output_path, const char type[] ) const {
 
 #ifdef HAVE_HDF5
@@ -28,6 +28,7 @@ namespace femus {
   class DofMap;
   class MultiLevelMeshTwo;
   class SystemTwo;
+  class NumericVector;
 
 
 
@@ -144,10 +145,46 @@ namespace femus {
         _debugOutput = value;
       }
 
+      /** Set if the ranks write their own part of the datasets with collective parallel HDF5 (default true).
+       * It is effective only if HDF5 was built with MPI-IO support, otherwise all the data are gathered on rank 0 */
+      void SetParallelHDF5( const bool &value ) {
+        _parallelHDF5 = value;
+      }
+
+      /** Set the number of entries of the HDF5 dataset chunks, 0 means contiguous datasets (default) */
+      void SetHDF5ChunkSize( const unsigned &chunkSize ) {
+        _hdf5ChunkSize = chunkSize;
+      }
+
+      /** Set the gzip compression level (0-9) of the HDF5 datasets, 0 means no compression (default).
+       * Compressed datasets are always chunked, with the default chunk size if not set with SetHDF5ChunkSize */
+      void SetHDF5Compression( const unsigned &level ) {
+        _hdf5CompressionLevel = level;
+      }
+
     private:
 
+      /** Each rank writes the owned dofs and elements of the finest level as hyperslabs of the datasets with collective MPI-IO.
+       * The topology and the fixed geometry go to mesh_filename, only if printMesh. elemtype is the same on all the ranks,
+       * also on those that own no elements */
+      void ParallelHDF5Write( const std::string &hdf5_filename, const std::string &mesh_filename, const bool &printMesh,
+                              const unsigned &index_nd, const unsigned &elemtype, const bool &print_all,
+                              const std::vector < std::string >& vars, NumericVector* numVector );
+
+      /** Creates the globalSize x 1 dataset name and writes localSize entries of data starting from the row offset.
+       * With the serial output rank 0 writes the whole dataset, xferList is H5P_DEFAULT */
+      void WriteHDF5Dataset( hid_t file_id, hid_t xferList, const std::string &name, hid_t memType,
+                             const hsize_t &globalSize, const hsize_t &offset, const hsize_t &localSize, const void* data ) const;
+
       bool _debugOutput;
 
+      bool _parallelHDF5;
+      unsigned _hdf5ChunkSize;
+      unsigned _hdf5CompressionLevel;
+
+      /** name of the last shared mesh file printed, for each output order (cached mesh output) */
+      std::string _cachedMeshFile[3];
+
       static const std::string type_el[3][N_GEOM_ELS];
 
       static const std::string _nodes_name;
@@ -22,6 +22,7 @@
 namespace femus {
 
 adept::Stack FemusInit::_adeptStack;
+std::vector < adept::Stack* > FemusInit::_adeptStackPool(1, &FemusInit::_adeptStack);
 
 // =======================================================
 /// This function initializes the libraries if it is parallel
@@ -52,12 +53,20 @@ FemusInit::FemusInit(
 
    std::cout << " FemusInit(): PETSC_COMM_WORLD initialized" << std::endl << std::endl;
 
+   // element Jacobians are small: do not let adept spawn OpenMP threads for each of them
+   _adeptStack.set_max_jacobian_threads(1);
+
     return;
 }
 
 
 FemusInit::~FemusInit() {
 
+    for(unsigned ithread = 1; ithread < _adeptStackPool.size(); ithread++) {
+      delete _adeptStackPool[ithread];
+    }
+    _adeptStackPool.resize(1);
+
 #ifdef HAVE_PETSC
     PetscFinalize();
     std::cout << std::endl << " ~FemusInit(): PETSC_COMM_WORLD ends" << std::endl;
@@ -67,6 +76,17 @@ FemusInit::~FemusInit() {
 }
 
 
+
+void FemusInit::ResizeAdeptStackPool(const unsigned &nthreads) {
+
+    for(unsigned ithread = _adeptStackPool.size(); ithread < nthreads; ithread++) {
+      adept::Stack* threadStack = new adept::Stack(false);
+      threadStack->set_max_jacobian_threads(1);
+      _adeptStackPool.push_back(threadStack);
+    }
+
+}
+
 } //end namespace femus
 
 
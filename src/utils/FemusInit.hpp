@@ -40,6 +40,7 @@
 // ========================================
 
 #include "adept.h"
+#include <vector>
 
 namespace femus {
 
@@ -56,6 +57,19 @@ public:
     ~FemusInit();
     
     static adept::Stack _adeptStack; 
+
+    /** Get the adept::Stack of the assembly thread ithread, the one of thread 0 is _adeptStack.
+     * The stacks live as long as the program, so the memory grown by the first recordings is reused by all the others */
+    static adept::Stack& GetAdeptStack(const unsigned &ithread = 0) {
+      return (ithread == 0) ? _adeptStack : *_adeptStackPool[ithread];
+    }
+
+    /** Allocate the (inactive) stacks of the assembly threads 1,...,nthreads-1. Call it outside any parallel region */
+    static void ResizeAdeptStackPool(const unsigned &nthreads);
+
+private:
+
+    static std::vector < adept::Stack* > _adeptStackPool;
      
 };
 
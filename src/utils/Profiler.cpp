@@ -0,0 +1,290 @@
+/*=========================================================================
+
+ Program: FEMUS
+ Module: Profiler
+
+ Copyright (c) FEMTTU
+ All rights reserved.
+
+ This software is distributed WITHOUT ANY WARRANTY; without even
+ the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ PURPOSE.  See the above copyright notice for more information.
+
+=========================================================================*/
+
+//----------------------------------------------------------------------------
+// includes :
+//----------------------------------------------------------------------------
+#include "Profiler.hpp"
+#include "mpi.h"
+
+#include <cstdlib>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <limits>
+#include <set>
+#include <sstream>
+
+namespace femus {
+
+  bool Profiler::_enabled = true;
+  bool Profiler::_traceEnabled = false;
+  unsigned Profiler::_maxTraceEvents = 1000000;
+  std::thread::id Profiler::_recordingThread = std::this_thread::get_id();
+
+  std::vector < Profiler::OpenRegion > Profiler::_openRegions;
+  std::map < std::string, Profiler::RegionStatistics > Profiler::_statistics;
+  std::vector < Profiler::TraceEvent > Profiler::_traceEvents;
+
+// ===============================================================
+  double Profiler::GetWallTime() {
+    return MPI_Wtime();
+  }
+
+// ===============================================================
+  bool Profiler::Start(const std::string &name) {
+
+    if(!_enabled || !IsRecordingThread()) return false;
+
+    OpenRegion region;
+    region.path = (_openRegions.empty()) ? name : _openRegions.back().path + "/" + name;
+    region.start = GetWallTime();
+    _openRegions.push_back(region);
+
+    return true;
+  }
+
+// ===============================================================
+  void Profiler::Stop() {
+
+    if(!IsRecordingThread()) return;
+
+    if(_openRegions.empty()) {
+      std::cout << "Error in Profiler::Stop(): no open region" << std::endl;
+      abort();
+    }
+
+    const OpenRegion &region = _openRegions.back();
+    double duration = GetWallTime() - region.start;
+
+    std::map < std::string, RegionStatistics >::iterator it = _statistics.find(region.path);
+    if(it == _statistics.end()) {
+      RegionStatistics statistics = {0u, 0.};
+      it = _statistics.insert(std::make_pair(region.path, statistics)).first;
+    }
+    it->second.calls++;
+    it->second.time += duration;
+
+    if(_traceEnabled && _traceEvents.size() < _maxTraceEvents) {
+      TraceEvent event;
+      event.path = region.path;
+      event.start = region.start;
+      event.duration = duration;
+      _traceEvents.push_back(event);
+    }
+
+    _openRegions.pop_back();
+  }
+
+// ===============================================================
+  void Profiler::Reset() {
+
+    if(!_openRegions.empty()) {
+      std::cout << "Error in Profiler::Reset(): the region " << _openRegions.back().path << " is still open" << std::endl;
+      abort();
+    }
+
+    _statistics.clear();
+    _traceEvents.clear();
+  }
+
+// ===============================================================
+  void Profiler::ReduceStatistics(std::vector < std::string > &paths, std::vector < unsigned > &maxCalls,
+                                  std::vector < double > &minTime, std::vector < double > &maxTime, std::vector < double > &avgTime) {
+
+    int nprocs;
+    MPI_Comm_size(MPI_COMM_WORLD, &nprocs);
+
+    // the union of the local paths, one per line, is built on every process
+    std::string localPaths;
+    for(std::map < std::string, RegionStatistics >::const_iterator it = _statistics.begin(); it != _statistics.end(); it++) {
+      localPaths += it->first + "\n";
+    }
+
+    int localSize = localPaths.size();
+    std::vector < int > size(nprocs);
+    MPI_Allgather(&localSize, 1, MPI_INT, &size[0], 1, MPI_INT, MPI_COMM_WORLD);
+
+    std::vector < int > offset(nprocs + 1, 0);
+    for(int jproc = 0; jproc < nprocs; jproc++) {
+      offset[jproc + 1] = offset[jproc] + size[jproc];
+    }
+
+    std::vector < char > allPaths(offset[nprocs] + 1);
+    MPI_Allgatherv(localPaths.c_str(), localSize, MPI_CHAR, &allPaths[0], &size[0], &offset[0], MPI_CHAR, MPI_COMM_WORLD);
+
+    std::set < std::string > pathSet;
+    std::istringstream allPathsStream(std::string(allPaths.begin(), allPaths.begin() + offset[nprocs]));
+    std::string path;
+    while(std::getline(allPathsStream, path)) {
+      pathSet.insert(path);
+    }
+    paths.assign(pathSet.begin(), pathSet.end());
+
+    // the regions not recorded on this process count as zero time
+    unsigned n = paths.size();
+    std::vector < unsigned > calls(n, 0u);
+    std::vector < double > time(n, 0.);
+    for(unsigned i = 0; i < n; i++) {
+      std::map < std::string, RegionStatistics >::const_iterator it = _statistics.find(paths[i]);
+      if(it != _statistics.end()) {
+        calls[i] = it->second.calls;
+        time[i] = it->second.time;
+      }
+    }
+
+    maxCalls.resize(n);
+    minTime.resize(n);
+    maxTime.resize(n);
+    avgTime.resize(n);
+    if(n > 0) {
+      MPI_Allreduce(&calls[0], &maxCalls[0], n, MPI_UNSIGNED, MPI_MAX, MPI_COMM_WORLD);
+      MPI_Allreduce(&time[0], &minTime[0], n, MPI_DOUBLE, MPI_MIN, MPI_COMM_WORLD);
+      MPI_Allreduce(&time[0], &maxTime[0], n, MPI_DOUBLE, MPI_MAX, MPI_COMM_WORLD);
+      MPI_Allreduce(&time[0], &avgTime[0], n, MPI_DOUBLE, MPI_SUM, MPI_COMM_WORLD);
+    }
+    for(unsigned i = 0; i < n; i++) {
+      avgTime[i] /= nprocs;
+    }
+  }
+
+// ===============================================================
+  void Profiler::PrintSummary() {
+
+    std::vector < std::string > paths;
+    std::vector < unsigned > calls;
+    std::vector < double > minTime, maxTime, avgTime;
+    ReduceStatistics(paths, calls, minTime, maxTime, avgTime);
+
+    unsigned width = 6;
+    for(unsigned i = 0; i < paths.size(); i++) {
+      width = (paths[i].size() > width) ? paths[i].size() : width;
+    }
+
+    std::ios_base::fmtflags flags = std::cout.flags();
+    std::streamsize precision = std::cout.precision();
+
+    std::cout << std::endl << " *** Profiler wall-clock times [s] ***" << std::endl;
+    std::cout << std::left << " " << std::setw(width) << "Region" << std::right << std::setw(10) << "Calls"
+              << std::setw(14) << "Min" << std::setw(14) << "Max" << std::setw(14) << "Avg" << std::endl;
+    for(unsigned i = 0; i < paths.size(); i++) {
+      std::cout << std::left << " " << std::setw(width) << paths[i] << std::right << std::setw(10) << calls[i]
+                << std::scientific << std::setprecision(4)
+                << std::setw(14) << minTime[i] << std::setw(14) << maxTime[i] << std::setw(14) << avgTime[i] << std::endl;
+    }
+    std::cout.flags(flags);
+    std::cout.precision(precision);
+  }
+
+// ===============================================================
+  void Profiler::WriteJson(const std::string &filename) {
+
+    std::vector < std::string > paths;
+    std::vector < unsigned > calls;
+    std::vector < double > minTime, maxTime, avgTime;
+    ReduceStatistics(paths, calls, minTime, maxTime, avgTime);
+
+    int iproc, nprocs;
+    MPI_Comm_rank(MPI_COMM_WORLD, &iproc);
+    MPI_Comm_size(MPI_COMM_WORLD, &nprocs);
+
+    if(iproc != 0) return;
+
+    std::ofstream fout(filename.c_str());
+    if(!fout) {
+      std::cout << "Error in Profiler::WriteJson(): cannot open the file " << filename << std::endl;
+      abort();
+    }
+
+    fout << std::setprecision(9);
+    fout << "{\n  \"nprocs\": " << nprocs << ",\n  \"regions\": [";
+    for(unsigned i = 0; i < paths.size(); i++) {
+      fout << ((i == 0) ? "\n" : ",\n")
+           << "    {\"name\": " << JsonString(paths[i]) << ", \"calls\": " << calls[i]
+           << ", \"min\": " << minTime[i] << ", \"max\": " << maxTime[i] << ", \"avg\": " << avgTime[i] << "}";
+    }
+    fout << "\n  ]\n}\n";
+  }
+
+// ===============================================================
+  void Profiler::WriteChromeTrace(const std::string &filename) {
+
+    int iproc, nprocs;
+    MPI_Comm_rank(MPI_COMM_WORLD, &iproc);
+    MPI_Comm_size(MPI_COMM_WORLD, &nprocs);
+
+    // common time origin, the trace times are in microseconds
+    double localOrigin = (_traceEvents.empty()) ? std::numeric_limits < double >::max() : _traceEvents[0].start;
+    for(unsigned i = 1; i < _traceEvents.size(); i++) {
+      localOrigin = (_traceEvents[i].start < localOrigin) ? _traceEvents[i].start : localOrigin;
+    }
+    double origin;
+    MPI_Allreduce(&localOrigin, &origin, 1, MPI_DOUBLE, MPI_MIN, MPI_COMM_WORLD);
+
+    std::ostringstream localEvents;
+    localEvents << std::fixed << std::setprecision(3);
+    for(unsigned i = 0; i < _traceEvents.size(); i++) {
+      const std::string &path = _traceEvents[i].path;
+      std::string::size_type slash = path.rfind('/');
+      std::string name = (slash == std::string::npos) ? path : path.substr(slash + 1);
+      localEvents << ",\n{\"name\": " << JsonString(name) << ", \"cat\": \"femus\", \"ph\": \"X\""
+                  << ", \"ts\": " << (_traceEvents[i].start - origin) * 1.e6
+                  << ", \"dur\": " << _traceEvents[i].duration * 1.e6
+                  << ", \"pid\": " << iproc << ", \"tid\": 0, \"args\": {\"path\": " << JsonString(path) << "}}";
+    }
+    std::string localString = localEvents.str();
+
+    int localSize = localString.size();
+    std::vector < int > size(nprocs);
+    MPI_Gather(&localSize, 1, MPI_INT, &size[0], 1, MPI_INT, 0, MPI_COMM_WORLD);
+
+    std::vector < int > offset(nprocs + 1, 0);
+    for(int jproc = 0; jproc < nprocs; jproc++) {
+      offset[jproc + 1] = offset[jproc] + size[jproc];
+    }
+
+    std::vector < char > allEvents((iproc == 0) ? offset[nprocs] + 1 : 1);
+    MPI_Gatherv(localString.c_str(), localSize, MPI_CHAR, &allEvents[0], &size[0], &offset[0], MPI_CHAR, 0, MPI_COMM_WORLD);
+
+    if(iproc != 0) return;
+
+    std::ofstream fout(filename.c_str());
+    if(!fout) {
+      std::cout << "Error in Profiler::WriteChromeTrace(): cannot open the file " << filename << std::endl;
+      abort();
+    }
+
+    fout << "{\"displayTimeUnit\": \"ms\", \"traceEvents\": [\n";
+    for(int jproc = 0; jproc < nprocs; jproc++) {
+      fout << ((jproc == 0) ? "" : ",\n")
+           << "{\"name\": \"process_name\", \"ph\": \"M\", \"pid\": " << jproc << ", \"args\": {\"name\": \"rank " << jproc << "\"}}";
+    }
+    fout.write(&allEvents[0], offset[nprocs]);
+    fout << "\n]}\n";
+  }
+
+// ===============================================================
+  std::string Profiler::JsonString(const std::string &value) {
+
+    std::string json = "\"";
+    for(unsigned i = 0; i < value.size(); i++) {
+      if(value[i] == '"' || value[i] == '\\') json += '\\';
+      json += value[i];
+    }
+    json += "\"";
+
+    return json;
+  }
+
+} //end namespace femus
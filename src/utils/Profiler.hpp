@@ -0,0 +1,151 @@
+/*=========================================================================
+
+ Program: FEMUS
+ Module: Profiler
+
+ Copyright (c) FEMTTU
+ All rights reserved.
+
+ This software is distributed WITHOUT ANY WARRANTY; without even
+ the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ PURPOSE.  See the above copyright notice for more information.
+
+=========================================================================*/
+
+#ifndef __femus_utils_Profiler_hpp__
+#define __femus_utils_Profiler_hpp__
+
+//----------------------------------------------------------------------------
+// includes :
+//----------------------------------------------------------------------------
+#include <map>
+#include <string>
+#include <vector>
+#include <thread>
+
+namespace femus {
+
+  /**
+   * Registry of wall-clock timers. The regions are hierarchical: a region started while another one is open is
+   * recorded with the path "parent/child", so the same name (e.g. "Assembly") is timed separately in a linear and
+   * in a nonlinear solve. For each path every process accumulates the number of calls and the elapsed time;
+   * PrintSummary and WriteJson reduce them over the processes (min/max/avg of the per-process times), and,
+   * if the trace is enabled, WriteChromeTrace writes every single region as an event of the chrome://tracing format.
+   * Only the thread that loaded the library records regions, the calls from OpenMP or I/O threads are ignored.
+   **/
+  class Profiler {
+
+    public:
+
+      /** Wall-clock time in seconds */
+      static double GetWallTime();
+
+      /** Opens the region name inside the innermost open region, returns false if nothing has been recorded */
+      static bool Start(const std::string &name);
+
+      /** Closes the innermost open region */
+      static void Stop();
+
+      /** Enables/disables the recording, enabled by default */
+      static void SetEnabled(const bool &value) {
+        _enabled = value;
+      }
+
+      /** Keeps every region as a trace event, at most maxEvents per process (disabled by default) */
+      static void SetTraceEnabled(const bool &value, const unsigned &maxEvents = 1000000) {
+        _traceEnabled = value;
+        _maxTraceEvents = maxEvents;
+      }
+
+      /** Clears all the statistics and the trace events, no region must be open */
+      static void Reset();
+
+      /** Prints the table of the regions, collective on MPI_COMM_WORLD */
+      static void PrintSummary();
+
+      /** Writes the table of the regions in JSON format, collective on MPI_COMM_WORLD */
+      static void WriteJson(const std::string &filename);
+
+      /** Writes the trace events of all the processes in the Chrome trace format, collective on MPI_COMM_WORLD */
+      static void WriteChromeTrace(const std::string &filename);
+
+    private:
+
+      struct OpenRegion {
+        std::string path;
+        double start;
+      };
+
+      struct RegionStatistics {
+        unsigned calls;
+        double time;
+      };
+
+      struct TraceEvent {
+        std::string path;
+        double start;
+        double duration;
+      };
+
+      static bool IsRecordingThread() {
+        return std::this_thread::get_id() == _recordingThread;
+      }
+
+      /** Statistics of all the regions recorded on any process, in the same order on all of them */
+      static void ReduceStatistics(std::vector < std::string > &paths, std::vector < unsigned > &maxCalls,
+                                   std::vector < double > &minTime, std::vector < double > &maxTime, std::vector < double > &avgTime);
+
+      static std::string JsonString(const std::string &value);
+
+      static bool _enabled;
+      static bool _traceEnabled;
+      static unsigned _maxTraceEvents;
+      static std::thread::id _recordingThread;
+
+      static std::vector < OpenRegion > _openRegions;
+      static std::map < std::string, RegionStatistics > _statistics;
+      static std::vector < TraceEvent > _traceEvents;
+
+  };
+
+  /**
+   * Scoped region of the Profiler: it is started by the constructor and stopped by Stop or by the destructor.
+   * GetElapsedTime is available even if the Profiler is disabled.
+   **/
+  class ProfilerRegion {
+
+    public:
+
+      ProfilerRegion(const std::string &name) :
+        _start(Profiler::GetWallTime()),
+        _elapsedTime(-1.) {
+        _isRecorded = Profiler::Start(name);
+      }
+
+      ~ProfilerRegion() {
+        Stop();
+      }
+
+      void Stop() {
+        if(_elapsedTime < 0.) {
+          _elapsedTime = Profiler::GetWallTime() - _start;
+          if(_isRecorded) Profiler::Stop();
+        }
+      }
+
+      /** Wall-clock time from the start of the region to Stop, or to now if the region is still open */
+      double GetElapsedTime() const {
+        return (_elapsedTime < 0.) ? Profiler::GetWallTime() - _start : _elapsedTime;
+      }
+
+    private:
+
+      double _start;
+      double _elapsedTime;
+      bool _isRecorded;
+
+  };
+
+} //end namespace femus
+
+#endif
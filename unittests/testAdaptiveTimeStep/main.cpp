@@ -0,0 +1,188 @@
+#include "FemusInit.hpp"
+#include "MultiLevelProblem.hpp"
+#include "NumericVector.hpp"
+#include "SparseMatrix.hpp"
+#include "NonLinearImplicitSystem.hpp"
+#include "TransientSystem.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+using namespace femus;
+
+// Test for the time stepping of TransientSystem on the decoupled equations du_i/dt = -lambda u_i, u_i(0) = 1,
+// integrated with backward Euler:
+// - with the adaptive time step the local error estimate is close to the true local error, below the tolerance,
+//   and the time step grows from a too small initial value;
+// - with a fixed time step and SetOperatorRebuildPeriod the Jacobian is assembled only every period steps
+//   and the solution is still the backward Euler one
+
+const double lambda = 1.;
+
+// number of assemblies of the Jacobian
+unsigned matrixAssemblies;
+
+bool SetBoundaryCondition(const std::vector < double >& x, const char solName[], double& value, const int faceName, const double time) {
+  value = 0.;
+  return false;
+}
+
+double InitialValueU(const std::vector < double >& x) {
+  return 1.;
+}
+
+void AssembleDecay(MultiLevelProblem& ml_prob) {
+
+  TransientNonlinearImplicitSystem* mlPdeSys  = &ml_prob.get_system<TransientNonlinearImplicitSystem> ("Decay");
+  const unsigned level = mlPdeSys->GetLevelToAssemble();
+  const bool assembleMatrix = mlPdeSys->GetAssembleMatrix();
+  const double dt = mlPdeSys->GetIntervalTime();
+
+  Mesh*                    msh = ml_prob._ml_msh->GetLevel(level);
+  MultiLevelSolution*    mlSol = ml_prob._ml_sol;
+  Solution*                sol = ml_prob._ml_sol->GetSolutionLevel(level);
+
+  LinearEquationSolver* pdeSys = mlPdeSys->_LinSolver[level];
+  SparseMatrix*             KK = pdeSys->_KK;
+  NumericVector*           RES = pdeSys->_RES;
+
+  const unsigned iproc = msh->processor_id();
+
+  unsigned soluIndex = mlSol->GetIndex("u");
+  unsigned soluType = mlSol->GetSolutionType(soluIndex);
+
+  if(assembleMatrix) KK->zero();
+  RES->zero();
+
+  // one equation for each owned dof, the system dofs of the only variable follow the owned dofs
+  for(unsigned idof = msh->_dofOffset[soluType][iproc]; idof < msh->_dofOffset[soluType][iproc + 1]; idof++) {
+    int idofKK = pdeSys->KKoffset[0][iproc] + idof - msh->_dofOffset[soluType][iproc];
+    double u = (*sol->_Sol[soluIndex])(idof);
+    double uOld = (*sol->_SolOld[soluIndex])(idof);
+
+    RES->set(idofKK, -((u - uOld) / dt + lambda * u));
+    if(assembleMatrix) KK->set(idofKK, idofKK, 1. / dt + lambda);
+  }
+
+  RES->close();
+  if(assembleMatrix) {
+    KK->close();
+    matrixAssemblies++;
+  }
+}
+
+// the value of u, the same on all the dofs
+double GetValue(MultiLevelSolution &mlSol) {
+  return mlSol.GetSolutionLevel(0)->_Sol[mlSol.GetIndex("u")]->linfty_norm();
+}
+
+int main(int argc, char** args) {
+
+  FemusInit mpinit(argc, args, MPI_COMM_WORLD);
+
+  MultiLevelMesh mlMsh;
+  mlMsh.ReadCoarseMesh("./input/square_quad.neu", "seventh", 1.);
+  mlMsh.RefineMesh(1, 1, NULL);
+
+  MultiLevelSolution mlSol(&mlMsh);
+  mlSol.AddSolution("u", LAGRANGE, FIRST, 2);
+  mlSol.AttachSetBoundaryConditionFunction(SetBoundaryCondition);
+  mlSol.GenerateBdc("u");
+
+  MultiLevelProblem mlProb(&mlSol);
+  TransientNonlinearImplicitSystem& system = mlProb.add_system < TransientNonlinearImplicitSystem > ("Decay");
+  system.AddSolutionToSystemPDE("u");
+  system.SetAssembleFunction(AssembleDecay);
+  system.init();
+  system.SetTolerances(1.e-12, 1.e-20, 1.e+50, 20, 20);
+  system.SetMgType(V_CYCLE);
+  // the equations are linear, one Newton step solves each time step
+  system.SetMaxNumberOfNonLinearIterations(1);
+
+  bool passed = true;
+
+  // adaptive time step
+  {
+    const double tolerance = 1.e-3;
+    const double dt0 = 0.01;
+    const double finalTime = 3.;
+
+    mlSol.Initialize("u", InitialValueU);
+    system.SetTime(0.);
+    system.SetIntervalTime(dt0);
+    system.SetAdaptiveTimeStep(true, tolerance, 1.e-4, 0.5);
+
+    unsigned numberOfSteps = 0;
+    double maxEstimateRatio = 1.;
+    double minEstimateRatio = 1.;
+    while(system.GetTime() < finalTime) {
+      double time = system.GetTime();
+      double uOld = GetValue(mlSol);
+
+      system.MGsolve();
+
+      // the step really taken, the interval time is already the one of the next step
+      double dt = system.GetTime() - time;
+      double u = GetValue(mlSol);
+      double estimate = system.GetLocalErrorEstimate();
+      double localError = fabs(u - uOld * exp(-lambda * dt)) / u;
+
+      std::cout << "Step " << numberOfSteps << ": dt " << dt << ", local error " << localError << ", estimate " << estimate << std::endl;
+
+      if(estimate > tolerance) passed = false;
+      // the estimate is asymptotically exact once the controller has left the initial dt
+      if(numberOfSteps > 2) {
+        maxEstimateRatio = std::max(maxEstimateRatio, estimate / localError);
+        minEstimateRatio = std::min(minEstimateRatio, estimate / localError);
+      }
+
+      system.CopySolutionToOldSolution();
+      numberOfSteps++;
+    }
+
+    // the relative errors of the steps add up for a linear equation
+    double globalError = fabs(GetValue(mlSol) / exp(-lambda * system.GetTime()) - 1.);
+    std::cout << "Adaptive time step: " << numberOfSteps << " steps, relative error at the final time " << globalError
+              << ", estimate / local error in [" << minEstimateRatio << ", " << maxEstimateRatio << "]" << std::endl;
+
+    if(minEstimateRatio < 0.5 || maxEstimateRatio > 2.) passed = false;
+    if(globalError > numberOfSteps * tolerance) passed = false;
+    if(system.GetIntervalTime() < 2. * dt0) passed = false;
+
+    system.SetAdaptiveTimeStep(false);
+  }
+
+  // fixed time step, the Jacobian is kept by the nonlinear solver in between the rebuilds
+  {
+    const double dt = 0.1;
+    const unsigned period = 4;
+    const unsigned numberOfSteps = 8;
+
+    mlSol.Initialize("u", InitialValueU);
+    system.SetTime(0.);
+    system.SetIntervalTime(dt);
+    system.SetOperatorRebuildPeriod(period);
+    system.SetJacobianReuseAcrossSolves(true);
+    matrixAssemblies = 0;
+
+    for(unsigned timeStep = 0; timeStep < numberOfSteps; timeStep++) {
+      system.MGsolve();
+      system.CopySolutionToOldSolution();
+    }
+
+    double error = fabs(GetValue(mlSol) - pow(1. + lambda * dt, -static_cast < double >(numberOfSteps)));
+    std::cout << "Operator rebuild period " << period << ": " << matrixAssemblies << " Jacobian assemblies in " << numberOfSteps
+              << " steps, difference from backward Euler " << error << std::endl;
+
+    if(matrixAssemblies != numberOfSteps / period) passed = false;
+    if(error > 1.e-10) passed = false;
+  }
+
+  mlProb.clear();
+
+  if(!passed) {
+    exit(1);
+  }
+
+  return 0;
+}
@@ -0,0 +1,142 @@
+#include "FemusInit.hpp"
+#include "MultiLevelProblem.hpp"
+#include "NumericVector.hpp"
+#include "LinearImplicitSystem.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+using namespace femus;
+
+// Test for Solution::UpdateSol and Solution::UpdateRes, that copy the blocks of the system vectors _EPS and _RES into the
+// vectors of the variables with NumericVector::insert_local_block: the result, owned and ghost entries, must be the same
+// as with the insertion dof by dof, with the residual set to zero on the Dirichlet dofs
+
+bool SetBoundaryCondition(const std::vector < double >& x, const char solName[], double& value, const int faceName, const double time) {
+  value = 0.;
+  return (faceName == 1 || faceName == 3);
+}
+
+double InitialValue(const std::vector < double >& x) {
+  return x[0] * x[0] - x[1];
+}
+
+// the largest difference between vector and reference, on the owned dofs and on the dofs of the owned elements
+double GetMaxDifference(Mesh* msh, const unsigned &solType, NumericVector* vector, NumericVector* reference) {
+
+  std::unique_ptr < NumericVector > difference = vector->clone();
+  difference->add(-1., *reference);
+  double maxDifference = difference->linfty_norm();
+
+  const unsigned iproc = msh->processor_id();
+  std::vector < double > values, referenceValues;
+  for(unsigned iel = msh->_elementOffset[iproc]; iel < msh->_elementOffset[iproc + 1]; iel++) {
+    unsigned nDofs = msh->GetElementDofNumber(iel, solType);
+    const int *localDofs = msh->GetElementSolutionLocalDofs(iel, solType);
+    values.resize(nDofs);
+    referenceValues.resize(nDofs);
+    vector->get_local(localDofs, nDofs, &values[0]);
+    reference->get_local(localDofs, nDofs, &referenceValues[0]);
+    for(unsigned i = 0; i < nDofs; i++) {
+      maxDifference = std::max(maxDifference, fabs(values[i] - referenceValues[i]));
+    }
+  }
+
+  return maxDifference;
+}
+
+int main(int argc, char** args) {
+
+  FemusInit mpinit(argc, args, MPI_COMM_WORLD);
+
+  MultiLevelMesh mlMsh;
+  mlMsh.ReadCoarseMesh("./input/square_quad.neu", "seventh", 1.);
+  unsigned numberOfUniformLevels = 3;
+  mlMsh.RefineMesh(numberOfUniformLevels, numberOfUniformLevels, NULL);
+  mlMsh.EraseCoarseLevels(numberOfUniformLevels - 1);
+
+  MultiLevelSolution mlSol(&mlMsh);
+  mlSol.AddSolution("u", LAGRANGE, SECOND);
+  mlSol.AddSolution("v", LAGRANGE, FIRST);
+  mlSol.AddSolution("p", DISCONTINOUS_POLYNOMIAL, FIRST);
+  mlSol.Initialize("All", InitialValue);
+  mlSol.AttachSetBoundaryConditionFunction(SetBoundaryCondition);
+  mlSol.GenerateBdc("All");
+
+  MultiLevelProblem mlProb(&mlSol);
+  LinearImplicitSystem& system = mlProb.add_system < LinearImplicitSystem > ("BlockInsert");
+  system.AddSolutionToSystemPDE("u");
+  system.AddSolutionToSystemPDE("v");
+  system.AddSolutionToSystemPDE("p");
+  system.init();
+
+  const unsigned level = mlMsh.GetNumberOfLevels() - 1u;
+  Mesh* msh = mlMsh.GetLevel(level);
+  Solution* sol = mlSol.GetSolutionLevel(level);
+  LinearEquationSolver* pdeSys = system._LinSolver[level];
+  const unsigned iproc = msh->processor_id();
+
+  // system vectors with a different value on each dof
+  for(int i = pdeSys->_EPS->first_local_index(); i < pdeSys->_EPS->last_local_index(); i++) {
+    pdeSys->_EPS->set(i, sin(0.1 * i) + 2.);
+    pdeSys->_RES->set(i, cos(0.3 * i) - 3.);
+  }
+  pdeSys->_EPS->close();
+  pdeSys->_RES->close();
+
+  // reference: dof by dof insertion
+  std::vector < unsigned > &solPdeIndex = system.GetSolPdeIndex();
+  std::vector < NumericVector* > epsReference(solPdeIndex.size());
+  std::vector < NumericVector* > resReference(solPdeIndex.size());
+  std::vector < NumericVector* > solReference(solPdeIndex.size());
+  for(unsigned k = 0; k < solPdeIndex.size(); k++) {
+    unsigned indexSol = solPdeIndex[k];
+    unsigned solType = mlSol.GetSolutionType(indexSol);
+
+    epsReference[k] = sol->_Eps[indexSol]->clone().release();
+    resReference[k] = sol->_Res[indexSol]->clone().release();
+    solReference[k] = sol->_Sol[indexSol]->clone().release();
+
+    for(int i = 0; i < msh->_ownSize[solType][iproc]; i++) {
+      int idof = msh->_dofOffset[solType][iproc] + i;
+      int idofKK = pdeSys->KKoffset[k][iproc] + i;
+      epsReference[k]->set(idof, (*pdeSys->_EPS)(idofKK));
+      resReference[k]->set(idof, ((*sol->_Bdc[indexSol])(idof) > 1.1) ? (*pdeSys->_RES)(idofKK) : 0.);
+    }
+    epsReference[k]->close();
+    resReference[k]->close();
+    solReference[k]->add(*epsReference[k]);
+    solReference[k]->close();
+  }
+
+  sol->UpdateSol(solPdeIndex, pdeSys->_EPS, pdeSys->KKoffset);
+  sol->UpdateRes(solPdeIndex, pdeSys->_RES, pdeSys->KKoffset);
+
+  bool passed = true;
+  for(unsigned k = 0; k < solPdeIndex.size(); k++) {
+    unsigned indexSol = solPdeIndex[k];
+    unsigned solType = mlSol.GetSolutionType(indexSol);
+
+    double epsDifference = GetMaxDifference(msh, solType, sol->_Eps[indexSol], epsReference[k]);
+    double resDifference = GetMaxDifference(msh, solType, sol->_Res[indexSol], resReference[k]);
+    double solDifference = GetMaxDifference(msh, solType, sol->_Sol[indexSol], solReference[k]);
+
+    std::cout << "Variable " << mlSol.GetSolutionName(indexSol) << ": difference from the dof by dof insertion, Eps " << epsDifference
+              << ", Res " << resDifference << ", Sol " << solDifference << std::endl;
+
+    // the block copy moves the same values, the results must be identical
+    if(epsDifference != 0. || resDifference != 0. || solDifference != 0.) passed = false;
+
+    delete epsReference[k];
+    delete resReference[k];
+    delete solReference[k];
+  }
+
+  mlProb.clear();
+
+  if(!passed) {
+    exit(1);
+  }
+
+  return 0;
+}
@@ -0,0 +1,176 @@
+#include "FemusInit.hpp"
+#include "MultiLevelProblem.hpp"
+#include "NumericVector.hpp"
+#include "SparseMatrix.hpp"
+#include "NonLinearImplicitSystem.hpp"
+
+#include <cmath>
+#include <limits>
+
+using namespace femus;
+
+// Test for the inexact Newton options of NonLinearImplicitSystem, on the decoupled equations atan(u_i) = 0:
+// - the relative tolerance of the linear solver follows the Eisenstat-Walker forcing sequence;
+// - the line search halves a step whose residual is NaN until the residual decreases enough;
+// - a step whose residual is NaN also at the shortest length is rejected and the solution is restored
+
+// the residual is NaN for u below this value, as for a physical state out of range
+double nanThreshold;
+double initialValue;
+
+// residual norms and linear relative tolerances seen by the assembly, one entry for each assembly
+std::vector < double > residualNorms;
+std::vector < double > relativeTolerances;
+
+bool SetBoundaryCondition(const std::vector < double >& x, const char solName[], double& value, const int faceName, const double time) {
+  value = 0.;
+  return false;
+}
+
+double InitialValueU(const std::vector < double >& x) {
+  return initialValue;
+}
+
+void AssembleArcTangent(MultiLevelProblem& ml_prob) {
+
+  NonLinearImplicitSystem* mlPdeSys  = &ml_prob.get_system<NonLinearImplicitSystem> ("ArcTangent");
+  const unsigned level = mlPdeSys->GetLevelToAssemble();
+  const bool assembleMatrix = mlPdeSys->GetAssembleMatrix();
+
+  Mesh*                    msh = ml_prob._ml_msh->GetLevel(level);
+  MultiLevelSolution*    mlSol = ml_prob._ml_sol;
+  Solution*                sol = ml_prob._ml_sol->GetSolutionLevel(level);
+
+  LinearEquationSolver* pdeSys = mlPdeSys->_LinSolver[level];
+  SparseMatrix*             KK = pdeSys->_KK;
+  NumericVector*           RES = pdeSys->_RES;
+
+  const unsigned iproc = msh->processor_id();
+
+  unsigned soluIndex = mlSol->GetIndex("u");
+  unsigned soluType = mlSol->GetSolutionType(soluIndex);
+
+  if(assembleMatrix) KK->zero();
+  RES->zero();
+
+  // one equation for each owned dof, the system dofs of the only variable follow the owned dofs
+  for(unsigned idof = msh->_dofOffset[soluType][iproc]; idof < msh->_dofOffset[soluType][iproc + 1]; idof++) {
+    int idofKK = pdeSys->KKoffset[0][iproc] + idof - msh->_dofOffset[soluType][iproc];
+    double u = (*sol->_Sol[soluIndex])(idof);
+
+    double residual = (u < nanThreshold) ? std::numeric_limits < double >::quiet_NaN() : -atan(u);
+    RES->set(idofKK, residual);
+    if(assembleMatrix) KK->set(idofKK, idofKK, 1. / (1. + u * u));
+  }
+
+  RES->close();
+  if(assembleMatrix) KK->close();
+
+  residualNorms.push_back(RES->l2_norm());
+  relativeTolerances.push_back(pdeSys->GetRelativeTolerance());
+}
+
+// the largest difference between the owned dofs of u and value
+double GetMaxDifference(MultiLevelSolution &mlSol, const double &value) {
+  Solution* sol = mlSol.GetSolutionLevel(0);
+  std::unique_ptr < NumericVector > difference = sol->_Sol[mlSol.GetIndex("u")]->clone();
+  difference->add(-value);
+  return difference->linfty_norm();
+}
+
+int main(int argc, char** args) {
+
+  FemusInit mpinit(argc, args, MPI_COMM_WORLD);
+
+  MultiLevelMesh mlMsh;
+  mlMsh.ReadCoarseMesh("./input/square_quad.neu", "seventh", 1.);
+  mlMsh.RefineMesh(1, 1, NULL);
+
+  MultiLevelSolution mlSol(&mlMsh);
+  mlSol.AddSolution("u", LAGRANGE, FIRST);
+  mlSol.AttachSetBoundaryConditionFunction(SetBoundaryCondition);
+  mlSol.GenerateBdc("u");
+
+  MultiLevelProblem mlProb(&mlSol);
+  NonLinearImplicitSystem& system = mlProb.add_system < NonLinearImplicitSystem > ("ArcTangent");
+  system.AddSolutionToSystemPDE("u");
+  system.SetAssembleFunction(AssembleArcTangent);
+  system.init();
+  system.SetTolerances(1.e-12, 1.e-20, 1.e+50, 20, 20);
+  system.SetMgType(V_CYCLE);
+
+  const double userRelativeTolerance = 1.e-12;
+  bool passed = true;
+
+  // forcing sequence: eta_0 = eta0, then 0.9 (||R_k|| / ||R_k-1||)^2, safeguarded and bounded by etaMax and by the user tolerance
+  {
+    const double eta0 = 0.3;
+    const double etaMax = 0.9;
+    nanThreshold = -std::numeric_limits < double >::max();
+    initialValue = 0.5;
+    mlSol.Initialize("u", InitialValueU);
+    residualNorms.resize(0);
+    relativeTolerances.resize(0);
+
+    system.SetInexactNewton(true, eta0, etaMax);
+    system.SetLineSearch(false);
+    system.SetMaxNumberOfNonLinearIterations(4);
+    system.MGsolve();
+
+    // the assembly of the iteration k sees the forcing term of the iteration k - 1
+    double eta = eta0;
+    for(unsigned k = 1; k < residualNorms.size(); k++) {
+      if(k > 1) {
+        double previousEta = eta;
+        eta = 0.9 * pow(residualNorms[k - 1] / residualNorms[k - 2], 2);
+        double safeguard = 0.9 * previousEta * previousEta;
+        if(safeguard > 0.1 && safeguard > eta) eta = safeguard;
+        if(eta > etaMax) eta = etaMax;
+        if(eta < userRelativeTolerance) eta = userRelativeTolerance;
+      }
+      std::cout << "Iteration " << k << ": forcing term " << relativeTolerances[k] << ", expected " << eta << std::endl;
+      if(fabs(relativeTolerances[k] - eta) > 1.e-10 * eta) passed = false;
+    }
+    if(residualNorms.size() < 3) passed = false;
+    system.SetInexactNewton(false);
+  }
+
+  // backtracking: the full step from 2 goes to 2 - 5 atan(2) < -3 where the residual is NaN, the half step is accepted
+  {
+    nanThreshold = -3.;
+    initialValue = 2.;
+    mlSol.Initialize("u", InitialValueU);
+
+    system.SetLineSearch(true, 5);
+    system.SetMaxNumberOfNonLinearIterations(1);
+    system.MGsolve();
+
+    double expected = initialValue - 0.5 * atan(initialValue) * (1. + initialValue * initialValue);
+    double error = GetMaxDifference(mlSol, expected);
+    std::cout << "Line search through a NaN residual: difference from the half step " << error << std::endl;
+    if(error > 1.e-8) passed = false;
+  }
+
+  // rejected step: the residual is NaN along all the step lengths down to 1/32, the solution must not change
+  {
+    nanThreshold = 1.9;
+    initialValue = 2.;
+    mlSol.Initialize("u", InitialValueU);
+
+    system.SetLineSearch(true, 5);
+    system.SetMaxNumberOfNonLinearIterations(3);
+    system.MGsolve();
+
+    double error = GetMaxDifference(mlSol, initialValue);
+    std::cout << "Line search with a NaN residual at all the step lengths: difference from the initial value " << error << std::endl;
+    if(error > 1.e-14) passed = false;
+  }
+
+  mlProb.clear();
+
+  if(!passed) {
+    exit(1);
+  }
+
+  return 0;
+}
@@ -0,0 +1,139 @@
+#include "FemusInit.hpp"
+#include "MultiLevelMesh.hpp"
+#include "NumericVector.hpp"
+#include "ElemType.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+using namespace femus;
+
+// Test for elem_type::JacobianBatch: the weights and the shape function derivatives of a batch of elements must be
+// the ones of elem_type::Jacobian evaluated element by element, for all the geometries and the Lagrange types 0, 1, 2.
+// The nodes are moved with a smooth map, so that the Jacobian matrices are not constant nor diagonal
+
+void MapCoordinates(std::vector < double > &x) {
+  const unsigned dim = x.size();
+  std::vector < double > y(x);
+  for(unsigned k = 0; k < dim; k++) {
+    double shift = 0.;
+    for(unsigned l = 0; l < dim; l++) {
+      shift += 0.05 * sin(2. * y[l] + k + l);
+    }
+    x[k] += shift;
+  }
+}
+
+// returns the largest difference between the batch and the pointwise evaluation, relative to the largest value
+double CompareJacobianBatch(Mesh* msh) {
+
+  const unsigned dim = msh->GetDimension();
+  const unsigned xType = 2;
+  const unsigned iproc = msh->processor_id();
+  const unsigned elementStart = msh->_elementOffset[iproc];
+  const unsigned elementEnd = msh->_elementOffset[iproc + 1];
+
+  double maxValue = 0.;
+  double maxError = 0.;
+
+  for(unsigned solType = 0; solType < 3; solType++) {
+    for(short unsigned ielGeom = 0; ielGeom < 6; ielGeom++) {
+
+      // all the owned elements with this geometry in one batch
+      std::vector < unsigned > batch;
+      for(unsigned iel = elementStart; iel < elementEnd; iel++) {
+        if(msh->GetElementType(iel) == ielGeom) batch.push_back(iel);
+      }
+      if(batch.size() == 0) continue;
+
+      const unsigned nElements = batch.size();
+      const elem_type* fe = msh->_finiteElement[ielGeom][solType];
+      const unsigned nDofs = msh->GetElementDofNumber(batch[0], solType);
+      const unsigned nGauss = fe->GetGaussPointNumber();
+
+      std::vector < std::vector < std::vector < double > > > x(nElements, std::vector < std::vector < double > > (dim, std::vector < double > (nDofs)));
+      std::vector < double > xBatch(dim * nDofs * nElements);
+
+      std::vector < double > xNode(dim);
+      std::vector < std::vector < double > > xe(dim, std::vector < double > (nDofs));
+      for(unsigned jel = 0; jel < nElements; jel++) {
+        const int *xLocalDofs = msh->GetElementSolutionLocalDofs(batch[jel], xType);
+        for(unsigned k = 0; k < dim; k++) {
+          msh->_topology->_Sol[k]->get_local(xLocalDofs, nDofs, &xe[k][0]);
+        }
+        for(unsigned i = 0; i < nDofs; i++) {
+          for(unsigned k = 0; k < dim; k++) xNode[k] = xe[k][i];
+          MapCoordinates(xNode);
+          for(unsigned k = 0; k < dim; k++) {
+            x[jel][k][i] = xNode[k];
+            xBatch[(k * nDofs + i) * nElements + jel] = xNode[k];
+          }
+        }
+      }
+
+      std::vector < double > weightBatch(nGauss * nElements);
+      std::vector < double > gradphiBatch(nGauss * nDofs * dim * nElements);
+      fe->JacobianBatch(&xBatch[0], nElements, &weightBatch[0], &gradphiBatch[0]);
+
+      std::vector < double > phi, gradphi;
+      double weight;
+      for(unsigned jel = 0; jel < nElements; jel++) {
+        for(unsigned ig = 0; ig < nGauss; ig++) {
+          fe->Jacobian(x[jel], ig, weight, phi, gradphi);
+
+          maxValue = std::max(maxValue, fabs(weight));
+          maxError = std::max(maxError, fabs(weight - weightBatch[ig * nElements + jel]));
+
+          const double* phiBatch = fe->GetPhi(ig);
+          for(unsigned i = 0; i < nDofs; i++) {
+            maxError = std::max(maxError, fabs(phi[i] - phiBatch[i]));
+            for(unsigned k = 0; k < dim; k++) {
+              double value = gradphi[i * dim + k];
+              maxValue = std::max(maxValue, fabs(value));
+              maxError = std::max(maxError, fabs(value - gradphiBatch[((ig * nDofs + i) * dim + k) * nElements + jel]));
+            }
+          }
+        }
+      }
+    }
+  }
+
+  return (maxValue > 0.) ? maxError / maxValue : 1.;
+}
+
+int main(int argc, char** args) {
+
+  FemusInit mpinit(argc, args, MPI_COMM_WORLD);
+
+  bool passed = true;
+
+  for(unsigned imesh = 0; imesh < 3; imesh++) {
+
+    MultiLevelMesh mlMsh;
+    if(imesh == 0) {
+      mlMsh.GenerateCoarseBoxMesh(8, 0, 0, -0.5, 0.5, 0., 0., 0., 0., EDGE3, "seventh");
+    }
+    else if(imesh == 1) {
+      mlMsh.ReadCoarseMesh("./input/square_mixed.neu", "seventh", 1.);
+    }
+    else {
+      mlMsh.ReadCoarseMesh("./input/cube_all_shapes.neu", "seventh", 1.);
+    }
+    unsigned numberOfUniformLevels = 2;
+    mlMsh.RefineMesh(numberOfUniformLevels, numberOfUniformLevels, NULL);
+    mlMsh.EraseCoarseLevels(numberOfUniformLevels - 1);
+
+    double error = CompareJacobianBatch(mlMsh.GetLevel(0));
+    std::cout << "Dimension " << mlMsh.GetDimension() << ": relative difference between batch and pointwise Jacobian " << error << std::endl;
+
+    if(error > 1.e-12) {
+      passed = false;
+    }
+  }
+
+  if(!passed) {
+    exit(1);
+  }
+
+  return 0;
+}
@@ -0,0 +1,197 @@
+#include "FemusInit.hpp"
+#include "MultiLevelSolution.hpp"
+#include "NumericVector.hpp"
+#include "Marker.hpp"
+#include "Line.hpp"
+#include "ElementSearchGrid.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+using namespace femus;
+
+// Test for the marker search and migration:
+// - Marker::GetElement started from the ElementSearchGrid must find the same element as the search without the grid,
+//   and the element must be among the grid candidates of the process that owns it;
+// - after Line::AdvectionParallel in a constant velocity field, where Runge-Kutta is exact, the markers must be at
+//   x + v T, in the element found by a new search, and each marker must be stored only by the process that owns it
+
+const double velocity[2] = {0.3137, 0.2071};
+
+bool SetBoundaryCondition(const std::vector < double >& x, const char solName[], double& value, const int faceName, const double time) {
+  value = 0.;
+  return false;
+}
+
+double InitialValueU(const std::vector < double >& x) {
+  return velocity[0];
+}
+
+double InitialValueV(const std::vector < double >& x) {
+  return velocity[1];
+}
+
+// the square is [-0.5, 0.5]^2
+bool IsInsideTheDomain(const std::vector < double >& x) {
+  return fabs(x[0]) < 0.5 && fabs(x[1]) < 0.5;
+}
+
+int main(int argc, char** args) {
+
+  FemusInit mpinit(argc, args, MPI_COMM_WORLD);
+
+  MultiLevelMesh mlMsh;
+  mlMsh.ReadCoarseMesh("./input/square_quad.neu", "seventh", 1.);
+  unsigned numberOfUniformLevels = 3;
+  mlMsh.RefineMesh(numberOfUniformLevels, numberOfUniformLevels, NULL);
+  mlMsh.EraseCoarseLevels(numberOfUniformLevels - 1);
+
+  MultiLevelSolution mlSol(&mlMsh);
+  mlSol.AddSolution("U", LAGRANGE, SECOND);
+  mlSol.AddSolution("V", LAGRANGE, SECOND);
+  mlSol.Initialize("U", InitialValueU);
+  mlSol.Initialize("V", InitialValueV);
+  mlSol.AttachSetBoundaryConditionFunction(SetBoundaryCondition);
+  mlSol.GenerateBdc("All");
+
+  const unsigned level = mlMsh.GetNumberOfLevels() - 1u;
+  Solution* sol = mlSol.GetSolutionLevel(level);
+  Mesh* msh = mlMsh.GetLevel(level);
+  const unsigned iproc = msh->processor_id();
+
+  bool passed = true;
+
+  // element search with and without the grid, also for points outside the domain
+  {
+    ElementSearchGrid searchGrid(sol, 0.);
+
+    const unsigned n = 25;
+    unsigned differentElements = 0;
+    unsigned missingCandidates = 0;
+    std::vector < double > x(2);
+    std::vector < unsigned > candidates;
+    for(unsigned i = 0; i < n; i++) {
+      for(unsigned j = 0; j < n; j++) {
+        x[0] = -0.6 + 1.2 * (i + 0.3719) / n;
+        x[1] = -0.6 + 1.2 * (j + 0.5813) / n;
+
+        Marker withGrid(x, 0., VOLUME, sol, 2, false, &searchGrid);
+        Marker withoutGrid(x, 0., VOLUME, sol, 2);
+
+        unsigned elem = withoutGrid.GetMarkerElement();
+        if(withGrid.GetMarkerElement() != elem) differentElements++;
+
+        if(elem != UINT_MAX && elem >= msh->_elementOffset[iproc] && elem < msh->_elementOffset[iproc + 1]) {
+          searchGrid.GetCandidateElements(x, candidates);
+          if(std::find(candidates.begin(), candidates.end(), elem) == candidates.end()) missingCandidates++;
+        }
+      }
+    }
+
+    std::cout << "Element search: " << differentElements << " different elements with the grid, "
+              << missingCandidates << " elements missing from the candidates" << std::endl;
+    if(differentElements != 0 || missingCandidates != 0) passed = false;
+  }
+
+  // advection with migration of the markers across the processes, some markers leave the domain
+  {
+    const unsigned n = 20;
+    std::vector < std::vector < double > > x(n * n, std::vector < double > (2));
+    std::vector < MarkerType > markerType(n * n, VOLUME);
+    std::vector < std::vector < double > > xExact;
+    for(unsigned i = 0; i < n; i++) {
+      for(unsigned j = 0; j < n; j++) {
+        x[i * n + j][0] = -0.5 + (i + 0.3719) / n;
+        x[i * n + j][1] = -0.5 + (j + 0.5813) / n;
+
+        std::vector < double > xEnd(2);
+        xEnd[0] = x[i * n + j][0] + velocity[0];
+        xEnd[1] = x[i * n + j][1] + velocity[1];
+        if(IsInsideTheDomain(xEnd)) xExact.push_back(xEnd);
+      }
+    }
+
+    Line linea(x, markerType, sol, 2);
+    linea.AdvectionParallel(10, 1., 4);
+
+    // each process stores only its markers: the markers inside the domain in its own elements, the others in the process 0
+    std::vector < Marker* > particles = linea.GetParticles();
+    std::vector < unsigned > markerIds = linea.GetMarkerIds();
+    unsigned localWrongOwners = 0;
+    std::vector < double > localMarkers;
+    std::vector < double > xn;
+    for(unsigned iMarker = 0; iMarker < particles.size(); iMarker++) {
+      unsigned elem = particles[iMarker]->GetMarkerElement();
+      bool isOwner = (elem == UINT_MAX) ? (iproc == 0) : (elem >= msh->_elementOffset[iproc] && elem < msh->_elementOffset[iproc + 1]);
+      if(!isOwner) localWrongOwners++;
+
+      xn = particles[iMarker]->GetIprocMarkerCoordinates();
+      localMarkers.push_back(markerIds[iMarker]);
+      localMarkers.push_back(elem);
+      localMarkers.push_back(xn[0]);
+      localMarkers.push_back(xn[1]);
+    }
+
+    unsigned wrongOwners;
+    MPI_Allreduce(&localWrongOwners, &wrongOwners, 1, MPI_UNSIGNED, MPI_SUM, MPI_COMM_WORLD);
+
+    // gather the markers of all the processes, the collective calls below must be done by all the processes
+    const int nprocs = msh->n_processors();
+    int localSize = localMarkers.size();
+    std::vector < int > size(nprocs), offset(nprocs + 1, 0);
+    MPI_Allgather(&localSize, 1, MPI_INT, &size[0], 1, MPI_INT, MPI_COMM_WORLD);
+    for(int jproc = 0; jproc < nprocs; jproc++) {
+      offset[jproc + 1] = offset[jproc] + size[jproc];
+    }
+    std::vector < double > allMarkers(offset[nprocs] + 1);
+    MPI_Allgatherv((localSize > 0) ? &localMarkers[0] : NULL, localSize, MPI_DOUBLE, &allMarkers[0], &size[0], &offset[0], MPI_DOUBLE, MPI_COMM_WORLD);
+
+    std::vector < std::vector < double > > line;
+    linea.GetLine(line);
+
+    const unsigned numberOfMarkers = offset[nprocs] / 4;
+    std::vector < unsigned > copies(n * n, 0);
+    unsigned markersInside = 0;
+    unsigned wrongElements = 0;
+    double maxError = 0.;
+    double maxLineError = 0.;
+    for(unsigned i = 0; i < numberOfMarkers; i++) {
+      unsigned markerId = static_cast < unsigned >(allMarkers[4 * i]);
+      unsigned elem = static_cast < unsigned >(allMarkers[4 * i + 1]);
+      xn.assign(&allMarkers[4 * i + 2], &allMarkers[4 * i + 4]);
+
+      copies[markerId]++;
+      maxLineError = std::max(maxLineError, fabs(line[markerId][0] - xn[0]) + fabs(line[markerId][1] - xn[1]));
+
+      if(elem == UINT_MAX) continue;
+      markersInside++;
+
+      double distance = 1.e10;
+      for(unsigned k = 0; k < xExact.size(); k++) {
+        distance = std::min(distance, sqrt(pow(xn[0] - xExact[k][0], 2) + pow(xn[1] - xExact[k][1], 2)));
+      }
+      maxError = std::max(maxError, distance);
+
+      Marker reference(xn, 0., VOLUME, sol, 2);
+      if(reference.GetMarkerElement() != elem) wrongElements++;
+    }
+    unsigned wrongCopies = (numberOfMarkers != n * n) ? 1 : 0;
+    for(unsigned j = 0; j < n * n; j++) {
+      if(copies[j] != 1) wrongCopies++;
+    }
+
+    std::cout << "Advection: " << markersInside << " markers inside the domain, expected " << xExact.size()
+              << ", largest distance from x + v T " << maxError << ", " << wrongElements << " wrong elements, "
+              << wrongOwners << " markers on the wrong process, " << wrongCopies << " markers not stored exactly once, "
+              << "largest difference from the line " << maxLineError << std::endl;
+
+    if(markersInside != xExact.size() || maxError > 1.e-10 || wrongElements != 0) passed = false;
+    if(wrongOwners != 0 || wrongCopies != 0 || maxLineError != 0.) passed = false;
+  }
+
+  if(!passed) {
+    exit(1);
+  }
+
+  return 0;
+}
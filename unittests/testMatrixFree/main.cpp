@@ -0,0 +1,312 @@
+#include "FemusInit.hpp"
+#include "MultiLevelProblem.hpp"
+#include "NumericVector.hpp"
+#include "SparseMatrix.hpp"
+#include "LinearImplicitSystem.hpp"
+#include "MatrixFreeOperator.hpp"
+#include "ElemType.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+using namespace femus;
+
+// Test for MatrixFreeOperator: the matrix-free Laplace operator must apply as the assembled matrix, and a Poisson
+// problem solved with the matrix-free finest level (no KK there, coarse operators assembled on their levels) must
+// give the solution of the assembled problem
+
+bool SetBoundaryCondition(const std::vector < double >& x, const char solName[], double& value, const int faceName, const double time) {
+  value = 0.;
+  return true;
+}
+
+// y += A x on the element iel, A the Laplace matrix, with the geometric factors of MatrixFreeOperator: the reference
+// gradients at the gauss points and their transpose use the sum factorization on the biquadratic quadrilaterals
+void LaplaceAction(const Mesh* msh, const unsigned &iel, const double* weight, const double* jacobianInverse,
+                   const std::vector < double > &x, std::vector < double > &y) {
+
+  const unsigned dim = msh->GetDimension();
+  short unsigned ielGeom = msh->GetElementType(iel);
+  const elem_type* fe = msh->_finiteElement[ielGeom][2];
+  const unsigned nGauss = fe->GetGaussPointNumber();
+
+  std::vector < double > gradXi(nGauss * dim), fluxXi(nGauss * dim);
+  std::vector < double > gradx(dim);
+
+  fe->GetReferenceGradients(&x[0], &gradXi[0]);
+
+  for(unsigned ig = 0; ig < nGauss; ig++) {
+    const double* JacI = &jacobianInverse[ig * dim * dim];
+
+    for(unsigned k = 0; k < dim; k++) {
+      gradx[k] = 0.;
+      for(unsigned l = 0; l < dim; l++) {
+        gradx[k] += JacI[k * dim + l] * gradXi[ig * dim + l];
+      }
+    }
+
+    // the flux of the Laplace operator is the gradient, mapped back to the reference element
+    for(unsigned l = 0; l < dim; l++) {
+      fluxXi[ig * dim + l] = 0.;
+      for(unsigned k = 0; k < dim; k++) {
+        fluxXi[ig * dim + l] += JacI[k * dim + l] * gradx[k] * weight[ig];
+      }
+    }
+  }
+
+  fe->AddReferenceGradientsTranspose(&fluxXi[0], &y[0]);
+}
+
+// the largest difference between the sum factorized and the tabulated reference gradients of fe, and of their transposes
+double GetSumFactorizationError(const elem_type &fe) {
+
+  const unsigned dim = fe.GetDim();
+  const unsigned nDofs = fe.GetNDofs();
+  const unsigned nGauss = fe.GetGaussPointNumber();
+
+  std::vector < double > x(nDofs), gradXi(nGauss * dim);
+  std::vector < double > fluxXi(nGauss * dim), y(nDofs, 0.), yTabulated(nDofs, 0.);
+  for(unsigned i = 0; i < nDofs; i++) x[i] = sin(1.3 * i + 0.2);
+  for(unsigned j = 0; j < nGauss * dim; j++) fluxXi[j] = cos(0.7 * j);
+
+  fe.GetReferenceGradients(&x[0], &gradXi[0]);
+  fe.AddReferenceGradientsTranspose(&fluxXi[0], &y[0]);
+
+  double error = 0.;
+  for(unsigned ig = 0; ig < nGauss; ig++) {
+    const double* dphi[3] = {fe.GetDPhiDXi(ig), fe.GetDPhiDEta(ig), (dim > 2) ? fe.GetDPhiDZeta(ig) : NULL};
+    for(unsigned l = 0; l < dim; l++) {
+      double value = 0.;
+      for(unsigned i = 0; i < nDofs; i++) {
+        value += dphi[l][i] * x[i];
+        yTabulated[i] += dphi[l][i] * fluxXi[ig * dim + l];
+      }
+      error = std::max(error, fabs(value - gradXi[ig * dim + l]));
+    }
+  }
+  for(unsigned i = 0; i < nDofs; i++) {
+    error = std::max(error, fabs(y[i] - yTabulated[i]));
+  }
+
+  return error;
+}
+
+// -Laplace u = 1, the matrix is assembled only when the system asks for it
+void AssemblePoisson(MultiLevelProblem& ml_prob, const char systemName[], const char solName[]) {
+
+  LinearImplicitSystem* mlPdeSys  = &ml_prob.get_system<LinearImplicitSystem> (systemName);
+  const unsigned level = mlPdeSys->GetLevelToAssemble();
+  const bool assembleMatrix = mlPdeSys->GetAssembleMatrix();
+
+  Mesh*                    msh = ml_prob._ml_msh->GetLevel(level);
+  MultiLevelSolution*    mlSol = ml_prob._ml_sol;
+  Solution*                sol = ml_prob._ml_sol->GetSolutionLevel(level);
+
+  LinearEquationSolver* pdeSys = mlPdeSys->_LinSolver[level];
+  SparseMatrix*             KK = pdeSys->_KK;
+  NumericVector*           RES = pdeSys->_RES;
+
+  const unsigned dim = msh->GetDimension();
+  const unsigned iproc = msh->processor_id();
+
+  unsigned soluIndex = mlSol->GetIndex(solName);
+  unsigned soluType = mlSol->GetSolutionType(soluIndex);
+  unsigned soluPdeIndex = mlPdeSys->GetSolPdeIndex(solName);
+  unsigned xType = 2;
+
+  std::vector < double > solu;
+  std::vector < std::vector < double > > x(dim);
+  std::vector < double > phi, phi_x;
+  std::vector < int > l2GMap;
+  std::vector < double > Res, Jac;
+
+  if(assembleMatrix) KK->zero();
+  RES->zero();
+
+  for(unsigned iel = msh->_elementOffset[iproc]; iel < msh->_elementOffset[iproc + 1]; iel++) {
+
+    short unsigned ielGeom = msh->GetElementType(iel);
+    unsigned nDofu = msh->GetElementDofNumber(iel, soluType);
+    unsigned nDofx = msh->GetElementDofNumber(iel, xType);
+
+    solu.resize(nDofu);
+    l2GMap.resize(nDofu);
+    for(unsigned k = 0; k < dim; k++) {
+      x[k].resize(nDofx);
+    }
+
+    const int *soluLocalDofs = msh->GetElementSolutionLocalDofs(iel, soluType);
+    const unsigned *soluSystemDofs = pdeSys->GetSystemDofs(soluPdeIndex, iel);
+    const int *xLocalDofs = msh->GetElementSolutionLocalDofs(iel, xType);
+
+    sol->_Sol[soluIndex]->get_local(soluLocalDofs, nDofu, &solu[0]);
+    for(unsigned i = 0; i < nDofu; i++) {
+      l2GMap[i] = soluSystemDofs[i];
+    }
+    for(unsigned k = 0; k < dim; k++) {
+      msh->_topology->_Sol[k]->get_local(xLocalDofs, nDofx, &x[k][0]);
+    }
+
+    Res.assign(nDofu, 0.);
+    Jac.assign(nDofu * nDofu, 0.);
+
+    for(unsigned ig = 0; ig < msh->_finiteElement[ielGeom][soluType]->GetGaussPointNumber(); ig++) {
+      double weight;
+      msh->_finiteElement[ielGeom][soluType]->Jacobian(x, ig, weight, phi, phi_x);
+
+      std::vector < double > gradSolu(dim, 0.);
+      for(unsigned i = 0; i < nDofu; i++) {
+        for(unsigned k = 0; k < dim; k++) {
+          gradSolu[k] += phi_x[i * dim + k] * solu[i];
+        }
+      }
+
+      for(unsigned i = 0; i < nDofu; i++) {
+        double laplace = 0.;
+        for(unsigned k = 0; k < dim; k++) {
+          laplace += phi_x[i * dim + k] * gradSolu[k];
+        }
+        Res[i] += (phi[i] - laplace) * weight;
+
+        if(assembleMatrix) {
+          for(unsigned j = 0; j < nDofu; j++) {
+            double laplaceij = 0.;
+            for(unsigned k = 0; k < dim; k++) {
+              laplaceij += phi_x[i * dim + k] * phi_x[j * dim + k];
+            }
+            Jac[i * nDofu + j] += laplaceij * weight;
+          }
+        }
+      }
+    }
+
+    RES->add_vector_blocked(Res, l2GMap);
+    if(assembleMatrix) KK->add_matrix_blocked(Jac, l2GMap, l2GMap);
+  }
+
+  RES->close();
+  if(assembleMatrix) KK->close();
+}
+
+void AssembleAssembled(MultiLevelProblem& ml_prob) {
+  AssemblePoisson(ml_prob, "Assembled", "u");
+}
+
+void AssembleMatrixFree(MultiLevelProblem& ml_prob) {
+  AssemblePoisson(ml_prob, "MatrixFree", "v");
+}
+
+void SetSolverOptions(LinearImplicitSystem& system, const PreconditionerType &preconditioner) {
+  system.SetSolverFineGrids(GMRES);
+  system.SetPreconditionerFineGrids(preconditioner);
+  system.SetTolerances(1.e-12, 1.e-20, 1.e+50, 100, 100);
+  system.SetNumberPreSmoothingStep(2);
+  system.SetNumberPostSmoothingStep(2);
+  system.SetMaxNumberOfLinearIterations(4);
+  system.SetAbsoluteLinearConvergenceTolerance(1.e-14);
+  system.SetMgType(V_CYCLE);
+}
+
+int main(int argc, char** args) {
+
+  FemusInit mpinit(argc, args, MPI_COMM_WORLD);
+
+  MultiLevelMesh mlMsh;
+  mlMsh.ReadCoarseMesh("./input/square_quad.neu", "seventh", 1.);
+  unsigned numberOfUniformLevels = 3;
+  mlMsh.RefineMesh(numberOfUniformLevels, numberOfUniformLevels, NULL);
+
+  MultiLevelSolution mlSol(&mlMsh);
+  mlSol.AddSolution("u", LAGRANGE, SECOND);
+  mlSol.AddSolution("v", LAGRANGE, SECOND);
+  mlSol.Initialize("All");
+  mlSol.AttachSetBoundaryConditionFunction(SetBoundaryCondition);
+  mlSol.GenerateBdc("All");
+
+  MultiLevelProblem mlProb(&mlSol);
+
+  LinearImplicitSystem& systemAssembled = mlProb.add_system < LinearImplicitSystem > ("Assembled");
+  systemAssembled.AddSolutionToSystemPDE("u");
+  systemAssembled.SetAssembleFunction(AssembleAssembled);
+  systemAssembled.SetMgSmoother(GMRES_SMOOTHER);
+  systemAssembled.init();
+  SetSolverOptions(systemAssembled, ILU_PRECOND);
+
+  LinearImplicitSystem& systemMatrixFree = mlProb.add_system < LinearImplicitSystem > ("MatrixFree");
+  systemMatrixFree.AddSolutionToSystemPDE("v");
+  systemMatrixFree.SetAssembleFunction(AssembleMatrixFree);
+  systemMatrixFree.SetMgSmoother(GMRES_SMOOTHER);
+  systemMatrixFree.SetMatrixFreeElementAction(LaplaceAction);
+  systemMatrixFree.init();
+  SetSolverOptions(systemMatrixFree, JACOBI_PRECOND);
+
+  // sum factorization of the biquadratic quadrilateral and hexahedron
+  {
+    elem_type_2D quad("quad", "biquadratic", "fifth");
+    elem_type_3D hex("hex", "biquadratic", "fifth");
+    double quadError = GetSumFactorizationError(quad);
+    double hexError = GetSumFactorizationError(hex);
+
+    std::cout << "Sum factorization: quad " << quad.IsSumFactorized() << " difference " << quadError
+              << ", hex " << hex.IsSumFactorized() << " difference " << hexError << std::endl;
+
+    if(!quad.IsSumFactorized() || !hex.IsSumFactorized() || quadError > 1.e-12 || hexError > 1.e-12) {
+      exit(1);
+    }
+  }
+
+  const unsigned level = mlMsh.GetNumberOfLevels() - 1u;
+
+  if(systemMatrixFree._LinSolver[level]->_KK != NULL || systemMatrixFree._LinSolver[level]->GetMatrixFreeOperator() == NULL) {
+    std::cout << "The matrix-free finest level must have no assembled matrix" << std::endl;
+    exit(1);
+  }
+
+  // the element action applied to a vector as the assembled matrix
+  systemAssembled.SetLevelToAssemble(level);
+  AssembleAssembled(mlProb);
+  LinearEquationSolver* pdeSys = systemAssembled._LinSolver[level];
+  {
+    MatrixFreeOperator matrixFree(pdeSys, LaplaceAction);
+
+    std::unique_ptr < NumericVector > x = pdeSys->_RES->clone();
+    std::unique_ptr < NumericVector > yAssembled = pdeSys->_RES->clone();
+    std::unique_ptr < NumericVector > yMatrixFree = pdeSys->_RES->clone();
+
+    yAssembled->matrix_mult(*x, *pdeSys->_KK);
+    matrixFree.mult(*x, *yMatrixFree);
+
+    double yNorm = yAssembled->linfty_norm();
+    yMatrixFree->add(-1., *yAssembled);
+    double yError = yMatrixFree->linfty_norm();
+
+    std::cout << "Operator apply: assembled norm " << yNorm << ", matrix-free difference " << yError << std::endl;
+
+    if(yNorm == 0. || yError > 1.e-12 * yNorm) {
+      exit(1);
+    }
+  }
+
+  // the same problem solved with the assembled and with the matrix-free finest level
+  systemAssembled.MGsolve();
+  systemMatrixFree.MGsolve();
+
+  unsigned uIndex = mlSol.GetIndex("u");
+  unsigned vIndex = mlSol.GetIndex("v");
+  Solution* sol = mlSol.GetSolutionLevel(level);
+
+  std::unique_ptr < NumericVector > difference = sol->_Sol[vIndex]->clone();
+  difference->add(-1., *sol->_Sol[uIndex]);
+  double uNorm = sol->_Sol[uIndex]->linfty_norm();
+  double error = difference->linfty_norm();
+
+  std::cout << "Solution: assembled norm " << uNorm << ", matrix-free difference " << error << std::endl;
+
+  if(uNorm == 0. || error > 1.e-8 * uNorm) {
+    exit(1);
+  }
+
+  mlProb.clear();
+
+  return 0;
+}
@@ -0,0 +1,128 @@
+#include "FemusInit.hpp"
+#include "Mesh.hpp"
+#include "MeshParMetisPartitioning.hpp"
+
+#include <petscconf.h>
+
+#include <algorithm>
+#include <cmath>
+
+using namespace femus;
+
+// Test for the distributed interface of MeshParMetisPartitioning on a structured grid of n x n quadrilaterals, with the
+// elements and the node coordinates distributed in contiguous blocks: after the partition (parmetis if available,
+// otherwise the blocks in reverse process order) and the redistribution every element must be owned by exactly one
+// process, with its own nodes, and the coordinates of the nodes must be the ones of the grid
+
+const unsigned n = 16;
+
+// the nodes of the quadrilateral iel
+void GetElementNodes(const unsigned &iel, int* nodes) {
+  unsigned i = iel % n;
+  unsigned j = iel / n;
+  nodes[0] = j * (n + 1) + i;
+  nodes[1] = j * (n + 1) + i + 1;
+  nodes[2] = (j + 1) * (n + 1) + i + 1;
+  nodes[3] = (j + 1) * (n + 1) + i;
+}
+
+double GetNodeCoordinate(const unsigned &inode, const unsigned &k) {
+  return (k == 0) ? sin(0.1 * (inode % (n + 1))) : exp(0.1 * (inode / (n + 1)));
+}
+
+int main(int argc, char** args) {
+
+  FemusInit mpinit(argc, args, MPI_COMM_WORLD);
+
+  int iproc, nprocs;
+  MPI_Comm_rank(MPI_COMM_WORLD, &iproc);
+  MPI_Comm_size(MPI_COMM_WORLD, &nprocs);
+
+  const int nelem = n * n;
+  const int nnodes = (n + 1) * (n + 1);
+
+  std::vector < int > elmdist(nprocs + 1), nodedist(nprocs + 1);
+  for(int isdom = 0; isdom <= nprocs; isdom++) {
+    elmdist[isdom] = (nelem * isdom) / nprocs;
+    nodedist[isdom] = (nnodes * isdom) / nprocs;
+  }
+
+  // the local blocks of elements and of node coordinates
+  unsigned nLocalElements = elmdist[iproc + 1] - elmdist[iproc];
+  std::vector < int > eptr(nLocalElements + 1), eind(4 * nLocalElements);
+  for(unsigned i = 0; i < nLocalElements; i++) {
+    eptr[i] = 4 * i;
+    GetElementNodes(elmdist[iproc] + i, &eind[4 * i]);
+  }
+  eptr[nLocalElements] = 4 * nLocalElements;
+
+  std::vector < std::vector < double > > coords(2, std::vector < double > (nodedist[iproc + 1] - nodedist[iproc]));
+  for(int inode = nodedist[iproc]; inode < nodedist[iproc + 1]; inode++) {
+    for(unsigned k = 0; k < 2; k++) {
+      coords[k][inode - nodedist[iproc]] = GetNodeCoordinate(inode, k);
+    }
+  }
+
+  Mesh mesh;
+  MeshParMetisPartitioning partitioning(mesh);
+
+  std::vector < int > part;
+#ifdef PETSC_HAVE_PARMETIS
+  partitioning.DoPartition(elmdist, eptr, eind, 2, part);
+#else
+  part.assign(nLocalElements, nprocs - 1 - iproc);
+#endif
+
+  bool passed = true;
+
+  for(unsigned i = 0; i < part.size(); i++) {
+    if(part[i] < 0 || part[i] >= nprocs) passed = false;
+  }
+
+  std::vector < int > elementIds, ownedEptr, ownedEind;
+  partitioning.RedistributeElements(elmdist, eptr, eind, part, elementIds, ownedEptr, ownedEind);
+
+  std::vector < int > nodeIds;
+  std::vector < std::vector < double > > ownedCoords;
+  partitioning.RedistributeNodes(nodedist, coords, ownedEind, nodeIds, ownedCoords);
+
+  // every element owned once, with its nodes
+  std::vector < int > ownership(nelem, 0), ownershipAll(nelem);
+  unsigned wrongElements = 0;
+  int nodes[4];
+  for(unsigned i = 0; i < elementIds.size(); i++) {
+    ownership[elementIds[i]]++;
+    if(i > 0 && elementIds[i] <= elementIds[i - 1]) wrongElements++;
+    GetElementNodes(elementIds[i], nodes);
+    if(ownedEptr[i + 1] - ownedEptr[i] != 4 || !std::equal(nodes, nodes + 4, &ownedEind[ownedEptr[i]])) wrongElements++;
+  }
+  MPI_Allreduce(&ownership[0], &ownershipAll[0], nelem, MPI_INT, MPI_SUM, MPI_COMM_WORLD);
+  for(int iel = 0; iel < nelem; iel++) {
+    if(ownershipAll[iel] != 1) wrongElements++;
+  }
+
+  // the coordinates of the nodes of the owned elements
+  unsigned wrongNodes = 0;
+  for(unsigned i = 0; i < nodeIds.size(); i++) {
+    if(i > 0 && nodeIds[i] <= nodeIds[i - 1]) wrongNodes++;
+    for(unsigned k = 0; k < 2; k++) {
+      if(ownedCoords[k][i] != GetNodeCoordinate(nodeIds[i], k)) wrongNodes++;
+    }
+  }
+  for(unsigned j = 0; j < ownedEind.size(); j++) {
+    if(!std::binary_search(nodeIds.begin(), nodeIds.end(), ownedEind[j])) wrongNodes++;
+  }
+
+  unsigned wrong[2] = {wrongElements, wrongNodes};
+  unsigned wrongAll[2];
+  MPI_Allreduce(wrong, wrongAll, 2, MPI_UNSIGNED, MPI_SUM, MPI_COMM_WORLD);
+
+  std::cout << "Process " << iproc << ": " << elementIds.size() << " elements and " << nodeIds.size() << " nodes after the redistribution, "
+            << wrongAll[0] << " wrong elements and " << wrongAll[1] << " wrong nodes on all the processes" << std::endl;
+
+  if(!passed || wrongAll[0] != 0 || wrongAll[1] != 0) {
+    exit(1);
+  }
+
+  return 0;
+}
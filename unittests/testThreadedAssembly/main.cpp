@@ -0,0 +1,211 @@
+#include "FemusInit.hpp"
+#include "MultiLevelProblem.hpp"
+#include "NumericVector.hpp"
+#include "SparseMatrix.hpp"
+#include "LinearImplicitSystem.hpp"
+#include "ThreadedElementLoop.hpp"
+#include "adept.h"
+
+using namespace femus;
+
+// Test for ThreadedElementLoop: the residual and the Jacobian of a nonlinear reaction-diffusion problem,
+// assembled with automatic differentiation, must be the same with the serial and with the threaded element loop
+
+bool SetBoundaryCondition(const std::vector < double >& x, const char solName[], double& value, const int faceName, const double time) {
+  value = 0.;
+  return true;
+}
+
+double InitialValueU(const std::vector < double >& x) {
+  return sin(3. * x[0]) * cos(2. * x[1]) + x[0] * x[1];
+}
+
+void AssembleReactionDiffusion(MultiLevelProblem& ml_prob, const bool &threaded) {
+
+  LinearImplicitSystem* mlPdeSys  = &ml_prob.get_system<LinearImplicitSystem> ("ReactionDiffusion");
+  const unsigned level = mlPdeSys->GetLevelToAssemble();
+
+  Mesh*                    msh = ml_prob._ml_msh->GetLevel(level);
+  MultiLevelSolution*    mlSol = ml_prob._ml_sol;
+  Solution*                sol = ml_prob._ml_sol->GetSolutionLevel(level);
+
+  LinearEquationSolver* pdeSys = mlPdeSys->_LinSolver[level];
+  SparseMatrix*             KK = pdeSys->_KK;
+  NumericVector*           RES = pdeSys->_RES;
+
+  const unsigned dim = msh->GetDimension();
+
+  unsigned soluIndex = mlSol->GetIndex("u");
+  unsigned soluType = mlSol->GetSolutionType(soluIndex);
+  unsigned soluPdeIndex = mlPdeSys->GetSolPdeIndex("u");
+  unsigned xType = 2;
+
+  const unsigned nThreads = GetNumberOfAssemblyThreads();
+
+  std::vector < std::vector < double > > soluValue(nThreads);
+  std::vector < std::vector < std::vector < double > > > x(nThreads, std::vector < std::vector < double > > (dim));
+  std::vector < std::vector < double > > phi(nThreads), phi_x(nThreads), phi_xx(nThreads);
+  std::vector < std::vector < int > > l2GMap(nThreads);
+  std::vector < std::vector < double > > Res(nThreads), Jac(nThreads);
+
+  KK->zero();
+  RES->zero();
+
+  auto assembleElement = [&](const unsigned & iel, const unsigned & ithread) {
+
+    adept::Stack& s = FemusInit::GetAdeptStack(ithread);
+
+    short unsigned ielGeom = msh->GetElementType(iel);
+    unsigned nDofu = msh->GetElementDofNumber(iel, soluType);
+    unsigned nDofx = msh->GetElementDofNumber(iel, xType);
+
+    std::vector < adept::adouble > solu(nDofu);
+    std::vector < adept::adouble > aRes(nDofu, 0.);
+
+    soluValue[ithread].resize(nDofu);
+    l2GMap[ithread].resize(nDofu);
+    for(unsigned k = 0; k < dim; k++) {
+      x[ithread][k].resize(nDofx);
+    }
+
+    const int *soluLocalDofs = msh->GetElementSolutionLocalDofs(iel, soluType);
+    const unsigned *soluSystemDofs = pdeSys->GetSystemDofs(soluPdeIndex, iel);
+    const int *xLocalDofs = msh->GetElementSolutionLocalDofs(iel, xType);
+
+    sol->_Sol[soluIndex]->get_local(soluLocalDofs, nDofu, &soluValue[ithread][0]);
+    for(unsigned i = 0; i < nDofu; i++) {
+      solu[i] = soluValue[ithread][i];
+      l2GMap[ithread][i] = soluSystemDofs[i];
+    }
+    for(unsigned k = 0; k < dim; k++) {
+      msh->_topology->_Sol[k]->get_local(xLocalDofs, nDofx, &x[ithread][k][0]);
+    }
+
+    s.new_recording();
+
+    for(unsigned ig = 0; ig < msh->_finiteElement[ielGeom][soluType]->GetGaussPointNumber(); ig++) {
+      double weight;
+      msh->_finiteElement[ielGeom][soluType]->Jacobian(x[ithread], ig, weight, phi[ithread], phi_x[ithread], phi_xx[ithread]);
+
+      adept::adouble solu_gss = 0.;
+      std::vector < adept::adouble > gradSolu_gss(dim, 0.);
+      std::vector < double > x_gss(dim, 0.);
+
+      for(unsigned i = 0; i < nDofu; i++) {
+        solu_gss += phi[ithread][i] * solu[i];
+        for(unsigned k = 0; k < dim; k++) {
+          gradSolu_gss[k] += phi_x[ithread][i * dim + k] * solu[i];
+          x_gss[k] += x[ithread][k][i] * phi[ithread][i];
+        }
+      }
+
+      for(unsigned i = 0; i < nDofu; i++) {
+        adept::adouble laplace = 0.;
+        for(unsigned k = 0; k < dim; k++) {
+          laplace += phi_x[ithread][i * dim + k] * gradSolu_gss[k];
+        }
+        double srcTerm = 1. + x_gss[0] * x_gss[0];
+        aRes[i] += (srcTerm * phi[ithread][i] - laplace - solu_gss * solu_gss * solu_gss * phi[ithread][i]) * weight;
+      }
+    }
+
+    Res[ithread].resize(nDofu);
+    for(unsigned i = 0; i < nDofu; i++) {
+      Res[ithread][i] = - aRes[i].value();
+    }
+    RES->add_vector_blocked(Res[ithread], l2GMap[ithread]);
+
+    s.dependent(&aRes[0], nDofu);
+    s.independent(&solu[0], nDofu);
+    Jac[ithread].resize(nDofu * nDofu);
+    s.jacobian(&Jac[ithread][0], true);
+    KK->add_matrix_blocked(Jac[ithread], l2GMap[ithread], l2GMap[ithread]);
+
+    s.clear_independents();
+    s.clear_dependents();
+  };
+
+  if(threaded) {
+    std::vector < NumericVector* > inputVectors(1, sol->_Sol[soluIndex]);
+    ThreadedElementLoop(msh, inputVectors, assembleElement);
+  }
+  else {
+    unsigned iproc = msh->processor_id();
+    for(unsigned iel = msh->_elementOffset[iproc]; iel < msh->_elementOffset[iproc + 1]; iel++) {
+      assembleElement(iel, 0u);
+    }
+  }
+
+  RES->close();
+  KK->close();
+}
+
+void AssembleSerial(MultiLevelProblem& ml_prob) {
+  AssembleReactionDiffusion(ml_prob, false);
+}
+
+void AssembleThreaded(MultiLevelProblem& ml_prob) {
+  AssembleReactionDiffusion(ml_prob, true);
+}
+
+int main(int argc, char** args) {
+
+  FemusInit mpinit(argc, args, MPI_COMM_WORLD);
+
+  MultiLevelMesh mlMsh;
+  mlMsh.ReadCoarseMesh("./input/square_quad.neu", "seventh", 1.);
+  unsigned numberOfUniformLevels = 4;
+  mlMsh.RefineMesh(numberOfUniformLevels, numberOfUniformLevels, NULL);
+  mlMsh.EraseCoarseLevels(numberOfUniformLevels - 1);
+
+  MultiLevelSolution mlSol(&mlMsh);
+  mlSol.AddSolution("u", LAGRANGE, SECOND);
+  mlSol.Initialize("u", InitialValueU);
+  mlSol.AttachSetBoundaryConditionFunction(SetBoundaryCondition);
+  mlSol.GenerateBdc("u");
+
+  MultiLevelProblem mlProb(&mlSol);
+  LinearImplicitSystem& system = mlProb.add_system < LinearImplicitSystem > ("ReactionDiffusion");
+  system.AddSolutionToSystemPDE("u");
+  system.init();
+
+  const unsigned level = mlMsh.GetNumberOfLevels() - 1u;
+  system.SetLevelToAssemble(level);
+  LinearEquationSolver* pdeSys = system._LinSolver[level];
+
+  std::cout << "Assembly threads: " << GetNumberOfAssemblyThreads() << std::endl;
+
+  // serial reference: residual and Jacobian applied to the residual
+  AssembleSerial(mlProb);
+  std::unique_ptr < NumericVector > resSerial = pdeSys->_RES->clone();
+  std::unique_ptr < NumericVector > jacResSerial = pdeSys->_RES->clone();
+  jacResSerial->matrix_mult(*resSerial, *pdeSys->_KK);
+
+  // threaded assembly, twice to reuse the tapes and the local storage of the threads
+  for(unsigned iteration = 0; iteration < 2; iteration++) {
+    AssembleThreaded(mlProb);
+    std::unique_ptr < NumericVector > jacResThreaded = pdeSys->_RES->clone();
+    jacResThreaded->matrix_mult(*resSerial, *pdeSys->_KK);
+
+    double resNorm = resSerial->linfty_norm();
+    double jacResNorm = jacResSerial->linfty_norm();
+
+    std::unique_ptr < NumericVector > resDifference = pdeSys->_RES->clone();
+    resDifference->add(-1., *resSerial);
+    jacResThreaded->add(-1., *jacResSerial);
+
+    double resError = resDifference->linfty_norm();
+    double jacResError = jacResThreaded->linfty_norm();
+
+    std::cout << "Residual: serial norm " << resNorm << ", threaded difference " << resError << std::endl;
+    std::cout << "Jacobian times residual: serial norm " << jacResNorm << ", threaded difference " << jacResError << std::endl;
+
+    if(resNorm == 0. || resError > 1.e-12 * resNorm || jacResError > 1.e-12 * jacResNorm) {
+      exit(1);
+    }
+  }
+
+  mlProb.clear();
+
+  return 0;
+}
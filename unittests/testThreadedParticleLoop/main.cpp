@@ -0,0 +1,210 @@
+#include "FemusInit.hpp"
+#include "MultiLevelProblem.hpp"
+#include "NumericVector.hpp"
+#include "SparseMatrix.hpp"
+#include "LinearImplicitSystem.hpp"
+#include "Line.hpp"
+#include "ParticleArrays.hpp"
+#include "ThreadedParticleLoop.hpp"
+
+using namespace femus;
+
+// Test for ThreadedParticleLoop: the particle to grid projection of a mass matrix and of a mass-weighted field,
+// with the particles used as integration points as in the MPM assembly, must be the same with the serial loop
+// over the element bins and with the threaded one
+
+bool SetBoundaryCondition(const std::vector < double >& x, const char solName[], double& value, const int faceName, const double time) {
+  value = 0.;
+  return false;
+}
+
+double InitialValueU(const std::vector < double >& x) {
+  return sin(3. * x[0]) * cos(2. * x[1]) + x[0] * x[1];
+}
+
+void ProjectParticlesToGrid(MultiLevelProblem& ml_prob, Line& linea, const bool &threaded) {
+
+  LinearImplicitSystem* mlPdeSys  = &ml_prob.get_system<LinearImplicitSystem> ("Projection");
+  const unsigned level = mlPdeSys->GetLevelToAssemble();
+
+  Mesh*                    msh = ml_prob._ml_msh->GetLevel(level);
+  MultiLevelSolution*    mlSol = ml_prob._ml_sol;
+  Solution*                sol = ml_prob._ml_sol->GetSolutionLevel(level);
+
+  LinearEquationSolver* pdeSys = mlPdeSys->_LinSolver[level];
+  SparseMatrix*             KK = pdeSys->_KK;
+  NumericVector*           RES = pdeSys->_RES;
+
+  const unsigned dim = msh->GetDimension();
+
+  unsigned soluIndex = mlSol->GetIndex("u");
+  unsigned soluType = mlSol->GetSolutionType(soluIndex);
+  unsigned soluPdeIndex = mlPdeSys->GetSolPdeIndex("u");
+  unsigned xType = 2;
+
+  const unsigned nThreads = GetNumberOfAssemblyThreads();
+
+  std::vector < std::vector < double > > soluValue(nThreads);
+  std::vector < std::vector < std::vector < double > > > x(nThreads, std::vector < std::vector < double > > (dim));
+  std::vector < std::vector < double > > xi(nThreads, std::vector < double > (dim));
+  std::vector < std::vector < double > > phi(nThreads), phi_x(nThreads);
+  std::vector < std::vector < int > > l2GMap(nThreads);
+  std::vector < std::vector < double > > Res(nThreads), Jac(nThreads);
+
+  ParticleArrays particles;
+  linea.GetLocalParticles(particles);
+
+  KK->zero();
+  RES->zero();
+
+  auto projectParticleBin = [&](const unsigned & ib, const unsigned & ithread) {
+
+    unsigned iel = particles.GetBinElement(ib);
+    short unsigned ielGeom = msh->GetElementType(iel);
+    unsigned nDofu = msh->GetElementDofNumber(iel, soluType);
+    unsigned nDofx = msh->GetElementDofNumber(iel, xType);
+
+    soluValue[ithread].resize(nDofu);
+    l2GMap[ithread].resize(nDofu);
+    for(unsigned k = 0; k < dim; k++) {
+      x[ithread][k].resize(nDofx);
+    }
+
+    const int *soluLocalDofs = msh->GetElementSolutionLocalDofs(iel, soluType);
+    const unsigned *soluSystemDofs = pdeSys->GetSystemDofs(soluPdeIndex, iel);
+    const int *xLocalDofs = msh->GetElementSolutionLocalDofs(iel, xType);
+
+    sol->_Sol[soluIndex]->get_local(soluLocalDofs, nDofu, &soluValue[ithread][0]);
+    for(unsigned i = 0; i < nDofu; i++) {
+      l2GMap[ithread][i] = soluSystemDofs[i];
+    }
+    for(unsigned k = 0; k < dim; k++) {
+      msh->_topology->_Sol[k]->get_local(xLocalDofs, nDofx, &x[ithread][k][0]);
+    }
+
+    Res[ithread].assign(nDofu, 0.);
+    Jac[ithread].assign(nDofu * nDofu, 0.);
+
+    for(unsigned ip = particles.GetBinBegin(ib); ip < particles.GetBinEnd(ib); ip++) {
+
+      xi[ithread].assign(particles.GetLocalCoordinates(ip), particles.GetLocalCoordinates(ip) + dim);
+
+      double weight;
+      msh->_finiteElement[ielGeom][soluType]->Jacobian(x[ithread], xi[ithread], weight, phi[ithread], phi_x[ithread]);
+
+      double mass = particles.GetMass(ip);
+      double solu_p = 0.;
+      for(unsigned i = 0; i < nDofu; i++) {
+        solu_p += phi[ithread][i] * soluValue[ithread][i];
+      }
+
+      for(unsigned i = 0; i < nDofu; i++) {
+        Res[ithread][i] += mass * phi[ithread][i] * solu_p;
+        for(unsigned j = 0; j < nDofu; j++) {
+          Jac[ithread][i * nDofu + j] += mass * phi[ithread][i] * phi[ithread][j];
+        }
+      }
+    }
+
+    RES->add_vector_blocked(Res[ithread], l2GMap[ithread]);
+    KK->add_matrix_blocked(Jac[ithread], l2GMap[ithread], l2GMap[ithread]);
+  };
+
+  if(threaded) {
+    std::vector < NumericVector* > inputVectors(1, sol->_Sol[soluIndex]);
+    ThreadedParticleLoop(msh, inputVectors, particles, projectParticleBin);
+  }
+  else {
+    for(unsigned ib = 0; ib < particles.GetNumberOfBins(); ib++) {
+      projectParticleBin(ib, 0u);
+    }
+  }
+
+  RES->close();
+  KK->close();
+}
+
+int main(int argc, char** args) {
+
+  FemusInit mpinit(argc, args, MPI_COMM_WORLD);
+
+  MultiLevelMesh mlMsh;
+  mlMsh.ReadCoarseMesh("./input/square_quad.neu", "seventh", 1.);
+  unsigned numberOfUniformLevels = 3;
+  mlMsh.RefineMesh(numberOfUniformLevels, numberOfUniformLevels, NULL);
+  mlMsh.EraseCoarseLevels(numberOfUniformLevels - 1);
+
+  MultiLevelSolution mlSol(&mlMsh);
+  mlSol.AddSolution("u", LAGRANGE, SECOND);
+  mlSol.Initialize("u", InitialValueU);
+  mlSol.AttachSetBoundaryConditionFunction(SetBoundaryCondition);
+  mlSol.GenerateBdc("u");
+
+  MultiLevelProblem mlProb(&mlSol);
+  LinearImplicitSystem& system = mlProb.add_system < LinearImplicitSystem > ("Projection");
+  system.AddSolutionToSystemPDE("u");
+  system.init();
+
+  const unsigned level = mlMsh.GetNumberOfLevels() - 1u;
+  system.SetLevelToAssemble(level);
+  LinearEquationSolver* pdeSys = system._LinSolver[level];
+
+  // particles on a regular grid of the square [-0.5, 0.5]^2, off the element edges
+  const unsigned n = 40;
+  std::vector < std::vector < double > > x(n * n, std::vector < double > (2));
+  std::vector < double > mass(n * n, 1. / (n * n));
+  std::vector < MarkerType > markerType(n * n, VOLUME);
+  for(unsigned i = 0; i < n; i++) {
+    for(unsigned j = 0; j < n; j++) {
+      x[i * n + j][0] = -0.5 + (i + 0.37) / n;
+      x[i * n + j][1] = -0.5 + (j + 0.61) / n;
+    }
+  }
+  Line linea(x, mass, markerType, mlSol.GetSolutionLevel(level), 2);
+
+  std::cout << "Assembly threads: " << GetNumberOfAssemblyThreads() << std::endl;
+
+  // serial reference: projection and projection matrix applied to it
+  ProjectParticlesToGrid(mlProb, linea, false);
+  std::unique_ptr < NumericVector > resSerial = pdeSys->_RES->clone();
+  std::unique_ptr < NumericVector > jacResSerial = pdeSys->_RES->clone();
+  jacResSerial->matrix_mult(*resSerial, *pdeSys->_KK);
+
+  // the mass is projected exactly: the shape functions are a partition of unity
+  std::unique_ptr < NumericVector > ones = pdeSys->_RES->clone();
+  std::unique_ptr < NumericVector > lumpedMass = pdeSys->_RES->clone();
+  *ones = 1.;
+  lumpedMass->matrix_mult(*ones, *pdeSys->_KK);
+  double totalMass = lumpedMass->sum();
+  std::cout << "Projected mass: " << totalMass << std::endl;
+  if(fabs(totalMass - 1.) > 1.e-12) {
+    exit(1);
+  }
+
+  for(unsigned iteration = 0; iteration < 2; iteration++) {
+    ProjectParticlesToGrid(mlProb, linea, true);
+    std::unique_ptr < NumericVector > jacResThreaded = pdeSys->_RES->clone();
+    jacResThreaded->matrix_mult(*resSerial, *pdeSys->_KK);
+
+    double resNorm = resSerial->linfty_norm();
+    double jacResNorm = jacResSerial->linfty_norm();
+
+    std::unique_ptr < NumericVector > resDifference = pdeSys->_RES->clone();
+    resDifference->add(-1., *resSerial);
+    jacResThreaded->add(-1., *jacResSerial);
+
+    double resError = resDifference->linfty_norm();
+    double jacResError = jacResThreaded->linfty_norm();
+
+    std::cout << "Projection: serial norm " << resNorm << ", threaded difference " << resError << std::endl;
+    std::cout << "Projection matrix times projection: serial norm " << jacResNorm << ", threaded difference " << jacResError << std::endl;
+
+    if(resNorm == 0. || resError > 1.e-12 * resNorm || jacResError > 1.e-12 * jacResNorm) {
+      exit(1);
+    }
+  }
+
+  mlProb.clear();
+
+  return 0;
+}